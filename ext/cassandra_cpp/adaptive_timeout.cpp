@@ -0,0 +1,438 @@
+#include "cassandra_cpp.h"
+#include <mutex>
+#include <condition_variable>
+
+// Adaptive request timeouts. While enabled, every execution of a prepared
+// statement gets a request timeout derived from that statement's own network
+// latency histogram (a percentile times a multiplier, clamped to a floor and
+// a ceiling) instead of the cluster-wide one. Idempotent statements also get
+// a speculative delay the same way: when the first execution has not finished
+// by then, a second one is sent and whichever succeeds first is used.
+
+typedef struct {
+    double timeout_percentile;
+    double timeout_multiplier;
+    uint64_t timeout_floor_ns;
+    uint64_t timeout_ceiling_ns;
+    double speculative_percentile;
+    double speculative_multiplier;  // 0 sends no speculative executions
+    uint64_t speculative_floor_ns;
+    uint64_t speculative_ceiling_ns;
+    uint64_t minimum_samples;       // Executions recorded before a statement adapts
+} adaptive_timeout_config_t;
+
+static VALUE rb_mNativeAdaptiveTimeouts;
+
+static std::atomic<bool> adaptive_enabled(false);
+static std::mutex config_lock;
+static adaptive_timeout_config_t current_config;
+static std::atomic<uint64_t> speculative_executions(0);
+static std::atomic<uint64_t> speculative_wins(0);
+
+bool adaptive_timeouts_enabled() {
+    return adaptive_enabled.load(std::memory_order_relaxed);
+}
+
+// A percentile of the histogram scaled and clamped, in nanoseconds
+static uint64_t adaptive_timeout_scaled_ns(const latency_histogram_t* histogram, double percentile, double multiplier,
+                                           uint64_t floor_ns, uint64_t ceiling_ns) {
+    double scaled_ns = (double)latency_histogram_percentile_ns(histogram, percentile) * multiplier;
+    
+    if (scaled_ns < (double)floor_ns) {
+        return floor_ns;
+    }
+    if (scaled_ns > (double)ceiling_ns) {
+        return ceiling_ns;
+    }
+    return (uint64_t)scaled_ns;
+}
+
+// Timeout and speculative delay for the next execution of a statement; both
+// stay 0 while disabled or before the statement has enough samples
+adaptive_timeout_t adaptive_timeout_for(const phase_stats_t* stats) {
+    adaptive_timeout_t adaptive = { 0, 0 };
+    if (!stats || !adaptive_timeouts_enabled()) {
+        return adaptive;
+    }
+    
+    adaptive_timeout_config_t config;
+    {
+        std::lock_guard<std::mutex> guard(config_lock);
+        config = current_config;
+    }
+    
+    const latency_histogram_t* network = &stats->phases[PHASE_NETWORK];
+    if (network->count.load(std::memory_order_relaxed) < config.minimum_samples) {
+        return adaptive;
+    }
+    
+    uint64_t timeout_ns = adaptive_timeout_scaled_ns(network, config.timeout_percentile, config.timeout_multiplier,
+                                                     config.timeout_floor_ns, config.timeout_ceiling_ns);
+    adaptive.timeout_ms = (cass_uint64_t)((timeout_ns + 999999ULL) / 1000000ULL);
+    
+    if (config.speculative_multiplier > 0.0) {
+        uint64_t delay_ns = adaptive_timeout_scaled_ns(network, config.speculative_percentile,
+                                                       config.speculative_multiplier, config.speculative_floor_ns,
+                                                       config.speculative_ceiling_ns);
+        // A delay past the timeout would never fire
+        if (delay_ns < timeout_ns) {
+            adaptive.speculative_delay_us = (cass_uint64_t)(delay_ns / 1000ULL);
+        }
+    }
+    
+    return adaptive;
+}
+
+// Set the statement's request timeout for its next execution and return the
+// values used, see adaptive_timeout_for
+adaptive_timeout_t adaptive_timeout_apply(CassStatement* statement, const phase_stats_t* stats) {
+    adaptive_timeout_t adaptive = adaptive_timeout_for(stats);
+    
+    if (adaptive.timeout_ms > 0) {
+        cass_statement_set_request_timeout(statement, adaptive.timeout_ms);
+    }
+    
+    return adaptive;
+}
+
+// Shared by the waiting thread and the callbacks of both executions; freed
+// by whichever lets go last
+typedef struct {
+    std::mutex lock;
+    std::condition_variable ready;
+    inflight_request_t requests[2];  // The first execution, then the speculative one
+    bool finished[2];
+    int executions;                  // Requests with a callback set
+    CassFuture* winner;              // First success, or the last execution when all fail
+    uint64_t ready_ns;
+    bool interrupted;                // Set by the unblock function, cleared by the waiter
+    bool abandoned;                  // The waiter left; callbacks settle what is still running
+    int references;
+} speculative_wait_t;
+
+static void speculative_wait_release(speculative_wait_t* wait) {
+    bool last;
+    {
+        std::lock_guard<std::mutex> guard(wait->lock);
+        last = --wait->references == 0;
+    }
+    if (last) {
+        delete wait;
+    }
+}
+
+// Report a finished execution nobody returns to its breaker and give back its
+// priority slot. No Ruby calls.
+static void speculative_request_settle(const inflight_request_t* request, CassError rc) {
+    uint64_t latency_ns = monotonic_now_ns() - request->submitted_ns;
+    circuit_breaker_record(request->breaker, rc, latency_ns);
+    priority_gate_exit(request->gate, request->priority, latency_ns);
+}
+
+// Pick the winner once an execution succeeded or all of them finished;
+// called with the lock held
+static void speculative_wait_decide(speculative_wait_t* wait, CassFuture* future, bool succeeded) {
+    int finished = (int)wait->finished[0] + (int)wait->finished[1];
+    if (!wait->winner && (succeeded || finished == wait->executions)) {
+        wait->winner = future;
+        wait->ready_ns = monotonic_now_ns();
+        wait->ready.notify_all();
+    }
+}
+
+// Driver callback, runs on a driver thread (or inline when already ready)
+static void speculative_wait_on_ready(CassFuture* future, void* data) {
+    speculative_wait_t* wait = (speculative_wait_t*)data;
+    CassError rc = cass_future_error_code(future);
+    int index = future == wait->requests[0].future ? 0 : 1;
+    bool settle;
+    
+    {
+        std::lock_guard<std::mutex> guard(wait->lock);
+        wait->finished[index] = true;
+        speculative_wait_decide(wait, future, rc == CASS_OK);
+        settle = wait->abandoned;
+    }
+    
+    if (settle) {
+        speculative_request_settle(&wait->requests[index], rc);
+    }
+    speculative_wait_release(wait);
+}
+
+// Join a request to the wait; false (and nothing changed) when the driver
+// refuses the callback
+static bool speculative_wait_join(speculative_wait_t* wait, const inflight_request_t* request) {
+    {
+        std::lock_guard<std::mutex> guard(wait->lock);
+        wait->requests[wait->executions] = *request;
+        wait->executions++;
+        wait->references++;
+    }
+    
+    if (cass_future_set_callback(request->future, speculative_wait_on_ready, wait) == CASS_OK) {
+        return true;
+    }
+    
+    std::lock_guard<std::mutex> guard(wait->lock);
+    wait->executions--;
+    wait->references--;
+    // The one left may already have failed, waiting on this one
+    if (wait->executions > 0 && wait->finished[0]) {
+        speculative_wait_decide(wait, wait->requests[0].future, false);
+    }
+    return false;
+}
+
+static void* speculative_wait_without_gvl(void* ptr) {
+    speculative_wait_t* wait = (speculative_wait_t*)ptr;
+    std::unique_lock<std::mutex> guard(wait->lock);
+    
+    while (!wait->winner && !wait->interrupted) {
+        wait->ready.wait(guard);
+    }
+    
+    return NULL;
+}
+
+static void speculative_wait_unblock(void* ptr) {
+    speculative_wait_t* wait = (speculative_wait_t*)ptr;
+    std::lock_guard<std::mutex> guard(wait->lock);
+    
+    wait->interrupted = true;
+    wait->ready.notify_all();
+}
+
+static bool speculative_wait_pending(speculative_wait_t* wait) {
+    std::lock_guard<std::mutex> guard(wait->lock);
+    wait->interrupted = false;
+    return !wait->winner;
+}
+
+static VALUE speculative_wait_run(VALUE arg) {
+    speculative_wait_t* wait = (speculative_wait_t*)arg;
+    
+    // An interrupt that does not raise (e.g. a trap handler) resumes the wait
+    while (speculative_wait_pending(wait)) {
+        gvl_release_call(speculative_wait_without_gvl, wait, speculative_wait_unblock, wait);
+        rb_thread_check_ints();
+    }
+    
+    return Qnil;
+}
+
+// Let go of every execution but keep (NULL when an interrupt unwinds the
+// wait): those already finished are settled here, the others by their
+// callbacks, and their futures freed
+static void speculative_wait_leave(speculative_wait_t* wait, CassFuture* keep) {
+    inflight_request_t requests[2];
+    bool settle[2] = { false, false };
+    int executions;
+    
+    {
+        std::lock_guard<std::mutex> guard(wait->lock);
+        wait->abandoned = true;
+        executions = wait->executions;
+        for (int i = 0; i < executions; i++) {
+            requests[i] = wait->requests[i];
+            settle[i] = wait->finished[i] && requests[i].future != keep;
+        }
+    }
+    
+    for (int i = 0; i < executions; i++) {
+        if (settle[i]) {
+            speculative_request_settle(&requests[i], cass_future_error_code(requests[i].future));
+        }
+        if (requests[i].future != keep) {
+            cass_future_free(requests[i].future);
+        }
+    }
+    
+    speculative_wait_release(wait);
+}
+
+// Wait for an execution of statement (request), sending a speculative one
+// when the statement is idempotent and the first is still running after the
+// delay. The speculative execution is admitted to the same breaker and
+// priority gate, and only sent when both let it through without waiting.
+// Returns the future to read, whose outcome the caller still owes to
+// request's breaker and gate; the other execution is settled and freed here.
+// Stamps timing and handles interrupts like wait_for_request.
+CassFuture* adaptive_timeout_wait(CassSession* session, const CassStatement* statement, const inflight_request_t* request,
+                                  const adaptive_timeout_t* adaptive, bool idempotent, request_timing_t* timing) {
+    CassFuture* future = request->future;
+    if (!idempotent || adaptive->speculative_delay_us == 0) {
+        wait_for_request(request, 0, timing);
+        return future;
+    }
+    if (wait_for_request(request, adaptive->speculative_delay_us, timing)) {
+        return future;
+    }
+    
+    speculative_wait_t* wait = new speculative_wait_t();
+    wait->executions = 0;
+    wait->finished[0] = wait->finished[1] = false;
+    wait->winner = NULL;
+    wait->ready_ns = 0;
+    wait->interrupted = false;
+    wait->abandoned = false;
+    wait->references = 1;
+    
+    // Without an admission or a callback on the first execution, it is
+    // simply waited for
+    bool admitted = request_try_admit(request->breaker, request->gate, request->priority);
+    if (!admitted || !speculative_wait_join(wait, request)) {
+        if (admitted) {
+            circuit_breaker_cancel(request->breaker);
+            priority_gate_exit(request->gate, request->priority, 0);
+        }
+        speculative_wait_release(wait);
+        wait_for_request(request, 0, timing);
+        return future;
+    }
+    
+    inflight_request_t speculative = {
+        cass_session_execute(session, statement), request->breaker, request->gate, request->priority, monotonic_now_ns()
+    };
+    speculative_executions.fetch_add(1, std::memory_order_relaxed);
+    if (!speculative_wait_join(wait, &speculative)) {
+        request_release_on_completion(&speculative);
+        cass_future_free(speculative.future);
+    }
+    
+    int state = 0;
+    rb_protect(speculative_wait_run, (VALUE)wait, &state);
+    if (state) {
+        speculative_wait_leave(wait, NULL);
+        rb_jump_tag(state);
+    }
+    
+    CassFuture* winner = wait->winner;
+    timing->ready_ns = wait->ready_ns;
+    timing->resumed_ns = monotonic_now_ns();
+    if (winner == speculative.future) {
+        speculative_wins.fetch_add(1, std::memory_order_relaxed);
+    }
+    speculative_wait_leave(wait, winner);
+    
+    return winner;
+}
+
+static uint64_t adaptive_timeout_ms_to_ns(VALUE ms) {
+    return (uint64_t)(NUM2DBL(ms) * 1000000.0);
+}
+
+static void adaptive_timeout_check_percentile(double percentile, const char* name) {
+    if (percentile <= 0.0 || percentile > 1.0) {
+        rb_raise(rb_eArgError, "%s must be in (0, 1]", name);
+    }
+}
+
+// Ruby method: NativeAdaptiveTimeouts.enable(timeout_percentile, timeout_multiplier, timeout_floor_ms,
+//   timeout_ceiling_ms, speculative_percentile, speculative_multiplier, speculative_floor_ms,
+//   speculative_ceiling_ms, minimum_samples)
+// A nil speculative_multiplier sends no speculative executions
+static VALUE native_adaptive_timeouts_enable(VALUE self, VALUE timeout_percentile, VALUE timeout_multiplier,
+                                             VALUE timeout_floor_ms, VALUE timeout_ceiling_ms,
+                                             VALUE speculative_percentile, VALUE speculative_multiplier,
+                                             VALUE speculative_floor_ms, VALUE speculative_ceiling_ms,
+                                             VALUE minimum_samples) {
+    adaptive_timeout_config_t config;
+    config.timeout_percentile = NUM2DBL(timeout_percentile);
+    config.timeout_multiplier = NUM2DBL(timeout_multiplier);
+    config.timeout_floor_ns = adaptive_timeout_ms_to_ns(timeout_floor_ms);
+    config.timeout_ceiling_ns = adaptive_timeout_ms_to_ns(timeout_ceiling_ms);
+    config.speculative_percentile = NUM2DBL(speculative_percentile);
+    config.speculative_multiplier = NIL_P(speculative_multiplier) ? 0.0 : NUM2DBL(speculative_multiplier);
+    config.speculative_floor_ns = adaptive_timeout_ms_to_ns(speculative_floor_ms);
+    config.speculative_ceiling_ns = adaptive_timeout_ms_to_ns(speculative_ceiling_ms);
+    config.minimum_samples = NUM2ULL(minimum_samples);
+    
+    adaptive_timeout_check_percentile(config.timeout_percentile, "timeout_percentile");
+    adaptive_timeout_check_percentile(config.speculative_percentile, "speculative_percentile");
+    if (config.timeout_multiplier <= 0.0 || config.speculative_multiplier < 0.0) {
+        rb_raise(rb_eArgError, "multipliers must be positive");
+    }
+    if (config.timeout_floor_ns < 1000000ULL || config.timeout_ceiling_ns < config.timeout_floor_ns ||
+        config.speculative_ceiling_ns < config.speculative_floor_ns) {
+        rb_raise(rb_eArgError, "timeout_floor_ms must be at least 1 and ceilings not below their floors");
+    }
+    if (config.minimum_samples < 1) {
+        rb_raise(rb_eArgError, "minimum_samples must be positive");
+    }
+    
+    {
+        std::lock_guard<std::mutex> guard(config_lock);
+        current_config = config;
+    }
+    
+    adaptive_enabled.store(true, std::memory_order_relaxed);
+    return Qnil;
+}
+
+// Ruby method: NativeAdaptiveTimeouts.disable
+static VALUE native_adaptive_timeouts_disable(VALUE self) {
+    adaptive_enabled.store(false, std::memory_order_relaxed);
+    return Qnil;
+}
+
+// Ruby method: NativeAdaptiveTimeouts.enabled?
+static VALUE native_adaptive_timeouts_enabled_p(VALUE self) {
+    return adaptive_timeouts_enabled() ? Qtrue : Qfalse;
+}
+
+// Ruby method: NativeAdaptiveTimeouts.stats -> { speculative_executions:, speculative_wins: }
+static VALUE native_adaptive_timeouts_stats(VALUE self) {
+    VALUE hash = rb_hash_new();
+    rb_hash_aset(hash, ID2SYM(rb_intern("speculative_executions")),
+                 ULL2NUM(speculative_executions.load(std::memory_order_relaxed)));
+    rb_hash_aset(hash, ID2SYM(rb_intern("speculative_wins")),
+                 ULL2NUM(speculative_wins.load(std::memory_order_relaxed)));
+    return hash;
+}
+
+static prepared_statement_wrapper_t* adaptive_timeout_prepared(VALUE self) {
+    prepared_statement_wrapper_t* wrapper;
+    TypedData_Get_Struct(self, prepared_statement_wrapper_t, &prepared_statement_type, wrapper);
+    return wrapper;
+}
+
+// Ruby method: prepared.adaptive_timeouts -> { timeout_ms:, speculative_delay_ms: } or nil
+// What the next execution would use; nil while disabled or still learning
+static VALUE prepared_statement_adaptive_timeouts(VALUE self) {
+    adaptive_timeout_t adaptive = adaptive_timeout_for(adaptive_timeout_prepared(self)->stats);
+    if (adaptive.timeout_ms == 0) {
+        return Qnil;
+    }
+    
+    VALUE hash = rb_hash_new();
+    rb_hash_aset(hash, ID2SYM(rb_intern("timeout_ms")), ULL2NUM(adaptive.timeout_ms));
+    rb_hash_aset(hash, ID2SYM(rb_intern("speculative_delay_ms")),
+                 adaptive.speculative_delay_us ? DBL2NUM((double)adaptive.speculative_delay_us / 1000.0) : Qnil);
+    return hash;
+}
+
+// Ruby method: prepared.idempotent = true
+// Statements bound afterwards are marked idempotent for the driver and may be
+// executed speculatively
+static VALUE prepared_statement_set_idempotent(VALUE self, VALUE idempotent) {
+    adaptive_timeout_prepared(self)->idempotent = RTEST(idempotent);
+    return idempotent;
+}
+
+// Ruby method: prepared.idempotent?
+static VALUE prepared_statement_idempotent_p(VALUE self) {
+    return adaptive_timeout_prepared(self)->idempotent ? Qtrue : Qfalse;
+}
+
+void init_adaptive_timeout() {
+    rb_mNativeAdaptiveTimeouts = rb_define_module_under(rb_cCassandraCpp, "NativeAdaptiveTimeouts");
+    rb_define_module_function(rb_mNativeAdaptiveTimeouts, "enable", (VALUE(*)(...))native_adaptive_timeouts_enable, 9);
+    rb_define_module_function(rb_mNativeAdaptiveTimeouts, "disable", (VALUE(*)(...))native_adaptive_timeouts_disable, 0);
+    rb_define_module_function(rb_mNativeAdaptiveTimeouts, "enabled?", (VALUE(*)(...))native_adaptive_timeouts_enabled_p, 0);
+    rb_define_module_function(rb_mNativeAdaptiveTimeouts, "stats", (VALUE(*)(...))native_adaptive_timeouts_stats, 0);
+    
+    rb_define_method(rb_cPreparedStatement, "adaptive_timeouts", (VALUE(*)(...))prepared_statement_adaptive_timeouts, 0);
+    rb_define_method(rb_cPreparedStatement, "idempotent=", (VALUE(*)(...))prepared_statement_set_idempotent, 1);
+    rb_define_method(rb_cPreparedStatement, "idempotent?", (VALUE(*)(...))prepared_statement_idempotent_p, 0);
+}
\ No newline at end of file
@@ -0,0 +1,418 @@
+#include "cassandra_cpp.h"
+
+typedef enum {
+    AGGREGATE_SUM,
+    AGGREGATE_MIN,
+    AGGREGATE_MAX,
+    AGGREGATE_OP_COUNT
+} aggregate_op_t;
+
+static const char* aggregate_op_names[AGGREGATE_OP_COUNT] = { "sum", "min", "max" };
+
+// One requested aggregate over one column
+typedef struct {
+    aggregate_op_t op;
+    std::string column;
+    size_t index;
+    CassValueType type;
+} aggregate_spec_t;
+
+// Running value of one aggregate; integers and floats are kept apart so
+// bigint sums stay exact. A sum past the int64 range wraps integer and is
+// carried into wraps, so the exact value is integer + wraps * 2^64.
+typedef struct {
+    bool seen;
+    int64_t integer;
+    int64_t wraps;
+    double real;
+} aggregate_slot_t;
+
+typedef struct {
+    uint64_t count;
+    std::vector<aggregate_slot_t> slots;  // Parallel to the specs
+} aggregate_group_t;
+
+// Folding state for one aggregate call. Heap-allocated and released from an
+// ensure handler, since a raise would skip C++ destructors.
+typedef struct {
+    std::vector<std::string> group_columns;
+    std::vector<size_t> group_indexes;
+    std::vector<aggregate_spec_t> specs;
+    bool resolved;
+    std::unordered_map<std::string, size_t> lookup;  // Raw key bytes -> group
+    std::vector<aggregate_group_t> groups;
+    std::string scratch;
+    VALUE group_keys;  // Ruby key per group, decoded once when the group appears
+} aggregate_state_t;
+
+static bool aggregate_type_supported(CassValueType type, aggregate_op_t op) {
+    switch (type) {
+        case CASS_VALUE_TYPE_TINY_INT:
+        case CASS_VALUE_TYPE_SMALL_INT:
+        case CASS_VALUE_TYPE_INT:
+        case CASS_VALUE_TYPE_BIGINT:
+        case CASS_VALUE_TYPE_COUNTER:
+        case CASS_VALUE_TYPE_FLOAT:
+        case CASS_VALUE_TYPE_DOUBLE:
+            return true;
+        case CASS_VALUE_TYPE_TIMESTAMP:
+            return op != AGGREGATE_SUM;
+        default:
+            return false;
+    }
+}
+
+static bool aggregate_type_is_real(CassValueType type) {
+    return type == CASS_VALUE_TYPE_FLOAT || type == CASS_VALUE_TYPE_DOUBLE;
+}
+
+static bool aggregate_find_column(const CassResult* result, const std::string& name, size_t* index) {
+    size_t column_count = cass_result_column_count(result);
+    
+    for (size_t i = 0; i < column_count; i++) {
+        const char* column_name;
+        size_t column_name_length;
+        cass_result_column_name(result, i, &column_name, &column_name_length);
+        
+        if (name.size() == column_name_length && memcmp(name.data(), column_name, column_name_length) == 0) {
+            *index = i;
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+// Map column names to indexes and check types against the first page
+static void aggregate_resolve(aggregate_state_t* state, const CassResult* result) {
+    const char* unknown = NULL;
+    const char* unsupported = NULL;
+    const char* unsupported_op = NULL;
+    
+    state->group_indexes.resize(state->group_columns.size());
+    for (size_t i = 0; i < state->group_columns.size() && !unknown; i++) {
+        if (!aggregate_find_column(result, state->group_columns[i], &state->group_indexes[i])) {
+            unknown = state->group_columns[i].c_str();
+        }
+    }
+    
+    for (size_t i = 0; i < state->specs.size() && !unknown && !unsupported; i++) {
+        aggregate_spec_t& spec = state->specs[i];
+        if (!aggregate_find_column(result, spec.column, &spec.index)) {
+            unknown = spec.column.c_str();
+        } else {
+            spec.type = cass_result_column_type(result, spec.index);
+            if (!aggregate_type_supported(spec.type, spec.op)) {
+                unsupported = spec.column.c_str();
+                unsupported_op = aggregate_op_names[spec.op];
+            }
+        }
+    }
+    
+    if (unknown) {
+        rb_raise(rb_eArgError, "Unknown column: %s", unknown);
+    }
+    if (unsupported) {
+        rb_raise(rb_eArgError, "Cannot compute %s over column %s", unsupported_op, unsupported);
+    }
+    
+    state->resolved = true;
+}
+
+// Read a numeric column; false for nulls, which aggregates skip
+static bool aggregate_read(const CassValue* value, CassValueType type, int64_t* integer, double* real) {
+    if (value == NULL || cass_value_is_null(value)) {
+        return false;
+    }
+    
+    switch (type) {
+        case CASS_VALUE_TYPE_TINY_INT: {
+            cass_int8_t v;
+            cass_value_get_int8(value, &v);
+            *integer = v;
+            return true;
+        }
+        case CASS_VALUE_TYPE_SMALL_INT: {
+            cass_int16_t v;
+            cass_value_get_int16(value, &v);
+            *integer = v;
+            return true;
+        }
+        case CASS_VALUE_TYPE_INT: {
+            cass_int32_t v;
+            cass_value_get_int32(value, &v);
+            *integer = v;
+            return true;
+        }
+        case CASS_VALUE_TYPE_FLOAT: {
+            cass_float_t v;
+            cass_value_get_float(value, &v);
+            *real = v;
+            return true;
+        }
+        case CASS_VALUE_TYPE_DOUBLE: {
+            cass_double_t v;
+            cass_value_get_double(value, &v);
+            *real = v;
+            return true;
+        }
+        default: {
+            cass_int64_t v;
+            cass_value_get_int64(value, &v);
+            *integer = v;
+            return true;
+        }
+    }
+}
+
+static void aggregate_fold(aggregate_slot_t* slot, const aggregate_spec_t& spec, int64_t integer, double real) {
+    bool is_real = aggregate_type_is_real(spec.type);
+    
+    if (!slot->seen) {
+        slot->seen = true;
+        slot->integer = integer;
+        slot->real = real;
+        return;
+    }
+    
+    switch (spec.op) {
+        case AGGREGATE_SUM: {
+            int64_t sum;
+            if (__builtin_add_overflow(slot->integer, integer, &sum)) {
+                // Operands of equal sign overflowed towards that sign
+                slot->wraps += integer < 0 ? -1 : 1;
+            }
+            slot->integer = sum;
+            slot->real += real;
+            break;
+        }
+        case AGGREGATE_MIN:
+            if (is_real ? real < slot->real : integer < slot->integer) {
+                slot->integer = integer;
+                slot->real = real;
+            }
+            break;
+        case AGGREGATE_MAX:
+            if (is_real ? real > slot->real : integer > slot->integer) {
+                slot->integer = integer;
+                slot->real = real;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Group key from the raw bytes of the group columns, each length-prefixed so
+// adjacent values cannot run together; nulls get a distinct marker
+static void aggregate_group_key(aggregate_state_t* state, const CassRow* row) {
+    state->scratch.clear();
+    
+    for (size_t i = 0; i < state->group_indexes.size(); i++) {
+        const CassValue* value = cass_row_get_column(row, state->group_indexes[i]);
+        const cass_byte_t* bytes;
+        size_t size;
+        
+        if (value == NULL || cass_value_is_null(value) || cass_value_get_bytes(value, &bytes, &size) != CASS_OK) {
+            state->scratch.append(1, '\0');
+            continue;
+        }
+        
+        uint32_t length = (uint32_t)size;
+        state->scratch.append(1, '\1');
+        state->scratch.append((const char*)&length, sizeof(length));
+        state->scratch.append((const char*)bytes, size);
+    }
+}
+
+static VALUE aggregate_ruby_key(aggregate_state_t* state, const CassRow* row) {
+    if (state->group_indexes.size() == 1) {
+        return convert_cass_value_to_ruby(cass_row_get_column(row, state->group_indexes[0]));
+    }
+    
+    VALUE key = rb_ary_new_capa((long)state->group_indexes.size());
+    for (size_t i = 0; i < state->group_indexes.size(); i++) {
+        rb_ary_push(key, convert_cass_value_to_ruby(cass_row_get_column(row, state->group_indexes[i])));
+    }
+    return key;
+}
+
+static void aggregate_visit_page(const CassResult* result, CassIterator* rows, void* context) {
+    aggregate_state_t* state = (aggregate_state_t*)context;
+    
+    if (!state->resolved) {
+        aggregate_resolve(state, result);
+    }
+    
+    while (cass_iterator_next(rows)) {
+        const CassRow* row = cass_iterator_get_row(rows);
+        
+        aggregate_group_key(state, row);
+        std::unordered_map<std::string, size_t>::iterator it = state->lookup.find(state->scratch);
+        
+        size_t group_index;
+        if (it == state->lookup.end()) {
+            // Only a group's first row produces Ruby objects
+            group_index = state->groups.size();
+            state->lookup.insert(std::make_pair(state->scratch, group_index));
+            rb_ary_push(state->group_keys, aggregate_ruby_key(state, row));
+            
+            aggregate_group_t group;
+            group.count = 0;
+            aggregate_slot_t empty = { false, 0, 0, 0.0 };
+            group.slots.assign(state->specs.size(), empty);
+            state->groups.push_back(group);
+        } else {
+            group_index = it->second;
+        }
+        
+        aggregate_group_t& group = state->groups[group_index];
+        group.count++;
+        
+        for (size_t i = 0; i < state->specs.size(); i++) {
+            const aggregate_spec_t& spec = state->specs[i];
+            int64_t integer = 0;
+            double real = 0.0;
+            
+            if (aggregate_read(cass_row_get_column(row, spec.index), spec.type, &integer, &real)) {
+                aggregate_fold(&group.slots[i], spec, integer, real);
+            }
+        }
+    }
+}
+
+static VALUE aggregate_slot_to_ruby(const aggregate_slot_t& slot, const aggregate_spec_t& spec) {
+    if (!slot.seen) {
+        return Qnil;
+    }
+    if (aggregate_type_is_real(spec.type)) {
+        return DBL2NUM(slot.real);
+    }
+    if (spec.type == CASS_VALUE_TYPE_TIMESTAMP) {
+        return timestamp_to_ruby(slot.integer);
+    }
+    if (slot.wraps != 0) {
+        // Only sums wrap; the exact total becomes a Bignum
+        VALUE carried = rb_funcall(LL2NUM(slot.wraps), rb_intern("<<"), 1, INT2FIX(64));
+        return rb_funcall(carried, '+', 1, LL2NUM(slot.integer));
+    }
+    return LL2NUM(slot.integer);
+}
+
+// { group_key => { count: n, sum: { column => value }, min: {...}, max: {...} } }
+static VALUE aggregate_to_ruby(aggregate_state_t* state) {
+    VALUE groups = rb_hash_new();
+    
+    for (size_t g = 0; g < state->groups.size(); g++) {
+        const aggregate_group_t& group = state->groups[g];
+        VALUE entry = rb_hash_new();
+        rb_hash_aset(entry, ID2SYM(rb_intern("count")), ULL2NUM(group.count));
+        
+        for (size_t i = 0; i < state->specs.size(); i++) {
+            const aggregate_spec_t& spec = state->specs[i];
+            VALUE op_key = ID2SYM(rb_intern(aggregate_op_names[spec.op]));
+            
+            VALUE values = rb_hash_lookup(entry, op_key);
+            if (NIL_P(values)) {
+                values = rb_hash_new();
+                rb_hash_aset(entry, op_key, values);
+            }
+            rb_hash_aset(values, rb_str_new(spec.column.data(), spec.column.size()),
+                         aggregate_slot_to_ruby(group.slots[i], spec));
+        }
+        
+        rb_hash_aset(groups, RARRAY_AREF(state->group_keys, (long)g), entry);
+    }
+    
+    return groups;
+}
+
+typedef struct {
+    aggregate_state_t* state;
+    const paged_request_t* request;
+} aggregate_call_t;
+
+static VALUE aggregate_run(VALUE arg) {
+    aggregate_call_t* call = (aggregate_call_t*)arg;
+    
+    for_each_result_page(call->request, aggregate_visit_page, call->state);
+    return aggregate_to_ruby(call->state);
+}
+
+static VALUE aggregate_cleanup(VALUE arg) {
+    aggregate_call_t* call = (aggregate_call_t*)arg;
+    
+    delete call->state;
+    return Qnil;
+}
+
+static int aggregate_op_index(VALUE op) {
+    ID op_id = SYM2ID(rb_to_symbol(op));
+    
+    for (int i = 0; i < AGGREGATE_OP_COUNT; i++) {
+        if (rb_intern(aggregate_op_names[i]) == op_id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Check aggregate arguments before any driver or C++ state exists, so a
+// raise here leaks nothing. group_columns is an Array of column names,
+// aggregates an Array of [op, column] pairs with op one of :sum, :min, :max.
+void aggregate_check_arguments(VALUE group_columns, VALUE aggregates) {
+    Check_Type(group_columns, T_ARRAY);
+    Check_Type(aggregates, T_ARRAY);
+    
+    if (RARRAY_LEN(group_columns) == 0) {
+        rb_raise(rb_eArgError, "group_by needs at least one column");
+    }
+    for (long i = 0; i < RARRAY_LEN(group_columns); i++) {
+        Check_Type(RARRAY_AREF(group_columns, i), T_STRING);
+    }
+    
+    for (long i = 0; i < RARRAY_LEN(aggregates); i++) {
+        VALUE pair = RARRAY_AREF(aggregates, i);
+        Check_Type(pair, T_ARRAY);
+        if (RARRAY_LEN(pair) != 2) {
+            rb_raise(rb_eArgError, "aggregates must be [op, column] pairs");
+        }
+        Check_Type(RARRAY_AREF(pair, 1), T_STRING);
+        if (aggregate_op_index(RARRAY_AREF(pair, 0)) < 0) {
+            VALUE op_name = rb_obj_as_string(RARRAY_AREF(pair, 0));
+            rb_raise(rb_eArgError, "Unknown aggregate: %s", StringValueCStr(op_name));
+        }
+    }
+}
+
+// Fold every page of a request into per-group aggregates; arguments must
+// have passed aggregate_check_arguments
+VALUE aggregate_statement_rows(const paged_request_t* request, VALUE group_columns, VALUE aggregates) {
+    aggregate_state_t* state = new aggregate_state_t();
+    state->resolved = false;
+    state->group_keys = rb_ary_new();
+    
+    for (long i = 0; i < RARRAY_LEN(group_columns); i++) {
+        VALUE column = RARRAY_AREF(group_columns, i);
+        state->group_columns.push_back(std::string(RSTRING_PTR(column), RSTRING_LEN(column)));
+    }
+    for (long i = 0; i < RARRAY_LEN(aggregates); i++) {
+        VALUE pair = RARRAY_AREF(aggregates, i);
+        VALUE column = RARRAY_AREF(pair, 1);
+        aggregate_spec_t spec;
+        spec.op = (aggregate_op_t)aggregate_op_index(RARRAY_AREF(pair, 0));
+        spec.column.assign(RSTRING_PTR(column), RSTRING_LEN(column));
+        spec.index = 0;
+        spec.type = CASS_VALUE_TYPE_UNKNOWN;
+        state->specs.push_back(spec);
+    }
+    
+    // The state lives on the C++ heap where the GC cannot see it; keep the
+    // key array reachable from this stack frame instead
+    VALUE group_keys = state->group_keys;
+    aggregate_call_t call = { state, request };
+    VALUE groups = rb_ensure(aggregate_run, (VALUE)&call, aggregate_cleanup, (VALUE)&call);
+    
+    RB_GC_GUARD(group_keys);
+    return groups;
+}
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include "cassandra_cpp.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_MALLOC_USABLE_SIZE
+#include <malloc.h>
+#elif defined(HAVE_MALLOC_SIZE)
+#include <malloc/malloc.h>
+#endif
+#ifdef HAVE_JEMALLOC_JEMALLOC_H
+#include <jemalloc/jemalloc.h>
+#endif
+
+// Driver allocation hooks. When enabled, the driver's buffers, results and
+// prepared metadata are allocated through counting wrappers, so native
+// memory can be told apart from Ruby's. Counting costs a usable-size query
+// and shared atomic updates on every driver allocation, so the hooks are
+// opt-in: CASSANDRA_CPP_ALLOCATOR picks them when the extension loads,
+// since they must be installed before the driver allocates anything:
+//
+//   off                     no hooks, nothing is counted (default)
+//   system                  malloc, counted
+//   jemalloc                jemalloc's mallocx, counted
+//   jemalloc_thread_arenas  as jemalloc, with a private arena for each
+//                           thread that allocates (the driver's IO threads)
+//
+// Sizes are taken from the allocator (usable size), so the counters include
+// its rounding. Without a usable-size query or jemalloc the hooks are not
+// installed.
+
+#define ALLOCATOR_MAX_THREAD_ARENAS 64
+
+typedef enum {
+    ALLOCATOR_NONE,
+    ALLOCATOR_SYSTEM,
+    ALLOCATOR_JEMALLOC
+} allocator_kind_t;
+
+static allocator_kind_t allocator_kind = ALLOCATOR_NONE;
+static bool thread_arenas = false;
+
+static std::atomic<int64_t> live_bytes(0);
+static std::atomic<int64_t> peak_bytes(0);
+static std::atomic<uint64_t> allocations(0);
+static std::atomic<uint64_t> frees(0);
+static std::atomic<unsigned> arenas_created(0);
+
+static void count_allocation(size_t size) {
+    int64_t live = live_bytes.fetch_add((int64_t)size, std::memory_order_relaxed) + (int64_t)size;
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    
+    int64_t peak = peak_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+static void count_free(size_t size) {
+    live_bytes.fetch_sub((int64_t)size, std::memory_order_relaxed);
+    frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+#if defined(HAVE_MALLOC_USABLE_SIZE) || defined(HAVE_MALLOC_SIZE)
+static size_t system_usable_size(void* ptr) {
+#ifdef HAVE_MALLOC_USABLE_SIZE
+    return malloc_usable_size(ptr);
+#else
+    return malloc_size(ptr);
+#endif
+}
+
+static void* system_counting_malloc(size_t size) {
+    void* ptr = malloc(size);
+    if (ptr) {
+        count_allocation(system_usable_size(ptr));
+    }
+    return ptr;
+}
+
+static void* system_counting_realloc(void* ptr, size_t size) {
+    size_t old_size = ptr ? system_usable_size(ptr) : 0;
+    void* resized = realloc(ptr, size);
+    if (resized) {
+        count_free(old_size);
+        count_allocation(system_usable_size(resized));
+    }
+    return resized;
+}
+
+static void system_counting_free(void* ptr) {
+    if (ptr) {
+        count_free(system_usable_size(ptr));
+        free(ptr);
+    }
+}
+#endif
+
+#ifdef HAVE_JEMALLOC_JEMALLOC_H
+// mallocx flags of the calling thread: its own arena once one is created,
+// 0 (jemalloc's automatic arenas) when arenas are off or exhausted
+static int jemalloc_thread_flags() {
+    static thread_local int flags = -1;
+    
+    if (flags < 0) {
+        flags = 0;
+        unsigned arena;
+        size_t arena_size = sizeof(arena);
+        if (thread_arenas &&
+            arenas_created.fetch_add(1, std::memory_order_relaxed) < ALLOCATOR_MAX_THREAD_ARENAS &&
+            mallctl("arenas.create", &arena, &arena_size, NULL, 0) == 0) {
+            flags = MALLOCX_ARENA(arena) | MALLOCX_TCACHE_NONE;
+        }
+    }
+    
+    return flags;
+}
+
+static void* jemalloc_counting_malloc(size_t size) {
+    void* ptr = mallocx(size == 0 ? 1 : size, jemalloc_thread_flags());
+    if (ptr) {
+        count_allocation(sallocx(ptr, 0));
+    }
+    return ptr;
+}
+
+static void* jemalloc_counting_realloc(void* ptr, size_t size) {
+    if (!ptr) {
+        return jemalloc_counting_malloc(size);
+    }
+    
+    size_t old_size = sallocx(ptr, 0);
+    void* resized = rallocx(ptr, size == 0 ? 1 : size, jemalloc_thread_flags());
+    if (resized) {
+        count_free(old_size);
+        count_allocation(sallocx(resized, 0));
+    }
+    return resized;
+}
+
+static void jemalloc_counting_free(void* ptr) {
+    if (ptr) {
+        count_free(sallocx(ptr, 0));
+        // Through the thread cache; jemalloc returns it to its own arena
+        dallocx(ptr, 0);
+    }
+}
+#endif
+
+void install_driver_allocator() {
+    const char* requested = getenv("CASSANDRA_CPP_ALLOCATOR");
+    if (!requested || !*requested || strcmp(requested, "off") == 0) {
+        return;
+    }
+
+#ifdef HAVE_JEMALLOC_JEMALLOC_H
+    if (strcmp(requested, "jemalloc") == 0 || strcmp(requested, "jemalloc_thread_arenas") == 0) {
+        thread_arenas = strcmp(requested, "jemalloc_thread_arenas") == 0;
+        allocator_kind = ALLOCATOR_JEMALLOC;
+        cass_alloc_set_functions(jemalloc_counting_malloc, jemalloc_counting_realloc, jemalloc_counting_free);
+        return;
+    }
+#endif
+
+#if defined(HAVE_MALLOC_USABLE_SIZE) || defined(HAVE_MALLOC_SIZE)
+    // Unknown or unavailable allocators fall back to the counted system one
+    allocator_kind = ALLOCATOR_SYSTEM;
+    cass_alloc_set_functions(system_counting_malloc, system_counting_realloc, system_counting_free);
+#endif
+}
+
+// Ruby method: NativeMetrics.driver_memory
+// -> { allocator:, thread_arenas:, arenas:, live_bytes:, peak_bytes:, allocations:, frees: }
+static VALUE native_metrics_driver_memory(VALUE self) {
+    const char* kind = allocator_kind == ALLOCATOR_JEMALLOC ? "jemalloc" :
+                       allocator_kind == ALLOCATOR_SYSTEM ? "system" : "off";
+    unsigned arenas = arenas_created.load(std::memory_order_relaxed);
+    
+    VALUE memory = rb_hash_new();
+    rb_hash_aset(memory, ID2SYM(rb_intern("allocator")), ID2SYM(rb_intern(kind)));
+    rb_hash_aset(memory, ID2SYM(rb_intern("thread_arenas")), thread_arenas ? Qtrue : Qfalse);
+    rb_hash_aset(memory, ID2SYM(rb_intern("arenas")),
+                 UINT2NUM(arenas < ALLOCATOR_MAX_THREAD_ARENAS ? arenas : ALLOCATOR_MAX_THREAD_ARENAS));
+    rb_hash_aset(memory, ID2SYM(rb_intern("live_bytes")), LL2NUM(live_bytes.load(std::memory_order_relaxed)));
+    rb_hash_aset(memory, ID2SYM(rb_intern("peak_bytes")), LL2NUM(peak_bytes.load(std::memory_order_relaxed)));
+    rb_hash_aset(memory, ID2SYM(rb_intern("allocations")), ULL2NUM(allocations.load(std::memory_order_relaxed)));
+    rb_hash_aset(memory, ID2SYM(rb_intern("frees")), ULL2NUM(frees.load(std::memory_order_relaxed)));
+    
+    return memory;
+}
+
+// Ruby method: NativeMetrics.reset_driver_memory_peak
+// Restart peak tracking from the current live bytes
+static VALUE native_metrics_reset_driver_memory_peak(VALUE self) {
+    peak_bytes.store(live_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    return Qnil;
+}
+
+void init_allocator() {
+    rb_define_module_function(rb_mNativeMetrics, "driver_memory", (VALUE(*)(...))native_metrics_driver_memory, 0);
+    rb_define_module_function(rb_mNativeMetrics, "reset_driver_memory_peak",
+                              (VALUE(*)(...))native_metrics_reset_driver_memory_peak, 0);
+}
\ No newline at end of file
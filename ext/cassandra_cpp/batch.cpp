@@ -19,7 +19,19 @@ const rb_data_type_t batch_type = {
 };
 
 // Batch methods
-static VALUE batch_add_statement(VALUE self, VALUE statement_or_query, VALUE params) {
+
+// Ruby method: batch.add_statement(statement_or_query, params, key_indexes = nil, key_types = nil)
+// key_indexes (Array of params forming the partition key) with key_types
+// (their CQL types, see routing_key_encode) routes a query string entry; the
+// driver routes the batch by its first entry with a routing key, which bound
+// prepared statements usually carry.
+static VALUE batch_add_statement_body(int argc, VALUE* argv, VALUE self) {
+    VALUE statement_or_query, params, key_indexes, key_types;
+    rb_scan_args(argc, argv, "22", &statement_or_query, &params, &key_indexes, &key_types);
+    if (!NIL_P(key_indexes)) {
+        Check_Type(key_indexes, T_ARRAY);
+    }
+    
     batch_wrapper_t* batch_wrapper;
     TypedData_Get_Struct(self, batch_wrapper_t, &batch_type, batch_wrapper);
     
@@ -35,19 +47,33 @@ static VALUE batch_add_statement(VALUE self, VALUE statement_or_query, VALUE par
             param_count = RARRAY_LEN(params);
         }
         
+        std::vector<bool> routing(param_count, false);
+        for (long i = 0; !NIL_P(key_indexes) && i < RARRAY_LEN(key_indexes); i++) {
+            size_t key_index = NUM2SIZET(RARRAY_AREF(key_indexes, i));
+            if (key_index >= param_count) {
+                rb_raise(rb_eArgError, "Routing key index %zu is not one of the %zu parameters", key_index, param_count);
+            }
+            routing[key_index] = true;
+        }
+        VALUE key_bytes = NIL_P(key_indexes) ? Qnil : routing_key_encode(params, key_indexes, key_types);
+        
         CassStatement* statement = cass_statement_new(query, param_count);
         
-        // Bind parameters if provided
-        if (param_count > 0) {
-            for (size_t i = 0; i < param_count; i++) {
-                VALUE param = rb_ary_entry(params, i);
-                rc = bind_ruby_value_to_statement(statement, i, param);
-                if (rc != CASS_OK) {
-                    cass_statement_free(statement);
-                    rb_raise(rb_eCassandraError, "Failed to bind parameter at index %zu: %s", i, cass_error_desc(rc));
-                }
+        // Bind parameters if provided; key params are bound at their column types
+        for (size_t i = 0; i < param_count; i++) {
+            if (routing[i]) {
+                continue;
+            }
+            VALUE param = rb_ary_entry(params, i);
+            rc = bind_ruby_value_to_statement(statement, i, param);
+            if (rc != CASS_OK) {
+                cass_statement_free(statement);
+                rb_raise(rb_eCassandraError, "Failed to bind parameter at index %zu: %s", i, cass_error_desc(rc));
             }
         }
+        if (!NIL_P(key_indexes)) {
+            routing_key_bind(statement, key_indexes, key_bytes);
+        }
         
         rc = cass_batch_add_statement(batch_wrapper->batch, statement);
         cass_statement_free(statement); // Batch takes ownership, safe to free
@@ -62,11 +88,16 @@ static VALUE batch_add_statement(VALUE self, VALUE statement_or_query, VALUE par
     if (rc != CASS_OK) {
         rb_raise(rb_eCassandraError, "Failed to add statement to batch: %s", cass_error_desc(rc));
     }
+    batch_wrapper->statement_count++;
     
     return self;
 }
 
-static VALUE batch_execute(VALUE self) {
+static VALUE batch_add_statement(int argc, VALUE* argv, VALUE self) {
+    return gvl_span_call(GVL_ENTRY_BATCH_ADD, batch_add_statement_body, argc, argv, self);
+}
+
+static VALUE batch_execute_body(int argc, VALUE* argv, VALUE self) {
     batch_wrapper_t* batch_wrapper;
     TypedData_Get_Struct(self, batch_wrapper_t, &batch_type, batch_wrapper);
     
@@ -75,47 +106,39 @@ static VALUE batch_execute(VALUE self) {
     session_wrapper_t* session_wrapper;
     TypedData_Get_Struct(session, session_wrapper_t, &session_type, session_wrapper);
     
+    request_timing_t timing = { monotonic_now_ns(), 0, 0, 0, 0, 0 };
+    
+    priority_class_t priority = priority_current();
+    priority_gate_enter(session_wrapper->gate, priority);
+    
     // Execute batch
     CassFuture* future = cass_session_execute_batch(session_wrapper->session, batch_wrapper->batch);
+    timing.submitted_ns = monotonic_now_ns();
     
-    // Wait for result
+    // Wait for result without holding the GVL
+    inflight_request_t request = { future, NULL, session_wrapper->gate, priority, timing.submitted_ns };
+    wait_for_request(&request, 0, &timing);
     CassError rc = cass_future_error_code(future);
+    CASSANDRA_CPP_PROBE3(batch__execute, batch_wrapper->statement_count, timing.ready_ns - timing.submitted_ns, (int)rc);
+    priority_gate_exit(session_wrapper->gate, priority, timing.ready_ns - timing.submitted_ns);
     if (rc != CASS_OK) {
         raise_cassandra_error(future, "batch execution");
     }
     
     // Get result (batch operations typically don't return data, but we'll handle it)
     const CassResult* result = cass_future_get_result(future);
-    VALUE rows = rb_ary_new(); // Empty array for batch results
-    
+    VALUE rows = convert_result_to_ruby(result, 0);
     if (result) {
-        // Convert result to Ruby array (reuse from session.cpp)
-        CassIterator* iterator = cass_iterator_from_result(result);
-        
-        while (cass_iterator_next(iterator)) {
-            const CassRow* row = cass_iterator_get_row(iterator);
-            size_t column_count = cass_result_column_count(result);
-            
-            VALUE row_hash = rb_hash_new();
-            
-            for (size_t i = 0; i < column_count; i++) {
-                const char* column_name;
-                size_t column_name_length;
-                cass_result_column_name(result, i, &column_name, &column_name_length);
-                
-                const CassValue* value = cass_row_get_column(row, i);
-                VALUE ruby_value = convert_cass_value_to_ruby(value);
-                
-                VALUE column_key = rb_str_new(column_name, column_name_length);
-                rb_hash_aset(row_hash, column_key, ruby_value);
-            }
-            
-            rb_ary_push(rows, row_hash);
-        }
-        
-        cass_iterator_free(iterator);
         cass_result_free(result);
     }
+    timing.decoded_ns = monotonic_now_ns();
+    record_request_timing(NULL, &timing);
+    
+    execution_info_t info;
+    execution_info_init(&info);
+    info.timing = timing;
+    execution_info_capture(&info, future, session);
+    execution_info_attach(rows, &info);
     
     // Cleanup
     cass_future_free(future);
@@ -123,6 +146,33 @@ static VALUE batch_execute(VALUE self) {
     return rows;
 }
 
+static VALUE batch_execute(VALUE self) {
+    return gvl_span_call(GVL_ENTRY_BATCH_EXECUTE, batch_execute_body, 0, NULL, self);
+}
+
+// Ruby method: batch.tracing = true, to read the request's trace afterwards
+static VALUE batch_set_tracing(VALUE self, VALUE enabled) {
+    batch_wrapper_t* batch_wrapper;
+    TypedData_Get_Struct(self, batch_wrapper_t, &batch_type, batch_wrapper);
+    
+    cass_batch_set_tracing(batch_wrapper->batch, RTEST(enabled) ? cass_true : cass_false);
+    return enabled;
+}
+
+// Ruby method: batch.keyspace = "app", the keyspace whose replicas the
+// batch's routing key is looked up in
+static VALUE batch_set_keyspace(VALUE self, VALUE keyspace) {
+    batch_wrapper_t* batch_wrapper;
+    TypedData_Get_Struct(self, batch_wrapper_t, &batch_type, batch_wrapper);
+    
+    CassError rc = cass_batch_set_keyspace(batch_wrapper->batch, StringValueCStr(keyspace));
+    if (rc != CASS_OK) {
+        rb_raise(rb_eCassandraError, "Failed to set batch keyspace: %s", cass_error_desc(rc));
+    }
+    
+    return keyspace;
+}
+
 static VALUE batch_set_consistency(VALUE self, VALUE consistency) {
     batch_wrapper_t* batch_wrapper;
     TypedData_Get_Struct(self, batch_wrapper_t, &batch_type, batch_wrapper);
@@ -140,7 +190,9 @@ static VALUE batch_set_consistency(VALUE self, VALUE consistency) {
 void init_batch() {
     rb_cBatch = rb_define_class_under(rb_cCassandraCpp, "NativeBatch", rb_cObject);
     rb_undef_alloc_func(rb_cBatch);
-    rb_define_method(rb_cBatch, "add_statement", (VALUE(*)(...))batch_add_statement, 2);
+    rb_define_method(rb_cBatch, "add_statement", (VALUE(*)(...))batch_add_statement, -1);
     rb_define_method(rb_cBatch, "execute", (VALUE(*)(...))batch_execute, 0);
     rb_define_method(rb_cBatch, "consistency=", (VALUE(*)(...))batch_set_consistency, 1);
+    rb_define_method(rb_cBatch, "tracing=", (VALUE(*)(...))batch_set_tracing, 1);
+    rb_define_method(rb_cBatch, "keyspace=", (VALUE(*)(...))batch_set_keyspace, 1);
 }
\ No newline at end of file
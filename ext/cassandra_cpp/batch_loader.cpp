@@ -0,0 +1,118 @@
+#include "cassandra_cpp.h"
+
+// Point reads for BatchLoader: one bound statement per key, all handed to
+// the driver before the first result is awaited. Each statement carries its
+// partition key, so the driver's token-aware policy sends it straight to a
+// replica, and a set of keys costs about one round trip instead of one per key.
+
+typedef struct {
+    VALUE keys;
+    VALUE output;
+    const CassPrepared* prepared;
+    prepared_statement_wrapper_t* prepared_wrapper;  // Its hot partitions, read after each wait
+    request_window_t* window;
+    const CassResult* result;  // Being converted, freed by the cleanup on a raise
+} key_load_t;
+
+// Bind one key, an Array of values in parameter order
+static CassStatement* key_load_statement(const CassPrepared* prepared, VALUE key, long position) {
+    Check_Type(key, T_ARRAY);
+    CassStatement* statement = cass_prepared_bind(prepared);
+    
+    for (long index = 0; index < RARRAY_LEN(key); index++) {
+        CassError rc = bind_ruby_value_to_statement(statement, (size_t)index, RARRAY_AREF(key, index));
+        if (rc != CASS_OK) {
+            cass_statement_free(statement);
+            rb_raise(rb_eCassandraError, "Failed to bind key %ld, parameter %ld: %s",
+                     position, index, cass_error_desc(rc));
+        }
+    }
+    
+    return statement;
+}
+
+// Partition key among a key's bind values, nil unless partitions are tracked
+static VALUE key_load_partition_key(const hot_partitions_t* hot, VALUE key) {
+    VALUE partition_key = Qnil;
+    for (long index = 0; hot && index < RARRAY_LEN(key); index++) {
+        partition_key = hot_partitions_bind(hot, partition_key, (size_t)index, RARRAY_AREF(key, index));
+    }
+    return partition_key;
+}
+
+// Wait for the oldest read and append its rows
+static void key_load_collect(key_load_t* load) {
+    load->result = request_window_next(load->window);
+    VALUE key = rb_ary_entry(load->keys, RARRAY_LEN(load->output));
+    hot_partitions_t* hot = load->prepared_wrapper->hot;
+    hot_partitions_record(hot, key_load_partition_key(hot, key), load->result);
+    rb_ary_push(load->output, convert_result_to_ruby(load->result, load->window->query_id));
+    cass_result_free(load->result);
+    load->result = NULL;
+}
+
+static VALUE key_load_run(VALUE arg) {
+    key_load_t* load = (key_load_t*)arg;
+    
+    for (long position = 0; position < RARRAY_LEN(load->keys); position++) {
+        if (request_window_full(load->window)) {
+            key_load_collect(load);
+        }
+        
+        uint64_t started_ns = monotonic_now_ns();
+        CassStatement* statement = key_load_statement(load->prepared, rb_ary_entry(load->keys, position), position);
+        request_window_submit(load->window, statement, started_ns);
+    }
+    
+    while (!request_window_empty(load->window)) {
+        key_load_collect(load);
+    }
+    
+    return load->output;
+}
+
+static VALUE key_load_cleanup(VALUE arg) {
+    key_load_t* load = (key_load_t*)arg;
+    
+    if (load->result) {
+        cass_result_free(load->result);
+    }
+    request_window_free(load->window);
+    
+    return Qnil;
+}
+
+// Ruby method: prepared.load_keys(keys, concurrency)
+// Executes the statement once per key (an Array of bind values), with up to
+// concurrency reads in flight, and returns the rows of each read (Arrays of
+// row hashes) in key order. The first failed read raises; reads still in flight are dropped.
+static VALUE prepared_statement_load_keys(VALUE self, VALUE keys, VALUE concurrency) {
+    Check_Type(keys, T_ARRAY);
+    size_t capacity = window_capacity_from_ruby(concurrency);
+    
+    prepared_statement_wrapper_t* prepared_wrapper;
+    TypedData_Get_Struct(self, prepared_statement_wrapper_t, &prepared_statement_type, prepared_wrapper);
+    
+    session_wrapper_t* session_wrapper;
+    TypedData_Get_Struct(rb_iv_get(self, "@session"), session_wrapper_t, &session_type, session_wrapper);
+    
+    circuit_breaker_t* breaker = circuit_breaker_for_prepared(self, prepared_wrapper);
+    
+    key_load_t load;
+    load.keys = keys;
+    load.output = rb_ary_new_capa(RARRAY_LEN(keys));
+    load.prepared = prepared_wrapper->prepared;
+    load.prepared_wrapper = prepared_wrapper;
+    load.result = NULL;
+    load.window = request_window_new(session_wrapper->session, capacity, prepared_wrapper->stats, "batch load");
+    load.window->breaker = breaker;
+    load.window->gate = session_wrapper->gate;
+    load.window->priority = priority_current();
+    load.window->query_id = prepared_wrapper->query_id;
+    
+    return rb_ensure(key_load_run, (VALUE)&load, key_load_cleanup, (VALUE)&load);
+}
+
+void init_batch_loader() {
+    rb_define_method(rb_cPreparedStatement, "load_keys", (VALUE(*)(...))prepared_statement_load_keys, 2);
+}
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "cassandra_cpp.h"
+#include <math.h>
+
+// Bloom filter over keys, hashed from their ordered encoding
+// (ordered_key_string): :a and "a" hash alike, 1 and "1" do not, so
+// KeyFilter converts keys to the key column's CQL type before they get here.
+// Only used with the GVL held, so the bits need no synchronization.
+
+#define BLOOM_MAX_HASHES 30
+
+typedef struct {
+    uint64_t* words;
+    size_t word_count;
+    uint32_t hashes;
+    uint64_t inserted;
+} bloom_filter_t;
+
+static VALUE rb_cNativeBloomFilter;
+
+static void bloom_filter_free(void* ptr) {
+    bloom_filter_t* filter = (bloom_filter_t*)ptr;
+    if (filter) {
+        xfree(filter->words);
+        xfree(filter);
+    }
+}
+
+static size_t bloom_filter_memsize(const void* ptr) {
+    const bloom_filter_t* filter = (const bloom_filter_t*)ptr;
+    return sizeof(bloom_filter_t) + filter->word_count * sizeof(uint64_t);
+}
+
+static const rb_data_type_t bloom_filter_type = {
+    "CassandraCpp::NativeBloomFilter",
+    { 0, bloom_filter_free, bloom_filter_memsize },
+    0, 0,
+    RUBY_TYPED_FREE_IMMEDIATELY
+};
+
+static uint64_t bloom_mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// Two independent 64-bit hashes of the key; probe i uses h1 + i * h2
+static void bloom_hash(VALUE key, uint64_t* h1, uint64_t* h2) {
+    VALUE encoded = ordered_key_string(key);
+    uint64_t hash = fnv1a_64(RSTRING_PTR(encoded), (size_t)RSTRING_LEN(encoded));
+    
+    *h1 = bloom_mix(hash);
+    *h2 = bloom_mix(hash ^ 0x9e3779b97f4a7c15ULL) | 1;
+}
+
+static void bloom_filter_insert(bloom_filter_t* filter, VALUE key) {
+    uint64_t h1, h2;
+    bloom_hash(key, &h1, &h2);
+    
+    uint64_t bits = (uint64_t)filter->word_count * 64;
+    for (uint32_t i = 0; i < filter->hashes; i++) {
+        uint64_t bit = (h1 + i * h2) % bits;
+        filter->words[bit / 64] |= 1ULL << (bit % 64);
+    }
+    filter->inserted++;
+}
+
+static bloom_filter_t* bloom_filter_get(VALUE self) {
+    bloom_filter_t* filter;
+    TypedData_Get_Struct(self, bloom_filter_t, &bloom_filter_type, filter);
+    return filter;
+}
+
+// Ruby method: CassandraCpp::NativeBloomFilter.new(expected_keys, false_positive_rate)
+// Sized so that false_positive_rate holds once expected_keys keys are added
+static VALUE bloom_filter_new(VALUE klass, VALUE expected_keys, VALUE false_positive_rate) {
+    long expected = NUM2LONG(expected_keys);
+    double rate = NUM2DBL(false_positive_rate);
+    
+    if (expected < 1) {
+        rb_raise(rb_eArgError, "expected_keys must be at least 1");
+    }
+    if (!(rate > 0.0 && rate < 1.0)) {
+        rb_raise(rb_eArgError, "false_positive_rate must be in (0, 1)");
+    }
+    
+    // m = -n ln p / (ln 2)^2 bits and k = m / n ln 2 hashes
+    double bits = ceil(-(double)expected * log(rate) / (M_LN2 * M_LN2));
+    double words = ceil(bits / 64.0);
+    if (words * 8.0 > (double)(SIZE_MAX / 2)) {
+        rb_raise(rb_eArgError, "Bloom filter for %ld keys is too large", expected);
+    }
+    long hashes = lround(words * 64.0 / (double)expected * M_LN2);
+    
+    bloom_filter_t* filter = ALLOC(bloom_filter_t);
+    filter->word_count = words < 1.0 ? 1 : (size_t)words;
+    filter->hashes = (uint32_t)(hashes < 1 ? 1 : (hashes > BLOOM_MAX_HASHES ? BLOOM_MAX_HASHES : hashes));
+    filter->inserted = 0;
+    filter->words = NULL;
+    
+    VALUE obj = TypedData_Wrap_Struct(klass, &bloom_filter_type, filter);
+    filter->words = ALLOC_N(uint64_t, filter->word_count);
+    memset(filter->words, 0, filter->word_count * sizeof(uint64_t));
+    
+    return obj;
+}
+
+static VALUE bloom_filter_add(VALUE self, VALUE key) {
+    bloom_filter_insert(bloom_filter_get(self), key);
+    return self;
+}
+
+static VALUE bloom_filter_add_all(VALUE self, VALUE keys) {
+    bloom_filter_t* filter = bloom_filter_get(self);
+    Check_Type(keys, T_ARRAY);
+    
+    for (long i = 0; i < RARRAY_LEN(keys); i++) {
+        bloom_filter_insert(filter, RARRAY_AREF(keys, i));
+    }
+    
+    return self;
+}
+
+// Ruby method: filter.include?(key) -> false only if key was never added
+static VALUE bloom_filter_include_p(VALUE self, VALUE key) {
+    bloom_filter_t* filter = bloom_filter_get(self);
+    uint64_t h1, h2;
+    bloom_hash(key, &h1, &h2);
+    
+    uint64_t bits = (uint64_t)filter->word_count * 64;
+    for (uint32_t i = 0; i < filter->hashes; i++) {
+        uint64_t bit = (h1 + i * h2) % bits;
+        if (!(filter->words[bit / 64] & (1ULL << (bit % 64)))) {
+            return Qfalse;
+        }
+    }
+    
+    return Qtrue;
+}
+
+// Ruby method: filter.stats -> { keys:, bits:, hashes:, fill_ratio:, false_positive_rate: }
+// false_positive_rate is estimated from the share of bits set
+static VALUE bloom_filter_stats(VALUE self) {
+    bloom_filter_t* filter = bloom_filter_get(self);
+    
+    uint64_t set = 0;
+    for (size_t i = 0; i < filter->word_count; i++) {
+        set += (uint64_t)__builtin_popcountll(filter->words[i]);
+    }
+    double fill = (double)set / (double)(filter->word_count * 64);
+    
+    VALUE stats = rb_hash_new();
+    rb_hash_aset(stats, ID2SYM(rb_intern("keys")), ULL2NUM(filter->inserted));
+    rb_hash_aset(stats, ID2SYM(rb_intern("bits")), ULL2NUM((uint64_t)filter->word_count * 64));
+    rb_hash_aset(stats, ID2SYM(rb_intern("hashes")), UINT2NUM(filter->hashes));
+    rb_hash_aset(stats, ID2SYM(rb_intern("fill_ratio")), DBL2NUM(fill));
+    rb_hash_aset(stats, ID2SYM(rb_intern("false_positive_rate")), DBL2NUM(pow(fill, (double)filter->hashes)));
+    
+    return stats;
+}
+
+void init_bloom_filter() {
+    rb_cNativeBloomFilter = rb_define_class_under(rb_cCassandraCpp, "NativeBloomFilter", rb_cObject);
+    rb_undef_alloc_func(rb_cNativeBloomFilter);
+    
+    rb_define_singleton_method(rb_cNativeBloomFilter, "new", (VALUE(*)(...))bloom_filter_new, 2);
+    rb_define_method(rb_cNativeBloomFilter, "add", (VALUE(*)(...))bloom_filter_add, 1);
+    rb_define_method(rb_cNativeBloomFilter, "add_all", (VALUE(*)(...))bloom_filter_add_all, 1);
+    rb_define_method(rb_cNativeBloomFilter, "include?", (VALUE(*)(...))bloom_filter_include_p, 1);
+    rb_define_method(rb_cNativeBloomFilter, "stats", (VALUE(*)(...))bloom_filter_stats, 0);
+}
\ No newline at end of file
@@ -2,6 +2,9 @@
 
 // Module initialization
 extern "C" void Init_cassandra_cpp() {
+    // Count driver memory from its first allocation
+    install_driver_allocator();
+    
     // Main module
     rb_cCassandraCpp = rb_define_module("CassandraCpp");
     
@@ -15,6 +18,24 @@ extern "C" void Init_cassandra_cpp() {
     init_statement();
     init_batch();
     init_future();
+    init_result();
+    init_metrics();
+    init_recorder();
+    init_large_object();
+    init_column_writer();
+    init_circuit_breaker();
+    init_priority();
+    init_snapshot();
+    init_bloom_filter();
+    init_vector();
+    init_allocator();
+    init_copy();
+    init_sstable_writer();
+    init_sstable_reader();
+    init_execution_info();
+    init_batch_loader();
+    init_hot_partitions();
+    init_adaptive_timeout();
     
     // Constants for consistency levels
     rb_define_const(rb_cCassandraCpp, "CONSISTENCY_ANY", INT2NUM(CASS_CONSISTENCY_ANY));
@@ -33,4 +54,11 @@ extern "C" void Init_cassandra_cpp() {
     rb_define_const(rb_cCassandraCpp, "BATCH_TYPE_LOGGED", INT2NUM(CASS_BATCH_TYPE_LOGGED));
     rb_define_const(rb_cCassandraCpp, "BATCH_TYPE_UNLOGGED", INT2NUM(CASS_BATCH_TYPE_UNLOGGED));
     rb_define_const(rb_cCassandraCpp, "BATCH_TYPE_COUNTER", INT2NUM(CASS_BATCH_TYPE_COUNTER));
+    
+    // Whether the USDT probes of probes.cpp were compiled in
+#ifdef HAVE_SYS_SDT_H
+    rb_define_const(rb_cCassandraCpp, "USDT_PROBES", Qtrue);
+#else
+    rb_define_const(rb_cCassandraCpp, "USDT_PROBES", Qfalse);
+#endif
 }
\ No newline at end of file
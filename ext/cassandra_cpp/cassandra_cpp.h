@@ -4,7 +4,12 @@
 #include <ruby.h>
 #include <cassandra.h>
 #include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
 #include <memory>
+#include <atomic>
+#include <stdint.h>
 
 // Forward declarations of Ruby classes
 extern VALUE rb_cCassandraCpp;
@@ -14,47 +19,335 @@ extern VALUE rb_cPreparedStatement;
 extern VALUE rb_cStatement;
 extern VALUE rb_cBatch;
 extern VALUE rb_cFuture;
+extern VALUE rb_cResult;
+extern VALUE rb_mNativeMetrics;
 extern VALUE rb_eCassandraError;
 
+// USDT probes (provider cassandra_cpp) for tracing with bpftrace or perf.
+// Compiled in when sys/sdt.h is available; an untraced probe is a nop.
+// Arguments that cost more than a load are computed only while a tracer is
+// attached, which CASSANDRA_CPP_PROBE_ENABLED reads from the probe semaphore.
+#ifdef HAVE_SYS_SDT_H
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+extern "C" {
+extern unsigned short cassandra_cpp_prepare_semaphore;
+extern unsigned short cassandra_cpp_bind_semaphore;
+extern unsigned short cassandra_cpp_request__submit_semaphore;
+extern unsigned short cassandra_cpp_request__complete_semaphore;
+extern unsigned short cassandra_cpp_decode__start_semaphore;
+extern unsigned short cassandra_cpp_decode__end_semaphore;
+extern unsigned short cassandra_cpp_batch__execute_semaphore;
+}
+
+#define CASSANDRA_CPP_PROBE_ENABLED(name) __builtin_expect(cassandra_cpp_##name##_semaphore != 0, 0)
+#define CASSANDRA_CPP_PROBE2(name, a1, a2) STAP_PROBE2(cassandra_cpp, name, a1, a2)
+#define CASSANDRA_CPP_PROBE3(name, a1, a2, a3) STAP_PROBE3(cassandra_cpp, name, a1, a2, a3)
+#define CASSANDRA_CPP_PROBE4(name, a1, a2, a3, a4) STAP_PROBE4(cassandra_cpp, name, a1, a2, a3, a4)
+#else
+// sizeof keeps the arguments referenced without evaluating them
+#define CASSANDRA_CPP_PROBE_ENABLED(name) false
+#define CASSANDRA_CPP_PROBE2(name, a1, a2) do { (void)sizeof(a1); (void)sizeof(a2); } while (0)
+#define CASSANDRA_CPP_PROBE3(name, a1, a2, a3) do { CASSANDRA_CPP_PROBE2(name, a1, a2); (void)sizeof(a3); } while (0)
+#define CASSANDRA_CPP_PROBE4(name, a1, a2, a3, a4) do { CASSANDRA_CPP_PROBE3(name, a1, a2, a3); (void)sizeof(a4); } while (0)
+#endif
+
+// Latency histogram: log-linear buckets over nanoseconds (8 sub-buckets per
+// power of two, ~12% relative error), recorded lock-free from any thread.
+#define LATENCY_HISTOGRAM_SUB_BUCKETS 8
+#define LATENCY_HISTOGRAM_BUCKETS 288
+
+typedef struct {
+    std::atomic<uint64_t> buckets[LATENCY_HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> total_ns;
+    std::atomic<uint64_t> max_ns;
+} latency_histogram_t;
+
+// Phases of a request as seen from the extension
+typedef enum {
+    PHASE_QUEUE,     // execute called until handed to the driver
+    PHASE_NETWORK,   // handed to the driver until the future is ready
+    PHASE_GVL_WAIT,  // future ready until the GVL is reacquired
+    PHASE_DECODE,    // GVL reacquired until rows are Ruby objects
+    PHASE_COUNT
+} request_phase_t;
+
+typedef struct {
+    latency_histogram_t phases[PHASE_COUNT];
+} phase_stats_t;
+
+// Extension entry points whose GVL hold time is recorded
+typedef enum {
+    GVL_ENTRY_EXECUTE,        // session/statement execute, rows or lazy result
+    GVL_ENTRY_BIND,           // statement bind of one value
+    GVL_ENTRY_VALUE,          // future value
+    GVL_ENTRY_BATCH_ADD,
+    GVL_ENTRY_BATCH_EXECUTE,
+    GVL_ENTRY_COUNT
+} gvl_entry_t;
+
+// One entry point call, see gvl_span_call
+typedef struct {
+    uint64_t started_ns;
+    uint64_t released_ns;  // Thread's released total when the call started
+} gvl_span_t;
+
+// Monotonic timestamps (ns) taken along one request
+typedef struct {
+    uint64_t started_ns;
+    uint64_t submitted_ns;
+    uint64_t ready_ns;
+    uint64_t resumed_ns;
+    uint64_t decoded_ns;
+    uint64_t query_id;  // Reported by the request probes, 0 when unknown
+} request_timing_t;
+
+// How one request executed, kept with its result (execution_info.cpp)
+typedef struct {
+    request_timing_t timing;
+    bool traced;          // tracing_id is set; the statement asked for a trace
+    CassUuid tracing_id;
+    VALUE session_ref;    // NativeSession the trace is read through, nil unless traced
+} execution_info_t;
+
+// A request being captured for the traffic log (recorder.cpp)
+typedef struct {
+    std::string query;
+    std::vector<std::string> params;  // Encoded bound values, by index
+    bool prepared;
+    CassConsistency consistency;
+} traffic_capture_t;
+
+// Per-execution limits from a statement's latency (adaptive_timeout.cpp);
+// 0 leaves the cluster's request timeout and sends no speculative execution
+typedef struct {
+    cass_uint64_t timeout_ms;
+    cass_uint64_t speculative_delay_us;
+} adaptive_timeout_t;
+
+// Circuit breaker tuning (circuit_breaker.cpp)
+typedef struct {
+    double failure_rate;        // Share of failed or timed-out requests that trips the breaker
+    uint64_t minimum_requests;  // Requests in a window before the rate is judged
+    uint64_t window_ns;         // Length of the counting window while closed
+    uint64_t open_ns;           // Time spent rejecting calls before probing
+    uint64_t slow_ns;           // Slower requests count as timeouts, 0 disables
+    uint32_t probes;            // Successful half-open probes needed to close
+} circuit_breaker_config_t;
+
+// Shared by every statement with the same key; lives for the whole process
+typedef struct circuit_breaker_s circuit_breaker_t;
+
+// Request priority classes, admitted by a per-session gate (priority.cpp)
+typedef enum {
+    PRIORITY_INTERACTIVE,  // Always granted free slots first
+    PRIORITY_BATCH,        // Throttled while interactive requests queue or slow down
+    PRIORITY_CLASS_COUNT
+} priority_class_t;
+
+typedef struct priority_gate_s priority_gate_t;
+
+// A request handed to the driver whose outcome is still owed to its circuit
+// breaker and priority gate, either of which may be NULL (common.cpp)
+typedef struct {
+    CassFuture* future;
+    circuit_breaker_t* breaker;
+    priority_gate_t* gate;
+    priority_class_t priority;
+    uint64_t submitted_ns;
+} inflight_request_t;
+
+// A registry connection shared by sessions with identical options (cluster.cpp)
+typedef struct shared_connection_s shared_connection_t;
+
+// Partition counts of a prepared statement, see hot_partitions.cpp
+typedef struct hot_partitions_s hot_partitions_t;
+
+// Options for streaming row iteration (row_stream.cpp)
+typedef struct {
+    bool reuse;     // Refill one row object in place instead of allocating per row
+    bool as_array;  // Yield rows as arrays in column order instead of hashes
+} row_stream_options_t;
+
+// A statement executed page by page (row_stream.cpp)
+typedef struct {
+    CassSession* session;
+    CassStatement* statement;
+    bool owns_statement;         // Free the statement once all pages are read
+    int page_size;               // Rows per page, 0 keeps the driver default
+    phase_stats_t* stats;        // Per-statement phase histograms, may be NULL
+    circuit_breaker_t* breaker;  // Checked before every page, may be NULL
+    priority_gate_t* gate;       // Admits every page, may be NULL
+    priority_class_t priority;
+    traffic_capture_t* capture;  // Owned, written for the first page only
+    uint64_t started_ns;
+    const char* operation;       // Used in error messages
+    uint64_t query_id;           // Reported by the request probes
+} paged_request_t;
+
+// Bounded set of concurrent requests, consumed in submission order
+// (request_window.cpp)
+typedef struct {
+    CassFuture* future;
+    uint64_t started_ns;
+    uint64_t submitted_ns;
+} window_request_t;
+
+typedef struct {
+    CassSession* session;
+    size_t capacity;
+    phase_stats_t* stats;         // Per-statement phase histograms, may be NULL
+    circuit_breaker_t* breaker;   // Checked before every submission, may be NULL
+    priority_gate_t* gate;        // Admits every submission, may be NULL
+    priority_class_t priority;
+    const char* operation;        // Used in error messages
+    std::deque<window_request_t> in_flight;
+    CassFuture* failed;           // Kept alive while its error is raised
+    uint64_t query_id;            // Reported by the request probes
+} request_window_t;
+
+// Called once per page with an iterator over that page's rows
+typedef void (*result_page_visitor_t)(const CassResult* result, CassIterator* rows, void* context);
+
+// Column types of SSTables read and written offline (sstable.cpp)
+typedef enum {
+    SSTABLE_TYPE_ASCII,
+    SSTABLE_TYPE_BIGINT,
+    SSTABLE_TYPE_BLOB,
+    SSTABLE_TYPE_BOOLEAN,
+    SSTABLE_TYPE_DATE,
+    SSTABLE_TYPE_DECIMAL,
+    SSTABLE_TYPE_DOUBLE,
+    SSTABLE_TYPE_FLOAT,
+    SSTABLE_TYPE_INET,
+    SSTABLE_TYPE_INT,
+    SSTABLE_TYPE_SMALLINT,
+    SSTABLE_TYPE_TEXT,
+    SSTABLE_TYPE_TIME,
+    SSTABLE_TYPE_TIMESTAMP,
+    SSTABLE_TYPE_TIMEUUID,
+    SSTABLE_TYPE_TINYINT,
+    SSTABLE_TYPE_UUID,
+    SSTABLE_TYPE_VARINT
+} sstable_type_kind_t;
+
+typedef struct {
+    sstable_type_kind_t kind;
+    const char* cql_name;
+    const char* marshal_class;  // Class name under org.apache.cassandra.db.marshal
+    int fixed_length;           // Values are stored without a length when >= 0
+} sstable_type_t;
+
+// Zero points of the delta-encoded timestamps, deletion times and TTLs
+// (Cassandra's EncodingStats.NO_STATS: 2015-09-22T00:00:00Z)
+#define SSTABLE_TIMESTAMP_EPOCH 1442880000000000LL
+#define SSTABLE_DELETION_TIME_EPOCH 1442880000LL
+#define SSTABLE_NO_DELETION_TIME INT32_MAX
+
+// Unfiltered (row and range tombstone marker) flags
+#define SSTABLE_END_OF_PARTITION 0x01
+#define SSTABLE_IS_MARKER 0x02
+#define SSTABLE_HAS_TIMESTAMP 0x04
+#define SSTABLE_HAS_TTL 0x08
+#define SSTABLE_HAS_DELETION 0x10
+#define SSTABLE_HAS_ALL_COLUMNS 0x20
+#define SSTABLE_HAS_COMPLEX_DELETION 0x40
+#define SSTABLE_EXTENSION_FLAG 0x80
+#define SSTABLE_IS_STATIC 0x01
+
+// Cell flags
+#define SSTABLE_CELL_IS_DELETED 0x01
+#define SSTABLE_CELL_IS_EXPIRING 0x02
+#define SSTABLE_CELL_HAS_EMPTY_VALUE 0x04
+#define SSTABLE_CELL_USE_ROW_TIMESTAMP 0x08
+#define SSTABLE_CELL_USE_ROW_TTL 0x10
+
+// Statistics.db components, by MetadataType ordinal
+#define SSTABLE_METADATA_VALIDATION 0
+#define SSTABLE_METADATA_COMPACTION 1
+#define SSTABLE_METADATA_STATS 2
+#define SSTABLE_METADATA_HEADER 3
+
 // Wrapper structures
 typedef struct {
     CassCluster* cluster;
     CassFuture* connect_future;
     CassSession* session;
+    CassConsistency consistency;  // Default applied to every statement
 } cluster_wrapper_t;
 
 typedef struct {
     CassSession* session;
     VALUE cluster_ref;
+    priority_gate_t* gate;         // NULL until priorities are configured
+    shared_connection_t* shared;  // Registry connection this session holds a reference on, or NULL
+    CassConsistency consistency;  // The cluster's default, recorded with captured requests
 } session_wrapper_t;
 
 typedef struct {
     const CassPrepared* prepared;
     VALUE session_ref;
+    phase_stats_t* stats;
+    circuit_breaker_t* breaker;  // Resolved on first use, see circuit_breaker_for_prepared
+    uint64_t query_id;           // probe_query_id of the query text
+    hot_partitions_t* hot;       // NULL unless partitions are tracked
+    bool idempotent;             // Bound statements may be executed speculatively
 } prepared_statement_wrapper_t;
 
 typedef struct {
     CassStatement* statement;
     const CassPrepared* prepared; // For parameter binding validation
     VALUE prepared_ref;
+    traffic_capture_t* capture;  // Non-NULL while traffic recording is active
+    uint64_t query_id;           // Copied from the prepared statement
+    VALUE partition_key;         // Bound partition key values while tracked, else nil
 } statement_wrapper_t;
 
 typedef struct {
     CassBatch* batch;
     VALUE session_ref;
+    size_t statement_count;
 } batch_wrapper_t;
 
+typedef struct {
+    const CassResult* result;
+    std::vector<const CassRow*>* row_pointers;  // Built on first random access
+    VALUE column_keys;  // Frozen column name strings
+    VALUE rows;         // Memoized array of row hashes, nil until converted
+    execution_info_t info;
+} result_wrapper_t;
+
 typedef enum {
     FUTURE_TYPE_EXECUTE,
     FUTURE_TYPE_PREPARE
 } future_type_t;
 
+// Set from the driver's IO thread when the future resolves; shared between
+// the future wrapper and the driver callback, freed by whichever drops last.
+typedef struct {
+    std::atomic<uint64_t> ready_ns;
+    std::atomic<int> refs;
+    circuit_breaker_t* breaker;  // Told the outcome from the callback, may be NULL
+    priority_gate_t* gate;       // Slot given back from the callback, may be NULL
+    priority_class_t priority;
+    uint64_t submitted_ns;
+    uint64_t query_id;
+} future_ready_stamp_t;
+
 typedef struct {
     CassFuture* future;
     VALUE callback_proc;
     VALUE error_callback_proc;
     VALUE session_ref;
     future_type_t type;
+    request_timing_t timing;
+    future_ready_stamp_t* ready_stamp;
+    phase_stats_t* stats;  // Owned by stats_ref (a prepared statement), may be NULL
+    VALUE stats_ref;
+    traffic_capture_t* capture;
+    VALUE partition_key;  // Counted against stats_ref once the rows are read, may be nil
 } future_wrapper_t;
 
 // Type information
@@ -64,13 +357,148 @@ extern const rb_data_type_t prepared_statement_type;
 extern const rb_data_type_t statement_type;
 extern const rb_data_type_t batch_type;
 extern const rb_data_type_t future_type;
+extern const rb_data_type_t result_type;
 
 // Helper functions
 void raise_cassandra_error(CassFuture* future, const char* operation);
 VALUE convert_cass_value_to_ruby(const CassValue* value);
+VALUE timestamp_to_ruby(cass_int64_t milliseconds);
+VALUE uuid_to_ruby(CassUuid uuid);
+uint32_t crc32_update(uint32_t crc, const void* bytes, size_t length);
+uint64_t fnv1a_64(const void* bytes, size_t length);
+VALUE convert_result_to_ruby(const CassResult* result, uint64_t query_id);
+VALUE create_result_object(const CassResult* result, const execution_info_t* info);
+cass_bool_t wait_for_future(CassFuture* future, cass_uint64_t timeout_us, request_timing_t* timing);
+cass_bool_t wait_for_request(const inflight_request_t* request, cass_uint64_t timeout_us, request_timing_t* timing);
+void request_release_on_completion(const inflight_request_t* request);
+void request_admit(circuit_breaker_t* breaker, priority_gate_t* gate, priority_class_t priority,
+                   CassStatement* statement);
+bool request_try_admit(circuit_breaker_t* breaker, priority_gate_t* gate, priority_class_t priority);
 CassError bind_ruby_value_to_statement(CassStatement* statement, size_t index, VALUE value);
 CassError bind_ruby_value_to_collection(CassCollection* collection, VALUE value);
 VALUE create_future_from_cass_future(CassFuture* cass_future, VALUE session_ref, future_type_t type);
+VALUE create_timed_future(CassFuture* cass_future, VALUE session_ref, const request_timing_t* timing,
+                          phase_stats_t* stats, VALUE stats_ref, traffic_capture_t* capture,
+                          circuit_breaker_t* breaker, priority_gate_t* gate, priority_class_t priority);
+
+// Metrics helpers (metrics.cpp)
+uint64_t monotonic_now_ns();
+void latency_histogram_record(latency_histogram_t* histogram, uint64_t ns);
+VALUE latency_histogram_to_ruby(const latency_histogram_t* histogram);
+uint64_t latency_histogram_percentile_ns(const latency_histogram_t* histogram, double percentile);
+phase_stats_t* phase_stats_new();
+void phase_stats_free(phase_stats_t* stats);
+void phase_stats_reset(phase_stats_t* stats);
+VALUE phase_stats_to_ruby(const phase_stats_t* stats);
+void record_request_timing(phase_stats_t* statement_stats, const request_timing_t* timing);
+VALUE request_timing_to_ruby(const request_timing_t* timing);
+void* gvl_release_call(void* (*func)(void*), void* data, rb_unblock_function_t* ubf, void* ubf_data);
+VALUE gvl_span_call(gvl_entry_t entry, VALUE (*body)(int, VALUE*, VALUE), int argc, VALUE* argv, VALUE self);
+
+// Per-request execution info (execution_info.cpp)
+void execution_info_init(execution_info_t* info);
+void execution_info_capture(execution_info_t* info, CassFuture* future, VALUE session_ref);
+VALUE execution_info_new(const execution_info_t* info);
+void execution_info_attach(VALUE rows, const execution_info_t* info);
+
+// Traffic recorder helpers (recorder.cpp)
+bool traffic_recorder_active();
+traffic_capture_t* traffic_capture_new(VALUE query_str, bool prepared, CassConsistency consistency);
+traffic_capture_t* traffic_capture_copy(const traffic_capture_t* capture);
+void traffic_capture_free(traffic_capture_t* capture);
+void traffic_capture_bind(traffic_capture_t* capture, size_t index, VALUE value);
+void traffic_recorder_write(const traffic_capture_t* capture, const request_timing_t* timing, CassError rc);
+void traffic_value_append(std::string* out, VALUE value);
+VALUE traffic_value_read(const char** cursor, const char* end);
+
+// Hot-partition tracking (hot_partitions.cpp)
+void hot_partitions_free(hot_partitions_t* hot);
+void hot_partitions_mark(const hot_partitions_t* hot);
+VALUE hot_partitions_bind(const hot_partitions_t* hot, VALUE key, size_t index, VALUE value);
+void hot_partitions_record(hot_partitions_t* hot, VALUE key, const CassResult* result);
+
+// Paged execution helpers (row_stream.cpp)
+int page_size_from_ruby(VALUE page_size);
+void for_each_result_page(const paged_request_t* request, result_page_visitor_t visitor, void* context);
+VALUE stream_statement_rows(const paged_request_t* request, const row_stream_options_t* options);
+VALUE stream_statement_pages(const paged_request_t* request, bool as_array);
+
+// Shared connection registry (cluster.cpp); in_gc hands a last reference's
+// close to the closer thread
+void shared_connection_release(shared_connection_t* connection, bool in_gc);
+
+// Circuit breakers (circuit_breaker.cpp)
+bool circuit_breakers_enabled();
+circuit_breaker_t* circuit_breaker_for_query(VALUE query_str, VALUE keyspace);
+circuit_breaker_t* circuit_breaker_for_prepared(VALUE prepared_obj, prepared_statement_wrapper_t* wrapper);
+bool circuit_breaker_admit(circuit_breaker_t* breaker);
+NORETURN(void circuit_breaker_raise_open(circuit_breaker_t* breaker));
+void circuit_breaker_cancel(circuit_breaker_t* breaker);
+void circuit_breaker_record(circuit_breaker_t* breaker, CassError rc, uint64_t latency_ns);
+
+// Adaptive request timeouts (adaptive_timeout.cpp)
+bool adaptive_timeouts_enabled();
+adaptive_timeout_t adaptive_timeout_for(const phase_stats_t* stats);
+adaptive_timeout_t adaptive_timeout_apply(CassStatement* statement, const phase_stats_t* stats);
+CassFuture* adaptive_timeout_wait(CassSession* session, const CassStatement* statement, const inflight_request_t* request,
+                                  const adaptive_timeout_t* adaptive, bool idempotent, request_timing_t* timing);
+
+// Priority admission (priority.cpp)
+priority_class_t priority_current();
+priority_gate_t* priority_gate_new();
+void priority_gate_free(priority_gate_t* gate);
+void priority_gate_configure(priority_gate_t* gate, size_t capacity, double batch_share, uint64_t latency_target_ns);
+void priority_gate_enter(priority_gate_t* gate, priority_class_t priority);
+bool priority_gate_try_enter(priority_gate_t* gate, priority_class_t priority);
+void priority_gate_exit(priority_gate_t* gate, priority_class_t priority, uint64_t latency_ns);
+VALUE priority_gate_to_ruby(priority_gate_t* gate);
+
+// Concurrent request window (request_window.cpp)
+size_t window_capacity_from_ruby(VALUE concurrency);
+request_window_t* request_window_new(CassSession* session, size_t capacity, phase_stats_t* stats, const char* operation);
+void request_window_free(request_window_t* window);
+bool request_window_full(const request_window_t* window);
+bool request_window_empty(const request_window_t* window);
+void request_window_submit(request_window_t* window, CassStatement* statement, uint64_t started_ns);
+const CassResult* request_window_next(request_window_t* window);
+
+// Native group-by aggregation (aggregate.cpp)
+void aggregate_check_arguments(VALUE group_columns, VALUE aggregates);
+VALUE aggregate_statement_rows(const paged_request_t* request, VALUE group_columns, VALUE aggregates);
+
+// Order-preserving key encoding (snapshot.cpp)
+VALUE ordered_key_string(VALUE key);
+
+// vector<float, n> values (vector.cpp)
+size_t float_vector_dimensions(const CassDataType* data_type);
+bool float_vector_p(VALUE value);
+VALUE float_vector_from_cass_value(const CassValue* value);
+CassError bind_float_vector_buffer(CassStatement* statement, size_t index, const char* floats, size_t count);
+CassError bind_float_vector_to_statement(CassStatement* statement, size_t index, size_t dimensions, VALUE value);
+
+// Routing keys of simple statements (session.cpp)
+VALUE routing_key_encode(VALUE params, VALUE key_indexes, VALUE key_types);
+void routing_key_bind(CassStatement* statement, VALUE key_indexes, VALUE encoded);
+
+// Query ids for the USDT probes (probes.cpp)
+uint64_t probe_query_id(VALUE query_str);
+uint64_t probe_query_id_if_traced(VALUE query_str);
+
+// SSTable format helpers (sstable.cpp)
+const sstable_type_t* sstable_type_from_cql(VALUE name);
+const sstable_type_t* sstable_type_from_marshal(const char* name, size_t length);
+void sstable_encode_value(const sstable_type_t* type, VALUE value, std::string* out);
+VALUE sstable_decode_value(const sstable_type_t* type, const char* bytes, size_t length);
+int sstable_compare_values(const sstable_type_t* type, const std::string& left, const std::string& right);
+void sstable_write_vint(std::string* out, uint64_t value);
+void sstable_append_be(std::string* out, uint64_t value, int bytes);
+uint64_t sstable_read_be(const char* bytes, size_t length);
+void sstable_murmur3_hash(const char* bytes, size_t length, uint64_t hash[2]);
+uint64_t sstable_murmur2_hash64(const char* bytes, size_t length);
+int64_t sstable_token(const uint64_t hash[2]);
+
+// Driver allocation hooks (allocator.cpp); must run before any other driver call
+void install_driver_allocator();
 
 // Initialization functions
 void init_cluster();
@@ -79,5 +507,23 @@ void init_prepared_statement();
 void init_statement();
 void init_batch();
 void init_future();
+void init_result();
+void init_metrics();
+void init_recorder();
+void init_large_object();
+void init_column_writer();
+void init_circuit_breaker();
+void init_priority();
+void init_snapshot();
+void init_bloom_filter();
+void init_vector();
+void init_allocator();
+void init_copy();
+void init_sstable_writer();
+void init_sstable_reader();
+void init_execution_info();
+void init_batch_loader();
+void init_hot_partitions();
+void init_adaptive_timeout();
 
 #endif // CASSANDRA_CPP_H
\ No newline at end of file
@@ -0,0 +1,532 @@
+#include "cassandra_cpp.h"
+#include <mutex>
+#include <ctype.h>
+
+// Circuit breakers keyed by table (or by an explicit key per prepared
+// statement). A closed breaker counts requests over a tumbling window and
+// opens once enough of them failed or timed out; an open breaker rejects
+// calls without touching the network until open_ns has passed, then lets a
+// few probes through (half-open) and closes again once they all succeed.
+
+typedef enum {
+    BREAKER_CLOSED,
+    BREAKER_OPEN,
+    BREAKER_HALF_OPEN
+} breaker_state_t;
+
+struct circuit_breaker_s {
+    std::string key;
+    std::mutex lock;
+    circuit_breaker_config_t config;
+    bool configured;  // Explicit config, kept when the defaults change
+    breaker_state_t state;
+    
+    // Current window while closed
+    uint64_t window_started_ns;
+    uint64_t window_requests;
+    uint64_t window_failures;
+    
+    // Open and half-open bookkeeping
+    uint64_t opened_ns;
+    uint64_t probe_started_ns;
+    uint32_t probes_in_flight;
+    uint32_t probe_successes;
+    
+    // Lifetime counters for metrics
+    uint64_t requests;
+    uint64_t failures;
+    uint64_t timeouts;
+    uint64_t rejected;
+    uint64_t trips;
+};
+
+// Counters copied out for metrics
+typedef struct {
+    std::string key;
+    breaker_state_t state;
+    uint64_t requests;
+    uint64_t failures;
+    uint64_t timeouts;
+    uint64_t rejected;
+    uint64_t trips;
+} breaker_snapshot_t;
+
+static VALUE rb_mNativeCircuitBreakers;
+static VALUE rb_eCircuitOpenError;
+
+static std::atomic<bool> breakers_enabled(false);
+static std::mutex registry_lock;
+static std::unordered_map<std::string, circuit_breaker_t*>* registry;
+static circuit_breaker_config_t default_config = {
+    0.5, 20, 10000000000ULL, 5000000000ULL, 0, 3
+};
+
+bool circuit_breakers_enabled() {
+    return breakers_enabled.load(std::memory_order_relaxed);
+}
+
+// Find or create the breaker for a key. Breakers live for the whole process,
+// so the pointer can be cached by statements and driver callbacks.
+static circuit_breaker_t* circuit_breaker_lookup(const std::string& key) {
+    std::lock_guard<std::mutex> guard(registry_lock);
+    
+    std::unordered_map<std::string, circuit_breaker_t*>::iterator it = registry->find(key);
+    if (it != registry->end()) {
+        return it->second;
+    }
+    
+    circuit_breaker_t* breaker = new circuit_breaker_t();
+    breaker->key = key;
+    breaker->config = default_config;
+    breaker->configured = false;
+    breaker->state = BREAKER_CLOSED;
+    breaker->window_started_ns = monotonic_now_ns();
+    
+    registry->insert(std::make_pair(key, breaker));
+    return breaker;
+}
+
+// Table named by a CQL statement: the identifier after FROM, INTO or UPDATE,
+// keyspace-qualified when the query qualifies it. Unquoted identifiers are
+// lowercased like Cassandra does. String literals are skipped.
+static bool circuit_breaker_table_from_query(const char* query, size_t length, std::string* table) {
+    size_t i = 0;
+    
+    while (i < length) {
+        char c = query[i];
+        if (c == '\'') {
+            for (i++; i < length && query[i] != '\''; i++) {}
+            i++;
+            continue;
+        }
+        if (!isalpha((unsigned char)c)) {
+            i++;
+            continue;
+        }
+        
+        size_t word_start = i;
+        while (i < length && (isalnum((unsigned char)query[i]) || query[i] == '_')) {
+            i++;
+        }
+        size_t word_length = i - word_start;
+        
+        bool keyword = (word_length == 4 && strncasecmp(query + word_start, "from", 4) == 0) ||
+                       (word_length == 4 && strncasecmp(query + word_start, "into", 4) == 0) ||
+                       (word_length == 6 && strncasecmp(query + word_start, "update", 6) == 0);
+        if (!keyword) {
+            continue;
+        }
+        
+        while (i < length && isspace((unsigned char)query[i])) {
+            i++;
+        }
+        
+        table->clear();
+        bool quoted = false;
+        for (; i < length; i++) {
+            char t = query[i];
+            if (t == '"') {
+                quoted = !quoted;
+            } else if (quoted || isalnum((unsigned char)t) || t == '_' || t == '.') {
+                table->push_back(quoted ? t : (char)tolower((unsigned char)t));
+            } else {
+                break;
+            }
+        }
+        
+        return !table->empty();
+    }
+    
+    return false;
+}
+
+// Breaker guarding a simple query, or NULL when breakers are disabled or the
+// statement names no table. An unqualified table is keyed under keyspace
+// (the session's, may be nil) so same-named tables in different keyspaces
+// get separate breakers.
+circuit_breaker_t* circuit_breaker_for_query(VALUE query_str, VALUE keyspace) {
+    if (!circuit_breakers_enabled()) {
+        return NULL;
+    }
+    StringValue(query_str);
+    
+    std::string table;
+    if (!circuit_breaker_table_from_query(RSTRING_PTR(query_str), (size_t)RSTRING_LEN(query_str), &table)) {
+        return NULL;
+    }
+    
+    if (table.find('.') == std::string::npos && !NIL_P(keyspace)) {
+        StringValue(keyspace);
+        std::string qualified;
+        for (long i = 0; i < RSTRING_LEN(keyspace); i++) {
+            qualified.push_back((char)tolower((unsigned char)RSTRING_PTR(keyspace)[i]));
+        }
+        qualified.push_back('.');
+        table.insert(0, qualified);
+    }
+    
+    return circuit_breaker_lookup(table);
+}
+
+// Breaker guarding a prepared statement: its explicit key if one was set,
+// otherwise the table of its query, resolved once and cached
+circuit_breaker_t* circuit_breaker_for_prepared(VALUE prepared_obj, prepared_statement_wrapper_t* wrapper) {
+    if (!circuit_breakers_enabled()) {
+        return NULL;
+    }
+    
+    if (!wrapper->breaker) {
+        wrapper->breaker = circuit_breaker_for_query(rb_iv_get(prepared_obj, "@query"),
+                                                     rb_iv_get(wrapper->session_ref, "@keyspace"));
+    }
+    
+    return wrapper->breaker;
+}
+
+// Whether a call may go ahead. Open breakers move to half-open once open_ns
+// has passed; probes that never reported back (e.g. an abandoned request)
+// are written off after another open_ns.
+bool circuit_breaker_admit(circuit_breaker_t* breaker) {
+    if (!breaker) {
+        return true;
+    }
+    
+    uint64_t now = monotonic_now_ns();
+    std::lock_guard<std::mutex> guard(breaker->lock);
+    
+    if (breaker->state == BREAKER_OPEN) {
+        if (now - breaker->opened_ns < breaker->config.open_ns) {
+            breaker->rejected++;
+            return false;
+        }
+        breaker->state = BREAKER_HALF_OPEN;
+        breaker->probes_in_flight = 0;
+        breaker->probe_successes = 0;
+        breaker->probe_started_ns = now;
+    }
+    
+    if (breaker->state == BREAKER_HALF_OPEN) {
+        if (breaker->probes_in_flight > 0 && now - breaker->probe_started_ns >= breaker->config.open_ns) {
+            breaker->probes_in_flight = 0;
+        }
+        if (breaker->probes_in_flight + breaker->probe_successes >= breaker->config.probes) {
+            breaker->rejected++;
+            return false;
+        }
+        breaker->probes_in_flight++;
+        breaker->probe_started_ns = now;
+    }
+    
+    return true;
+}
+
+void circuit_breaker_raise_open(circuit_breaker_t* breaker) {
+    rb_raise(rb_eCircuitOpenError, "Circuit breaker open for %s", breaker->key.c_str());
+}
+
+// Give back an admitted call that never reached the driver, or whose outcome
+// will never be known; it counts neither way. No Ruby calls.
+void circuit_breaker_cancel(circuit_breaker_t* breaker) {
+    if (!breaker) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> guard(breaker->lock);
+    if (breaker->state == BREAKER_HALF_OPEN && breaker->probes_in_flight > 0) {
+        breaker->probes_in_flight--;
+    }
+}
+
+// Errors that say the replicas are unhealthy, as opposed to a bad query
+static bool circuit_breaker_failure(CassError rc, bool* timeout) {
+    switch (rc) {
+        case CASS_ERROR_LIB_REQUEST_TIMED_OUT:
+        case CASS_ERROR_SERVER_READ_TIMEOUT:
+        case CASS_ERROR_SERVER_WRITE_TIMEOUT:
+            *timeout = true;
+            return true;
+        case CASS_ERROR_LIB_NO_HOSTS_AVAILABLE:
+        case CASS_ERROR_LIB_REQUEST_QUEUE_FULL:
+        case CASS_ERROR_SERVER_UNAVAILABLE:
+        case CASS_ERROR_SERVER_OVERLOADED:
+        case CASS_ERROR_SERVER_READ_FAILURE:
+        case CASS_ERROR_SERVER_WRITE_FAILURE:
+        case CASS_ERROR_SERVER_IS_BOOTSTRAPPING:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void circuit_breaker_trip(circuit_breaker_t* breaker, uint64_t now) {
+    breaker->state = BREAKER_OPEN;
+    breaker->opened_ns = now;
+    breaker->trips++;
+}
+
+// Report the outcome of an admitted call. No Ruby calls: this also runs on
+// driver IO threads for async requests.
+void circuit_breaker_record(circuit_breaker_t* breaker, CassError rc, uint64_t latency_ns) {
+    if (!breaker) {
+        return;
+    }
+    
+    bool timeout = false;
+    bool failed = circuit_breaker_failure(rc, &timeout);
+    uint64_t now = monotonic_now_ns();
+    std::lock_guard<std::mutex> guard(breaker->lock);
+    
+    if (!failed && breaker->config.slow_ns > 0 && latency_ns >= breaker->config.slow_ns) {
+        failed = true;
+        timeout = true;
+    }
+    
+    breaker->requests++;
+    if (failed) {
+        breaker->failures++;
+    }
+    if (timeout) {
+        breaker->timeouts++;
+    }
+    
+    switch (breaker->state) {
+        case BREAKER_HALF_OPEN:
+            if (breaker->probes_in_flight > 0) {
+                breaker->probes_in_flight--;
+            }
+            if (failed) {
+                circuit_breaker_trip(breaker, now);
+            } else if (++breaker->probe_successes >= breaker->config.probes) {
+                breaker->state = BREAKER_CLOSED;
+                breaker->window_started_ns = now;
+                breaker->window_requests = 0;
+                breaker->window_failures = 0;
+            }
+            break;
+        case BREAKER_CLOSED:
+            if (now - breaker->window_started_ns >= breaker->config.window_ns) {
+                breaker->window_started_ns = now;
+                breaker->window_requests = 0;
+                breaker->window_failures = 0;
+            }
+            breaker->window_requests++;
+            if (failed) {
+                breaker->window_failures++;
+            }
+            if (breaker->window_requests >= breaker->config.minimum_requests &&
+                (double)breaker->window_failures >= breaker->config.failure_rate * (double)breaker->window_requests) {
+                circuit_breaker_trip(breaker, now);
+            }
+            break;
+        case BREAKER_OPEN:
+            // Calls admitted before the breaker opened are already counted
+            break;
+    }
+}
+
+static circuit_breaker_config_t circuit_breaker_config_from_ruby(VALUE failure_rate, VALUE minimum_requests,
+                                                                 VALUE window_ms, VALUE open_ms, VALUE slow_ms,
+                                                                 VALUE probes) {
+    circuit_breaker_config_t config;
+    config.failure_rate = NUM2DBL(failure_rate);
+    config.minimum_requests = NUM2ULL(minimum_requests);
+    config.window_ns = NUM2ULL(window_ms) * 1000000ULL;
+    config.open_ns = NUM2ULL(open_ms) * 1000000ULL;
+    config.slow_ns = NIL_P(slow_ms) ? 0 : NUM2ULL(slow_ms) * 1000000ULL;
+    config.probes = NUM2UINT(probes);
+    
+    if (config.failure_rate <= 0.0 || config.failure_rate > 1.0) {
+        rb_raise(rb_eArgError, "failure_rate must be in (0, 1]");
+    }
+    if (config.minimum_requests < 1 || config.probes < 1 || config.window_ns == 0) {
+        rb_raise(rb_eArgError, "minimum_requests, probes and window_ms must be positive");
+    }
+    
+    return config;
+}
+
+// Ruby method: NativeCircuitBreakers.enable(failure_rate, minimum_requests, window_ms, open_ms, slow_ms, probes)
+// Sets the defaults for every breaker without an explicit configuration and
+// starts guarding requests
+static VALUE native_circuit_breakers_enable(VALUE self, VALUE failure_rate, VALUE minimum_requests,
+                                            VALUE window_ms, VALUE open_ms, VALUE slow_ms, VALUE probes) {
+    circuit_breaker_config_t config = circuit_breaker_config_from_ruby(failure_rate, minimum_requests,
+                                                                       window_ms, open_ms, slow_ms, probes);
+    
+    {
+        std::lock_guard<std::mutex> guard(registry_lock);
+        default_config = config;
+        
+        for (std::unordered_map<std::string, circuit_breaker_t*>::iterator it = registry->begin();
+             it != registry->end(); ++it) {
+            std::lock_guard<std::mutex> breaker_guard(it->second->lock);
+            if (!it->second->configured) {
+                it->second->config = config;
+            }
+        }
+    }
+    
+    breakers_enabled.store(true, std::memory_order_relaxed);
+    return Qnil;
+}
+
+// Ruby method: NativeCircuitBreakers.disable
+static VALUE native_circuit_breakers_disable(VALUE self) {
+    breakers_enabled.store(false, std::memory_order_relaxed);
+    return Qnil;
+}
+
+// Ruby method: NativeCircuitBreakers.enabled?
+static VALUE native_circuit_breakers_enabled_p(VALUE self) {
+    return circuit_breakers_enabled() ? Qtrue : Qfalse;
+}
+
+// Ruby method: NativeCircuitBreakers.configure(key, failure_rate, minimum_requests, window_ms, open_ms, slow_ms, probes)
+static VALUE native_circuit_breakers_configure(VALUE self, VALUE key, VALUE failure_rate, VALUE minimum_requests,
+                                               VALUE window_ms, VALUE open_ms, VALUE slow_ms, VALUE probes) {
+    circuit_breaker_config_t config = circuit_breaker_config_from_ruby(failure_rate, minimum_requests,
+                                                                       window_ms, open_ms, slow_ms, probes);
+    StringValue(key);
+    
+    circuit_breaker_t* breaker = circuit_breaker_lookup(std::string(RSTRING_PTR(key), (size_t)RSTRING_LEN(key)));
+    std::lock_guard<std::mutex> guard(breaker->lock);
+    breaker->config = config;
+    breaker->configured = true;
+    
+    return Qnil;
+}
+
+static VALUE circuit_breaker_state_symbol(breaker_state_t state) {
+    switch (state) {
+        case BREAKER_OPEN: return ID2SYM(rb_intern("open"));
+        case BREAKER_HALF_OPEN: return ID2SYM(rb_intern("half_open"));
+        default: return ID2SYM(rb_intern("closed"));
+    }
+}
+
+// Ruby method: NativeCircuitBreakers.states
+// { key => { state:, requests:, failures:, timeouts:, rejected:, trips: } }
+static VALUE native_circuit_breakers_states(VALUE self) {
+    // Copy under the locks, build Ruby objects afterwards
+    std::vector<breaker_snapshot_t> snapshot;
+    {
+        std::lock_guard<std::mutex> guard(registry_lock);
+        snapshot.reserve(registry->size());
+        
+        for (std::unordered_map<std::string, circuit_breaker_t*>::iterator it = registry->begin();
+             it != registry->end(); ++it) {
+            circuit_breaker_t* breaker = it->second;
+            std::lock_guard<std::mutex> breaker_guard(breaker->lock);
+            
+            breaker_snapshot_t copy = { breaker->key, breaker->state, breaker->requests, breaker->failures,
+                                        breaker->timeouts, breaker->rejected, breaker->trips };
+            snapshot.push_back(copy);
+        }
+    }
+    
+    VALUE states = rb_hash_new();
+    for (size_t i = 0; i < snapshot.size(); i++) {
+        const breaker_snapshot_t& breaker = snapshot[i];
+        VALUE state = rb_hash_new();
+        rb_hash_aset(state, ID2SYM(rb_intern("state")), circuit_breaker_state_symbol(breaker.state));
+        rb_hash_aset(state, ID2SYM(rb_intern("requests")), ULL2NUM(breaker.requests));
+        rb_hash_aset(state, ID2SYM(rb_intern("failures")), ULL2NUM(breaker.failures));
+        rb_hash_aset(state, ID2SYM(rb_intern("timeouts")), ULL2NUM(breaker.timeouts));
+        rb_hash_aset(state, ID2SYM(rb_intern("rejected")), ULL2NUM(breaker.rejected));
+        rb_hash_aset(state, ID2SYM(rb_intern("trips")), ULL2NUM(breaker.trips));
+        rb_hash_aset(states, rb_str_new(breaker.key.data(), (long)breaker.key.size()), state);
+    }
+    
+    return states;
+}
+
+// Ruby method: NativeCircuitBreakers.reset - close every breaker and clear its counters
+static VALUE native_circuit_breakers_reset(VALUE self) {
+    std::lock_guard<std::mutex> guard(registry_lock);
+    uint64_t now = monotonic_now_ns();
+    
+    for (std::unordered_map<std::string, circuit_breaker_t*>::iterator it = registry->begin();
+         it != registry->end(); ++it) {
+        circuit_breaker_t* breaker = it->second;
+        std::lock_guard<std::mutex> breaker_guard(breaker->lock);
+        
+        breaker->state = BREAKER_CLOSED;
+        breaker->window_started_ns = now;
+        breaker->window_requests = 0;
+        breaker->window_failures = 0;
+        breaker->probes_in_flight = 0;
+        breaker->probe_successes = 0;
+        breaker->requests = 0;
+        breaker->failures = 0;
+        breaker->timeouts = 0;
+        breaker->rejected = 0;
+        breaker->trips = 0;
+    }
+    
+    return Qnil;
+}
+
+static circuit_breaker_t* circuit_breaker_from_ruby_key(VALUE key) {
+    StringValue(key);
+    return circuit_breaker_lookup(std::string(RSTRING_PTR(key), (size_t)RSTRING_LEN(key)));
+}
+
+// Ruby method: NativeCircuitBreakers.admit(key) -> true if a call may go ahead
+// For instrumentation and tests of requests made outside the extension
+static VALUE native_circuit_breakers_admit(VALUE self, VALUE key) {
+    return circuit_breaker_admit(circuit_breaker_from_ruby_key(key)) ? Qtrue : Qfalse;
+}
+
+// Ruby method: NativeCircuitBreakers.record(key, outcome, latency_ms)
+// Report an admitted call; outcome is :success, :timeout or :failure
+static VALUE native_circuit_breakers_record(VALUE self, VALUE key, VALUE outcome, VALUE latency_ms) {
+    ID outcome_id = SYM2ID(rb_to_symbol(outcome));
+    CassError rc;
+    if (outcome_id == rb_intern("success")) {
+        rc = CASS_OK;
+    } else if (outcome_id == rb_intern("timeout")) {
+        rc = CASS_ERROR_LIB_REQUEST_TIMED_OUT;
+    } else if (outcome_id == rb_intern("failure")) {
+        rc = CASS_ERROR_SERVER_UNAVAILABLE;
+    } else {
+        rb_raise(rb_eArgError, "Unknown outcome: %" PRIsVALUE ". Use :success, :timeout or :failure", outcome);
+    }
+    
+    uint64_t latency_ns = (uint64_t)(NUM2DBL(latency_ms) * 1000000.0);
+    circuit_breaker_record(circuit_breaker_from_ruby_key(key), rc, latency_ns);
+    return Qnil;
+}
+
+// Ruby method: prepared.circuit_breaker = key
+// Guard this statement with the named breaker instead of its table's
+static VALUE prepared_statement_set_circuit_breaker(VALUE self, VALUE key) {
+    prepared_statement_wrapper_t* wrapper;
+    TypedData_Get_Struct(self, prepared_statement_wrapper_t, &prepared_statement_type, wrapper);
+    
+    if (NIL_P(key)) {
+        wrapper->breaker = NULL;
+    } else {
+        StringValue(key);
+        wrapper->breaker = circuit_breaker_lookup(std::string(RSTRING_PTR(key), (size_t)RSTRING_LEN(key)));
+    }
+    
+    return key;
+}
+
+void init_circuit_breaker() {
+    registry = new std::unordered_map<std::string, circuit_breaker_t*>();
+    
+    rb_eCircuitOpenError = rb_define_class_under(rb_cCassandraCpp, "CircuitOpenError", rb_eCassandraError);
+    
+    rb_mNativeCircuitBreakers = rb_define_module_under(rb_cCassandraCpp, "NativeCircuitBreakers");
+    rb_define_module_function(rb_mNativeCircuitBreakers, "enable", (VALUE(*)(...))native_circuit_breakers_enable, 6);
+    rb_define_module_function(rb_mNativeCircuitBreakers, "disable", (VALUE(*)(...))native_circuit_breakers_disable, 0);
+    rb_define_module_function(rb_mNativeCircuitBreakers, "enabled?", (VALUE(*)(...))native_circuit_breakers_enabled_p, 0);
+    rb_define_module_function(rb_mNativeCircuitBreakers, "configure", (VALUE(*)(...))native_circuit_breakers_configure, 7);
+    rb_define_module_function(rb_mNativeCircuitBreakers, "states", (VALUE(*)(...))native_circuit_breakers_states, 0);
+    rb_define_module_function(rb_mNativeCircuitBreakers, "reset", (VALUE(*)(...))native_circuit_breakers_reset, 0);
+    rb_define_module_function(rb_mNativeCircuitBreakers, "admit", (VALUE(*)(...))native_circuit_breakers_admit, 1);
+    rb_define_module_function(rb_mNativeCircuitBreakers, "record", (VALUE(*)(...))native_circuit_breakers_record, 3);
+    
+    rb_define_method(rb_cPreparedStatement, "circuit_breaker=", (VALUE(*)(...))prepared_statement_set_circuit_breaker, 1);
+}
\ No newline at end of file
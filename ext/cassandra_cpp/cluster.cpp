@@ -1,4 +1,9 @@
 #include "cassandra_cpp.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <system_error>
+#include <unistd.h>
 
 // Memory management functions
 static void cluster_free(void* ptr) {
@@ -24,13 +29,8 @@ const rb_data_type_t cluster_type = {
     RUBY_TYPED_FREE_IMMEDIATELY
 };
 
-// Cluster methods
-static VALUE cluster_new(VALUE klass, VALUE options) {
-    cluster_wrapper_t* wrapper = ALLOC(cluster_wrapper_t);
-    wrapper->cluster = cass_cluster_new();
-    wrapper->connect_future = NULL;
-    wrapper->session = NULL;
-    
+// Apply Ruby options (or the defaults when nil) to a driver cluster
+static void cluster_configure(CassCluster* cluster, VALUE options) {
     // Set defaults
     const char* default_hosts = "127.0.0.1";  // Will be overridden by options
     int default_port = 9042;
@@ -42,54 +42,54 @@ static VALUE cluster_new(VALUE klass, VALUE options) {
         VALUE hosts = rb_hash_aref(options, ID2SYM(rb_intern("hosts")));
         if (!NIL_P(hosts)) {
             const char* hosts_str = StringValueCStr(hosts);
-            cass_cluster_set_contact_points(wrapper->cluster, hosts_str);
+            cass_cluster_set_contact_points(cluster, hosts_str);
         } else {
-            cass_cluster_set_contact_points(wrapper->cluster, default_hosts);
+            cass_cluster_set_contact_points(cluster, default_hosts);
         }
         
         VALUE port = rb_hash_aref(options, ID2SYM(rb_intern("port")));
         if (!NIL_P(port)) {
             int port_num = NUM2INT(port);
-            cass_cluster_set_port(wrapper->cluster, port_num);
+            cass_cluster_set_port(cluster, port_num);
         } else {
-            cass_cluster_set_port(wrapper->cluster, default_port);
+            cass_cluster_set_port(cluster, default_port);
         }
         
         VALUE consistency = rb_hash_aref(options, ID2SYM(rb_intern("consistency")));
         if (!NIL_P(consistency)) {
             int consistency_level = NUM2INT(consistency);
-            cass_cluster_set_consistency(wrapper->cluster, (CassConsistency)consistency_level);
+            cass_cluster_set_consistency(cluster, (CassConsistency)consistency_level);
         }
         
         // Connection pool configuration
         VALUE core_connections = rb_hash_aref(options, ID2SYM(rb_intern("core_connections_per_host")));
         if (!NIL_P(core_connections)) {
             unsigned int core_conn = NUM2UINT(core_connections);
-            cass_cluster_set_core_connections_per_host(wrapper->cluster, core_conn);
+            cass_cluster_set_core_connections_per_host(cluster, core_conn);
         }
         
         VALUE max_connections = rb_hash_aref(options, ID2SYM(rb_intern("max_connections_per_host")));
         if (!NIL_P(max_connections)) {
             unsigned int max_conn = NUM2UINT(max_connections);
-            cass_cluster_set_max_connections_per_host(wrapper->cluster, max_conn);
+            cass_cluster_set_max_connections_per_host(cluster, max_conn);
         }
         
         VALUE concurrent_requests = rb_hash_aref(options, ID2SYM(rb_intern("max_concurrent_requests_threshold")));
         if (!NIL_P(concurrent_requests)) {
             unsigned int max_req = NUM2UINT(concurrent_requests);
-            cass_cluster_set_max_concurrent_requests_threshold(wrapper->cluster, max_req);
+            cass_cluster_set_max_concurrent_requests_threshold(cluster, max_req);
         }
         
         VALUE connect_timeout = rb_hash_aref(options, ID2SYM(rb_intern("connect_timeout")));
         if (!NIL_P(connect_timeout)) {
             unsigned int timeout_ms = NUM2UINT(connect_timeout);
-            cass_cluster_set_connect_timeout(wrapper->cluster, timeout_ms);
+            cass_cluster_set_connect_timeout(cluster, timeout_ms);
         }
         
         VALUE request_timeout = rb_hash_aref(options, ID2SYM(rb_intern("request_timeout")));
         if (!NIL_P(request_timeout)) {
             unsigned int timeout_ms = NUM2UINT(request_timeout);
-            cass_cluster_set_request_timeout(wrapper->cluster, timeout_ms);
+            cass_cluster_set_request_timeout(cluster, timeout_ms);
         }
         
         // Load balancing configuration
@@ -97,7 +97,7 @@ static VALUE cluster_new(VALUE klass, VALUE options) {
         if (!NIL_P(load_balance_policy)) {
             const char* policy_str = StringValueCStr(load_balance_policy);
             if (strcmp(policy_str, "round_robin") == 0) {
-                cass_cluster_set_load_balance_round_robin(wrapper->cluster);
+                cass_cluster_set_load_balance_round_robin(cluster);
             } else if (strcmp(policy_str, "dc_aware") == 0) {
                 VALUE local_dc = rb_hash_aref(options, ID2SYM(rb_intern("local_datacenter")));
                 VALUE used_hosts_remote = rb_hash_aref(options, ID2SYM(rb_intern("used_hosts_per_remote_dc")));
@@ -108,9 +108,9 @@ static VALUE cluster_new(VALUE klass, VALUE options) {
                 cass_bool_t allow_remote_bool = NIL_P(allow_remote) ? cass_false : (RTEST(allow_remote) ? cass_true : cass_false);
                 
                 if (local_dc_str) {
-                    cass_cluster_set_load_balance_dc_aware(wrapper->cluster, local_dc_str, used_hosts, allow_remote_bool);
+                    cass_cluster_set_load_balance_dc_aware(cluster, local_dc_str, used_hosts, allow_remote_bool);
                 } else {
-                    cass_cluster_set_load_balance_dc_aware(wrapper->cluster, NULL, used_hosts, allow_remote_bool);
+                    cass_cluster_set_load_balance_dc_aware(cluster, NULL, used_hosts, allow_remote_bool);
                 }
             }
         }
@@ -119,14 +119,14 @@ static VALUE cluster_new(VALUE klass, VALUE options) {
         VALUE token_aware = rb_hash_aref(options, ID2SYM(rb_intern("token_aware_routing")));
         if (!NIL_P(token_aware)) {
             cass_bool_t enabled = RTEST(token_aware) ? cass_true : cass_false;
-            cass_cluster_set_token_aware_routing(wrapper->cluster, enabled);
+            cass_cluster_set_token_aware_routing(cluster, enabled);
         }
         
         // Latency-aware routing
         VALUE latency_aware = rb_hash_aref(options, ID2SYM(rb_intern("latency_aware_routing")));
         if (!NIL_P(latency_aware)) {
             cass_bool_t enabled = RTEST(latency_aware) ? cass_true : cass_false;
-            cass_cluster_set_latency_aware_routing(wrapper->cluster, enabled);
+            cass_cluster_set_latency_aware_routing(cluster, enabled);
             
             if (enabled) {
                 VALUE exclusion_threshold = rb_hash_aref(options, ID2SYM(rb_intern("latency_exclusion_threshold")));
@@ -135,7 +135,7 @@ static VALUE cluster_new(VALUE klass, VALUE options) {
                 VALUE update_rate_ms = rb_hash_aref(options, ID2SYM(rb_intern("latency_update_rate_ms")));
                 VALUE min_measured = rb_hash_aref(options, ID2SYM(rb_intern("latency_min_measured")));
                 
-                if (!NIL_P(exclusion_threshold) || !NIL_P(scale_ms) || !NIL_P(retry_period_ms) || 
+                if (!NIL_P(exclusion_threshold) || !NIL_P(scale_ms) || !NIL_P(retry_period_ms) ||
                     !NIL_P(update_rate_ms) || !NIL_P(min_measured)) {
                     cass_double_t threshold = NIL_P(exclusion_threshold) ? 2.0 : NUM2DBL(exclusion_threshold);
                     cass_uint64_t scale = NIL_P(scale_ms) ? 100 : NUM2ULL(scale_ms);
@@ -143,7 +143,7 @@ static VALUE cluster_new(VALUE klass, VALUE options) {
                     cass_uint64_t update_rate = NIL_P(update_rate_ms) ? 100 : NUM2ULL(update_rate_ms);
                     cass_uint64_t min_measured_queries = NIL_P(min_measured) ? 50 : NUM2ULL(min_measured);
                     
-                    cass_cluster_set_latency_aware_routing_settings(wrapper->cluster, threshold, 
+                    cass_cluster_set_latency_aware_routing_settings(cluster, threshold,
                         scale, retry_period, update_rate, min_measured_queries);
                 }
             }
@@ -167,10 +167,10 @@ static VALUE cluster_new(VALUE klass, VALUE options) {
                 VALUE logging_enabled = rb_hash_aref(options, ID2SYM(rb_intern("retry_policy_logging")));
                 if (!NIL_P(logging_enabled) && RTEST(logging_enabled)) {
                     CassRetryPolicy* logging_policy = cass_retry_policy_logging_new(policy);
-                    cass_cluster_set_retry_policy(wrapper->cluster, logging_policy);
+                    cass_cluster_set_retry_policy(cluster, logging_policy);
                     cass_retry_policy_free(logging_policy);
                 } else {
-                    cass_cluster_set_retry_policy(wrapper->cluster, policy);
+                    cass_cluster_set_retry_policy(cluster, policy);
                 }
                 cass_retry_policy_free(policy);
             }
@@ -180,37 +180,57 @@ static VALUE cluster_new(VALUE klass, VALUE options) {
         VALUE heartbeat_interval = rb_hash_aref(options, ID2SYM(rb_intern("heartbeat_interval")));
         if (!NIL_P(heartbeat_interval)) {
             unsigned int interval_s = NUM2UINT(heartbeat_interval);
-            cass_cluster_set_connection_heartbeat_interval(wrapper->cluster, interval_s);
+            cass_cluster_set_connection_heartbeat_interval(cluster, interval_s);
         }
         
         // Idle timeout
         VALUE idle_timeout = rb_hash_aref(options, ID2SYM(rb_intern("connection_idle_timeout")));
         if (!NIL_P(idle_timeout)) {
             unsigned int timeout_s = NUM2UINT(idle_timeout);
-            cass_cluster_set_connection_idle_timeout(wrapper->cluster, timeout_s);
+            cass_cluster_set_connection_idle_timeout(cluster, timeout_s);
         }
     } else {
         // No options provided, use defaults
-        cass_cluster_set_contact_points(wrapper->cluster, default_hosts);
-        cass_cluster_set_port(wrapper->cluster, default_port);
+        cass_cluster_set_contact_points(cluster, default_hosts);
+        cass_cluster_set_port(cluster, default_port);
         
         // Set sensible defaults for connection pooling
-        cass_cluster_set_core_connections_per_host(wrapper->cluster, 1);
-        cass_cluster_set_max_connections_per_host(wrapper->cluster, 2);
-        cass_cluster_set_max_concurrent_requests_threshold(wrapper->cluster, 100);
-        cass_cluster_set_connect_timeout(wrapper->cluster, 5000); // 5 seconds
-        cass_cluster_set_request_timeout(wrapper->cluster, 12000); // 12 seconds
-        cass_cluster_set_token_aware_routing(wrapper->cluster, cass_true);
-        cass_cluster_set_connection_heartbeat_interval(wrapper->cluster, 30); // 30 seconds
-        cass_cluster_set_connection_idle_timeout(wrapper->cluster, 60); // 60 seconds
+        cass_cluster_set_core_connections_per_host(cluster, 1);
+        cass_cluster_set_max_connections_per_host(cluster, 2);
+        cass_cluster_set_max_concurrent_requests_threshold(cluster, 100);
+        cass_cluster_set_connect_timeout(cluster, 5000); // 5 seconds
+        cass_cluster_set_request_timeout(cluster, 12000); // 12 seconds
+        cass_cluster_set_token_aware_routing(cluster, cass_true);
+        cass_cluster_set_connection_heartbeat_interval(cluster, 30); // 30 seconds
+        cass_cluster_set_connection_idle_timeout(cluster, 60); // 60 seconds
         
         // Set default retry policy
         CassRetryPolicy* default_policy = cass_retry_policy_default_new();
-        cass_cluster_set_retry_policy(wrapper->cluster, default_policy);
+        cass_cluster_set_retry_policy(cluster, default_policy);
         cass_retry_policy_free(default_policy);
     }
+}
+
+// Consistency the driver applies to statements that do not set their own
+static CassConsistency cluster_default_consistency(VALUE options) {
+    VALUE consistency = NIL_P(options) ? Qnil : rb_hash_aref(options, ID2SYM(rb_intern("consistency")));
+    return NIL_P(consistency) ? CASS_CONSISTENCY_LOCAL_ONE : (CassConsistency)NUM2INT(consistency);
+}
+
+// Cluster methods
+static VALUE cluster_new(VALUE klass, VALUE options) {
+    cluster_wrapper_t* wrapper = ALLOC(cluster_wrapper_t);
+    wrapper->cluster = NULL;
+    wrapper->connect_future = NULL;
+    wrapper->session = NULL;
+    wrapper->consistency = CASS_CONSISTENCY_LOCAL_ONE;
+    
+    VALUE cluster_obj = TypedData_Wrap_Struct(klass, &cluster_type, wrapper);
+    wrapper->cluster = cass_cluster_new();
+    cluster_configure(wrapper->cluster, options);
+    wrapper->consistency = cluster_default_consistency(options);
     
-    return TypedData_Wrap_Struct(klass, &cluster_type, wrapper);
+    return cluster_obj;
 }
 
 static VALUE cluster_connect(int argc, VALUE* argv, VALUE self) {
@@ -241,18 +261,223 @@ static VALUE cluster_connect(int argc, VALUE* argv, VALUE self) {
     session_wrapper_t* session_wrapper = ALLOC(session_wrapper_t);
     session_wrapper->session = cluster->session;
     session_wrapper->cluster_ref = self;
+    session_wrapper->gate = NULL;
+    session_wrapper->shared = NULL;
+    session_wrapper->consistency = cluster->consistency;
     
     VALUE session_obj = TypedData_Wrap_Struct(rb_cSession, &session_type, session_wrapper);
     
     // Keep reference to prevent cluster from being GC'd
     rb_iv_set(session_obj, "@cluster", self);
+    rb_iv_set(session_obj, "@keyspace", keyspace);
     
     return session_obj;
 }
 
+// Shared connections: one driver cluster and session per registry key,
+// handed to every consumer that asks for the same key and freed with the
+// last reference. Only touched with the GVL held, so the registry and the
+// reference counts need no locking.
+struct shared_connection_s {
+    std::string key;
+    CassCluster* cluster;
+    CassSession* session;
+    CassFuture* connect_future;
+    CassConsistency consistency;
+    long refs;
+};
+
+static std::unordered_map<std::string, shared_connection_t*>* shared_connections;
+
+static void shared_connection_unregister(shared_connection_t* connection) {
+    std::unordered_map<std::string, shared_connection_t*>::iterator it = shared_connections->find(connection->key);
+    if (it != shared_connections->end() && it->second == connection) {
+        shared_connections->erase(it);
+    }
+}
+
+// Closes the session synchronously when it is still connected
+static void shared_connection_destroy(shared_connection_t* connection) {
+    cass_session_free(connection->session);
+    cass_future_free(connection->connect_future);
+    cass_cluster_free(connection->cluster);
+    delete connection;
+}
+
+typedef struct {
+    shared_connection_t* connection;
+    bool destroyed;
+} shared_connection_close_t;
+
+static void* shared_connection_close_without_gvl(void* ptr) {
+    shared_connection_close_t* close = (shared_connection_close_t*)ptr;
+    shared_connection_destroy(close->connection);
+    close->destroyed = true;
+    return NULL;
+}
+
+// Connections whose last reference went away in a GC free, where blocking
+// on the driver's close would stall the collector. The closer thread is
+// started on first use, and again in a forked child, which has none.
+// Allocated once and never destroyed: the detached thread outlives exit.
+static std::mutex* closer_lock;
+static std::condition_variable* closer_ready;
+static std::deque<shared_connection_t*>* closer_queue;
+static pid_t closer_pid = 0;
+
+static void shared_connection_closer() {
+    std::unique_lock<std::mutex> lock(*closer_lock);
+    for (;;) {
+        closer_ready->wait(lock, [] { return !closer_queue->empty(); });
+        shared_connection_t* connection = closer_queue->front();
+        closer_queue->pop_front();
+        lock.unlock();
+        shared_connection_destroy(connection);
+        lock.lock();
+    }
+}
+
+static bool shared_connection_close_later(shared_connection_t* connection) {
+    std::lock_guard<std::mutex> lock(*closer_lock);
+    
+    if (closer_pid != getpid()) {
+        try {
+            std::thread(shared_connection_closer).detach();
+        } catch (const std::system_error&) {
+            return false;
+        }
+        closer_pid = getpid();
+    }
+    closer_queue->push_back(connection);
+    closer_ready->notify_one();
+    
+    return true;
+}
+
+void shared_connection_release(shared_connection_t* connection, bool in_gc) {
+    if (!connection || --connection->refs > 0) {
+        return;
+    }
+    
+    shared_connection_unregister(connection);
+    
+    if (in_gc) {
+        if (!shared_connection_close_later(connection)) {
+            shared_connection_destroy(connection);
+        }
+        return;
+    }
+    
+    // The close cannot be interrupted; func does not run at all when an
+    // interrupt is already pending, so finish it with the GVL held then
+    shared_connection_close_t close = { connection, false };
+    gvl_release_call(shared_connection_close_without_gvl, &close, NULL, NULL);
+    if (!close.destroyed) {
+        shared_connection_destroy(connection);
+    }
+}
+
+static shared_connection_t* shared_connection_find(VALUE key) {
+    std::unordered_map<std::string, shared_connection_t*>::iterator it =
+        shared_connections->find(std::string(RSTRING_PTR(key), (size_t)RSTRING_LEN(key)));
+    return it == shared_connections->end() ? NULL : it->second;
+}
+
+// Register a connection for key and start connecting it; takes ownership
+// of cluster
+static shared_connection_t* shared_connection_open(VALUE key, CassCluster* cluster, CassConsistency consistency,
+                                                   const char* keyspace) {
+    shared_connection_t* connection = new shared_connection_t();
+    connection->key.assign(RSTRING_PTR(key), (size_t)RSTRING_LEN(key));
+    connection->cluster = cluster;
+    connection->consistency = consistency;
+    connection->session = cass_session_new();
+    connection->refs = 0;
+    
+    if (keyspace) {
+        connection->connect_future = cass_session_connect_keyspace(connection->session, cluster, keyspace);
+    } else {
+        connection->connect_future = cass_session_connect(connection->session, cluster);
+    }
+    
+    (*shared_connections)[connection->key] = connection;
+    return connection;
+}
+
+// Ruby method: NativeCluster.acquire_shared(key, options, keyspace) -> NativeSession
+// Returns a session on the connection registered under key, connecting one
+// configured from options when there is none. Every returned session holds
+// a reference that Session#close (or GC) gives back.
+static VALUE cluster_acquire_shared(VALUE klass, VALUE key, VALUE options, VALUE keyspace) {
+    StringValue(key);
+    const char* keyspace_str = NIL_P(keyspace) ? NULL : StringValueCStr(keyspace);
+    
+    session_wrapper_t* session_wrapper = ALLOC(session_wrapper_t);
+    session_wrapper->session = NULL;
+    session_wrapper->cluster_ref = Qnil;
+    session_wrapper->gate = NULL;
+    session_wrapper->shared = NULL;
+    session_wrapper->consistency = CASS_CONSISTENCY_LOCAL_ONE;
+    VALUE session_obj = TypedData_Wrap_Struct(rb_cSession, &session_type, session_wrapper);
+    rb_iv_set(session_obj, "@keyspace", keyspace);
+    
+    shared_connection_t* connection = shared_connection_find(key);
+    if (!connection) {
+        // Configure through a throwaway NativeCluster so bad options raise
+        // before anything is registered, then take over its driver cluster
+        VALUE configured = cluster_new(klass, options);
+        cluster_wrapper_t* cluster_wrapper;
+        TypedData_Get_Struct(configured, cluster_wrapper_t, &cluster_type, cluster_wrapper);
+        CassCluster* cluster = cluster_wrapper->cluster;
+        cluster_wrapper->cluster = NULL;
+        
+        connection = shared_connection_open(key, cluster, cluster_wrapper->consistency, keyspace_str);
+    }
+    connection->refs++;
+    session_wrapper->shared = connection;
+    
+    // Concurrent first acquirers all wait on the same connect
+    wait_for_future(connection->connect_future, 0, NULL);
+    if (cass_future_error_code(connection->connect_future) != CASS_OK) {
+        const char* message;
+        size_t message_length;
+        cass_future_error_message(connection->connect_future, &message, &message_length);
+        VALUE error_msg = rb_sprintf("Cassandra connection error: %.*s", (int)message_length, message);
+        
+        // Let the next acquirer retry with a fresh connection
+        shared_connection_unregister(connection);
+        session_wrapper->shared = NULL;
+        shared_connection_release(connection, false);
+        rb_raise(rb_eCassandraError, "%s", StringValueCStr(error_msg));
+    }
+    
+    session_wrapper->session = connection->session;
+    session_wrapper->consistency = connection->consistency;
+    return session_obj;
+}
+
+// Ruby method: NativeCluster.shared_connections -> { key => references }
+static VALUE cluster_shared_connections(VALUE klass) {
+    VALUE connections = rb_hash_new();
+    
+    for (std::unordered_map<std::string, shared_connection_t*>::iterator it = shared_connections->begin();
+         it != shared_connections->end(); ++it) {
+        rb_hash_aset(connections, rb_str_new(it->first.data(), (long)it->first.size()), LONG2NUM(it->second->refs));
+    }
+    
+    return connections;
+}
+
 void init_cluster() {
+    shared_connections = new std::unordered_map<std::string, shared_connection_t*>();
+    closer_lock = new std::mutex();
+    closer_ready = new std::condition_variable();
+    closer_queue = new std::deque<shared_connection_t*>();
+    
     rb_cCluster = rb_define_class_under(rb_cCassandraCpp, "NativeCluster", rb_cObject);
     rb_undef_alloc_func(rb_cCluster);
     rb_define_singleton_method(rb_cCluster, "new", (VALUE(*)(...))cluster_new, 1);
+    rb_define_singleton_method(rb_cCluster, "acquire_shared", (VALUE(*)(...))cluster_acquire_shared, 3);
+    rb_define_singleton_method(rb_cCluster, "shared_connections", (VALUE(*)(...))cluster_shared_connections, 0);
     rb_define_method(rb_cCluster, "connect", (VALUE(*)(...))cluster_connect, -1);
 }
\ No newline at end of file
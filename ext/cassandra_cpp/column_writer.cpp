@@ -0,0 +1,319 @@
+#include "cassandra_cpp.h"
+
+// Element types of packed column buffers (native byte order)
+typedef enum {
+    PACKED_NONE,
+    PACKED_INT32,
+    PACKED_INT64,
+    PACKED_FLOAT,
+    PACKED_DOUBLE
+} packed_type_t;
+
+// One bind parameter fed from a column: either a Ruby Array of values or a
+// String holding packed numbers
+typedef struct {
+    VALUE values;
+    packed_type_t packed;
+    CassValueType param_type;
+    size_t vector_dimensions;  // Non-zero for vector<float, n> parameters
+} column_source_t;
+
+typedef struct {
+    const CassPrepared* prepared;
+    request_window_t* window;
+    std::vector<column_source_t>* columns;
+    long row_count;
+} column_write_t;
+
+static packed_type_t packed_type_from_ruby(VALUE type) {
+    if (NIL_P(type)) {
+        return PACKED_NONE;
+    }
+    
+    ID id = SYM2ID(type);
+    if (id == rb_intern("int32")) return PACKED_INT32;
+    if (id == rb_intern("int64")) return PACKED_INT64;
+    if (id == rb_intern("float")) return PACKED_FLOAT;
+    if (id == rb_intern("double")) return PACKED_DOUBLE;
+    
+    rb_raise(rb_eArgError, "Unknown packed type: %" PRIsVALUE ". Use :int32, :int64, :float or :double", type);
+    return PACKED_NONE;
+}
+
+static size_t packed_type_size(packed_type_t type) {
+    switch (type) {
+        case PACKED_INT32: return sizeof(cass_int32_t);
+        case PACKED_INT64: return sizeof(cass_int64_t);
+        case PACKED_FLOAT: return sizeof(cass_float_t);
+        case PACKED_DOUBLE: return sizeof(cass_double_t);
+        default: return 0;
+    }
+}
+
+static size_t column_parameter_count(const CassPrepared* prepared) {
+    const char* param_name;
+    size_t param_name_length;
+    size_t count = 0;
+    
+    while (cass_prepared_parameter_name(prepared, count, &param_name, &param_name_length) == CASS_OK) {
+        count++;
+    }
+    
+    return count;
+}
+
+// Bind position of a named parameter of the prepared statement, or -1
+static long column_parameter_index(const CassPrepared* prepared, size_t parameter_count, VALUE name) {
+    const char* param_name;
+    size_t param_name_length;
+    
+    for (size_t index = 0; index < parameter_count; index++) {
+        cass_prepared_parameter_name(prepared, index, &param_name, &param_name_length);
+        if ((size_t)RSTRING_LEN(name) == param_name_length &&
+            memcmp(RSTRING_PTR(name), param_name, param_name_length) == 0) {
+            return (long)index;
+        }
+    }
+    
+    return -1;
+}
+
+// NUM2INT only checks the int range; narrower columns would silently wrap
+static int column_small_integer(VALUE value, int min, int max, const char* cql_name) {
+    int number = NUM2INT(value);
+    if (number < min || number > max) {
+        rb_raise(rb_eRangeError, "%d is out of range for a %s column", number, cql_name);
+    }
+    return number;
+}
+
+// Integers and floats bind at the parameter's width instead of the width
+// guessed from the Ruby value, so small numbers can fill bigint columns
+static CassError column_bind_value(CassStatement* statement, size_t index, CassValueType param_type, VALUE value) {
+    if (RB_INTEGER_TYPE_P(value)) {
+        switch (param_type) {
+            case CASS_VALUE_TYPE_TINY_INT:
+                return cass_statement_bind_int8(statement, index,
+                                                (cass_int8_t)column_small_integer(value, INT8_MIN, INT8_MAX, "tinyint"));
+            case CASS_VALUE_TYPE_SMALL_INT:
+                return cass_statement_bind_int16(statement, index,
+                                                 (cass_int16_t)column_small_integer(value, INT16_MIN, INT16_MAX, "smallint"));
+            case CASS_VALUE_TYPE_INT:
+                return cass_statement_bind_int32(statement, index, (cass_int32_t)NUM2INT(value));
+            case CASS_VALUE_TYPE_BIGINT:
+            case CASS_VALUE_TYPE_COUNTER:
+            case CASS_VALUE_TYPE_TIMESTAMP:
+                return cass_statement_bind_int64(statement, index, (cass_int64_t)NUM2LL(value));
+            case CASS_VALUE_TYPE_FLOAT:
+                return cass_statement_bind_float(statement, index, (cass_float_t)NUM2DBL(value));
+            case CASS_VALUE_TYPE_DOUBLE:
+                return cass_statement_bind_double(statement, index, NUM2DBL(value));
+            default:
+                break;
+        }
+    } else if (RB_FLOAT_TYPE_P(value) && param_type == CASS_VALUE_TYPE_FLOAT) {
+        return cass_statement_bind_float(statement, index, (cass_float_t)NUM2DBL(value));
+    }
+    
+    return bind_ruby_value_to_statement(statement, index, value);
+}
+
+static CassError column_bind_packed(CassStatement* statement, size_t index, packed_type_t type,
+                                    const char* buffer, long row) {
+    switch (type) {
+        case PACKED_INT32: {
+            cass_int32_t value;
+            memcpy(&value, buffer + row * sizeof(value), sizeof(value));
+            return cass_statement_bind_int32(statement, index, value);
+        }
+        case PACKED_INT64: {
+            cass_int64_t value;
+            memcpy(&value, buffer + row * sizeof(value), sizeof(value));
+            return cass_statement_bind_int64(statement, index, value);
+        }
+        case PACKED_FLOAT: {
+            cass_float_t value;
+            memcpy(&value, buffer + row * sizeof(value), sizeof(value));
+            return cass_statement_bind_float(statement, index, value);
+        }
+        case PACKED_DOUBLE: {
+            cass_double_t value;
+            memcpy(&value, buffer + row * sizeof(value), sizeof(value));
+            return cass_statement_bind_double(statement, index, value);
+        }
+        default:
+            return CASS_ERROR_LIB_INVALID_VALUE_TYPE;
+    }
+}
+
+static VALUE column_write_run(VALUE arg) {
+    column_write_t* write = (column_write_t*)arg;
+    std::vector<column_source_t>& columns = *write->columns;
+    
+    for (long row = 0; row < write->row_count; row++) {
+        if (request_window_full(write->window)) {
+            cass_result_free(request_window_next(write->window));
+        }
+        
+        uint64_t started_ns = monotonic_now_ns();
+        CassStatement* statement = cass_prepared_bind(write->prepared);
+        
+        for (size_t index = 0; index < columns.size(); index++) {
+            const column_source_t& column = columns[index];
+            CassError rc;
+            
+            if (column.vector_dimensions > 0 && column.packed == PACKED_FLOAT) {
+                rc = bind_float_vector_buffer(statement, index,
+                                              RSTRING_PTR(column.values) + row * column.vector_dimensions * sizeof(float),
+                                              column.vector_dimensions);
+            } else if (column.vector_dimensions > 0) {
+                VALUE value = rb_ary_entry(column.values, row);
+                rc = NIL_P(value) ? cass_statement_bind_null(statement, index)
+                                  : bind_float_vector_to_statement(statement, index, column.vector_dimensions, value);
+            } else if (column.packed == PACKED_NONE) {
+                rc = column_bind_value(statement, index, column.param_type, rb_ary_entry(column.values, row));
+            } else {
+                rc = column_bind_packed(statement, index, column.packed, RSTRING_PTR(column.values), row);
+            }
+            
+            if (rc != CASS_OK) {
+                cass_statement_free(statement);
+                rb_raise(rb_eCassandraError, "Failed to bind row %ld, parameter %lu: %s",
+                         row, (unsigned long)index, cass_error_desc(rc));
+            }
+        }
+        
+        request_window_submit(write->window, statement, started_ns);
+    }
+    
+    while (!request_window_empty(write->window)) {
+        cass_result_free(request_window_next(write->window));
+    }
+    
+    return Qnil;
+}
+
+static VALUE column_write_cleanup(VALUE arg) {
+    column_write_t* write = (column_write_t*)arg;
+    
+    request_window_free(write->window);
+    delete write->columns;
+    
+    return Qnil;
+}
+
+// Ruby method: prepared.write_columns(names, columns, packed_types, concurrency)
+// Executes the statement once per row, binding row i from element i of each
+// column: names[k] is the parameter fed by columns[k], which is an Array, or
+// a String of packed packed_types[k] values (n floats per row for a
+// vector<float, n> parameter). Every parameter must be covered
+// and all columns must have the same number of rows. Up to concurrency rows
+// are in flight at a time. Returns the number of rows written.
+static VALUE prepared_statement_write_columns(VALUE self, VALUE names, VALUE columns, VALUE packed_types,
+                                              VALUE concurrency) {
+    prepared_statement_wrapper_t* prepared_wrapper;
+    TypedData_Get_Struct(self, prepared_statement_wrapper_t, &prepared_statement_type, prepared_wrapper);
+    
+    session_wrapper_t* session_wrapper;
+    TypedData_Get_Struct(rb_iv_get(self, "@session"), session_wrapper_t, &session_type, session_wrapper);
+    
+    Check_Type(names, T_ARRAY);
+    Check_Type(columns, T_ARRAY);
+    Check_Type(packed_types, T_ARRAY);
+    if (RARRAY_LEN(columns) != RARRAY_LEN(names) || RARRAY_LEN(packed_types) != RARRAY_LEN(names)) {
+        rb_raise(rb_eArgError, "names, columns and packed types must have the same length");
+    }
+    size_t capacity = window_capacity_from_ruby(concurrency);
+    
+    // Validate everything up front; the C++ state below is only created once
+    // nothing else can raise before the ensure handler is in place
+    long column_count = RARRAY_LEN(names);
+    long row_count = -1;
+    size_t parameter_count = column_parameter_count(prepared_wrapper->prepared);
+    if ((size_t)column_count != parameter_count) {
+        rb_raise(rb_eArgError, "Expected %lu columns, one per bind parameter, got %ld",
+                 (unsigned long)parameter_count, column_count);
+    }
+    
+    VALUE ordered = rb_ary_new_capa(column_count);
+    VALUE ordered_types = rb_ary_new_capa(column_count);
+    
+    for (long i = 0; i < column_count; i++) {
+        VALUE name = rb_obj_as_string(RARRAY_AREF(names, i));
+        VALUE values = RARRAY_AREF(columns, i);
+        packed_type_t packed = packed_type_from_ruby(RARRAY_AREF(packed_types, i));
+        
+        long index = column_parameter_index(prepared_wrapper->prepared, parameter_count, name);
+        if (index < 0) {
+            rb_raise(rb_eArgError, "Unknown column: %s", StringValueCStr(name));
+        }
+        if (!NIL_P(rb_ary_entry(ordered, index))) {
+            rb_raise(rb_eArgError, "Duplicate column: %s", StringValueCStr(name));
+        }
+        
+        // A packed :float column feeding a vector<float, n> holds n floats per row
+        size_t vector_dimensions = float_vector_dimensions(
+            cass_prepared_parameter_data_type(prepared_wrapper->prepared, (size_t)index));
+        
+        long rows;
+        if (packed == PACKED_NONE) {
+            Check_Type(values, T_ARRAY);
+            rows = RARRAY_LEN(values);
+        } else {
+            // Rows are bound straight from the buffer, and other threads run
+            // while the window waits without the GVL; a frozen copy (shared
+            // until the caller writes to it) cannot be resized or freed under us
+            StringValue(values);
+            values = rb_str_new_frozen(values);
+            size_t element_size = packed_type_size(packed);
+            if (vector_dimensions > 0) {
+                if (packed != PACKED_FLOAT) {
+                    rb_raise(rb_eArgError, "Packed column %s feeds a vector<float, %lu>; pack it as :float",
+                             StringValueCStr(name), (unsigned long)vector_dimensions);
+                }
+                element_size *= vector_dimensions;
+            }
+            if ((size_t)RSTRING_LEN(values) % element_size != 0) {
+                rb_raise(rb_eArgError, "Packed column %s is not a whole number of values", StringValueCStr(name));
+            }
+            rows = (long)((size_t)RSTRING_LEN(values) / element_size);
+        }
+        
+        if (row_count >= 0 && rows != row_count) {
+            rb_raise(rb_eArgError, "Column %s has %ld rows, expected %ld", StringValueCStr(name), rows, row_count);
+        }
+        row_count = rows;
+        
+        rb_ary_store(ordered, index, values);
+        rb_ary_store(ordered_types, index, INT2NUM(packed));
+    }
+    
+    column_write_t write;
+    write.prepared = prepared_wrapper->prepared;
+    write.row_count = row_count < 0 ? 0 : row_count;
+    write.columns = new std::vector<column_source_t>((size_t)column_count);
+    for (long i = 0; i < column_count; i++) {
+        column_source_t& column = (*write.columns)[(size_t)i];
+        column.values = RARRAY_AREF(ordered, i);
+        column.packed = (packed_type_t)NUM2INT(RARRAY_AREF(ordered_types, i));
+        const CassDataType* param_data_type = cass_prepared_parameter_data_type(prepared_wrapper->prepared, (size_t)i);
+        column.param_type = cass_data_type_type(param_data_type);
+        column.vector_dimensions = float_vector_dimensions(param_data_type);
+    }
+    write.window = request_window_new(session_wrapper->session, capacity, prepared_wrapper->stats,
+                                      "columnar write");
+    write.window->breaker = circuit_breaker_for_prepared(self, prepared_wrapper);
+    write.window->gate = session_wrapper->gate;
+    write.window->priority = priority_current();
+    write.window->query_id = prepared_wrapper->query_id;
+    
+    rb_ensure(column_write_run, (VALUE)&write, column_write_cleanup, (VALUE)&write);
+    
+    // Keeps the column arrays and frozen buffers referenced by write.columns alive
+    RB_GC_GUARD(ordered);
+    return LONG2NUM(write.row_count);
+}
+
+void init_column_writer() {
+    rb_define_method(rb_cPreparedStatement, "write_columns", (VALUE(*)(...))prepared_statement_write_columns, 4);
+}
\ No newline at end of file
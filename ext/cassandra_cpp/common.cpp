@@ -1,4 +1,5 @@
 #include "cassandra_cpp.h"
+#include <ruby/thread.h>
 #include <math.h>
 
 // Global Ruby class references
@@ -9,19 +10,252 @@ VALUE rb_cPreparedStatement;
 VALUE rb_cStatement;
 VALUE rb_cBatch;
 VALUE rb_cFuture;
+VALUE rb_cResult;
 VALUE rb_eCassandraError;
 
+// A wait is done in slices so an interrupt is noticed without a driver
+// callback (futures may already have one); a slice ends early once the
+// future resolves
+#define FUTURE_WAIT_SLICE_US 10000
+
+typedef struct {
+    CassFuture* future;
+    uint64_t deadline_ns;  // 0 waits until the future resolves
+    cass_bool_t completed;
+    uint64_t ready_ns;
+    std::atomic<bool> interrupted;
+} future_wait_args_t;
+
+static void* future_wait_without_gvl(void* ptr) {
+    future_wait_args_t* args = (future_wait_args_t*)ptr;
+    
+    while (!args->interrupted.load(std::memory_order_relaxed)) {
+        cass_uint64_t slice_us = FUTURE_WAIT_SLICE_US;
+        if (args->deadline_ns != 0) {
+            uint64_t now = monotonic_now_ns();
+            if (now >= args->deadline_ns) {
+                break;
+            }
+            if ((args->deadline_ns - now) / 1000ULL < slice_us) {
+                slice_us = (args->deadline_ns - now + 999ULL) / 1000ULL;
+            }
+        }
+        if (cass_future_wait_timed(args->future, slice_us)) {
+            args->completed = cass_true;
+            break;
+        }
+    }
+    
+    args->ready_ns = monotonic_now_ns();
+    return NULL;
+}
+
+static void future_wait_unblock(void* ptr) {
+    future_wait_args_t* args = (future_wait_args_t*)ptr;
+    args->interrupted.store(true, std::memory_order_relaxed);
+}
+
+// Wait for a future with the GVL released so other Ruby threads keep running.
+// A timeout of 0 waits indefinitely. When timing is given, the moment the
+// future resolved and the moment the GVL was reacquired are stamped into it.
+// Interrupts such as Thread#raise, Timeout or Ctrl-C are delivered while
+// waiting, so this may raise; callers holding a breaker admission or a
+// priority slot use wait_for_request instead.
+cass_bool_t wait_for_future(CassFuture* future, cass_uint64_t timeout_us, request_timing_t* timing) {
+    future_wait_args_t args;
+    args.future = future;
+    args.deadline_ns = timeout_us == 0 ? 0 : monotonic_now_ns() + timeout_us * 1000ULL;
+    args.completed = cass_future_ready(future);
+    args.ready_ns = args.completed ? monotonic_now_ns() : 0;
+    
+    // An interrupt that does not raise (e.g. a trap handler) resumes the wait
+    while (!args.completed && (args.deadline_ns == 0 || monotonic_now_ns() < args.deadline_ns)) {
+        args.interrupted.store(false, std::memory_order_relaxed);
+        gvl_release_call(future_wait_without_gvl, &args, future_wait_unblock, &args);
+    }
+    
+    if (timing) {
+        timing->ready_ns = args.ready_ns;
+        timing->resumed_ns = monotonic_now_ns();
+    }
+    
+    return args.completed;
+}
+
+static void request_completion_callback(CassFuture* future, void* data) {
+    inflight_request_t* request = (inflight_request_t*)data;
+    uint64_t latency_ns = monotonic_now_ns() - request->submitted_ns;
+    
+    circuit_breaker_record(request->breaker, cass_future_error_code(future), latency_ns);
+    priority_gate_exit(request->gate, request->priority, latency_ns);
+    delete request;
+}
+
+// Report the request's outcome to its breaker and give back its priority
+// slot from the driver callback, so both happen as soon as it resolves even
+// if nobody consumes the future. No Ruby calls.
+void request_release_on_completion(const inflight_request_t* request) {
+    if (!request->breaker && !request->gate) {
+        return;
+    }
+    
+    inflight_request_t* completion = new inflight_request_t(*request);
+    if (cass_future_set_callback(request->future, request_completion_callback, completion) != CASS_OK) {
+        delete completion;
+        circuit_breaker_cancel(request->breaker);
+        priority_gate_exit(request->gate, request->priority, 0);
+    }
+}
+
+typedef struct {
+    CassFuture* future;
+    cass_uint64_t timeout_us;
+    request_timing_t* timing;
+    cass_bool_t completed;
+} request_wait_t;
+
+static VALUE request_wait_run(VALUE arg) {
+    request_wait_t* wait = (request_wait_t*)arg;
+    wait->completed = wait_for_future(wait->future, wait->timeout_us, wait->timing);
+    return Qnil;
+}
+
+// wait_for_future for a request the caller still owes an outcome to its
+// breaker and gate. When an interrupt unwinds the wait, the request is left
+// to request_release_on_completion and its future freed before re-raising,
+// so the caller must not touch the future afterwards.
+cass_bool_t wait_for_request(const inflight_request_t* request, cass_uint64_t timeout_us, request_timing_t* timing) {
+    request_wait_t wait = { request->future, timeout_us, timing, cass_false };
+    int state = 0;
+    
+    rb_protect(request_wait_run, (VALUE)&wait, &state);
+    if (state) {
+        request_release_on_completion(request);
+        cass_future_free(request->future);
+        rb_jump_tag(state);
+    }
+    
+    return wait.completed;
+}
+
+typedef struct {
+    priority_gate_t* gate;
+    priority_class_t priority;
+} request_gate_entry_t;
+
+static VALUE request_gate_enter(VALUE arg) {
+    request_gate_entry_t* entry = (request_gate_entry_t*)arg;
+    priority_gate_enter(entry->gate, entry->priority);
+    return Qnil;
+}
+
+// Admit a request to its breaker, then queue it for a priority slot; either
+// may be NULL. When the breaker is open, or an interrupt unwinds the queue
+// wait, statement (if given, otherwise owned elsewhere) is freed and the
+// breaker admission given back before raising, so nothing taken here
+// outlives the raise.
+void request_admit(circuit_breaker_t* breaker, priority_gate_t* gate, priority_class_t priority,
+                   CassStatement* statement) {
+    if (!circuit_breaker_admit(breaker)) {
+        if (statement) {
+            cass_statement_free(statement);
+        }
+        circuit_breaker_raise_open(breaker);
+    }
+    
+    request_gate_entry_t entry = { gate, priority };
+    int state = 0;
+    rb_protect(request_gate_enter, (VALUE)&entry, &state);
+    if (state) {
+        circuit_breaker_cancel(breaker);
+        if (statement) {
+            cass_statement_free(statement);
+        }
+        rb_jump_tag(state);
+    }
+}
+
+// request_admit for an optional extra request: admitted only when the breaker
+// lets it through and a priority slot is free right now, never queueing or
+// raising. On false nothing is held.
+bool request_try_admit(circuit_breaker_t* breaker, priority_gate_t* gate, priority_class_t priority) {
+    if (!circuit_breaker_admit(breaker)) {
+        return false;
+    }
+    if (!priority_gate_try_enter(gate, priority)) {
+        circuit_breaker_cancel(breaker);
+        return false;
+    }
+    return true;
+}
+
 // Helper function to raise Cassandra errors
 void raise_cassandra_error(CassFuture* future, const char* operation) {
     const char* message;
     size_t message_length;
     cass_future_error_message(future, &message, &message_length);
     
-    VALUE error_msg = rb_sprintf("Cassandra %s error: %.*s", 
+    VALUE error_msg = rb_sprintf("Cassandra %s error: %.*s",
                                 operation, (int)message_length, message);
     rb_raise(rb_eCassandraError, "%s", StringValueCStr(error_msg));
 }
 
+// Milliseconds since the epoch as a Ruby Time
+VALUE timestamp_to_ruby(cass_int64_t milliseconds) {
+    time_t seconds = (time_t)(milliseconds / 1000);
+    long microseconds = (long)(milliseconds % 1000) * 1000;
+    if (microseconds < 0) {
+        seconds -= 1;
+        microseconds += 1000000;
+    }
+    return rb_time_new(seconds, microseconds);
+}
+
+VALUE uuid_to_ruby(CassUuid uuid) {
+    char uuid_str[CASS_UUID_STRING_LENGTH];
+    cass_uuid_string(uuid, uuid_str);
+    return rb_str_new_cstr(uuid_str);
+}
+
+typedef struct crc32_table_s {
+    uint32_t entries[256];
+    
+    crc32_table_s() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int bit = 0; bit < 8; bit++) {
+                c = (c & 1) ? 0xedb88320U ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+    }
+} crc32_table_t;
+
+// Continue a zlib-compatible CRC32 over another buffer; start with crc 0
+uint32_t crc32_update(uint32_t crc, const void* bytes, size_t length) {
+    // Built on first use; callers run without the GVL too, so this relies on
+    // thread-safe static initialization
+    static const crc32_table_t table;
+    
+    const unsigned char* data = (const unsigned char*)bytes;
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = table.entries[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// 64-bit FNV-1a
+uint64_t fnv1a_64(const void* bytes, size_t length) {
+    const unsigned char* data = (const unsigned char*)bytes;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
 // Helper function to convert CassValue to Ruby value
 VALUE convert_cass_value_to_ruby(const CassValue* value) {
     if (cass_value_is_null(value)) {
@@ -56,9 +290,14 @@ VALUE convert_cass_value_to_ruby(const CassValue* value) {
         case CASS_VALUE_TYPE_UUID: {
             CassUuid uuid_val;
             cass_value_get_uuid(value, &uuid_val);
-            char uuid_str[CASS_UUID_STRING_LENGTH];
-            cass_uuid_string(uuid_val, uuid_str);
-            return rb_str_new_cstr(uuid_str);
+            return uuid_to_ruby(uuid_val);
+        }
+        case CASS_VALUE_TYPE_INET: {
+            CassInet inet_val;
+            cass_value_get_inet(value, &inet_val);
+            char inet_str[CASS_INET_STRING_LENGTH];
+            cass_inet_string(inet_val, inet_str);
+            return rb_str_new_cstr(inet_str);
         }
         case CASS_VALUE_TYPE_FLOAT: {
             cass_float_t float_val;
@@ -73,9 +312,7 @@ VALUE convert_cass_value_to_ruby(const CassValue* value) {
         case CASS_VALUE_TYPE_TIMESTAMP: {
             cass_int64_t timestamp_val;
             cass_value_get_int64(value, &timestamp_val);
-            // Convert milliseconds since epoch to Ruby Time
-            double time_seconds = (double)timestamp_val / 1000.0;
-            return rb_time_new(time_seconds, (time_seconds - floor(time_seconds)) * 1000000);
+            return timestamp_to_ruby(timestamp_val);
         }
         case CASS_VALUE_TYPE_DECIMAL: {
             const cass_byte_t* decimal_bytes;
@@ -84,7 +321,7 @@ VALUE convert_cass_value_to_ruby(const CassValue* value) {
             cass_value_get_decimal(value, &decimal_bytes, &decimal_size, &scale);
             
             // Convert to BigDecimal string representation
-            // This is a simplified implementation - for production use, 
+            // This is a simplified implementation - for production use,
             // you'd want proper arbitrary precision decimal handling
             VALUE decimal_str = rb_str_new_cstr("0");
             
@@ -165,7 +402,55 @@ VALUE convert_cass_value_to_ruby(const CassValue* value) {
             cass_iterator_free(iterator);
             return array;
         }
+        case CASS_VALUE_TYPE_CUSTOM: {
+            // vector<float, n> decodes to a packed FloatVector, not an Array of Floats
+            if (float_vector_dimensions(cass_value_data_type(value)) > 0) {
+                return float_vector_from_cass_value(value);
+            }
+            return rb_str_new_cstr("[unsupported type]");
+        }
         default:
             return rb_str_new_cstr("[unsupported type]");
     }
+}
+
+// Helper function to convert CassResult rows to a Ruby array of hashes
+VALUE convert_result_to_ruby(const CassResult* result, uint64_t query_id) {
+    VALUE rows = rb_ary_new();
+    
+    if (!result) {
+        return rows;
+    }
+    
+    size_t row_count = cass_result_row_count(result);
+    uint64_t decode_started_ns = CASSANDRA_CPP_PROBE_ENABLED(decode__end) ? monotonic_now_ns() : 0;
+    CASSANDRA_CPP_PROBE2(decode__start, query_id, row_count);
+    
+    CassIterator* iterator = cass_iterator_from_result(result);
+    size_t column_count = cass_result_column_count(result);
+    
+    while (cass_iterator_next(iterator)) {
+        const CassRow* row = cass_iterator_get_row(iterator);
+        
+        VALUE row_hash = rb_hash_new();
+        
+        for (size_t i = 0; i < column_count; i++) {
+            const char* column_name;
+            size_t column_name_length;
+            cass_result_column_name(result, i, &column_name, &column_name_length);
+            
+            const CassValue* value = cass_row_get_column(row, i);
+            VALUE ruby_value = convert_cass_value_to_ruby(value);
+            
+            VALUE column_key = rb_str_new(column_name, column_name_length);
+            rb_hash_aset(row_hash, column_key, ruby_value);
+        }
+        
+        rb_ary_push(rows, row_hash);
+    }
+    
+    cass_iterator_free(iterator);
+    CASSANDRA_CPP_PROBE3(decode__end, query_id, row_count,
+                         decode_started_ns ? monotonic_now_ns() - decode_started_ns : 0);
+    return rows;
 }
\ No newline at end of file
@@ -0,0 +1,341 @@
+#include "cassandra_cpp.h"
+
+// Table copy: source pages are read by several token-range readers at once
+// and every row is re-bound value by value into the destination statement,
+// which runs through a request window. A reader's next page is requested
+// before the current one is written, so reads and writes overlap.
+//
+// Scalar values are bound straight from the driver's decoded values;
+// collections, tuples and UDTs are converted through Ruby values.
+
+typedef struct {
+    CassStatement* statement;  // Range query, carries the paging state; NULL when idle
+    CassFuture* future;        // Page in flight, NULL when none
+} copy_reader_t;
+
+typedef struct {
+    CassSession* source_session;
+    const CassPrepared* source;
+    const CassPrepared* dest;
+    size_t dest_parameter_count;
+    VALUE ranges;              // [[from, to], ...] token bounds, exclusive from
+    long next_range;
+    int page_size;
+    std::vector<copy_reader_t>* readers;
+    request_window_t* window;
+    const CassResult* result;  // Page being written
+    CassIterator* iterator;
+    CassFuture* failed;        // Kept alive while its error is raised
+    long rows;
+} table_copy_t;
+
+// Bind a decoded source value as parameter index of a destination statement
+static CassError copy_bind_value(CassStatement* statement, size_t index, const CassValue* value) {
+    if (cass_value_is_null(value)) {
+        return cass_statement_bind_null(statement, index);
+    }
+    
+    switch (cass_value_type(value)) {
+        case CASS_VALUE_TYPE_ASCII:
+        case CASS_VALUE_TYPE_TEXT:
+        case CASS_VALUE_TYPE_VARCHAR: {
+            const char* string;
+            size_t length;
+            cass_value_get_string(value, &string, &length);
+            return cass_statement_bind_string_n(statement, index, string, length);
+        }
+        case CASS_VALUE_TYPE_BLOB:
+        case CASS_VALUE_TYPE_VARINT:
+        case CASS_VALUE_TYPE_CUSTOM: {
+            const cass_byte_t* bytes;
+            size_t size;
+            cass_value_get_bytes(value, &bytes, &size);
+            return cass_statement_bind_bytes(statement, index, bytes, size);
+        }
+        case CASS_VALUE_TYPE_BOOLEAN: {
+            cass_bool_t b;
+            cass_value_get_bool(value, &b);
+            return cass_statement_bind_bool(statement, index, b);
+        }
+        case CASS_VALUE_TYPE_TINY_INT: {
+            cass_int8_t i;
+            cass_value_get_int8(value, &i);
+            return cass_statement_bind_int8(statement, index, i);
+        }
+        case CASS_VALUE_TYPE_SMALL_INT: {
+            cass_int16_t i;
+            cass_value_get_int16(value, &i);
+            return cass_statement_bind_int16(statement, index, i);
+        }
+        case CASS_VALUE_TYPE_INT: {
+            cass_int32_t i;
+            cass_value_get_int32(value, &i);
+            return cass_statement_bind_int32(statement, index, i);
+        }
+        case CASS_VALUE_TYPE_DATE: {
+            cass_uint32_t date;
+            cass_value_get_uint32(value, &date);
+            return cass_statement_bind_uint32(statement, index, date);
+        }
+        case CASS_VALUE_TYPE_BIGINT:
+        case CASS_VALUE_TYPE_COUNTER:
+        case CASS_VALUE_TYPE_TIMESTAMP:
+        case CASS_VALUE_TYPE_TIME: {
+            cass_int64_t i;
+            cass_value_get_int64(value, &i);
+            return cass_statement_bind_int64(statement, index, i);
+        }
+        case CASS_VALUE_TYPE_FLOAT: {
+            cass_float_t f;
+            cass_value_get_float(value, &f);
+            return cass_statement_bind_float(statement, index, f);
+        }
+        case CASS_VALUE_TYPE_DOUBLE: {
+            cass_double_t d;
+            cass_value_get_double(value, &d);
+            return cass_statement_bind_double(statement, index, d);
+        }
+        case CASS_VALUE_TYPE_UUID:
+        case CASS_VALUE_TYPE_TIMEUUID: {
+            CassUuid uuid;
+            cass_value_get_uuid(value, &uuid);
+            return cass_statement_bind_uuid(statement, index, uuid);
+        }
+        case CASS_VALUE_TYPE_INET: {
+            CassInet inet;
+            cass_value_get_inet(value, &inet);
+            return cass_statement_bind_inet(statement, index, inet);
+        }
+        case CASS_VALUE_TYPE_DECIMAL: {
+            const cass_byte_t* varint;
+            size_t varint_size;
+            cass_int32_t scale;
+            cass_value_get_decimal(value, &varint, &varint_size, &scale);
+            return cass_statement_bind_decimal(statement, index, varint, varint_size, scale);
+        }
+        case CASS_VALUE_TYPE_DURATION: {
+            cass_int32_t months, days;
+            cass_int64_t nanos;
+            cass_value_get_duration(value, &months, &days, &nanos);
+            return cass_statement_bind_duration(statement, index, months, days, nanos);
+        }
+        default:
+            return bind_ruby_value_to_statement(statement, index, convert_cass_value_to_ruby(value));
+    }
+}
+
+// Start the next unread range on reader, or leave it idle when none is left
+static void copy_reader_start(table_copy_t* copy, copy_reader_t* reader) {
+    if (copy->next_range >= RARRAY_LEN(copy->ranges)) {
+        return;
+    }
+    
+    VALUE range = RARRAY_AREF(copy->ranges, copy->next_range);
+    copy->next_range++;
+    
+    reader->statement = cass_prepared_bind(copy->source);
+    cass_statement_bind_int64(reader->statement, 0, (cass_int64_t)NUM2LL(RARRAY_AREF(range, 0)));
+    cass_statement_bind_int64(reader->statement, 1, (cass_int64_t)NUM2LL(RARRAY_AREF(range, 1)));
+    if (copy->page_size > 0) {
+        cass_statement_set_paging_size(reader->statement, copy->page_size);
+    }
+    reader->future = cass_session_execute(copy->source_session, reader->statement);
+}
+
+// Wait for reader's page and request the one after it (or the next range)
+static void copy_reader_take_page(table_copy_t* copy, copy_reader_t* reader) {
+    // The reader keeps the future while waiting, for the cleanup handler
+    wait_for_future(reader->future, 0, NULL);
+    CassFuture* future = reader->future;
+    reader->future = NULL;
+    
+    if (cass_future_error_code(future) != CASS_OK) {
+        copy->failed = future;
+        raise_cassandra_error(future, "copy read");
+    }
+    copy->result = cass_future_get_result(future);
+    cass_future_free(future);
+    
+    if (cass_result_has_more_pages(copy->result)) {
+        cass_statement_set_paging_state(reader->statement, copy->result);
+        reader->future = cass_session_execute(copy->source_session, reader->statement);
+    } else {
+        cass_statement_free(reader->statement);
+        reader->statement = NULL;
+        copy_reader_start(copy, reader);
+    }
+}
+
+static void copy_write_page(table_copy_t* copy) {
+    size_t column_count = cass_result_column_count(copy->result);
+    if (column_count != copy->dest_parameter_count) {
+        rb_raise(rb_eArgError, "Source rows have %lu columns, destination statement takes %lu parameters",
+                 (unsigned long)column_count, (unsigned long)copy->dest_parameter_count);
+    }
+    
+    copy->iterator = cass_iterator_from_result(copy->result);
+    while (cass_iterator_next(copy->iterator)) {
+        const CassRow* row = cass_iterator_get_row(copy->iterator);
+        
+        if (request_window_full(copy->window)) {
+            cass_result_free(request_window_next(copy->window));
+        }
+        
+        uint64_t started_ns = monotonic_now_ns();
+        CassStatement* statement = cass_prepared_bind(copy->dest);
+        for (size_t i = 0; i < column_count; i++) {
+            CassError rc = copy_bind_value(statement, i, cass_row_get_column(row, i));
+            if (rc != CASS_OK) {
+                cass_statement_free(statement);
+                rb_raise(rb_eCassandraError, "Failed to bind copied column %lu: %s",
+                         (unsigned long)i, cass_error_desc(rc));
+            }
+        }
+        
+        request_window_submit(copy->window, statement, started_ns);
+        copy->rows++;
+    }
+    
+    cass_iterator_free(copy->iterator);
+    copy->iterator = NULL;
+    cass_result_free(copy->result);
+    copy->result = NULL;
+}
+
+static VALUE table_copy_run(VALUE arg) {
+    table_copy_t* copy = (table_copy_t*)arg;
+    std::vector<copy_reader_t>& readers = *copy->readers;
+    
+    for (size_t i = 0; i < readers.size(); i++) {
+        copy_reader_start(copy, &readers[i]);
+    }
+    
+    // Round robin over the readers; the others' pages load meanwhile
+    bool reading = true;
+    while (reading) {
+        reading = false;
+        for (size_t i = 0; i < readers.size(); i++) {
+            if (!readers[i].future) {
+                continue;
+            }
+            reading = true;
+            copy_reader_take_page(copy, &readers[i]);
+            copy_write_page(copy);
+        }
+    }
+    
+    while (!request_window_empty(copy->window)) {
+        cass_result_free(request_window_next(copy->window));
+    }
+    
+    return Qnil;
+}
+
+static VALUE table_copy_cleanup(VALUE arg) {
+    table_copy_t* copy = (table_copy_t*)arg;
+    std::vector<copy_reader_t>& readers = *copy->readers;
+    
+    for (size_t i = 0; i < readers.size(); i++) {
+        if (readers[i].future) {
+            cass_future_free(readers[i].future);
+        }
+        if (readers[i].statement) {
+            cass_statement_free(readers[i].statement);
+        }
+    }
+    if (copy->iterator) {
+        cass_iterator_free(copy->iterator);
+    }
+    if (copy->result) {
+        cass_result_free(copy->result);
+    }
+    if (copy->failed) {
+        cass_future_free(copy->failed);
+    }
+    request_window_free(copy->window);
+    delete copy->readers;
+    
+    return Qnil;
+}
+
+// Ruby method: prepared.copy_from(source_prepared, ranges, page_size, readers, concurrency)
+// Runs source_prepared (a query taking the exclusive lower and inclusive
+// upper token of a range) over every range in ranges with up to readers
+// ranges read at once, and executes this statement once per source row with
+// the row's columns as parameters, in order. Up to concurrency writes are in
+// flight at a time. Returns the number of rows copied.
+static VALUE prepared_statement_copy_from(VALUE self, VALUE source_prepared, VALUE ranges, VALUE page_size,
+                                          VALUE readers, VALUE concurrency) {
+    prepared_statement_wrapper_t* dest_wrapper;
+    TypedData_Get_Struct(self, prepared_statement_wrapper_t, &prepared_statement_type, dest_wrapper);
+    prepared_statement_wrapper_t* source_wrapper;
+    TypedData_Get_Struct(source_prepared, prepared_statement_wrapper_t, &prepared_statement_type, source_wrapper);
+    
+    session_wrapper_t* dest_session;
+    TypedData_Get_Struct(rb_iv_get(self, "@session"), session_wrapper_t, &session_type, dest_session);
+    session_wrapper_t* source_session;
+    TypedData_Get_Struct(rb_iv_get(source_prepared, "@session"), session_wrapper_t, &session_type, source_session);
+    
+    // Validate everything up front; the C++ state below is only created once
+    // nothing else can raise before the ensure handler is in place
+    Check_Type(ranges, T_ARRAY);
+    for (long i = 0; i < RARRAY_LEN(ranges); i++) {
+        VALUE range = RARRAY_AREF(ranges, i);
+        Check_Type(range, T_ARRAY);
+        if (RARRAY_LEN(range) != 2) {
+            rb_raise(rb_eArgError, "Token ranges must be [from, to] pairs");
+        }
+        NUM2LL(RARRAY_AREF(range, 0));
+        NUM2LL(RARRAY_AREF(range, 1));
+    }
+    long reader_count = NUM2LONG(readers);
+    if (reader_count < 1) {
+        rb_raise(rb_eArgError, "readers must be at least 1");
+    }
+    int rows_per_page = page_size_from_ruby(page_size);
+    size_t capacity = window_capacity_from_ruby(concurrency);
+    
+    size_t dest_parameter_count = 0;
+    const char* param_name;
+    size_t param_name_length;
+    while (cass_prepared_parameter_name(dest_wrapper->prepared, dest_parameter_count,
+                                        &param_name, &param_name_length) == CASS_OK) {
+        dest_parameter_count++;
+    }
+    
+    // Frozen so the ranges cannot change while the copy walks them
+    ranges = rb_ary_freeze(rb_ary_dup(ranges));
+    circuit_breaker_t* breaker = circuit_breaker_for_prepared(self, dest_wrapper);
+    
+    table_copy_t copy;
+    copy.source_session = source_session->session;
+    copy.source = source_wrapper->prepared;
+    copy.dest = dest_wrapper->prepared;
+    copy.dest_parameter_count = dest_parameter_count;
+    copy.ranges = ranges;
+    copy.next_range = 0;
+    copy.page_size = rows_per_page;
+    copy.result = NULL;
+    copy.iterator = NULL;
+    copy.failed = NULL;
+    copy.rows = 0;
+    copy.readers = new std::vector<copy_reader_t>((size_t)reader_count);
+    for (size_t i = 0; i < copy.readers->size(); i++) {
+        (*copy.readers)[i].statement = NULL;
+        (*copy.readers)[i].future = NULL;
+    }
+    copy.window = request_window_new(dest_session->session, capacity, dest_wrapper->stats, "copy write");
+    copy.window->breaker = breaker;
+    copy.window->gate = dest_session->gate;
+    copy.window->priority = priority_current();
+    copy.window->query_id = dest_wrapper->query_id;
+    
+    rb_ensure(table_copy_run, (VALUE)&copy, table_copy_cleanup, (VALUE)&copy);
+    
+    RB_GC_GUARD(ranges);
+    return LONG2NUM(copy.rows);
+}
+
+void init_copy() {
+    rb_define_method(rb_cPreparedStatement, "copy_from", (VALUE(*)(...))prepared_statement_copy_from, 5);
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "cassandra_cpp.h"
+
+// Execution info: the phase timings every execute path already takes, and
+// the tracing id when the statement asked for a trace, copied out of the
+// future before it is freed. Lazy results keep it inline in the NativeResult;
+// row arrays carry a NativeExecutionInfo in a hidden instance variable, so no
+// Ruby objects beyond that one are built until it is asked for.
+
+static VALUE rb_cNativeExecutionInfo;
+
+// Not prefixed with @, so invisible to Ruby code
+static ID id_execution_info;
+
+static void execution_info_mark(void* ptr) {
+    execution_info_t* info = (execution_info_t*)ptr;
+    if (info) {
+        rb_gc_mark(info->session_ref);
+    }
+}
+
+static void execution_info_free(void* ptr) {
+    xfree(ptr);
+}
+
+static size_t execution_info_memsize(const void* ptr) {
+    return sizeof(execution_info_t);
+}
+
+static const rb_data_type_t execution_info_type = {
+    "CassandraCpp::NativeExecutionInfo",
+    { execution_info_mark, execution_info_free, execution_info_memsize },
+    0, 0,
+    RUBY_TYPED_FREE_IMMEDIATELY
+};
+
+void execution_info_init(execution_info_t* info) {
+    memset(info, 0, sizeof(*info));
+    info->traced = false;
+    info->session_ref = Qnil;
+}
+
+// Copy what the resolved future knows about the request; must run before the
+// future is freed. session_ref is kept only for traced requests.
+void execution_info_capture(execution_info_t* info, CassFuture* future, VALUE session_ref) {
+    info->traced = cass_future_tracing_id(future, &info->tracing_id) == CASS_OK;
+    info->session_ref = info->traced ? session_ref : Qnil;
+}
+
+VALUE execution_info_new(const execution_info_t* info) {
+    execution_info_t* copy = ALLOC(execution_info_t);
+    *copy = *info;
+    return TypedData_Wrap_Struct(rb_cNativeExecutionInfo, &execution_info_type, copy);
+}
+
+// Attach execution info to the row array an execute returned
+void execution_info_attach(VALUE rows, const execution_info_t* info) {
+    if (RB_TYPE_P(rows, T_ARRAY) && !OBJ_FROZEN(rows)) {
+        rb_ivar_set(rows, id_execution_info, execution_info_new(info));
+    }
+}
+
+// Ruby method: CassandraCpp::NativeExecutionInfo.of(rows)
+static VALUE execution_info_of(VALUE klass, VALUE rows) {
+    if (!RB_TYPE_P(rows, T_ARRAY)) {
+        return Qnil;
+    }
+    return rb_attr_get(rows, id_execution_info);
+}
+
+// Ruby method: info.tracing_id
+static VALUE execution_info_tracing_id(VALUE self) {
+    execution_info_t* info;
+    TypedData_Get_Struct(self, execution_info_t, &execution_info_type, info);
+    
+    return info->traced ? uuid_to_ruby(info->tracing_id) : Qnil;
+}
+
+// Ruby method: info.phases -> { queue:, network:, gvl_wait:, decode: } in ms
+static VALUE execution_info_phases(VALUE self) {
+    execution_info_t* info;
+    TypedData_Get_Struct(self, execution_info_t, &execution_info_type, info);
+    
+    return request_timing_to_ruby(&info->timing);
+}
+
+// Ruby method: info.query_id
+static VALUE execution_info_query_id(VALUE self) {
+    execution_info_t* info;
+    TypedData_Get_Struct(self, execution_info_t, &execution_info_type, info);
+    
+    return info->timing.query_id == 0 ? Qnil : ULL2NUM(info->timing.query_id);
+}
+
+// Ruby method: info.session, the NativeSession a trace is read through
+static VALUE execution_info_session(VALUE self) {
+    execution_info_t* info;
+    TypedData_Get_Struct(self, execution_info_t, &execution_info_type, info);
+    
+    return info->session_ref;
+}
+
+void init_execution_info() {
+    id_execution_info = rb_intern("execution_info");
+    
+    rb_cNativeExecutionInfo = rb_define_class_under(rb_cCassandraCpp, "NativeExecutionInfo", rb_cObject);
+    rb_undef_alloc_func(rb_cNativeExecutionInfo);
+    rb_define_singleton_method(rb_cNativeExecutionInfo, "of", (VALUE(*)(...))execution_info_of, 1);
+    rb_define_method(rb_cNativeExecutionInfo, "tracing_id", (VALUE(*)(...))execution_info_tracing_id, 0);
+    rb_define_method(rb_cNativeExecutionInfo, "phases", (VALUE(*)(...))execution_info_phases, 0);
+    rb_define_method(rb_cNativeExecutionInfo, "query_id", (VALUE(*)(...))execution_info_query_id, 0);
+    rb_define_method(rb_cNativeExecutionInfo, "session", (VALUE(*)(...))execution_info_session, 0);
+}
\ No newline at end of file
@@ -26,6 +26,15 @@ have_library('crypto')
 have_library('z')
 have_library('uv')
 
+# Usable-size queries let the driver allocation hooks count bytes
+have_func('malloc_usable_size', 'malloc.h') || have_func('malloc_size', 'malloc/malloc.h')
+
+# jemalloc for CASSANDRA_CPP_ALLOCATOR=jemalloc / jemalloc_thread_arenas;
+# opt in at build time with CASSANDRA_CPP_JEMALLOC
+if ENV['CASSANDRA_CPP_JEMALLOC']
+  have_header('jemalloc/jemalloc.h') && have_library('jemalloc', 'mallocx')
+end
+
 # Check for pkg-config
 if find_executable('pkg-config')
   pkg_config('cassandra')
@@ -39,6 +48,10 @@ when /darwin/
 when /linux/
   # Linux specific settings
   $LDFLAGS += ' -lrt'
+
+  # USDT probes for bpftrace/perf (systemtap-sdt-dev or systemtap-sdt-devel);
+  # set CASSANDRA_CPP_DISABLE_USDT to build without them
+  have_header('sys/sdt.h') unless ENV['CASSANDRA_CPP_DISABLE_USDT']
 end
 
 # Define source files
@@ -50,7 +63,30 @@ $srcs = [
   "prepared_statement.cpp",
   "statement.cpp",
   "batch.cpp",
-  "future.cpp"
+  "future.cpp",
+  "result.cpp",
+  "metrics.cpp",
+  "recorder.cpp",
+  "row_stream.cpp",
+  "aggregate.cpp",
+  "request_window.cpp",
+  "large_object.cpp",
+  "column_writer.cpp",
+  "circuit_breaker.cpp",
+  "priority.cpp",
+  "snapshot.cpp",
+  "bloom_filter.cpp",
+  "vector.cpp",
+  "probes.cpp",
+  "allocator.cpp",
+  "copy.cpp",
+  "sstable.cpp",
+  "sstable_writer.cpp",
+  "sstable_reader.cpp",
+  "execution_info.cpp",
+  "batch_loader.cpp",
+  "hot_partitions.cpp",
+  "adaptive_timeout.cpp"
 ]
 
 # Create the Makefile
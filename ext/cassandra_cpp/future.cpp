@@ -7,15 +7,43 @@ static void future_mark(void* ptr) {
         rb_gc_mark(wrapper->callback_proc);
         rb_gc_mark(wrapper->error_callback_proc);
         rb_gc_mark(wrapper->session_ref);
+        rb_gc_mark(wrapper->stats_ref);
+        rb_gc_mark(wrapper->partition_key);
     }
 }
 
+// Drop one reference to a ready stamp, freeing it with the last one
+static void future_ready_stamp_release(future_ready_stamp_t* stamp) {
+    if (stamp->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete stamp;
+    }
+}
+
+// Driver callback, runs on an IO thread: only stamp the time, report to the
+// circuit breaker and free the priority slot, no Ruby calls
+static void future_ready_callback(CassFuture* future, void* data) {
+    future_ready_stamp_t* stamp = (future_ready_stamp_t*)data;
+    uint64_t ready_ns = monotonic_now_ns();
+    stamp->ready_ns.store(ready_ns, std::memory_order_release);
+    CassError rc = cass_future_error_code(future);
+    CASSANDRA_CPP_PROBE4(request__complete, stamp->query_id, future, ready_ns - stamp->submitted_ns, (int)rc);
+    circuit_breaker_record(stamp->breaker, rc, ready_ns - stamp->submitted_ns);
+    priority_gate_exit(stamp->gate, stamp->priority, ready_ns - stamp->submitted_ns);
+    future_ready_stamp_release(stamp);
+}
+
 static void future_free(void* ptr) {
     future_wrapper_t* wrapper = (future_wrapper_t*)ptr;
     if (wrapper) {
         if (wrapper->future) {
             cass_future_free(wrapper->future);
         }
+        if (wrapper->ready_stamp) {
+            future_ready_stamp_release(wrapper->ready_stamp);
+        }
+        if (wrapper->capture) {
+            traffic_capture_free(wrapper->capture);
+        }
         xfree(wrapper);
     }
 }
@@ -36,6 +64,12 @@ static VALUE future_new(VALUE klass, CassFuture* cass_future, VALUE session_ref,
     wrapper->error_callback_proc = Qnil;
     wrapper->session_ref = session_ref;
     wrapper->type = type;
+    memset(&wrapper->timing, 0, sizeof(wrapper->timing));
+    wrapper->ready_stamp = NULL;
+    wrapper->stats = NULL;
+    wrapper->stats_ref = Qnil;
+    wrapper->capture = NULL;
+    wrapper->partition_key = Qnil;
     
     VALUE future_obj = TypedData_Wrap_Struct(klass, &future_type, wrapper);
     return future_obj;
@@ -67,29 +101,114 @@ static VALUE future_rescue(VALUE self) {
     return self;
 }
 
+// Wrap the prepared statement resolved by a prepare future
+static VALUE future_prepared_to_ruby(VALUE self, future_wrapper_t* wrapper) {
+    const CassPrepared* prepared = cass_future_get_prepared(wrapper->future);
+    
+    // Create prepared statement wrapper
+    prepared_statement_wrapper_t* prepared_wrapper = ALLOC(prepared_statement_wrapper_t);
+    prepared_wrapper->prepared = prepared;
+    prepared_wrapper->session_ref = wrapper->session_ref;
+    prepared_wrapper->stats = phase_stats_new();
+    prepared_wrapper->breaker = NULL;
+    prepared_wrapper->hot = NULL;
+    prepared_wrapper->idempotent = false;
+    
+    VALUE query_str = rb_iv_get(self, "@query");
+    prepared_wrapper->query_id = NIL_P(query_str) ? 0 : probe_query_id(query_str);
+    CASSANDRA_CPP_PROBE4(prepare, prepared_wrapper->query_id, NIL_P(query_str) ? "" : StringValueCStr(query_str),
+                         wrapper->timing.ready_ns - wrapper->timing.submitted_ns, (int)CASS_OK);
+    
+    VALUE prepared_obj = TypedData_Wrap_Struct(rb_cPreparedStatement, &prepared_statement_type, prepared_wrapper);
+    
+    // Keep reference to prevent session from being GC'd
+    rb_iv_set(prepared_obj, "@session", wrapper->session_ref);
+    rb_iv_set(prepared_obj, "@query", query_str);
+    
+    return prepared_obj;
+}
+
+// Note when the future resolved, preferring the driver-side ready time over
+// when Ruby noticed it, and write the request to the traffic log once
+static void future_mark_resolved(future_wrapper_t* wrapper, const request_timing_t* wait_timing) {
+    request_timing_t* timing = &wrapper->timing;
+    if (timing->decoded_ns != 0 || timing->resumed_ns != 0) {
+        return;
+    }
+    
+    timing->ready_ns = wait_timing->ready_ns;
+    timing->resumed_ns = wait_timing->resumed_ns;
+    
+    uint64_t ready_ns = wrapper->ready_stamp ? wrapper->ready_stamp->ready_ns.load(std::memory_order_acquire) : 0;
+    if (ready_ns != 0 && ready_ns < timing->ready_ns) {
+        timing->ready_ns = ready_ns;
+    }
+    
+    if (wrapper->capture) {
+        traffic_recorder_write(wrapper->capture, timing, cass_future_error_code(wrapper->future));
+        traffic_capture_free(wrapper->capture);
+        wrapper->capture = NULL;
+    }
+}
+
+// Convert the rows of an execute future, recording phase timings the first time
+static VALUE future_rows_to_ruby(future_wrapper_t* wrapper) {
+    const CassResult* cass_result = cass_future_get_result(wrapper->future);
+    VALUE rows = convert_result_to_ruby(cass_result, wrapper->timing.query_id);
+    
+    // Count the partition once, however often the rows are read
+    if (!NIL_P(wrapper->partition_key)) {
+        prepared_statement_wrapper_t* prepared_wrapper;
+        TypedData_Get_Struct(wrapper->stats_ref, prepared_statement_wrapper_t, &prepared_statement_type, prepared_wrapper);
+        hot_partitions_record(prepared_wrapper->hot, wrapper->partition_key, cass_result);
+        wrapper->partition_key = Qnil;
+    }
+    if (cass_result) {
+        cass_result_free(cass_result);
+    }
+    
+    request_timing_t* timing = &wrapper->timing;
+    if (timing->started_ns != 0 && timing->decoded_ns == 0) {
+        timing->decoded_ns = monotonic_now_ns();
+        record_request_timing(wrapper->stats, timing);
+    }
+    
+    execution_info_t info;
+    execution_info_init(&info);
+    info.timing = *timing;
+    execution_info_capture(&info, wrapper->future, wrapper->session_ref);
+    execution_info_attach(rows, &info);
+    
+    return rows;
+}
+
 // Ruby method: future.value(timeout = nil)
-static VALUE future_value(int argc, VALUE* argv, VALUE self) {
+static VALUE future_value_body(int argc, VALUE* argv, VALUE self) {
     VALUE timeout_val;
     rb_scan_args(argc, argv, "01", &timeout_val);
     
     future_wrapper_t* wrapper;
     TypedData_Get_Struct(self, future_wrapper_t, &future_type, wrapper);
     
-    // Wait for the future with optional timeout
-    cass_bool_t result;
-    if (NIL_P(timeout_val)) {
-        cass_future_wait(wrapper->future);
-        result = cass_true;
-    } else {
+    // Wait for the future with optional timeout, without holding the GVL
+    cass_uint64_t timeout_us = 0;
+    if (!NIL_P(timeout_val)) {
         double timeout_seconds = NUM2DBL(timeout_val);
-        cass_uint64_t timeout_us = (cass_uint64_t)(timeout_seconds * 1000000);
-        result = cass_future_wait_timed(wrapper->future, timeout_us);
+        timeout_us = (cass_uint64_t)(timeout_seconds * 1000000);
+        if (timeout_us == 0) {
+            timeout_us = 1;
+        }
     }
     
+    request_timing_t wait_timing;
+    cass_bool_t result = wait_for_future(wrapper->future, timeout_us, &wait_timing);
+    
     if (!result) {
         rb_raise(rb_eCassandraError, "Future timed out");
     }
     
+    future_mark_resolved(wrapper, &wait_timing);
+    
     // Check for errors
     CassError rc = cass_future_error_code(wrapper->future);
     if (rc != CASS_OK) {
@@ -97,56 +216,15 @@ static VALUE future_value(int argc, VALUE* argv, VALUE self) {
     }
     
     // Handle different future types
-    if (wrapper->type == FUTURE_TYPE_PREPARE) {
-        // For prepare operations, get the prepared statement
-        const CassPrepared* prepared = cass_future_get_prepared(wrapper->future);
-        
-        // Create prepared statement wrapper
-        prepared_statement_wrapper_t* prepared_wrapper = ALLOC(prepared_statement_wrapper_t);
-        prepared_wrapper->prepared = prepared;
-        prepared_wrapper->session_ref = wrapper->session_ref;
-        
-        VALUE prepared_obj = TypedData_Wrap_Struct(rb_cPreparedStatement, &prepared_statement_type, prepared_wrapper);
-        
-        // Keep reference to prevent session from being GC'd
-        rb_iv_set(prepared_obj, "@session", wrapper->session_ref);
-        
-        return prepared_obj;
-    } else {
-        // For execute operations, get the result and convert to Ruby
-        const CassResult* cass_result = cass_future_get_result(wrapper->future);
-        VALUE rows = rb_ary_new();
-        
-        if (cass_result) {
-            CassIterator* iterator = cass_iterator_from_result(cass_result);
-            
-            while (cass_iterator_next(iterator)) {
-                const CassRow* row = cass_iterator_get_row(iterator);
-                size_t column_count = cass_result_column_count(cass_result);
-                
-                VALUE row_hash = rb_hash_new();
-                
-                for (size_t i = 0; i < column_count; i++) {
-                    const char* column_name;
-                    size_t column_name_length;
-                    cass_result_column_name(cass_result, i, &column_name, &column_name_length);
-                    
-                    const CassValue* value = cass_row_get_column(row, i);
-                    VALUE ruby_value = convert_cass_value_to_ruby(value);
-                    
-                    VALUE column_key = rb_str_new(column_name, column_name_length);
-                    rb_hash_aset(row_hash, column_key, ruby_value);
-                }
-                
-                rb_ary_push(rows, row_hash);
-            }
-            
-            cass_iterator_free(iterator);
-            cass_result_free(cass_result);
-        }
-        
-        return rows;
-    }
+    VALUE value = wrapper->type == FUTURE_TYPE_PREPARE
+        ? future_prepared_to_ruby(self, wrapper)
+        : future_rows_to_ruby(wrapper);
+    
+    return value;
+}
+
+static VALUE future_value(int argc, VALUE* argv, VALUE self) {
+    return gvl_span_call(GVL_ENTRY_VALUE, future_value_body, argc, argv, self);
 }
 
 // Ruby method: future.ready?
@@ -166,6 +244,10 @@ static VALUE future_execute_callbacks(VALUE self) {
     // This is a simplified implementation - a production version would use
     // a better async mechanism
     if (cass_future_ready(wrapper->future)) {
+        request_timing_t wait_timing;
+        wait_for_future(wrapper->future, 0, &wait_timing);
+        future_mark_resolved(wrapper, &wait_timing);
+        
         CassError rc = cass_future_error_code(wrapper->future);
         
         if (rc == CASS_OK && !NIL_P(wrapper->callback_proc)) {
@@ -173,47 +255,9 @@ static VALUE future_execute_callbacks(VALUE self) {
             VALUE result;
             
             if (wrapper->type == FUTURE_TYPE_PREPARE) {
-                const CassPrepared* prepared = cass_future_get_prepared(wrapper->future);
-                prepared_statement_wrapper_t* prepared_wrapper = ALLOC(prepared_statement_wrapper_t);
-                prepared_wrapper->prepared = prepared;
-                prepared_wrapper->session_ref = wrapper->session_ref;
-                
-                VALUE prepared_obj = TypedData_Wrap_Struct(rb_cPreparedStatement, &prepared_statement_type, prepared_wrapper);
-                rb_iv_set(prepared_obj, "@session", wrapper->session_ref);
-                result = prepared_obj;
+                result = future_prepared_to_ruby(self, wrapper);
             } else {
-                const CassResult* cass_result = cass_future_get_result(wrapper->future);
-                VALUE rows = rb_ary_new();
-                
-                if (cass_result) {
-                    CassIterator* iterator = cass_iterator_from_result(cass_result);
-                    
-                    while (cass_iterator_next(iterator)) {
-                        const CassRow* row = cass_iterator_get_row(iterator);
-                        size_t column_count = cass_result_column_count(cass_result);
-                        
-                        VALUE row_hash = rb_hash_new();
-                        
-                        for (size_t i = 0; i < column_count; i++) {
-                            const char* column_name;
-                            size_t column_name_length;
-                            cass_result_column_name(cass_result, i, &column_name, &column_name_length);
-                            
-                            const CassValue* value = cass_row_get_column(row, i);
-                            VALUE ruby_value = convert_cass_value_to_ruby(value);
-                            
-                            VALUE column_key = rb_str_new(column_name, column_name_length);
-                            rb_hash_aset(row_hash, column_key, ruby_value);
-                        }
-                        
-                        rb_ary_push(rows, row_hash);
-                    }
-                    
-                    cass_iterator_free(iterator);
-                    cass_result_free(cass_result);
-                }
-                
-                result = rows;
+                result = future_rows_to_ruby(wrapper);
             }
             
             rb_funcall(wrapper->callback_proc, rb_intern("call"), 1, result);
@@ -234,7 +278,52 @@ static VALUE future_execute_callbacks(VALUE self) {
 
 // C function to create Future from CassFuture (called from session.cpp)
 VALUE create_future_from_cass_future(CassFuture* cass_future, VALUE session_ref, future_type_t type) {
-    return future_new(rb_cFuture, cass_future, session_ref, type);
+    VALUE future_obj = future_new(rb_cFuture, cass_future, session_ref, type);
+    
+    // Lets the prepare probe report a latency; no phases are recorded
+    // without a start time
+    future_wrapper_t* wrapper;
+    TypedData_Get_Struct(future_obj, future_wrapper_t, &future_type, wrapper);
+    wrapper->timing.submitted_ns = monotonic_now_ns();
+    
+    return future_obj;
+}
+
+// C function to create an execute Future that records phase timings once its
+// rows are decoded. stats may be NULL; otherwise stats_ref keeps its owner alive.
+// Takes ownership of capture, which is written to the traffic log on completion.
+// breaker (may be NULL) is told the outcome as soon as the driver resolves it,
+// and the slot taken from gate (may be NULL) is given back at the same time.
+VALUE create_timed_future(CassFuture* cass_future, VALUE session_ref, const request_timing_t* timing,
+                          phase_stats_t* stats, VALUE stats_ref, traffic_capture_t* capture,
+                          circuit_breaker_t* breaker, priority_gate_t* gate, priority_class_t priority) {
+    VALUE future_obj = future_new(rb_cFuture, cass_future, session_ref, FUTURE_TYPE_EXECUTE);
+    
+    future_wrapper_t* wrapper;
+    TypedData_Get_Struct(future_obj, future_wrapper_t, &future_type, wrapper);
+    wrapper->timing = *timing;
+    wrapper->stats = stats;
+    wrapper->stats_ref = stats_ref;
+    wrapper->capture = capture;
+    
+    // One reference for the wrapper, one for the driver callback
+    future_ready_stamp_t* stamp = new future_ready_stamp_t();
+    stamp->refs.store(2, std::memory_order_relaxed);
+    stamp->breaker = breaker;
+    stamp->gate = gate;
+    stamp->priority = priority;
+    stamp->submitted_ns = timing->submitted_ns;
+    stamp->query_id = timing->query_id;
+    if (cass_future_set_callback(cass_future, future_ready_callback, stamp) == CASS_OK) {
+        wrapper->ready_stamp = stamp;
+    } else {
+        // As in request_release_on_completion: no outcome will be recorded
+        delete stamp;
+        circuit_breaker_cancel(breaker);
+        priority_gate_exit(gate, priority, 0);
+    }
+    
+    return future_obj;
 }
 
 void init_future() {
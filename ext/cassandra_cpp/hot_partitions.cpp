@@ -0,0 +1,280 @@
+#include "cassandra_cpp.h"
+#include <algorithm>
+
+// Hot-partition detection for one prepared statement. Every execution adds
+// its partition key (the bound values of the partition key columns) to two
+// count-min sketches, one counting requests and one counting bytes returned,
+// and offers it to a small top list per sketch. Memory is fixed (depth x width
+// counters per sketch plus the top lists) and a request costs depth counter
+// updates and a scan of the top lists. Measuring a response walks all of its
+// cells, so only a random 1 in HOT_PARTITIONS_BYTE_SAMPLE responses is
+// measured and counted with that weight. Only used with the GVL held, so no
+// synchronization is needed.
+
+#define HOT_PARTITIONS_MAX_DEPTH 16
+#define HOT_PARTITIONS_BYTE_SAMPLE 16
+
+typedef struct {
+    uint64_t hash;
+    VALUE key;           // Frozen Array of partition key values
+    uint64_t requests;   // Sketch estimate, never below the true count
+    uint64_t bytes;      // Sketch estimate of bytes returned, from sampled responses
+    uint64_t rows;       // Rows returned since the key entered the list
+    uint64_t max_bytes;  // Largest sampled response since then
+} hot_partition_t;
+
+struct hot_partitions_s {
+    std::vector<size_t> key_indexes;  // Parameter index of each partition key column
+    size_t width;
+    size_t depth;
+    size_t top;
+    std::vector<uint64_t> request_counts;  // depth rows of width counters
+    std::vector<uint64_t> byte_counts;
+    std::vector<hot_partition_t> hot;      // Most requested keys
+    std::vector<hot_partition_t> heavy;    // Keys returning the most bytes
+    uint64_t requests;
+    uint64_t sample_state;                 // xorshift state picking measured responses
+};
+
+static uint64_t hot_partitions_mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+void hot_partitions_free(hot_partitions_t* hot) {
+    delete hot;
+}
+
+void hot_partitions_mark(const hot_partitions_t* hot) {
+    if (!hot) {
+        return;
+    }
+    for (size_t i = 0; i < hot->hot.size(); i++) {
+        rb_gc_mark(hot->hot[i].key);
+    }
+    for (size_t i = 0; i < hot->heavy.size(); i++) {
+        rb_gc_mark(hot->heavy[i].key);
+    }
+}
+
+// Store value into the partition key being bound when index is one of the
+// key's parameters. Returns the key, created on its first value; nil while
+// no key value was bound or partitions are not tracked.
+VALUE hot_partitions_bind(const hot_partitions_t* hot, VALUE key, size_t index, VALUE value) {
+    if (!hot) {
+        return key;
+    }
+    
+    for (size_t slot = 0; slot < hot->key_indexes.size(); slot++) {
+        if (hot->key_indexes[slot] == index) {
+            if (NIL_P(key)) {
+                key = rb_ary_new_capa((long)hot->key_indexes.size());
+            }
+            rb_ary_store(key, (long)slot, value);
+            break;
+        }
+    }
+    
+    return key;
+}
+
+// Whether to measure this response; random rather than every Nth, so a
+// periodic request pattern cannot hide a partition from the byte sketch
+static bool hot_partitions_sampled(hot_partitions_t* hot) {
+    uint64_t x = hot->sample_state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    hot->sample_state = x;
+    return x % HOT_PARTITIONS_BYTE_SAMPLE == 0;
+}
+
+// Bytes of all cells of a result, what the partition cost on the wire
+static uint64_t hot_partitions_result_bytes(const CassResult* result) {
+    uint64_t bytes = 0;
+    size_t column_count = cass_result_column_count(result);
+    CassIterator* iterator = cass_iterator_from_result(result);
+    
+    while (cass_iterator_next(iterator)) {
+        const CassRow* row = cass_iterator_get_row(iterator);
+        for (size_t i = 0; i < column_count; i++) {
+            const CassValue* value = cass_row_get_column(row, i);
+            const cass_byte_t* data;
+            size_t size;
+            if (!cass_value_is_null(value) && cass_value_get_bytes(value, &data, &size) == CASS_OK) {
+                bytes += size;
+            }
+        }
+    }
+    
+    cass_iterator_free(iterator);
+    return bytes;
+}
+
+// Add weight to the key's counter in every row and return the new estimate,
+// the smallest of them; row i uses column h1 + i * h2
+static uint64_t hot_partitions_count(std::vector<uint64_t>* counts, size_t width, size_t depth,
+                                     uint64_t hash, uint64_t weight) {
+    uint64_t h1 = hash & 0xffffffffULL;
+    uint64_t h2 = (hash >> 32) | 1;
+    uint64_t estimate = UINT64_MAX;
+    
+    for (size_t i = 0; i < depth; i++) {
+        uint64_t* counter = &(*counts)[i * width + (size_t)((h1 + i * h2) % width)];
+        *counter += weight;
+        if (*counter < estimate) {
+            estimate = *counter;
+        }
+    }
+    
+    return estimate;
+}
+
+static uint64_t hot_partition_rank(const hot_partition_t& entry, bool by_bytes) {
+    return by_bytes ? entry.bytes : entry.requests;
+}
+
+// Update the key's entry, or let it replace the lowest ranked entry once its
+// estimate is above it
+static void hot_partitions_offer(std::vector<hot_partition_t>* top, size_t capacity, bool by_bytes,
+                                 const hot_partition_t& sample, VALUE key) {
+    size_t lowest = 0;
+    for (size_t i = 0; i < top->size(); i++) {
+        hot_partition_t& entry = (*top)[i];
+        if (entry.hash == sample.hash) {
+            entry.requests = sample.requests;
+            entry.bytes = sample.bytes;
+            entry.rows += sample.rows;
+            if (sample.max_bytes > entry.max_bytes) {
+                entry.max_bytes = sample.max_bytes;
+            }
+            return;
+        }
+        if (hot_partition_rank(entry, by_bytes) < hot_partition_rank((*top)[lowest], by_bytes)) {
+            lowest = i;
+        }
+    }
+    
+    hot_partition_t entry = sample;
+    entry.key = rb_obj_freeze(rb_ary_dup(key));
+    if (top->size() < capacity) {
+        top->push_back(entry);
+    } else if (hot_partition_rank(sample, by_bytes) > hot_partition_rank((*top)[lowest], by_bytes)) {
+        (*top)[lowest] = entry;
+    }
+}
+
+// Count one execution of the key and what it returned
+void hot_partitions_record(hot_partitions_t* hot, VALUE key, const CassResult* result) {
+    if (!hot || NIL_P(key)) {
+        return;
+    }
+    
+    hot_partition_t sample;
+    sample.hash = hot_partitions_mix((uint64_t)NUM2LONG(rb_hash(key)));
+    sample.key = Qnil;
+    sample.rows = result ? cass_result_row_count(result) : 0;
+    sample.max_bytes = result && hot_partitions_sampled(hot) ? hot_partitions_result_bytes(result) : 0;
+    sample.requests = hot_partitions_count(&hot->request_counts, hot->width, hot->depth, sample.hash, 1);
+    sample.bytes = hot_partitions_count(&hot->byte_counts, hot->width, hot->depth, sample.hash,
+                                        sample.max_bytes * HOT_PARTITIONS_BYTE_SAMPLE);
+    hot->requests++;
+    
+    hot_partitions_offer(&hot->hot, hot->top, false, sample, key);
+    hot_partitions_offer(&hot->heavy, hot->top, true, sample, key);
+}
+
+static bool hot_partition_more_requested(const hot_partition_t& left, const hot_partition_t& right) {
+    return left.requests > right.requests;
+}
+
+static bool hot_partition_heavier(const hot_partition_t& left, const hot_partition_t& right) {
+    return left.bytes > right.bytes;
+}
+
+// Sorts the list in place; the order does not matter to hot_partitions_offer
+static VALUE hot_partitions_list_to_ruby(std::vector<hot_partition_t>& entries, bool by_bytes) {
+    std::sort(entries.begin(), entries.end(), by_bytes ? hot_partition_heavier : hot_partition_more_requested);
+    
+    VALUE list = rb_ary_new_capa((long)entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        VALUE hash = rb_hash_new();
+        rb_hash_aset(hash, ID2SYM(rb_intern("key")), entries[i].key);
+        rb_hash_aset(hash, ID2SYM(rb_intern("requests")), ULL2NUM(entries[i].requests));
+        rb_hash_aset(hash, ID2SYM(rb_intern("bytes")), ULL2NUM(entries[i].bytes));
+        rb_hash_aset(hash, ID2SYM(rb_intern("rows")), ULL2NUM(entries[i].rows));
+        rb_hash_aset(hash, ID2SYM(rb_intern("max_bytes")), ULL2NUM(entries[i].max_bytes));
+        rb_ary_push(list, hash);
+    }
+    
+    return list;
+}
+
+static prepared_statement_wrapper_t* hot_partitions_prepared(VALUE self) {
+    prepared_statement_wrapper_t* wrapper;
+    TypedData_Get_Struct(self, prepared_statement_wrapper_t, &prepared_statement_type, wrapper);
+    return wrapper;
+}
+
+// Ruby method: prepared.track_partitions(key_indexes, top, width, depth)
+// Start counting partitions, keyed by the parameters at key_indexes (in
+// partition key order). Tracking again starts over with the new sizes.
+static VALUE prepared_statement_track_partitions(VALUE self, VALUE key_indexes, VALUE top, VALUE width, VALUE depth) {
+    Check_Type(key_indexes, T_ARRAY);
+    if (RARRAY_LEN(key_indexes) == 0) {
+        rb_raise(rb_eArgError, "key_indexes must name at least one parameter");
+    }
+    long top_count = NUM2LONG(top);
+    long width_count = NUM2LONG(width);
+    long depth_count = NUM2LONG(depth);
+    if (top_count < 1 || width_count < 1 || depth_count < 1 || depth_count > HOT_PARTITIONS_MAX_DEPTH) {
+        rb_raise(rb_eArgError, "top and width must be positive, depth between 1 and %d", HOT_PARTITIONS_MAX_DEPTH);
+    }
+    
+    for (long i = 0; i < RARRAY_LEN(key_indexes); i++) {
+        NUM2SIZET(RARRAY_AREF(key_indexes, i));
+    }
+    
+    hot_partitions_t* hot = new hot_partitions_t();
+    for (long i = 0; i < RARRAY_LEN(key_indexes); i++) {
+        hot->key_indexes.push_back(NUM2SIZET(RARRAY_AREF(key_indexes, i)));
+    }
+    hot->width = (size_t)width_count;
+    hot->depth = (size_t)depth_count;
+    hot->top = (size_t)top_count;
+    hot->request_counts.assign(hot->width * hot->depth, 0);
+    hot->byte_counts.assign(hot->width * hot->depth, 0);
+    hot->requests = 0;
+    hot->sample_state = hot_partitions_mix((uint64_t)(uintptr_t)hot ^ monotonic_now_ns()) | 1;
+    
+    prepared_statement_wrapper_t* wrapper = hot_partitions_prepared(self);
+    hot_partitions_free(wrapper->hot);
+    wrapper->hot = hot;
+    
+    return self;
+}
+
+// Ruby method: prepared.hot_partitions -> Hash or nil
+// { requests:, hot: [...], heavy: [...] }: hot ranked by requests, heavy by
+// bytes returned, each entry { key:, requests:, bytes:, rows:, max_bytes: }
+static VALUE prepared_statement_hot_partitions(VALUE self) {
+    hot_partitions_t* hot = hot_partitions_prepared(self)->hot;
+    if (!hot) {
+        return Qnil;
+    }
+    
+    VALUE hash = rb_hash_new();
+    rb_hash_aset(hash, ID2SYM(rb_intern("requests")), ULL2NUM(hot->requests));
+    rb_hash_aset(hash, ID2SYM(rb_intern("hot")), hot_partitions_list_to_ruby(hot->hot, false));
+    rb_hash_aset(hash, ID2SYM(rb_intern("heavy")), hot_partitions_list_to_ruby(hot->heavy, true));
+    return hash;
+}
+
+void init_hot_partitions() {
+    rb_define_method(rb_cPreparedStatement, "track_partitions", (VALUE(*)(...))prepared_statement_track_partitions, 4);
+    rb_define_method(rb_cPreparedStatement, "hot_partitions", (VALUE(*)(...))prepared_statement_hot_partitions, 0);
+}
\ No newline at end of file
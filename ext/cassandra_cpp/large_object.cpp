@@ -0,0 +1,467 @@
+#include "cassandra_cpp.h"
+#include <ruby/encoding.h>
+
+// Large objects are stored as fixed-size chunks, one partition per
+// (key, version, chunk_no), plus a manifest row at version 0, chunk_no -1:
+//
+//   CREATE TABLE objects (
+//     key text, version bigint, chunk_no int,
+//     data blob, checksum bigint, object_size bigint, chunk_count int, chunk_version bigint,
+//     PRIMARY KEY ((key, version, chunk_no)))
+//
+// Every chunk row carries the CRC32 of its data; the manifest carries the
+// CRC32 of the whole object and the version its chunks were written under.
+// Each write uses a fresh version and switches the manifest only after all
+// chunks succeeded, so readers never see chunks of two writes; the previous
+// version's chunks are deleted afterwards.
+
+#define OBJECT_MANIFEST_VERSION 0
+#define OBJECT_MANIFEST_CHUNK -1
+
+// Bind and column positions shared by the insert, select and delete statements
+enum {
+    OBJECT_COLUMN_KEY,
+    OBJECT_COLUMN_VERSION,
+    OBJECT_COLUMN_CHUNK_NO,
+    OBJECT_COLUMN_DATA,
+    OBJECT_COLUMN_CHECKSUM,
+    OBJECT_COLUMN_SIZE,
+    OBJECT_COLUMN_CHUNK_COUNT,
+    OBJECT_COLUMN_CHUNK_VERSION
+};
+
+static VALUE rb_eIntegrityError;
+static ID id_read;
+static ID id_write;
+
+typedef struct {
+    VALUE key;
+    cass_int64_t version;
+    VALUE io;
+    long chunk_size;
+    const CassPrepared* prepared;
+    request_window_t* window;
+    uint64_t object_size;
+    int32_t chunk_count;
+    uint32_t checksum;
+} object_put_t;
+
+typedef struct {
+    VALUE key;
+    VALUE io;
+    VALUE output;
+    const CassPrepared* prepared;
+    request_window_t* window;
+    const CassResult* result;
+} object_get_t;
+
+typedef struct {
+    VALUE key;
+    cass_int64_t version;
+    cass_int32_t chunk_count;
+    const CassPrepared* prepared;
+    request_window_t* window;
+} object_delete_t;
+
+// What a manifest row says about the current version of an object
+typedef struct {
+    cass_int64_t chunk_version;
+    cass_int32_t chunk_count;
+    uint64_t object_size;
+    uint32_t checksum;
+} object_manifest_t;
+
+static request_window_t* object_window(VALUE self, VALUE concurrency, const char* operation,
+                                       const CassPrepared** prepared) {
+    prepared_statement_wrapper_t* prepared_wrapper;
+    TypedData_Get_Struct(self, prepared_statement_wrapper_t, &prepared_statement_type, prepared_wrapper);
+    
+    session_wrapper_t* session_wrapper;
+    TypedData_Get_Struct(rb_iv_get(self, "@session"), session_wrapper_t, &session_type, session_wrapper);
+    
+    *prepared = prepared_wrapper->prepared;
+    request_window_t* window = request_window_new(session_wrapper->session, window_capacity_from_ruby(concurrency),
+                                                  prepared_wrapper->stats, operation);
+    window->breaker = circuit_breaker_for_prepared(self, prepared_wrapper);
+    window->query_id = prepared_wrapper->query_id;
+    window->gate = session_wrapper->gate;
+    window->priority = priority_current();
+    
+    return window;
+}
+
+// Bound insert, select or delete for one row of the object; the key is always text
+static CassStatement* object_statement(const CassPrepared* prepared, VALUE key, cass_int64_t version,
+                                       cass_int32_t chunk_no) {
+    CassStatement* statement = cass_prepared_bind(prepared);
+    cass_statement_bind_string_n(statement, OBJECT_COLUMN_KEY, RSTRING_PTR(key), (size_t)RSTRING_LEN(key));
+    cass_statement_bind_int64(statement, OBJECT_COLUMN_VERSION, version);
+    cass_statement_bind_int32(statement, OBJECT_COLUMN_CHUNK_NO, chunk_no);
+    return statement;
+}
+
+static void object_check_bind(CassStatement* statement, CassError rc) {
+    if (rc != CASS_OK) {
+        cass_statement_free(statement);
+        rb_raise(rb_eCassandraError, "Failed to bind large object chunk: %s", cass_error_desc(rc));
+    }
+}
+
+static VALUE object_put_run(VALUE arg) {
+    object_put_t* put = (object_put_t*)arg;
+    VALUE read_length = LONG2NUM(put->chunk_size);
+    
+    for (;;) {
+        VALUE chunk = rb_funcall(put->io, id_read, 1, read_length);
+        if (NIL_P(chunk)) {
+            break;
+        }
+        StringValue(chunk);
+        if (RSTRING_LEN(chunk) == 0) {
+            break;
+        }
+        
+        const unsigned char* data = (const unsigned char*)RSTRING_PTR(chunk);
+        size_t length = (size_t)RSTRING_LEN(chunk);
+        uint32_t chunk_checksum = crc32_update(0, data, length);
+        put->checksum = crc32_update(put->checksum, data, length);
+        put->object_size += length;
+        
+        // Wait for the oldest write before submitting past the window
+        if (request_window_full(put->window)) {
+            cass_result_free(request_window_next(put->window));
+        }
+        
+        uint64_t started_ns = monotonic_now_ns();
+        CassStatement* statement = object_statement(put->prepared, put->key, put->version, put->chunk_count);
+        object_check_bind(statement, cass_statement_bind_bytes(statement, OBJECT_COLUMN_DATA, data, length));
+        object_check_bind(statement, cass_statement_bind_int64(statement, OBJECT_COLUMN_CHECKSUM, chunk_checksum));
+        request_window_submit(put->window, statement, started_ns);
+        
+        put->chunk_count++;
+        RB_GC_GUARD(chunk);
+    }
+    
+    while (!request_window_empty(put->window)) {
+        cass_result_free(request_window_next(put->window));
+    }
+    
+    // The manifest switches readers to the new version, so it goes last
+    uint64_t started_ns = monotonic_now_ns();
+    CassStatement* statement = object_statement(put->prepared, put->key, OBJECT_MANIFEST_VERSION, OBJECT_MANIFEST_CHUNK);
+    object_check_bind(statement, cass_statement_bind_int64(statement, OBJECT_COLUMN_CHECKSUM, put->checksum));
+    object_check_bind(statement, cass_statement_bind_int64(statement, OBJECT_COLUMN_SIZE, (cass_int64_t)put->object_size));
+    object_check_bind(statement, cass_statement_bind_int32(statement, OBJECT_COLUMN_CHUNK_COUNT, put->chunk_count));
+    object_check_bind(statement, cass_statement_bind_int64(statement, OBJECT_COLUMN_CHUNK_VERSION, put->version));
+    request_window_submit(put->window, statement, started_ns);
+    cass_result_free(request_window_next(put->window));
+    
+    return Qnil;
+}
+
+static VALUE object_put_cleanup(VALUE arg) {
+    object_put_t* put = (object_put_t*)arg;
+    request_window_free(put->window);
+    return Qnil;
+}
+
+// Ruby method: prepared.put_object(key, version, io, chunk_size, concurrency)
+// The statement must be
+//   INSERT INTO t (key, version, chunk_no, data, checksum, object_size, chunk_count, chunk_version)
+//   VALUES (?, ?, ?, ?, ?, ?, ?, ?)
+// Reads io in chunk_size pieces written under version, which must be new
+// for the key and non-zero, keeping up to concurrency chunk writes in
+// flight, then points the manifest at version. Returns
+// [object_size, chunk_count, crc32].
+static VALUE prepared_statement_put_object(VALUE self, VALUE key, VALUE version, VALUE io, VALUE chunk_size,
+                                           VALUE concurrency) {
+    StringValue(key);
+    cass_int64_t chunk_version = (cass_int64_t)NUM2LL(version);
+    if (chunk_version == OBJECT_MANIFEST_VERSION) {
+        rb_raise(rb_eArgError, "version %d is reserved for the manifest", OBJECT_MANIFEST_VERSION);
+    }
+    long size = NUM2LONG(chunk_size);
+    if (size < 1) {
+        rb_raise(rb_eArgError, "chunk_size must be positive");
+    }
+    
+    object_put_t put = { key, chunk_version, io, size, NULL, NULL, 0, 0, 0 };
+    put.window = object_window(self, concurrency, "large object write", &put.prepared);
+    
+    rb_ensure(object_put_run, (VALUE)&put, object_put_cleanup, (VALUE)&put);
+    
+    RB_GC_GUARD(key);
+    return rb_ary_new_from_args(3, ULL2NUM(put.object_size), INT2NUM(put.chunk_count), UINT2NUM(put.checksum));
+}
+
+static void object_integrity_error(VALUE key, const char* message, long chunk_no) {
+    rb_raise(rb_eIntegrityError, "Large object %s: %s (chunk %ld)", StringValueCStr(key), message, chunk_no);
+}
+
+static const CassRow* object_next_row(object_get_t* get) {
+    get->result = request_window_next(get->window);
+    return cass_result_first_row(get->result);
+}
+
+static cass_int64_t object_column_int64(const CassRow* row, size_t column) {
+    cass_int64_t value = 0;
+    cass_value_get_int64(cass_row_get_column(row, column), &value);
+    return value;
+}
+
+// Fetch the manifest row through the get's window; false when the key does
+// not exist
+static bool object_read_manifest(object_get_t* get, object_manifest_t* manifest) {
+    request_window_submit(get->window,
+                          object_statement(get->prepared, get->key, OBJECT_MANIFEST_VERSION, OBJECT_MANIFEST_CHUNK),
+                          monotonic_now_ns());
+    const CassRow* row = object_next_row(get);
+    if (!row) {
+        return false;
+    }
+    
+    manifest->chunk_count = 0;
+    cass_value_get_int32(cass_row_get_column(row, OBJECT_COLUMN_CHUNK_COUNT), &manifest->chunk_count);
+    manifest->chunk_version = object_column_int64(row, OBJECT_COLUMN_CHUNK_VERSION);
+    manifest->object_size = (uint64_t)object_column_int64(row, OBJECT_COLUMN_SIZE);
+    manifest->checksum = (uint32_t)object_column_int64(row, OBJECT_COLUMN_CHECKSUM);
+    cass_result_free(get->result);
+    get->result = NULL;
+    return true;
+}
+
+// Attempts of a read whose chunks a concurrent put deleted: each starts over
+// on the manifest that replaced the one being read
+#define OBJECT_READ_ATTEMPTS 3
+
+// Wait out the chunk reads still in flight so the window can be reused
+static void object_drain(object_get_t* get) {
+    while (!request_window_empty(get->window)) {
+        cass_result_free(request_window_next(get->window));
+    }
+}
+
+// Fetch and verify the chunks of manifest's version into the get's output,
+// counting bytes handed to io in *written. Returns the first missing chunk,
+// or -1 once the whole object was read.
+static long object_read_chunks(object_get_t* get, const object_manifest_t* manifest, uint64_t* written) {
+    cass_int32_t chunk_count = manifest->chunk_count;
+    uint64_t received = 0;
+    uint32_t checksum = 0;
+    cass_int32_t submitted = 0;
+    
+    for (cass_int32_t chunk_no = 0; chunk_no < chunk_count; chunk_no++) {
+        // Keep the window full ahead of the chunk being consumed
+        while (submitted < chunk_count && !request_window_full(get->window)) {
+            request_window_submit(get->window,
+                                  object_statement(get->prepared, get->key, manifest->chunk_version, submitted),
+                                  monotonic_now_ns());
+            submitted++;
+        }
+        
+        const CassRow* row = object_next_row(get);
+        if (!row) {
+            cass_result_free(get->result);
+            get->result = NULL;
+            return chunk_no;
+        }
+        
+        const cass_byte_t* data = NULL;
+        size_t length = 0;
+        const CassValue* data_value = cass_row_get_column(row, OBJECT_COLUMN_DATA);
+        if (!cass_value_is_null(data_value)) {
+            cass_value_get_bytes(data_value, &data, &length);
+        }
+        
+        uint32_t expected = (uint32_t)object_column_int64(row, OBJECT_COLUMN_CHECKSUM);
+        if (crc32_update(0, data, length) != expected) {
+            object_integrity_error(get->key, "chunk checksum mismatch", chunk_no);
+        }
+        
+        checksum = crc32_update(checksum, data, length);
+        received += length;
+        
+        if (NIL_P(get->io)) {
+            rb_str_cat(get->output, (const char*)data, (long)length);
+        } else {
+            rb_funcall(get->io, id_write, 1, rb_str_new((const char*)data, (long)length));
+            *written += length;
+        }
+        
+        cass_result_free(get->result);
+        get->result = NULL;
+    }
+    
+    if (received != manifest->object_size) {
+        object_integrity_error(get->key, "size mismatch", chunk_count);
+    }
+    if (checksum != manifest->checksum) {
+        object_integrity_error(get->key, "object checksum mismatch", chunk_count);
+    }
+    
+    return -1;
+}
+
+static VALUE object_get_run(VALUE arg) {
+    object_get_t* get = (object_get_t*)arg;
+    
+    // Manifest first: it says which chunks to fetch and what they add up to
+    object_manifest_t manifest;
+    if (!object_read_manifest(get, &manifest)) {
+        return Qnil;
+    }
+    
+    if (NIL_P(get->io)) {
+        get->output = rb_str_buf_new((long)manifest.object_size);
+        rb_enc_associate(get->output, rb_ascii8bit_encoding());
+    }
+    
+    uint64_t written = 0;
+    for (int attempt = 1;; attempt++) {
+        long missing = object_read_chunks(get, &manifest, &written);
+        if (missing < 0) {
+            break;
+        }
+        
+        // A put switches the manifest before deleting the chunks it replaced,
+        // so a changed manifest means the object was replaced mid-read
+        object_drain(get);
+        object_manifest_t current;
+        bool exists = object_read_manifest(get, &current);
+        if (exists && current.chunk_version == manifest.chunk_version) {
+            object_integrity_error(get->key, "chunk missing", missing);
+        }
+        
+        // Bytes already written to io cannot be taken back
+        if (attempt == OBJECT_READ_ATTEMPTS || written > 0) {
+            object_integrity_error(get->key, "replaced while being read", missing);
+        }
+        if (!exists) {
+            return Qnil;
+        }
+        
+        manifest = current;
+        if (NIL_P(get->io)) {
+            rb_str_set_len(get->output, 0);
+        }
+    }
+    
+    return NIL_P(get->io) ? get->output : get->io;
+}
+
+static VALUE object_get_cleanup(VALUE arg) {
+    object_get_t* get = (object_get_t*)arg;
+    
+    if (get->result) {
+        cass_result_free(get->result);
+    }
+    request_window_free(get->window);
+    
+    return Qnil;
+}
+
+// Ruby method: prepared.get_object(key, io, concurrency)
+// The statement must be
+//   SELECT key, version, chunk_no, data, checksum, object_size, chunk_count, chunk_version
+//   FROM t WHERE key = ? AND version = ? AND chunk_no = ?
+// Fetches the manifest, then up to concurrency chunks at a time, verifying
+// each chunk's CRC32 and the object's size and CRC32. Chunks are written to
+// io in order, or collected into a binary String when io is nil. A read
+// whose object a concurrent put replaced starts over on the new manifest,
+// unless chunks were already written to io. Returns nil when the object
+// does not exist.
+static VALUE prepared_statement_get_object(VALUE self, VALUE key, VALUE io, VALUE concurrency) {
+    StringValue(key);
+    
+    object_get_t get = { key, io, Qnil, NULL, NULL, NULL };
+    get.window = object_window(self, concurrency, "large object read", &get.prepared);
+    
+    VALUE object = rb_ensure(object_get_run, (VALUE)&get, object_get_cleanup, (VALUE)&get);
+    
+    RB_GC_GUARD(key);
+    RB_GC_GUARD(get.output);
+    return object;
+}
+
+static VALUE object_manifest_run(VALUE arg) {
+    object_get_t* get = (object_get_t*)arg;
+    
+    object_manifest_t manifest;
+    if (!object_read_manifest(get, &manifest)) {
+        return Qnil;
+    }
+    return rb_ary_new_from_args(2, LL2NUM(manifest.chunk_version), INT2NUM(manifest.chunk_count));
+}
+
+// Ruby method: prepared.object_manifest(key) -> [chunk_version, chunk_count] or nil
+// Same statement as get_object; reads only the manifest row.
+static VALUE prepared_statement_object_manifest(VALUE self, VALUE key) {
+    StringValue(key);
+    
+    object_get_t get = { key, Qnil, Qnil, NULL, NULL, NULL };
+    get.window = object_window(self, INT2FIX(1), "large object read", &get.prepared);
+    
+    VALUE manifest = rb_ensure(object_manifest_run, (VALUE)&get, object_get_cleanup, (VALUE)&get);
+    
+    RB_GC_GUARD(key);
+    return manifest;
+}
+
+static VALUE object_delete_run(VALUE arg) {
+    object_delete_t* del = (object_delete_t*)arg;
+    
+    for (cass_int32_t chunk_no = 0; chunk_no < del->chunk_count; chunk_no++) {
+        if (request_window_full(del->window)) {
+            cass_result_free(request_window_next(del->window));
+        }
+        request_window_submit(del->window, object_statement(del->prepared, del->key, del->version, chunk_no),
+                              monotonic_now_ns());
+    }
+    
+    while (!request_window_empty(del->window)) {
+        cass_result_free(request_window_next(del->window));
+    }
+    
+    return Qnil;
+}
+
+static VALUE object_delete_cleanup(VALUE arg) {
+    object_delete_t* del = (object_delete_t*)arg;
+    request_window_free(del->window);
+    return Qnil;
+}
+
+// Ruby method: prepared.delete_object_chunks(key, version, chunk_count, concurrency)
+// The statement must be
+//   DELETE FROM t WHERE key = ? AND version = ? AND chunk_no = ?
+// Deletes the chunks of a version the manifest no longer points at, keeping
+// up to concurrency deletes in flight.
+static VALUE prepared_statement_delete_object_chunks(VALUE self, VALUE key, VALUE version, VALUE chunk_count,
+                                                     VALUE concurrency) {
+    StringValue(key);
+    cass_int64_t chunk_version = (cass_int64_t)NUM2LL(version);
+    if (chunk_version == OBJECT_MANIFEST_VERSION) {
+        rb_raise(rb_eArgError, "version %d is reserved for the manifest", OBJECT_MANIFEST_VERSION);
+    }
+    
+    object_delete_t del = { key, chunk_version, (cass_int32_t)NUM2INT(chunk_count), NULL, NULL };
+    del.window = object_window(self, concurrency, "large object delete", &del.prepared);
+    
+    rb_ensure(object_delete_run, (VALUE)&del, object_delete_cleanup, (VALUE)&del);
+    
+    RB_GC_GUARD(key);
+    return Qnil;
+}
+
+void init_large_object() {
+    id_read = rb_intern("read");
+    id_write = rb_intern("write");
+    
+    rb_eIntegrityError = rb_define_class_under(rb_cCassandraCpp, "IntegrityError", rb_eCassandraError);
+    
+    rb_define_method(rb_cPreparedStatement, "put_object", (VALUE(*)(...))prepared_statement_put_object, 5);
+    rb_define_method(rb_cPreparedStatement, "get_object", (VALUE(*)(...))prepared_statement_get_object, 3);
+    rb_define_method(rb_cPreparedStatement, "object_manifest", (VALUE(*)(...))prepared_statement_object_manifest, 1);
+    rb_define_method(rb_cPreparedStatement, "delete_object_chunks",
+                     (VALUE(*)(...))prepared_statement_delete_object_chunks, 4);
+}
\ No newline at end of file
@@ -0,0 +1,323 @@
+#include "cassandra_cpp.h"
+#include <ruby/thread.h>
+#include <time.h>
+
+VALUE rb_mNativeMetrics;
+
+// Process-wide phase histograms, fed by every execute path
+static phase_stats_t* global_phase_stats = NULL;
+
+static const char* phase_names[PHASE_COUNT] = {
+    "queue",
+    "network",
+    "gvl_wait",
+    "decode"
+};
+
+// Process-wide GVL histograms: how long each entry point held the GVL, and
+// how long any release waited to get it back once its work was done
+static latency_histogram_t* gvl_hold_stats = NULL;  // GVL_ENTRY_COUNT histograms
+static latency_histogram_t* gvl_reacquire_stats = NULL;
+
+static const char* gvl_entry_names[GVL_ENTRY_COUNT] = {
+    "execute",
+    "bind",
+    "value",
+    "batch_add",
+    "batch_execute"
+};
+
+// Time the current thread spent with the GVL released, summed over all
+// gvl_release_call; entry points subtract it from their elapsed time
+static thread_local uint64_t gvl_released_total_ns = 0;
+
+uint64_t monotonic_now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Map a duration to its bucket: values below 8ns get their own bucket, larger
+// values are split into 8 linear sub-buckets per power of two.
+static size_t latency_bucket_index(uint64_t ns) {
+    if (ns < LATENCY_HISTOGRAM_SUB_BUCKETS) {
+        return (size_t)ns;
+    }
+
+    int msb = 63 - __builtin_clzll(ns);
+    size_t sub_bucket = (size_t)((ns >> (msb - 3)) & (LATENCY_HISTOGRAM_SUB_BUCKETS - 1));
+    size_t index = (size_t)(msb - 2) * LATENCY_HISTOGRAM_SUB_BUCKETS + sub_bucket;
+
+    return index < LATENCY_HISTOGRAM_BUCKETS ? index : LATENCY_HISTOGRAM_BUCKETS - 1;
+}
+
+// Upper bound (exclusive) of a bucket in nanoseconds
+static uint64_t latency_bucket_upper_ns(size_t index) {
+    if (index < LATENCY_HISTOGRAM_SUB_BUCKETS) {
+        return index + 1;
+    }
+
+    int msb = (int)(index / LATENCY_HISTOGRAM_SUB_BUCKETS) + 2;
+    uint64_t sub_bucket = index % LATENCY_HISTOGRAM_SUB_BUCKETS;
+    return (LATENCY_HISTOGRAM_SUB_BUCKETS + sub_bucket + 1) << (msb - 3);
+}
+
+void latency_histogram_record(latency_histogram_t* histogram, uint64_t ns) {
+    histogram->buckets[latency_bucket_index(ns)].fetch_add(1, std::memory_order_relaxed);
+    histogram->count.fetch_add(1, std::memory_order_relaxed);
+    histogram->total_ns.fetch_add(ns, std::memory_order_relaxed);
+
+    uint64_t current_max = histogram->max_ns.load(std::memory_order_relaxed);
+    while (ns > current_max &&
+           !histogram->max_ns.compare_exchange_weak(current_max, ns, std::memory_order_relaxed)) {
+    }
+}
+
+static void latency_histogram_reset(latency_histogram_t* histogram) {
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        histogram->buckets[i].store(0, std::memory_order_relaxed);
+    }
+    histogram->count.store(0, std::memory_order_relaxed);
+    histogram->total_ns.store(0, std::memory_order_relaxed);
+    histogram->max_ns.store(0, std::memory_order_relaxed);
+}
+
+static double ns_to_ms(uint64_t ns) {
+    return (double)ns / 1000000.0;
+}
+
+// Convert a histogram snapshot to a Ruby hash with millisecond values,
+// matching the units used by SessionMetrics
+VALUE latency_histogram_to_ruby(const latency_histogram_t* histogram) {
+    static const double percentiles[] = { 0.50, 0.90, 0.95, 0.99, 0.999 };
+    static const char* percentile_keys[] = { "p50_ms", "p90_ms", "p95_ms", "p99_ms", "p999_ms" };
+    const size_t percentile_count = sizeof(percentiles) / sizeof(percentiles[0]);
+
+    uint64_t counts[LATENCY_HISTOGRAM_BUCKETS];
+    uint64_t count = 0;
+    for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        counts[i] = histogram->buckets[i].load(std::memory_order_relaxed);
+        count += counts[i];
+    }
+
+    uint64_t total_ns = histogram->total_ns.load(std::memory_order_relaxed);
+    uint64_t max_ns = histogram->max_ns.load(std::memory_order_relaxed);
+
+    VALUE hash = rb_hash_new();
+    rb_hash_aset(hash, ID2SYM(rb_intern("count")), ULL2NUM(count));
+    rb_hash_aset(hash, ID2SYM(rb_intern("mean_ms")), DBL2NUM(count ? ns_to_ms(total_ns) / count : 0.0));
+    rb_hash_aset(hash, ID2SYM(rb_intern("max_ms")), DBL2NUM(ns_to_ms(max_ns)));
+
+    size_t bucket = 0;
+    uint64_t seen = 0;
+    for (size_t p = 0; p < percentile_count; p++) {
+        double value_ms = 0.0;
+        if (count > 0) {
+            uint64_t rank = (uint64_t)(percentiles[p] * (double)count);
+            if (rank == 0) {
+                rank = 1;
+            }
+            while (bucket < LATENCY_HISTOGRAM_BUCKETS && seen + counts[bucket] < rank) {
+                seen += counts[bucket];
+                bucket++;
+            }
+            uint64_t upper_ns = bucket < LATENCY_HISTOGRAM_BUCKETS ? latency_bucket_upper_ns(bucket) : max_ns;
+            value_ms = ns_to_ms(upper_ns < max_ns ? upper_ns : max_ns);
+        }
+        rb_hash_aset(hash, ID2SYM(rb_intern(percentile_keys[p])), DBL2NUM(value_ms));
+    }
+
+    return hash;
+}
+
+// Upper bound of the bucket holding the percentile, capped at the largest
+// value recorded; 0 while the histogram is empty
+uint64_t latency_histogram_percentile_ns(const latency_histogram_t* histogram, double percentile) {
+    uint64_t count = histogram->count.load(std::memory_order_relaxed);
+    uint64_t max_ns = histogram->max_ns.load(std::memory_order_relaxed);
+    if (count == 0) {
+        return 0;
+    }
+
+    uint64_t rank = (uint64_t)(percentile * (double)count);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < LATENCY_HISTOGRAM_BUCKETS; bucket++) {
+        seen += histogram->buckets[bucket].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t upper_ns = latency_bucket_upper_ns(bucket);
+            return upper_ns < max_ns ? upper_ns : max_ns;
+        }
+    }
+
+    return max_ns;
+}
+
+phase_stats_t* phase_stats_new() {
+    return new phase_stats_t();
+}
+
+void phase_stats_free(phase_stats_t* stats) {
+    delete stats;
+}
+
+void phase_stats_reset(phase_stats_t* stats) {
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        latency_histogram_reset(&stats->phases[phase]);
+    }
+}
+
+VALUE phase_stats_to_ruby(const phase_stats_t* stats) {
+    VALUE hash = rb_hash_new();
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        rb_hash_aset(hash, ID2SYM(rb_intern(phase_names[phase])),
+                     latency_histogram_to_ruby(&stats->phases[phase]));
+    }
+    return hash;
+}
+
+static void record_phase(phase_stats_t* statement_stats, request_phase_t phase, uint64_t from_ns, uint64_t to_ns) {
+    if (from_ns == 0 || to_ns < from_ns) {
+        return;
+    }
+
+    uint64_t elapsed = to_ns - from_ns;
+    latency_histogram_record(&global_phase_stats->phases[phase], elapsed);
+    if (statement_stats) {
+        latency_histogram_record(&statement_stats->phases[phase], elapsed);
+    }
+}
+
+// Record each phase of a completed request globally and, when given, for the statement
+void record_request_timing(phase_stats_t* statement_stats, const request_timing_t* timing) {
+    record_phase(statement_stats, PHASE_QUEUE, timing->started_ns, timing->submitted_ns);
+    record_phase(statement_stats, PHASE_NETWORK, timing->submitted_ns, timing->ready_ns);
+    record_phase(statement_stats, PHASE_GVL_WAIT, timing->ready_ns, timing->resumed_ns);
+    record_phase(statement_stats, PHASE_DECODE, timing->resumed_ns, timing->decoded_ns);
+}
+
+// Phases of one request in milliseconds, nil for those it never reached
+VALUE request_timing_to_ruby(const request_timing_t* timing) {
+    const uint64_t stamps[PHASE_COUNT + 1] = {
+        timing->started_ns, timing->submitted_ns, timing->ready_ns, timing->resumed_ns, timing->decoded_ns
+    };
+
+    VALUE hash = rb_hash_new();
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        uint64_t from_ns = stamps[phase];
+        uint64_t to_ns = stamps[phase + 1];
+        VALUE elapsed = from_ns == 0 || to_ns < from_ns ? Qnil : DBL2NUM(ns_to_ms(to_ns - from_ns));
+        rb_hash_aset(hash, ID2SYM(rb_intern(phase_names[phase])), elapsed);
+    }
+    return hash;
+}
+
+typedef struct {
+    void* (*func)(void*);
+    void* data;
+    uint64_t returned_ns;
+} gvl_release_t;
+
+static void* gvl_release_run(void* ptr) {
+    gvl_release_t* release = (gvl_release_t*)ptr;
+    void* result = release->func(release->data);
+    release->returned_ns = monotonic_now_ns();
+    return result;
+}
+
+// rb_thread_call_without_gvl that keeps the GVL accounting: the time away
+// counts against the calling entry point's hold time, and the time from
+// func returning until the GVL is back is recorded as a reacquire wait
+void* gvl_release_call(void* (*func)(void*), void* data, rb_unblock_function_t* ubf, void* ubf_data) {
+    gvl_release_t release = { func, data, 0 };
+    uint64_t released_ns = monotonic_now_ns();
+    void* result = rb_thread_call_without_gvl(gvl_release_run, &release, ubf, ubf_data);
+    uint64_t resumed_ns = monotonic_now_ns();
+
+    gvl_released_total_ns += resumed_ns - released_ns;
+    // func does not run when an interrupt was already pending
+    if (release.returned_ns != 0 && resumed_ns >= release.returned_ns) {
+        latency_histogram_record(gvl_reacquire_stats, resumed_ns - release.returned_ns);
+    }
+
+    return result;
+}
+
+typedef struct {
+    gvl_span_t span;
+    gvl_entry_t entry;
+    VALUE (*body)(int, VALUE*, VALUE);
+    int argc;
+    VALUE* argv;
+    VALUE self;
+} gvl_span_call_t;
+
+static VALUE gvl_span_call_body(VALUE ptr) {
+    gvl_span_call_t* call = (gvl_span_call_t*)ptr;
+    return call->body(call->argc, call->argv, call->self);
+}
+
+// Record the GVL hold time of the call: its elapsed time minus the time it
+// spent in gvl_release_call
+static VALUE gvl_span_call_end(VALUE ptr) {
+    gvl_span_call_t* call = (gvl_span_call_t*)ptr;
+    uint64_t elapsed = monotonic_now_ns() - call->span.started_ns;
+    uint64_t released = gvl_released_total_ns - call->span.released_ns;
+    latency_histogram_record(&gvl_hold_stats[call->entry], elapsed > released ? elapsed - released : 0);
+    return Qnil;
+}
+
+// Run an entry point's body as one GVL span, recorded whether the body
+// returns or raises
+VALUE gvl_span_call(gvl_entry_t entry, VALUE (*body)(int, VALUE*, VALUE), int argc, VALUE* argv, VALUE self) {
+    gvl_span_call_t call = { { monotonic_now_ns(), gvl_released_total_ns }, entry, body, argc, argv, self };
+    return rb_ensure(gvl_span_call_body, (VALUE)&call, gvl_span_call_end, (VALUE)&call);
+}
+
+// Ruby method: CassandraCpp::NativeMetrics.phase_latencies
+static VALUE native_metrics_phase_latencies(VALUE self) {
+    return phase_stats_to_ruby(global_phase_stats);
+}
+
+// Ruby method: CassandraCpp::NativeMetrics.reset_phase_latencies
+static VALUE native_metrics_reset_phase_latencies(VALUE self) {
+    phase_stats_reset(global_phase_stats);
+    return Qnil;
+}
+
+// Ruby method: CassandraCpp::NativeMetrics.gvl_stats
+static VALUE native_metrics_gvl_stats(VALUE self) {
+    VALUE hold = rb_hash_new();
+    for (int entry = 0; entry < GVL_ENTRY_COUNT; entry++) {
+        rb_hash_aset(hold, ID2SYM(rb_intern(gvl_entry_names[entry])), latency_histogram_to_ruby(&gvl_hold_stats[entry]));
+    }
+
+    VALUE hash = rb_hash_new();
+    rb_hash_aset(hash, ID2SYM(rb_intern("hold")), hold);
+    rb_hash_aset(hash, ID2SYM(rb_intern("reacquire")), latency_histogram_to_ruby(gvl_reacquire_stats));
+    return hash;
+}
+
+// Ruby method: CassandraCpp::NativeMetrics.reset_gvl_stats
+static VALUE native_metrics_reset_gvl_stats(VALUE self) {
+    for (int entry = 0; entry < GVL_ENTRY_COUNT; entry++) {
+        latency_histogram_reset(&gvl_hold_stats[entry]);
+    }
+    latency_histogram_reset(gvl_reacquire_stats);
+    return Qnil;
+}
+
+void init_metrics() {
+    global_phase_stats = phase_stats_new();
+    gvl_hold_stats = new latency_histogram_t[GVL_ENTRY_COUNT]();
+    gvl_reacquire_stats = new latency_histogram_t();
+
+    rb_mNativeMetrics = rb_define_module_under(rb_cCassandraCpp, "NativeMetrics");
+    rb_define_module_function(rb_mNativeMetrics, "phase_latencies", (VALUE(*)(...))native_metrics_phase_latencies, 0);
+    rb_define_module_function(rb_mNativeMetrics, "reset_phase_latencies", (VALUE(*)(...))native_metrics_reset_phase_latencies, 0);
+    rb_define_module_function(rb_mNativeMetrics, "gvl_stats", (VALUE(*)(...))native_metrics_gvl_stats, 0);
+    rb_define_module_function(rb_mNativeMetrics, "reset_gvl_stats", (VALUE(*)(...))native_metrics_reset_gvl_stats, 0);
+}
\ No newline at end of file
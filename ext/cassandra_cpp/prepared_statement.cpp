@@ -1,19 +1,30 @@
 #include "cassandra_cpp.h"
 
 // Memory management functions
+static void prepared_statement_mark(void* ptr) {
+    prepared_statement_wrapper_t* wrapper = (prepared_statement_wrapper_t*)ptr;
+    if (wrapper) {
+        hot_partitions_mark(wrapper->hot);
+    }
+}
+
 static void prepared_statement_free(void* ptr) {
     prepared_statement_wrapper_t* wrapper = (prepared_statement_wrapper_t*)ptr;
     if (wrapper) {
         if (wrapper->prepared) {
             cass_prepared_free(wrapper->prepared);
         }
+        if (wrapper->stats) {
+            phase_stats_free(wrapper->stats);
+        }
+        hot_partitions_free(wrapper->hot);
         xfree(wrapper);
     }
 }
 
 const rb_data_type_t prepared_statement_type = {
     "CassandraCpp::NativePreparedStatement",
-    { 0, prepared_statement_free, 0 },
+    { prepared_statement_mark, prepared_statement_free, 0 },
     0, 0,
     RUBY_TYPED_FREE_IMMEDIATELY
 };
@@ -25,12 +36,23 @@ static VALUE prepared_statement_bind(VALUE self) {
     
     // Create statement from prepared
     CassStatement* statement = cass_prepared_bind(prepared_wrapper->prepared);
+    if (prepared_wrapper->idempotent) {
+        cass_statement_set_is_idempotent(statement, cass_true);
+    }
     
     // Create statement wrapper
     statement_wrapper_t* statement_wrapper = ALLOC(statement_wrapper_t);
     statement_wrapper->statement = statement;
     statement_wrapper->prepared = prepared_wrapper->prepared;
     statement_wrapper->prepared_ref = self;
+    statement_wrapper->capture = NULL;
+    if (traffic_recorder_active()) {
+        session_wrapper_t* session_wrapper;
+        TypedData_Get_Struct(prepared_wrapper->session_ref, session_wrapper_t, &session_type, session_wrapper);
+        statement_wrapper->capture = traffic_capture_new(rb_iv_get(self, "@query"), true, session_wrapper->consistency);
+    }
+    statement_wrapper->query_id = prepared_wrapper->query_id;
+    statement_wrapper->partition_key = Qnil;
     
     VALUE statement_obj = TypedData_Wrap_Struct(rb_cStatement, &statement_type, statement_wrapper);
     
@@ -40,8 +62,33 @@ static VALUE prepared_statement_bind(VALUE self) {
     return statement_obj;
 }
 
+// Ruby method: prepared.phase_latencies
+static VALUE prepared_statement_phase_latencies(VALUE self) {
+    prepared_statement_wrapper_t* prepared_wrapper;
+    TypedData_Get_Struct(self, prepared_statement_wrapper_t, &prepared_statement_type, prepared_wrapper);
+    
+    return phase_stats_to_ruby(prepared_wrapper->stats);
+}
+
+// Ruby method: prepared.parameter_names -> names of the bind markers, in order
+static VALUE prepared_statement_parameter_names(VALUE self) {
+    prepared_statement_wrapper_t* prepared_wrapper;
+    TypedData_Get_Struct(self, prepared_statement_wrapper_t, &prepared_statement_type, prepared_wrapper);
+    
+    VALUE names = rb_ary_new();
+    const char* name;
+    size_t name_length;
+    for (size_t i = 0; cass_prepared_parameter_name(prepared_wrapper->prepared, i, &name, &name_length) == CASS_OK; i++) {
+        rb_ary_push(names, rb_str_new(name, (long)name_length));
+    }
+    
+    return names;
+}
+
 void init_prepared_statement() {
     rb_cPreparedStatement = rb_define_class_under(rb_cCassandraCpp, "NativePreparedStatement", rb_cObject);
     rb_undef_alloc_func(rb_cPreparedStatement);
     rb_define_method(rb_cPreparedStatement, "bind", (VALUE(*)(...))prepared_statement_bind, 0);
+    rb_define_method(rb_cPreparedStatement, "phase_latencies", (VALUE(*)(...))prepared_statement_phase_latencies, 0);
+    rb_define_method(rb_cPreparedStatement, "parameter_names", (VALUE(*)(...))prepared_statement_parameter_names, 0);
 }
\ No newline at end of file
@@ -0,0 +1,328 @@
+#include "cassandra_cpp.h"
+#include <ruby/thread.h>
+#include <mutex>
+#include <condition_variable>
+
+// Per-session admission gate in front of driver submission. At most
+// capacity requests are in flight; interactive requests are granted slots
+// first, and batch requests only get a slot while no interactive request is
+// queued and fewer than batch_limit batch requests are in flight. With a
+// latency target, batch_limit shrinks while interactive latency is above it
+// and grows back once it recovers.
+
+#define PRIORITY_ADJUST_INTERVAL_NS 100000000ULL  // 100ms between batch limit changes
+#define PRIORITY_LATENCY_EWMA_WEIGHT 0.2
+
+typedef struct priority_waiter_s priority_waiter_t;
+
+struct priority_gate_s {
+    std::mutex lock;
+    std::condition_variable ready;
+    std::atomic<int> refs;
+    
+    size_t capacity;
+    double batch_share;          // Batch slots as a share of capacity, when latency is healthy
+    uint64_t latency_target_ns;  // 0 disables adaptive throttling
+    size_t batch_limit;
+    
+    size_t in_flight[PRIORITY_CLASS_COUNT];
+    std::deque<priority_waiter_t*> waiting[PRIORITY_CLASS_COUNT];
+    uint64_t granted[PRIORITY_CLASS_COUNT];
+    size_t max_queued[PRIORITY_CLASS_COUNT];
+    latency_histogram_t queue_wait[PRIORITY_CLASS_COUNT];
+    
+    double interactive_latency_ns;  // EWMA
+    uint64_t adjusted_ns;
+};
+
+struct priority_waiter_s {
+    priority_gate_t* gate;
+    priority_class_t priority;
+    bool granted;
+    bool interrupted;
+};
+
+static ID id_priority;
+static ID id_batch;
+
+static const char* priority_class_names[PRIORITY_CLASS_COUNT] = { "interactive", "batch" };
+
+// Priority of the calling fiber, set from Ruby by Session#with_priority
+priority_class_t priority_current() {
+    VALUE priority = rb_thread_local_aref(rb_thread_current(), id_priority);
+    
+    if (SYMBOL_P(priority) && SYM2ID(priority) == id_batch) {
+        return PRIORITY_BATCH;
+    }
+    return PRIORITY_INTERACTIVE;
+}
+
+static size_t priority_batch_ceiling(const priority_gate_t* gate) {
+    size_t ceiling = (size_t)((double)gate->capacity * gate->batch_share);
+    return ceiling < 1 ? 1 : ceiling;
+}
+
+// Caller holds gate->lock
+static bool priority_gate_can_grant(const priority_gate_t* gate, priority_class_t priority) {
+    size_t total = gate->in_flight[PRIORITY_INTERACTIVE] + gate->in_flight[PRIORITY_BATCH];
+    if (total >= gate->capacity) {
+        return false;
+    }
+    
+    if (priority == PRIORITY_BATCH) {
+        return gate->waiting[PRIORITY_INTERACTIVE].empty() && gate->in_flight[PRIORITY_BATCH] < gate->batch_limit;
+    }
+    return true;
+}
+
+// Caller holds gate->lock
+static void priority_gate_grant(priority_gate_t* gate, priority_class_t priority) {
+    gate->in_flight[priority]++;
+    gate->granted[priority]++;
+    gate->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void priority_gate_unref(priority_gate_t* gate) {
+    if (gate->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete gate;
+    }
+}
+
+static void* priority_gate_wait_without_gvl(void* ptr) {
+    priority_waiter_t* waiter = (priority_waiter_t*)ptr;
+    priority_gate_t* gate = waiter->gate;
+    std::deque<priority_waiter_t*>& queue = gate->waiting[waiter->priority];
+    std::unique_lock<std::mutex> guard(gate->lock);
+    
+    for (;;) {
+        if (queue.front() == waiter && priority_gate_can_grant(gate, waiter->priority)) {
+            queue.pop_front();
+            priority_gate_grant(gate, waiter->priority);
+            waiter->granted = true;
+            // The next waiter (or a batch waiter, once interactive drains) may fit too
+            gate->ready.notify_all();
+            break;
+        }
+        if (waiter->interrupted) {
+            for (std::deque<priority_waiter_t*>::iterator it = queue.begin(); it != queue.end(); ++it) {
+                if (*it == waiter) {
+                    queue.erase(it);
+                    break;
+                }
+            }
+            gate->ready.notify_all();
+            break;
+        }
+        gate->ready.wait(guard);
+    }
+    
+    return NULL;
+}
+
+static void priority_gate_unblock(void* ptr) {
+    priority_waiter_t* waiter = (priority_waiter_t*)ptr;
+    std::lock_guard<std::mutex> guard(waiter->gate->lock);
+    
+    waiter->interrupted = true;
+    waiter->gate->ready.notify_all();
+}
+
+// Take a slot for one request, queueing (without the GVL) behind earlier
+// requests of the same class. Interrupts such as Thread#raise or Timeout are
+// delivered while queued, so this may raise; callers must not hold
+// resources that only their own frame would release. NULL gates admit all.
+void priority_gate_enter(priority_gate_t* gate, priority_class_t priority) {
+    if (!gate) {
+        return;
+    }
+    
+    uint64_t queued_ns = monotonic_now_ns();
+    
+    for (;;) {
+        priority_waiter_t waiter = { gate, priority, false, false };
+        {
+            std::lock_guard<std::mutex> guard(gate->lock);
+            if (gate->waiting[priority].empty() && priority_gate_can_grant(gate, priority)) {
+                priority_gate_grant(gate, priority);
+                waiter.granted = true;
+            } else {
+                gate->waiting[priority].push_back(&waiter);
+                if (gate->waiting[priority].size() > gate->max_queued[priority]) {
+                    gate->max_queued[priority] = gate->waiting[priority].size();
+                }
+            }
+        }
+        
+        if (!waiter.granted) {
+            gvl_release_call(priority_gate_wait_without_gvl, &waiter, priority_gate_unblock, &waiter);
+        }
+        if (waiter.granted) {
+            break;
+        }
+        
+        // Raises if the interrupt was meant for this thread, otherwise queue again
+        rb_thread_check_ints();
+    }
+    
+    latency_histogram_record(&gate->queue_wait[priority], monotonic_now_ns() - queued_ns);
+}
+
+// Take a slot only if one is free right now, without queueing behind anyone;
+// for optional extra requests that must not wait while their caller holds a
+// slot. No Ruby calls. NULL gates admit all.
+bool priority_gate_try_enter(priority_gate_t* gate, priority_class_t priority) {
+    if (!gate) {
+        return true;
+    }
+    
+    std::lock_guard<std::mutex> guard(gate->lock);
+    if (!gate->waiting[priority].empty() || !priority_gate_can_grant(gate, priority)) {
+        return false;
+    }
+    priority_gate_grant(gate, priority);
+    return true;
+}
+
+// Give back a slot once its request resolved. latency_ns feeds adaptive
+// batch throttling. No Ruby calls: also runs on driver IO threads.
+void priority_gate_exit(priority_gate_t* gate, priority_class_t priority, uint64_t latency_ns) {
+    if (!gate) {
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> guard(gate->lock);
+        gate->in_flight[priority]--;
+        
+        if (priority == PRIORITY_INTERACTIVE && gate->latency_target_ns > 0) {
+            gate->interactive_latency_ns = gate->interactive_latency_ns == 0.0
+                ? (double)latency_ns
+                : gate->interactive_latency_ns + PRIORITY_LATENCY_EWMA_WEIGHT * ((double)latency_ns - gate->interactive_latency_ns);
+            
+            uint64_t now = monotonic_now_ns();
+            if (now - gate->adjusted_ns >= PRIORITY_ADJUST_INTERVAL_NS) {
+                gate->adjusted_ns = now;
+                if (gate->interactive_latency_ns > (double)gate->latency_target_ns) {
+                    gate->batch_limit = gate->batch_limit > 1 ? gate->batch_limit / 2 : 1;
+                } else if (gate->batch_limit < priority_batch_ceiling(gate)) {
+                    gate->batch_limit++;
+                }
+            }
+        }
+        
+        gate->ready.notify_all();
+    }
+    
+    priority_gate_unref(gate);
+}
+
+priority_gate_t* priority_gate_new() {
+    priority_gate_t* gate = new priority_gate_t();
+    gate->refs.store(1, std::memory_order_relaxed);
+    return gate;
+}
+
+// Drop the session's reference; in-flight requests keep the gate alive
+void priority_gate_free(priority_gate_t* gate) {
+    if (gate) {
+        priority_gate_unref(gate);
+    }
+}
+
+void priority_gate_configure(priority_gate_t* gate, size_t capacity, double batch_share, uint64_t latency_target_ns) {
+    std::lock_guard<std::mutex> guard(gate->lock);
+    
+    gate->capacity = capacity;
+    gate->batch_share = batch_share;
+    gate->latency_target_ns = latency_target_ns;
+    gate->batch_limit = priority_batch_ceiling(gate);
+    gate->interactive_latency_ns = 0.0;
+    gate->ready.notify_all();
+}
+
+// { capacity:, batch_limit:, interactive_latency_ms:, interactive: {...}, batch: {...} }
+// where each class reports in_flight, queued, max_queued, granted and a
+// queue_wait histogram summary
+VALUE priority_gate_to_ruby(priority_gate_t* gate) {
+    size_t capacity;
+    size_t batch_limit;
+    double interactive_latency_ns;
+    size_t in_flight[PRIORITY_CLASS_COUNT];
+    size_t queued[PRIORITY_CLASS_COUNT];
+    size_t max_queued[PRIORITY_CLASS_COUNT];
+    uint64_t granted[PRIORITY_CLASS_COUNT];
+    {
+        std::lock_guard<std::mutex> guard(gate->lock);
+        capacity = gate->capacity;
+        batch_limit = gate->batch_limit;
+        interactive_latency_ns = gate->interactive_latency_ns;
+        for (int i = 0; i < PRIORITY_CLASS_COUNT; i++) {
+            in_flight[i] = gate->in_flight[i];
+            queued[i] = gate->waiting[i].size();
+            max_queued[i] = gate->max_queued[i];
+            granted[i] = gate->granted[i];
+        }
+    }
+    
+    VALUE stats = rb_hash_new();
+    rb_hash_aset(stats, ID2SYM(rb_intern("capacity")), SIZET2NUM(capacity));
+    rb_hash_aset(stats, ID2SYM(rb_intern("batch_limit")), SIZET2NUM(batch_limit));
+    rb_hash_aset(stats, ID2SYM(rb_intern("interactive_latency_ms")), DBL2NUM(interactive_latency_ns / 1e6));
+    
+    for (int i = 0; i < PRIORITY_CLASS_COUNT; i++) {
+        VALUE class_stats = rb_hash_new();
+        rb_hash_aset(class_stats, ID2SYM(rb_intern("in_flight")), SIZET2NUM(in_flight[i]));
+        rb_hash_aset(class_stats, ID2SYM(rb_intern("queued")), SIZET2NUM(queued[i]));
+        rb_hash_aset(class_stats, ID2SYM(rb_intern("max_queued")), SIZET2NUM(max_queued[i]));
+        rb_hash_aset(class_stats, ID2SYM(rb_intern("granted")), ULL2NUM(granted[i]));
+        rb_hash_aset(class_stats, ID2SYM(rb_intern("queue_wait")), latency_histogram_to_ruby(&gate->queue_wait[i]));
+        rb_hash_aset(stats, ID2SYM(rb_intern(priority_class_names[i])), class_stats);
+    }
+    
+    return stats;
+}
+
+// Ruby method: session.configure_priorities(max_in_flight, batch_share, latency_target_ms)
+// Puts the gate in front of every request of this session, or retunes it.
+// latency_target_ms may be nil to keep batch traffic at its full share.
+static VALUE session_configure_priorities(VALUE self, VALUE max_in_flight, VALUE batch_share, VALUE latency_target_ms) {
+    session_wrapper_t* wrapper;
+    TypedData_Get_Struct(self, session_wrapper_t, &session_type, wrapper);
+    
+    long capacity = NUM2LONG(max_in_flight);
+    double share = NUM2DBL(batch_share);
+    double target_ms = NIL_P(latency_target_ms) ? 0.0 : NUM2DBL(latency_target_ms);
+    
+    if (capacity < 1) {
+        rb_raise(rb_eArgError, "max_in_flight must be at least 1");
+    }
+    if (!(share > 0.0 && share <= 1.0)) {
+        rb_raise(rb_eArgError, "batch_share must be in (0, 1]");
+    }
+    if (target_ms < 0.0) {
+        rb_raise(rb_eArgError, "interactive latency target must not be negative");
+    }
+    
+    if (!wrapper->gate) {
+        wrapper->gate = priority_gate_new();
+    }
+    priority_gate_configure(wrapper->gate, (size_t)capacity, share, (uint64_t)(target_ms * 1e6));
+    
+    return self;
+}
+
+// Ruby method: session.priority_stats -> Hash or nil when not configured
+static VALUE session_priority_stats(VALUE self) {
+    session_wrapper_t* wrapper;
+    TypedData_Get_Struct(self, session_wrapper_t, &session_type, wrapper);
+    
+    return wrapper->gate ? priority_gate_to_ruby(wrapper->gate) : Qnil;
+}
+
+void init_priority() {
+    id_priority = rb_intern("cassandra_cpp_priority");
+    id_batch = rb_intern("batch");
+    
+    rb_define_method(rb_cSession, "configure_priorities", (VALUE(*)(...))session_configure_priorities, 3);
+    rb_define_method(rb_cSession, "priority_stats", (VALUE(*)(...))session_priority_stats, 0);
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "cassandra_cpp.h"
+
+// USDT probe semaphores and query ids. Probes, all under provider
+// cassandra_cpp (latencies in ns, rc is the driver's CassError):
+//
+//   prepare(query_id, query, latency_ns, rc)
+//   bind(query_id, index, rc)
+//   request__submit(query_id, future, queue_ns)
+//   request__complete(query_id, future, latency_ns, rc)
+//   decode__start(query_id, rows)
+//   decode__end(query_id, rows, decode_ns)
+//   batch__execute(statements, latency_ns, rc)
+//
+// future identifies one request between submit and complete. query_id is a
+// hash of the query text, stable across processes; for simple (unprepared)
+// queries it is only computed while the request probes are traced, and is
+// 0 otherwise.
+
+#ifdef HAVE_SYS_SDT_H
+#define CASSANDRA_CPP_SEMAPHORE(name) \
+    __extension__ unsigned short cassandra_cpp_##name##_semaphore __attribute__((section(".probes")))
+
+extern "C" {
+CASSANDRA_CPP_SEMAPHORE(prepare);
+CASSANDRA_CPP_SEMAPHORE(bind);
+CASSANDRA_CPP_SEMAPHORE(request__submit);
+CASSANDRA_CPP_SEMAPHORE(request__complete);
+CASSANDRA_CPP_SEMAPHORE(decode__start);
+CASSANDRA_CPP_SEMAPHORE(decode__end);
+CASSANDRA_CPP_SEMAPHORE(batch__execute);
+}
+#endif
+
+// 64-bit FNV-1a of the query text
+uint64_t probe_query_id(VALUE query_str) {
+    return fnv1a_64(RSTRING_PTR(query_str), (size_t)RSTRING_LEN(query_str));
+}
+
+uint64_t probe_query_id_if_traced(VALUE query_str) {
+    if (CASSANDRA_CPP_PROBE_ENABLED(request__submit) || CASSANDRA_CPP_PROBE_ENABLED(request__complete) ||
+        CASSANDRA_CPP_PROBE_ENABLED(decode__start) || CASSANDRA_CPP_PROBE_ENABLED(decode__end)) {
+        return probe_query_id(query_str);
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,531 @@
+#include "cassandra_cpp.h"
+#include <ruby/encoding.h>
+#include <mutex>
+#include <stdio.h>
+#include <sys/time.h>
+
+// Traffic log layout (all integers little-endian, "varint" = unsigned LEB128):
+//
+//   header:   "CCTR" u8(version) u64(wall clock start, microseconds)
+//   entries:  u8(kind) followed by
+//     TRAFFIC_ENTRY_QUERY:   varint(query id) varint(length) bytes
+//     TRAFFIC_ENTRY_REQUEST: varint(query id) u8(flags) varint(offset_us) varint(latency_us)
+//                            varint(consistency + 1, 0 = session default) varint(CassError)
+//                            varint(param count) values...
+//
+// Query text is written once per distinct query and referenced by id.
+// Values are tagged (see traffic_value_tag_t) and mirror the Ruby types the
+// binder understands, so replay can bind them through the same code path.
+
+#define TRAFFIC_LOG_VERSION 1
+
+enum {
+    TRAFFIC_ENTRY_QUERY = 1,
+    TRAFFIC_ENTRY_REQUEST = 2
+};
+
+enum {
+    TRAFFIC_FLAG_PREPARED = 1
+};
+
+typedef enum {
+    TRAFFIC_VALUE_NIL = 0,
+    TRAFFIC_VALUE_TRUE = 1,
+    TRAFFIC_VALUE_FALSE = 2,
+    TRAFFIC_VALUE_INTEGER = 3,   // zigzag varint, unbounded for Bignums
+    TRAFFIC_VALUE_DOUBLE = 4,    // 8 bytes IEEE 754
+    TRAFFIC_VALUE_STRING = 5,    // varint length + UTF-8 bytes
+    TRAFFIC_VALUE_BINARY = 6,    // varint length + raw bytes
+    TRAFFIC_VALUE_TIME = 7,      // zigzag varint microseconds since epoch
+    TRAFFIC_VALUE_LIST = 8,      // varint count + values
+    TRAFFIC_VALUE_SET = 9,       // varint count + values
+    TRAFFIC_VALUE_MAP = 10,      // varint count + key/value pairs
+    TRAFFIC_VALUE_DECIMAL = 11   // varint length + decimal string
+} traffic_value_tag_t;
+
+typedef struct {
+    FILE* file;
+    uint64_t started_ns;
+    uint64_t requests;
+    uint64_t bytes;
+    std::unordered_map<std::string, uint32_t> query_ids;
+} traffic_recorder_t;
+
+static std::mutex recorder_lock;
+static traffic_recorder_t* recorder = NULL;
+static std::atomic<bool> recorder_active(false);
+
+static void append_varint(std::string* out, uint64_t value) {
+    while (value >= 0x80) {
+        out->push_back((char)((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out->push_back((char)value);
+}
+
+static void append_zigzag(std::string* out, int64_t value) {
+    append_varint(out, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+// The same zigzag varint as append_zigzag for an Integer of any size; the
+// log's varints are unbounded, so Bignums beyond 64 bits decode unchanged
+static void append_zigzag_integer(std::string* out, VALUE value) {
+    VALUE doubled = rb_funcall(value, rb_intern("<<"), 1, INT2FIX(1));
+    VALUE zigzag = RTEST(rb_funcall(value, '<', 1, INT2FIX(0))) ? rb_funcall(doubled, '~', 0) : doubled;
+    
+    // 7 value bits per byte, least significant group first, as in append_varint
+    size_t groups = rb_absint_numwords(zigzag, 7, NULL);
+    size_t start = out->size();
+    out->resize(start + groups);
+    rb_integer_pack(zigzag, &(*out)[start], groups, 1, 1, INTEGER_PACK_LITTLE_ENDIAN);
+    for (size_t i = start; i + 1 < out->size(); i++) {
+        (*out)[i] = (char)((*out)[i] | 0x80);
+    }
+}
+
+static void append_bytes(std::string* out, const char* bytes, size_t length) {
+    append_varint(out, length);
+    out->append(bytes, length);
+}
+
+static void append_uint64_le(std::string* out, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        out->push_back((char)((value >> (8 * i)) & 0xFF));
+    }
+}
+
+
+static int append_hash_pair(VALUE key, VALUE val, VALUE data) {
+    std::string* out = (std::string*)data;
+    traffic_value_append(out, key);
+    traffic_value_append(out, val);
+    return ST_CONTINUE;
+}
+
+static void append_array_items(std::string* out, VALUE array) {
+    long length = RARRAY_LEN(array);
+    append_varint(out, (uint64_t)length);
+    for (long i = 0; i < length; i++) {
+        traffic_value_append(out, rb_ary_entry(array, i));
+    }
+}
+
+// Serialize a bound Ruby value; mirrors the type dispatch in bind_ruby_value_to_statement.
+// Table snapshots store their rows in the same encoding.
+void traffic_value_append(std::string* out, VALUE value) {
+    switch (TYPE(value)) {
+        case T_NIL:
+            out->push_back((char)TRAFFIC_VALUE_NIL);
+            break;
+        case T_TRUE:
+            out->push_back((char)TRAFFIC_VALUE_TRUE);
+            break;
+        case T_FALSE:
+            out->push_back((char)TRAFFIC_VALUE_FALSE);
+            break;
+        case T_FIXNUM:
+            out->push_back((char)TRAFFIC_VALUE_INTEGER);
+            append_zigzag(out, NUM2LL(value));
+            break;
+        case T_BIGNUM:
+            out->push_back((char)TRAFFIC_VALUE_INTEGER);
+            append_zigzag_integer(out, value);
+            break;
+        case T_FLOAT: {
+            double double_val = NUM2DBL(value);
+            uint64_t bits;
+            memcpy(&bits, &double_val, sizeof(bits));
+            out->push_back((char)TRAFFIC_VALUE_DOUBLE);
+            append_uint64_le(out, bits);
+            break;
+        }
+        case T_STRING: {
+            bool is_binary = rb_enc_get_index(value) == rb_ascii8bit_encindex() ||
+                             memchr(RSTRING_PTR(value), '\0', RSTRING_LEN(value)) != NULL;
+            out->push_back((char)(is_binary ? TRAFFIC_VALUE_BINARY : TRAFFIC_VALUE_STRING));
+            append_bytes(out, RSTRING_PTR(value), RSTRING_LEN(value));
+            break;
+        }
+        case T_ARRAY:
+            out->push_back((char)TRAFFIC_VALUE_LIST);
+            append_array_items(out, value);
+            break;
+        case T_HASH:
+            out->push_back((char)TRAFFIC_VALUE_MAP);
+            append_varint(out, (uint64_t)RHASH_SIZE(value));
+            rb_hash_foreach(value, append_hash_pair, (VALUE)out);
+            break;
+        default: {
+            if (rb_obj_is_kind_of(value, rb_cTime)) {
+                // Exact microseconds; going through a Float can round one off
+                struct timespec ts = rb_time_timespec(value);
+                out->push_back((char)TRAFFIC_VALUE_TIME);
+                append_zigzag(out, (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+                break;
+            }
+            
+            // Replays as an Array, which binds to the vector parameter alike
+            if (float_vector_p(value)) {
+                out->push_back((char)TRAFFIC_VALUE_LIST);
+                append_array_items(out, rb_funcall(value, rb_intern("to_a"), 0));
+                break;
+            }
+            
+            VALUE klass_name = rb_class_name(rb_obj_class(value));
+            const char* class_name = StringValueCStr(klass_name);
+            if (strcmp(class_name, "Set") == 0) {
+                out->push_back((char)TRAFFIC_VALUE_SET);
+                append_array_items(out, rb_funcall(value, rb_intern("to_a"), 0));
+                break;
+            }
+            
+            VALUE str_val = rb_obj_as_string(value);
+            out->push_back((char)(strcmp(class_name, "BigDecimal") == 0 ? TRAFFIC_VALUE_DECIMAL : TRAFFIC_VALUE_STRING));
+            append_bytes(out, RSTRING_PTR(str_val), RSTRING_LEN(str_val));
+            break;
+        }
+    }
+}
+
+// Maximum nesting of collections read back by traffic_value_read
+#define TRAFFIC_VALUE_MAX_DEPTH 64
+
+static void traffic_value_corrupt() {
+    rb_raise(rb_eArgError, "Corrupt tagged value");
+}
+
+static uint64_t read_varint(const char** cursor, const char* end) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*cursor >= end) {
+            traffic_value_corrupt();
+        }
+        uint8_t byte = (uint8_t)*(*cursor)++;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (byte < 0x80) {
+            return value;
+        }
+    }
+    traffic_value_corrupt();
+    return 0;
+}
+
+// Inverse of append_zigzag_integer: varints wider than 63 bits are Bignums
+static VALUE read_zigzag_integer(const char** cursor, const char* end) {
+    const char* start = *cursor;
+    while (*cursor < end && (uint8_t)**cursor >= 0x80) {
+        (*cursor)++;
+    }
+    if (*cursor >= end) {
+        traffic_value_corrupt();
+    }
+    (*cursor)++;
+    
+    size_t groups = (size_t)(*cursor - start);
+    if (groups <= 9) {
+        const char* small = start;
+        uint64_t zigzag = read_varint(&small, *cursor);
+        return LL2NUM((int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1));
+    }
+    
+    VALUE zigzag = rb_integer_unpack(start, groups, 1, 1, INTEGER_PACK_LITTLE_ENDIAN);
+    VALUE value = rb_funcall(zigzag, rb_intern(">>"), 1, INT2FIX(1));
+    return RTEST(rb_funcall(zigzag, rb_intern("odd?"), 0)) ? rb_funcall(value, '~', 0) : value;
+}
+
+static VALUE read_string(const char** cursor, const char* end, bool binary) {
+    uint64_t length = read_varint(cursor, end);
+    if (length > (uint64_t)(end - *cursor)) {
+        traffic_value_corrupt();
+    }
+    VALUE str = binary ? rb_str_new(*cursor, (long)length) : rb_utf8_str_new(*cursor, (long)length);
+    *cursor += length;
+    return str;
+}
+
+static VALUE read_value(const char** cursor, const char* end, int depth);
+
+// Every item takes at least one byte, so a count beyond the bytes left is corrupt
+static VALUE read_array_items(const char** cursor, const char* end, int depth) {
+    uint64_t count = read_varint(cursor, end);
+    if (count > (uint64_t)(end - *cursor)) {
+        traffic_value_corrupt();
+    }
+    VALUE array = rb_ary_new_capa((long)count);
+    for (uint64_t i = 0; i < count; i++) {
+        rb_ary_push(array, read_value(cursor, end, depth + 1));
+    }
+    return array;
+}
+
+static VALUE read_value(const char** cursor, const char* end, int depth) {
+    if (*cursor >= end || depth > TRAFFIC_VALUE_MAX_DEPTH) {
+        traffic_value_corrupt();
+    }
+    
+    switch ((uint8_t)*(*cursor)++) {
+        case TRAFFIC_VALUE_NIL:
+            return Qnil;
+        case TRAFFIC_VALUE_TRUE:
+            return Qtrue;
+        case TRAFFIC_VALUE_FALSE:
+            return Qfalse;
+        case TRAFFIC_VALUE_INTEGER:
+            return read_zigzag_integer(cursor, end);
+        case TRAFFIC_VALUE_DOUBLE: {
+            if (end - *cursor < 8) {
+                traffic_value_corrupt();
+            }
+            uint64_t bits = 0;
+            for (int i = 0; i < 8; i++) {
+                bits |= (uint64_t)(uint8_t)(*cursor)[i] << (8 * i);
+            }
+            *cursor += 8;
+            double double_val;
+            memcpy(&double_val, &bits, sizeof(double_val));
+            return DBL2NUM(double_val);
+        }
+        case TRAFFIC_VALUE_STRING:
+            return read_string(cursor, end, false);
+        case TRAFFIC_VALUE_BINARY:
+            return read_string(cursor, end, true);
+        case TRAFFIC_VALUE_TIME: {
+            uint64_t zigzag = read_varint(cursor, end);
+            int64_t micros = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+            int64_t seconds = micros / 1000000;
+            int64_t usec = micros % 1000000;
+            if (usec < 0) {
+                seconds -= 1;
+                usec += 1000000;
+            }
+            return rb_time_new((time_t)seconds, (long)usec);
+        }
+        case TRAFFIC_VALUE_LIST:
+            return read_array_items(cursor, end, depth);
+        case TRAFFIC_VALUE_SET: {
+            VALUE items = read_array_items(cursor, end, depth);
+            return rb_funcall(rb_const_get(rb_cObject, rb_intern("Set")), rb_intern("new"), 1, items);
+        }
+        case TRAFFIC_VALUE_MAP: {
+            uint64_t count = read_varint(cursor, end);
+            if (count > (uint64_t)(end - *cursor) / 2) {
+                traffic_value_corrupt();
+            }
+            VALUE hash = rb_hash_new();
+            for (uint64_t i = 0; i < count; i++) {
+                VALUE key = read_value(cursor, end, depth + 1);
+                rb_hash_aset(hash, key, read_value(cursor, end, depth + 1));
+            }
+            return hash;
+        }
+        case TRAFFIC_VALUE_DECIMAL:
+            return rb_funcall(rb_cObject, rb_intern("BigDecimal"), 1, read_string(cursor, end, false));
+        default:
+            traffic_value_corrupt();
+            return Qnil;
+    }
+}
+
+// Decode one value written by traffic_value_append, advancing *cursor past
+// it. Bytes may come from a file, so malformed input raises ArgumentError.
+VALUE traffic_value_read(const char** cursor, const char* end) {
+    return read_value(cursor, end, 0);
+}
+
+bool traffic_recorder_active() {
+    return recorder_active.load(std::memory_order_relaxed);
+}
+
+// consistency is the level the request is sent with: statements here never
+// override it, so it is the session's cluster default
+traffic_capture_t* traffic_capture_new(VALUE query_str, bool prepared, CassConsistency consistency) {
+    if (!traffic_recorder_active() || NIL_P(query_str)) {
+        return NULL;
+    }
+    
+    traffic_capture_t* capture = new traffic_capture_t();
+    capture->query.assign(RSTRING_PTR(query_str), RSTRING_LEN(query_str));
+    capture->prepared = prepared;
+    capture->consistency = consistency;
+    return capture;
+}
+
+traffic_capture_t* traffic_capture_copy(const traffic_capture_t* capture) {
+    return capture ? new traffic_capture_t(*capture) : NULL;
+}
+
+void traffic_capture_free(traffic_capture_t* capture) {
+    delete capture;
+}
+
+void traffic_capture_bind(traffic_capture_t* capture, size_t index, VALUE value) {
+    if (index >= capture->params.size()) {
+        capture->params.resize(index + 1, std::string(1, (char)TRAFFIC_VALUE_NIL));
+    }
+    
+    std::string encoded;
+    traffic_value_append(&encoded, value);
+    capture->params[index].swap(encoded);
+}
+
+static void recorder_write(traffic_recorder_t* rec, const std::string& buffer) {
+    fwrite(buffer.data(), 1, buffer.size(), rec->file);
+    rec->bytes += buffer.size();
+}
+
+// Append one completed request to the log; a no-op once recording has stopped
+void traffic_recorder_write(const traffic_capture_t* capture, const request_timing_t* timing, CassError rc) {
+    if (!capture || !traffic_recorder_active()) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> guard(recorder_lock);
+    if (!recorder) {
+        return;
+    }
+    
+    std::string buffer;
+    uint32_t query_id;
+    std::unordered_map<std::string, uint32_t>::iterator known = recorder->query_ids.find(capture->query);
+    if (known == recorder->query_ids.end()) {
+        query_id = (uint32_t)recorder->query_ids.size();
+        recorder->query_ids[capture->query] = query_id;
+        
+        buffer.push_back((char)TRAFFIC_ENTRY_QUERY);
+        append_varint(&buffer, query_id);
+        append_bytes(&buffer, capture->query.data(), capture->query.size());
+    } else {
+        query_id = known->second;
+    }
+    
+    uint64_t offset_ns = timing->submitted_ns > recorder->started_ns ? timing->submitted_ns - recorder->started_ns : 0;
+    uint64_t latency_ns = timing->ready_ns > timing->submitted_ns ? timing->ready_ns - timing->submitted_ns : 0;
+    
+    buffer.push_back((char)TRAFFIC_ENTRY_REQUEST);
+    append_varint(&buffer, query_id);
+    buffer.push_back((char)(capture->prepared ? TRAFFIC_FLAG_PREPARED : 0));
+    append_varint(&buffer, offset_ns / 1000);
+    append_varint(&buffer, latency_ns / 1000);
+    append_varint(&buffer, capture->consistency == CASS_CONSISTENCY_UNKNOWN ? 0 : (uint64_t)capture->consistency + 1);
+    append_varint(&buffer, (uint64_t)rc);
+    append_varint(&buffer, capture->params.size());
+    for (size_t i = 0; i < capture->params.size(); i++) {
+        buffer.append(capture->params[i]);
+    }
+    
+    recorder_write(recorder, buffer);
+    recorder->requests++;
+}
+
+// Counters copied out under recorder_lock, so the Hash is built (and may
+// raise NoMemoryError) after the lock is released
+typedef struct {
+    uint64_t requests;
+    uint64_t queries;
+    uint64_t bytes;
+} recorder_counts_t;
+
+static recorder_counts_t recorder_counts(const traffic_recorder_t* rec) {
+    recorder_counts_t counts = { 0, 0, 0 };
+    if (rec) {
+        counts.requests = rec->requests;
+        counts.queries = rec->query_ids.size();
+        counts.bytes = rec->bytes;
+    }
+    return counts;
+}
+
+static VALUE recorder_stats_hash(const recorder_counts_t& counts) {
+    VALUE stats = rb_hash_new();
+    rb_hash_aset(stats, ID2SYM(rb_intern("requests")), ULL2NUM(counts.requests));
+    rb_hash_aset(stats, ID2SYM(rb_intern("queries")), ULL2NUM(counts.queries));
+    rb_hash_aset(stats, ID2SYM(rb_intern("bytes")), ULL2NUM(counts.bytes));
+    return stats;
+}
+
+// Ruby method: CassandraCpp::NativeRecorder.start(path)
+static VALUE native_recorder_start(VALUE self, VALUE path) {
+    const char* path_str = StringValueCStr(path);
+    
+    FILE* file = fopen(path_str, "wb");
+    if (!file) {
+        rb_sys_fail(path_str);
+    }
+    
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    
+    std::string header("CCTR");
+    header.push_back((char)TRAFFIC_LOG_VERSION);
+    append_uint64_le(&header, (uint64_t)now.tv_sec * 1000000ULL + (uint64_t)now.tv_usec);
+    
+    bool already_recording = false;
+    {
+        // No Ruby exceptions while the lock is held
+        std::lock_guard<std::mutex> guard(recorder_lock);
+        if (recorder) {
+            already_recording = true;
+        } else {
+            recorder = new traffic_recorder_t();
+            recorder->file = file;
+            recorder->started_ns = monotonic_now_ns();
+            recorder->requests = 0;
+            recorder->bytes = 0;
+            recorder_write(recorder, header);
+            recorder_active.store(true, std::memory_order_relaxed);
+        }
+    }
+    
+    if (already_recording) {
+        fclose(file);
+        rb_raise(rb_eCassandraError, "Traffic recording already in progress");
+    }
+    
+    return Qtrue;
+}
+
+// Ruby method: CassandraCpp::NativeRecorder.stop -> stats hash of the finished log
+static VALUE native_recorder_stop(VALUE self) {
+    traffic_recorder_t* stopped;
+    {
+        std::lock_guard<std::mutex> guard(recorder_lock);
+        recorder_active.store(false, std::memory_order_relaxed);
+        stopped = recorder;
+        recorder = NULL;
+    }
+    
+    if (!stopped) {
+        return Qnil;
+    }
+    
+    // No writer can reach the recorder any more
+    recorder_counts_t counts = recorder_counts(stopped);
+    fclose(stopped->file);
+    delete stopped;
+    
+    return recorder_stats_hash(counts);
+}
+
+// Ruby method: CassandraCpp::NativeRecorder.recording?
+static VALUE native_recorder_recording_p(VALUE self) {
+    return traffic_recorder_active() ? Qtrue : Qfalse;
+}
+
+// Ruby method: CassandraCpp::NativeRecorder.stats
+static VALUE native_recorder_stats(VALUE self) {
+    recorder_counts_t counts;
+    {
+        std::lock_guard<std::mutex> guard(recorder_lock);
+        counts = recorder_counts(recorder);
+    }
+    
+    return recorder_stats_hash(counts);
+}
+
+void init_recorder() {
+    VALUE rb_mNativeRecorder = rb_define_module_under(rb_cCassandraCpp, "NativeRecorder");
+    rb_define_module_function(rb_mNativeRecorder, "start", (VALUE(*)(...))native_recorder_start, 1);
+    rb_define_module_function(rb_mNativeRecorder, "stop", (VALUE(*)(...))native_recorder_stop, 0);
+    rb_define_module_function(rb_mNativeRecorder, "recording?", (VALUE(*)(...))native_recorder_recording_p, 0);
+    rb_define_module_function(rb_mNativeRecorder, "stats", (VALUE(*)(...))native_recorder_stats, 0);
+}
\ No newline at end of file
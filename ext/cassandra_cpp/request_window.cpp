@@ -0,0 +1,97 @@
+#include "cassandra_cpp.h"
+
+// Requests allowed in flight from Ruby; at least one
+size_t window_capacity_from_ruby(VALUE concurrency) {
+    long capacity = NUM2LONG(concurrency);
+    
+    if (capacity < 1) {
+        rb_raise(rb_eArgError, "concurrency must be at least 1");
+    }
+    
+    return (size_t)capacity;
+}
+
+request_window_t* request_window_new(CassSession* session, size_t capacity, phase_stats_t* stats, const char* operation) {
+    request_window_t* window = new request_window_t();
+    window->session = session;
+    window->capacity = capacity;
+    window->stats = stats;
+    window->breaker = NULL;
+    window->gate = NULL;
+    window->priority = PRIORITY_INTERACTIVE;
+    window->operation = operation;
+    window->failed = NULL;
+    window->query_id = 0;
+    
+    return window;
+}
+
+// Drop outstanding futures without waiting; the driver finishes (or fails)
+// those requests on its own. Safe to call from an ensure handler.
+void request_window_free(request_window_t* window) {
+    for (size_t i = 0; i < window->in_flight.size(); i++) {
+        cass_future_free(window->in_flight[i].future);
+    }
+    if (window->failed) {
+        cass_future_free(window->failed);
+    }
+    
+    delete window;
+}
+
+bool request_window_full(const request_window_t* window) {
+    return window->in_flight.size() >= window->capacity;
+}
+
+bool request_window_empty(const request_window_t* window) {
+    return window->in_flight.empty();
+}
+
+// Hand a statement to the driver without waiting; takes ownership of the
+// statement, which the driver has copied by the time execute returns.
+// Raises CircuitOpenError instead while the window's breaker is open.
+// Waits for a slot when the window has a priority gate; slots are given back
+// from the driver callback, so the window's own requests never block it.
+void request_window_submit(request_window_t* window, CassStatement* statement, uint64_t started_ns) {
+    request_admit(window->breaker, window->gate, window->priority, statement);
+    
+    adaptive_timeout_apply(statement, window->stats);
+    
+    window_request_t request;
+    request.started_ns = started_ns;
+    request.future = cass_session_execute(window->session, statement);
+    request.submitted_ns = monotonic_now_ns();
+    cass_statement_free(statement);
+    CASSANDRA_CPP_PROBE3(request__submit, window->query_id, request.future, request.submitted_ns - started_ns);
+    inflight_request_t inflight = { request.future, window->breaker, window->gate, window->priority, request.submitted_ns };
+    request_release_on_completion(&inflight);
+    
+    window->in_flight.push_back(request);
+}
+
+// Wait for the oldest request and return its result (owned by the caller).
+// Raises on a failed request or an interrupt; the remaining futures are
+// released by request_window_free. Breaker outcomes and priority slots are
+// settled from the driver callback, so abandoned requests still report.
+const CassResult* request_window_next(request_window_t* window) {
+    window_request_t request = window->in_flight.front();
+    request_timing_t timing = { request.started_ns, request.submitted_ns, 0, 0, 0, window->query_id };
+    wait_for_future(request.future, 0, &timing);
+    window->in_flight.pop_front();
+    
+    CassError rc = cass_future_error_code(request.future);
+    CASSANDRA_CPP_PROBE4(request__complete, timing.query_id, request.future, timing.ready_ns - timing.submitted_ns, (int)rc);
+    if (rc != CASS_OK) {
+        window->failed = request.future;
+        raise_cassandra_error(request.future, window->operation);
+    }
+    
+    // Later requests resolve while earlier ones are consumed, so the
+    // network phase includes time spent queued behind the window head
+    record_request_timing(window->stats, &timing);
+    
+    const CassResult* result = cass_future_get_result(request.future);
+    cass_future_free(request.future);
+    
+    return result;
+}
\ No newline at end of file
@@ -0,0 +1,345 @@
+#include "cassandra_cpp.h"
+#include <algorithm>
+
+// Memory management functions
+static void result_mark(void* ptr) {
+    result_wrapper_t* wrapper = (result_wrapper_t*)ptr;
+    if (wrapper) {
+        rb_gc_mark(wrapper->column_keys);
+        rb_gc_mark(wrapper->rows);
+        rb_gc_mark(wrapper->info.session_ref);
+    }
+}
+
+static void result_free(void* ptr) {
+    result_wrapper_t* wrapper = (result_wrapper_t*)ptr;
+    if (wrapper) {
+        if (wrapper->result) {
+            cass_result_free(wrapper->result);
+        }
+        delete wrapper->row_pointers;
+        xfree(wrapper);
+    }
+}
+
+const rb_data_type_t result_type = {
+    "CassandraCpp::NativeResult",
+    { result_mark, result_free, 0 },
+    0, 0,
+    RUBY_TYPED_FREE_IMMEDIATELY
+};
+
+// Wrap a driver result without converting any rows; takes ownership of result
+VALUE create_result_object(const CassResult* result, const execution_info_t* info) {
+    result_wrapper_t* wrapper = ALLOC(result_wrapper_t);
+    wrapper->result = result;
+    wrapper->row_pointers = NULL;
+    wrapper->column_keys = Qnil;
+    wrapper->rows = Qnil;
+    wrapper->info = *info;
+    
+    return TypedData_Wrap_Struct(rb_cResult, &result_type, wrapper);
+}
+
+// Frozen column name strings, built once and shared by every row hash
+static VALUE result_column_keys(result_wrapper_t* wrapper) {
+    if (NIL_P(wrapper->column_keys)) {
+        size_t column_count = cass_result_column_count(wrapper->result);
+        VALUE keys = rb_ary_new_capa((long)column_count);
+        
+        for (size_t i = 0; i < column_count; i++) {
+            const char* column_name;
+            size_t column_name_length;
+            cass_result_column_name(wrapper->result, i, &column_name, &column_name_length);
+            rb_ary_push(keys, rb_obj_freeze(rb_str_new(column_name, column_name_length)));
+        }
+        
+        wrapper->column_keys = rb_obj_freeze(keys);
+    }
+    
+    return wrapper->column_keys;
+}
+
+// Row pointers stay valid for the lifetime of the result, so collect them
+// once for random access by index
+static const std::vector<const CassRow*>& result_row_pointers(result_wrapper_t* wrapper) {
+    if (!wrapper->row_pointers) {
+        std::vector<const CassRow*>* rows = new std::vector<const CassRow*>();
+        rows->reserve(cass_result_row_count(wrapper->result));
+        
+        CassIterator* iterator = cass_iterator_from_result(wrapper->result);
+        while (cass_iterator_next(iterator)) {
+            rows->push_back(cass_iterator_get_row(iterator));
+        }
+        cass_iterator_free(iterator);
+        
+        wrapper->row_pointers = rows;
+    }
+    
+    return *wrapper->row_pointers;
+}
+
+// Ruby hash for one row, reusing the fully materialized row when it exists
+static VALUE result_row_to_ruby(result_wrapper_t* wrapper, size_t index) {
+    if (!NIL_P(wrapper->rows)) {
+        return RARRAY_AREF(wrapper->rows, (long)index);
+    }
+    
+    const CassRow* row = result_row_pointers(wrapper)[index];
+    VALUE keys = result_column_keys(wrapper);
+    VALUE row_hash = rb_hash_new();
+    
+    for (long i = 0; i < RARRAY_LEN(keys); i++) {
+        VALUE value = convert_cass_value_to_ruby(cass_row_get_column(row, (size_t)i));
+        rb_hash_aset(row_hash, RARRAY_AREF(keys, i), value);
+    }
+    
+    return row_hash;
+}
+
+static size_t result_column_index(result_wrapper_t* wrapper, VALUE column) {
+    VALUE column_str = rb_obj_as_string(column);
+    size_t column_count = cass_result_column_count(wrapper->result);
+    
+    for (size_t i = 0; i < column_count; i++) {
+        const char* column_name;
+        size_t column_name_length;
+        cass_result_column_name(wrapper->result, i, &column_name, &column_name_length);
+        
+        if ((size_t)RSTRING_LEN(column_str) == column_name_length &&
+            memcmp(RSTRING_PTR(column_str), column_name, column_name_length) == 0) {
+            return i;
+        }
+    }
+    
+    rb_raise(rb_eArgError, "Unknown column: %s", StringValueCStr(column_str));
+    return 0;
+}
+
+// Raw serialized bytes of a column value; false for nulls, which never match
+static bool result_key_bytes(const CassRow* row, size_t column, std::string* key) {
+    const CassValue* value = cass_row_get_column(row, column);
+    const cass_byte_t* bytes;
+    size_t size;
+    
+    if (value == NULL || cass_value_is_null(value) ||
+        cass_value_get_bytes(value, &bytes, &size) != CASS_OK) {
+        return false;
+    }
+    
+    key->assign((const char*)bytes, size);
+    return true;
+}
+
+// Ruby method: result.size
+static VALUE result_size(VALUE self) {
+    result_wrapper_t* wrapper;
+    TypedData_Get_Struct(self, result_wrapper_t, &result_type, wrapper);
+    
+    return SIZET2NUM(cass_result_row_count(wrapper->result));
+}
+
+// Ruby method: result.columns
+static VALUE result_columns(VALUE self) {
+    result_wrapper_t* wrapper;
+    TypedData_Get_Struct(self, result_wrapper_t, &result_type, wrapper);
+    
+    return rb_ary_dup(result_column_keys(wrapper));
+}
+
+// Ruby method: result.rows - converts every row once and memoizes the array
+static VALUE result_rows(VALUE self) {
+    result_wrapper_t* wrapper;
+    TypedData_Get_Struct(self, result_wrapper_t, &result_type, wrapper);
+    
+    if (NIL_P(wrapper->rows)) {
+        size_t row_count = result_row_pointers(wrapper).size();
+        VALUE rows = rb_ary_new_capa((long)row_count);
+        
+        for (size_t i = 0; i < row_count; i++) {
+            rb_ary_push(rows, result_row_to_ruby(wrapper, i));
+        }
+        
+        wrapper->rows = rows;
+    }
+    
+    return wrapper->rows;
+}
+
+// Ruby method: result.execution_info, built from the copy kept inline
+static VALUE result_execution_info(VALUE self) {
+    result_wrapper_t* wrapper;
+    TypedData_Get_Struct(self, result_wrapper_t, &result_type, wrapper);
+    
+    return execution_info_new(&wrapper->info);
+}
+
+// Working state of index_by and join. Converting rows and filling hashes
+// can raise, so the containers live on the heap and are freed under
+// rb_ensure rather than as stack locals a longjmp would skip.
+typedef struct {
+    result_wrapper_t* wrapper;
+    size_t column;
+    std::string key;
+    std::unordered_map<std::string, size_t> latest;
+    std::vector<size_t> order;
+} result_index_state_t;
+
+typedef struct {
+    result_wrapper_t* left;
+    result_wrapper_t* right;
+    size_t left_column;
+    size_t right_column;
+    std::string key;
+    std::unordered_multimap<std::string, size_t> table;
+    std::vector<size_t> right_matches;
+} result_join_state_t;
+
+static VALUE result_index_run(VALUE arg) {
+    result_index_state_t* state = (result_index_state_t*)arg;
+    const std::vector<const CassRow*>& rows = result_row_pointers(state->wrapper);
+    state->latest.reserve(rows.size());
+    
+    // Null keys never compare equal to a value; they are skipped
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (!result_key_bytes(rows[i], state->column, &state->key)) {
+            continue;
+        }
+        
+        std::unordered_map<std::string, size_t>::iterator it = state->latest.find(state->key);
+        if (it == state->latest.end()) {
+            state->latest.insert(std::make_pair(state->key, i));
+            state->order.push_back(i);
+        } else {
+            it->second = i;
+        }
+    }
+    
+    VALUE index = rb_hash_new();
+    for (size_t i = 0; i < state->order.size(); i++) {
+        result_key_bytes(rows[state->order[i]], state->column, &state->key);
+        size_t row_index = state->latest[state->key];
+        VALUE key_value = convert_cass_value_to_ruby(cass_row_get_column(rows[row_index], state->column));
+        rb_hash_aset(index, key_value, result_row_to_ruby(state->wrapper, row_index));
+    }
+    
+    return index;
+}
+
+static VALUE result_index_cleanup(VALUE arg) {
+    delete (result_index_state_t*)arg;
+    return Qnil;
+}
+
+// Ruby method: result.index_by(column)
+// Rows are deduplicated on the raw key bytes first (last row wins, as
+// with ActiveSupport's index_by), so only surviving rows are converted to Ruby.
+// Rows whose key column is null are left out of the index.
+static VALUE result_index_by(VALUE self, VALUE column) {
+    result_wrapper_t* wrapper;
+    TypedData_Get_Struct(self, result_wrapper_t, &result_type, wrapper);
+    
+    size_t column_index = result_column_index(wrapper, column);
+    
+    result_index_state_t* state = new result_index_state_t();
+    state->wrapper = wrapper;
+    state->column = column_index;
+    return rb_ensure(result_index_run, (VALUE)state, result_index_cleanup, (VALUE)state);
+}
+
+static VALUE result_join_run(VALUE arg) {
+    result_join_state_t* state = (result_join_state_t*)arg;
+    const std::vector<const CassRow*>& left_rows = result_row_pointers(state->left);
+    const std::vector<const CassRow*>& right_rows = result_row_pointers(state->right);
+    state->table.reserve(right_rows.size());
+    
+    for (size_t i = 0; i < right_rows.size(); i++) {
+        if (result_key_bytes(right_rows[i], state->right_column, &state->key)) {
+            state->table.insert(std::make_pair(state->key, i));
+        }
+    }
+    
+    VALUE joined = rb_ary_new();
+    VALUE right_keys = result_column_keys(state->right);
+    
+    for (size_t i = 0; i < left_rows.size(); i++) {
+        if (!result_key_bytes(left_rows[i], state->left_column, &state->key)) {
+            continue;
+        }
+        
+        std::pair<std::unordered_multimap<std::string, size_t>::iterator,
+                  std::unordered_multimap<std::string, size_t>::iterator> matches = state->table.equal_range(state->key);
+        if (matches.first == matches.second) {
+            continue;
+        }
+        
+        // Equal keys come back in unspecified order; keep the right side's row order
+        state->right_matches.clear();
+        for (std::unordered_multimap<std::string, size_t>::iterator it = matches.first; it != matches.second; ++it) {
+            state->right_matches.push_back(it->second);
+        }
+        std::sort(state->right_matches.begin(), state->right_matches.end());
+        
+        VALUE left_row = result_row_to_ruby(state->left, i);
+        for (size_t m = 0; m < state->right_matches.size(); m++) {
+            const CassRow* right_row = right_rows[state->right_matches[m]];
+            VALUE row_hash = rb_hash_dup(left_row);
+            
+            for (long c = 0; c < RARRAY_LEN(right_keys); c++) {
+                VALUE column_key = RARRAY_AREF(right_keys, c);
+                if (rb_hash_lookup2(row_hash, column_key, Qundef) == Qundef) {
+                    rb_hash_aset(row_hash, column_key,
+                                 convert_cass_value_to_ruby(cass_row_get_column(right_row, (size_t)c)));
+                }
+            }
+            
+            rb_ary_push(joined, row_hash);
+        }
+    }
+    
+    return joined;
+}
+
+static VALUE result_join_cleanup(VALUE arg) {
+    delete (result_join_state_t*)arg;
+    return Qnil;
+}
+
+// Ruby method: NativeResult.join(left, right, left_column, right_column)
+// Inner hash join: the right side is hashed on its raw key bytes, the left
+// side probes it in order, and only matching pairs become Ruby hashes. Left
+// values win when both sides have a column of the same name. Rows with a
+// null key match nothing, as in SQL.
+static VALUE result_join(VALUE klass, VALUE left, VALUE right, VALUE left_column, VALUE right_column) {
+    result_wrapper_t* left_wrapper;
+    result_wrapper_t* right_wrapper;
+    TypedData_Get_Struct(left, result_wrapper_t, &result_type, left_wrapper);
+    TypedData_Get_Struct(right, result_wrapper_t, &result_type, right_wrapper);
+    
+    size_t left_index = result_column_index(left_wrapper, left_column);
+    size_t right_index = result_column_index(right_wrapper, right_column);
+    
+    // Raw bytes only compare equal within the same CQL type
+    if (cass_result_column_type(left_wrapper->result, left_index) !=
+        cass_result_column_type(right_wrapper->result, right_index)) {
+        rb_raise(rb_eArgError, "Join columns must have the same type");
+    }
+    
+    result_join_state_t* state = new result_join_state_t();
+    state->left = left_wrapper;
+    state->right = right_wrapper;
+    state->left_column = left_index;
+    state->right_column = right_index;
+    return rb_ensure(result_join_run, (VALUE)state, result_join_cleanup, (VALUE)state);
+}
+
+void init_result() {
+    rb_cResult = rb_define_class_under(rb_cCassandraCpp, "NativeResult", rb_cObject);
+    rb_undef_alloc_func(rb_cResult);
+    rb_define_method(rb_cResult, "size", (VALUE(*)(...))result_size, 0);
+    rb_define_method(rb_cResult, "columns", (VALUE(*)(...))result_columns, 0);
+    rb_define_method(rb_cResult, "rows", (VALUE(*)(...))result_rows, 0);
+    rb_define_method(rb_cResult, "index_by", (VALUE(*)(...))result_index_by, 1);
+    rb_define_method(rb_cResult, "execution_info", (VALUE(*)(...))result_execution_info, 0);
+    rb_define_singleton_method(rb_cResult, "join", (VALUE(*)(...))result_join, 4);
+}
\ No newline at end of file
@@ -0,0 +1,255 @@
+#include "cassandra_cpp.h"
+
+// State of one paged execution, shared between the body and the ensure
+// handler so driver objects are released even if a visitor raises or breaks
+typedef struct {
+    const paged_request_t* request;
+    result_page_visitor_t visitor;
+    void* context;
+    traffic_capture_t* capture;
+    CassFuture* future;
+    const CassResult* result;
+    CassIterator* iterator;
+} paged_execution_t;
+
+// Fetch the next page; the statement carries the paging state between calls
+static void paged_execution_fetch(paged_execution_t* execution, uint64_t started_ns) {
+    const paged_request_t* request = execution->request;
+    request_timing_t timing = { started_ns, 0, 0, 0, 0, request->query_id };
+    
+    // The statement belongs to the request and is freed by its cleanup
+    request_admit(request->breaker, request->gate, request->priority, NULL);
+    CassFuture* future = cass_session_execute(request->session, request->statement);
+    timing.submitted_ns = monotonic_now_ns();
+    CASSANDRA_CPP_PROBE3(request__submit, timing.query_id, future, timing.submitted_ns - timing.started_ns);
+    
+    // Owned by the request until the wait returns, then by the cleanup handler
+    inflight_request_t inflight = { future, request->breaker, request->gate, request->priority, timing.submitted_ns };
+    wait_for_request(&inflight, 0, &timing);
+    execution->future = future;
+    CassError rc = cass_future_error_code(execution->future);
+    CASSANDRA_CPP_PROBE4(request__complete, timing.query_id, execution->future,
+                         timing.ready_ns - timing.submitted_ns, (int)rc);
+    circuit_breaker_record(request->breaker, rc, timing.ready_ns - timing.submitted_ns);
+    priority_gate_exit(request->gate, request->priority, timing.ready_ns - timing.submitted_ns);
+    
+    // Later pages carry driver paging state and cannot be replayed on their own
+    if (execution->capture) {
+        traffic_recorder_write(execution->capture, &timing, rc);
+        traffic_capture_free(execution->capture);
+        execution->capture = NULL;
+    }
+    if (rc != CASS_OK) {
+        raise_cassandra_error(execution->future, request->operation);
+    }
+    
+    // Decode time overlaps with the visitor's work, so only the request
+    // phases are recorded for paged execution
+    record_request_timing(request->stats, &timing);
+    
+    execution->result = cass_future_get_result(execution->future);
+    cass_future_free(execution->future);
+    execution->future = NULL;
+}
+
+static VALUE paged_execution_run(VALUE arg) {
+    paged_execution_t* execution = (paged_execution_t*)arg;
+    const paged_request_t* request = execution->request;
+    
+    if (request->page_size > 0) {
+        cass_statement_set_paging_size(request->statement, request->page_size);
+    }
+    
+    uint64_t started_ns = request->started_ns;
+    
+    for (;;) {
+        paged_execution_fetch(execution, started_ns);
+        if (!execution->result) {
+            break;
+        }
+        
+        execution->iterator = cass_iterator_from_result(execution->result);
+        execution->visitor(execution->result, execution->iterator, execution->context);
+        cass_iterator_free(execution->iterator);
+        execution->iterator = NULL;
+        
+        bool has_more = cass_result_has_more_pages(execution->result);
+        if (has_more) {
+            cass_statement_set_paging_state(request->statement, execution->result);
+        }
+        cass_result_free(execution->result);
+        execution->result = NULL;
+        
+        if (!has_more) {
+            break;
+        }
+        started_ns = monotonic_now_ns();
+    }
+    
+    return Qnil;
+}
+
+static VALUE paged_execution_cleanup(VALUE arg) {
+    paged_execution_t* execution = (paged_execution_t*)arg;
+    
+    if (execution->iterator) {
+        cass_iterator_free(execution->iterator);
+    }
+    if (execution->result) {
+        cass_result_free(execution->result);
+    }
+    if (execution->future) {
+        cass_future_free(execution->future);
+    }
+    if (execution->capture) {
+        traffic_capture_free(execution->capture);
+    }
+    if (execution->request->owns_statement) {
+        cass_statement_free(execution->request->statement);
+    }
+    
+    return Qnil;
+}
+
+// Execute a statement page by page, handing each page's row iterator to the
+// visitor before fetching the next one. Takes ownership of the request's
+// capture; the statement is freed afterwards only when owns_statement is set.
+void for_each_result_page(const paged_request_t* request, result_page_visitor_t visitor, void* context) {
+    paged_execution_t execution = { request, visitor, context, request->capture, NULL, NULL, NULL };
+    
+    rb_ensure(paged_execution_run, (VALUE)&execution, paged_execution_cleanup, (VALUE)&execution);
+}
+
+// Rows yielded by each_row
+typedef struct {
+    const row_stream_options_t* options;
+    VALUE keys;
+    VALUE row;
+    size_t row_count;
+} row_stream_t;
+
+// Column names become frozen strings once per stream, so every row (reused
+// or not) shares the same key objects
+static VALUE row_stream_column_keys(const CassResult* result) {
+    size_t column_count = cass_result_column_count(result);
+    VALUE keys = rb_ary_new_capa((long)column_count);
+    
+    for (size_t i = 0; i < column_count; i++) {
+        const char* column_name;
+        size_t column_name_length;
+        cass_result_column_name(result, i, &column_name, &column_name_length);
+        rb_ary_push(keys, rb_obj_freeze(rb_str_new(column_name, column_name_length)));
+    }
+    
+    return keys;
+}
+
+static void row_stream_visit_page(const CassResult* result, CassIterator* rows, void* context) {
+    row_stream_t* stream = (row_stream_t*)context;
+    const row_stream_options_t* options = stream->options;
+    
+    size_t column_count = cass_result_column_count(result);
+    if (NIL_P(stream->keys)) {
+        stream->keys = row_stream_column_keys(result);
+    }
+    
+    while (cass_iterator_next(rows)) {
+        const CassRow* cass_row = cass_iterator_get_row(rows);
+        
+        if (!options->reuse || NIL_P(stream->row)) {
+            stream->row = options->as_array ? rb_ary_new_capa((long)column_count) : rb_hash_new();
+        }
+        
+        // Immediates (integers, floats, booleans, nil) allocate nothing, so
+        // fixed-width rows are refilled without creating garbage
+        for (size_t i = 0; i < column_count; i++) {
+            VALUE value = convert_cass_value_to_ruby(cass_row_get_column(cass_row, i));
+            if (options->as_array) {
+                rb_ary_store(stream->row, (long)i, value);
+            } else {
+                rb_hash_aset(stream->row, RARRAY_AREF(stream->keys, (long)i), value);
+            }
+        }
+        
+        stream->row_count++;
+        rb_yield(stream->row);
+    }
+}
+
+// Execute a request page by page, yielding each row to the current block as
+// it is decoded instead of materializing the whole result
+VALUE stream_statement_rows(const paged_request_t* request, const row_stream_options_t* options) {
+    row_stream_t stream = { options, Qnil, Qnil, 0 };
+    
+    for_each_result_page(request, row_stream_visit_page, &stream);
+    
+    RB_GC_GUARD(stream.keys);
+    RB_GC_GUARD(stream.row);
+    return SIZET2NUM(stream.row_count);
+}
+
+// Pages yielded by each_page
+typedef struct {
+    bool as_array;
+    VALUE keys;
+    size_t row_count;
+} page_stream_t;
+
+static void page_stream_visit_page(const CassResult* result, CassIterator* rows, void* context) {
+    page_stream_t* stream = (page_stream_t*)context;
+    
+    size_t column_count = cass_result_column_count(result);
+    if (NIL_P(stream->keys)) {
+        stream->keys = row_stream_column_keys(result);
+    }
+    
+    VALUE page = rb_ary_new_capa((long)cass_result_row_count(result));
+    while (cass_iterator_next(rows)) {
+        const CassRow* cass_row = cass_iterator_get_row(rows);
+        VALUE row = stream->as_array ? rb_ary_new_capa((long)column_count) : rb_hash_new();
+        
+        for (size_t i = 0; i < column_count; i++) {
+            VALUE value = convert_cass_value_to_ruby(cass_row_get_column(cass_row, i));
+            if (stream->as_array) {
+                rb_ary_store(row, (long)i, value);
+            } else {
+                rb_hash_aset(row, RARRAY_AREF(stream->keys, (long)i), value);
+            }
+        }
+        rb_ary_push(page, row);
+    }
+    stream->row_count += (size_t)RARRAY_LEN(page);
+    
+    // Resuming from this token continues after the page just yielded
+    VALUE paging_state = Qnil;
+    const char* token;
+    size_t token_size;
+    if (cass_result_has_more_pages(result) &&
+        cass_result_paging_state_token(result, &token, &token_size) == CASS_OK) {
+        paging_state = rb_str_new(token, (long)token_size);
+    }
+    
+    rb_yield_values(2, page, paging_state);
+}
+
+// Execute a request page by page, yielding each page's rows together with
+// the driver paging state that resumes after it (nil on the last page)
+VALUE stream_statement_pages(const paged_request_t* request, bool as_array) {
+    page_stream_t stream = { as_array, Qnil, 0 };
+    
+    for_each_result_page(request, page_stream_visit_page, &stream);
+    
+    RB_GC_GUARD(stream.keys);
+    return SIZET2NUM(stream.row_count);
+}
+
+// Rows per page from Ruby, nil keeps the driver default (0)
+int page_size_from_ruby(VALUE page_size) {
+    int size = NIL_P(page_size) ? 0 : NUM2INT(page_size);
+    
+    if (size < 0) {
+        rb_raise(rb_eArgError, "page_size must not be negative");
+    }
+    
+    return size;
+}
\ No newline at end of file
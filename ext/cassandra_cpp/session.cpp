@@ -4,7 +4,10 @@
 static void session_free(void* ptr) {
     session_wrapper_t* wrapper = (session_wrapper_t*)ptr;
     if (wrapper) {
-        // Session is owned by cluster, don't free here
+        // Session is owned by cluster, don't free here; a shared one is
+        // closed with its last reference, off the GC on the closer thread
+        shared_connection_release(wrapper->shared, true);
+        priority_gate_free(wrapper->gate);
         xfree(wrapper);
     }
 }
@@ -13,76 +16,301 @@ const rb_data_type_t session_type = {
     "CassandraCpp::NativeSession",
     { 0, session_free, 0 },
     0, 0,
-    RUBY_TYPED_FREE_IMMEDIATELY
+    0
 };
 
-// Convert CassResult to Ruby array
-static VALUE convert_result_to_ruby(const CassResult* result) {
-    VALUE rows = rb_ary_new();
-    CassIterator* iterator = cass_iterator_from_result(result);
+// Session methods
+
+static VALUE session_option(VALUE options, const char* name) {
+    return NIL_P(options) ? Qnil : rb_hash_aref(options, ID2SYM(rb_intern(name)));
+}
+
+// Encode the params forming a routing key at their partition key column
+// types (key_types, CQL type names in key order), as Cassandra stores them.
+// A simple statement has no parameter metadata, so bound as inferred from
+// the Ruby value a small Integer would go out as an int and hash to another
+// token than the bigint the server reads. Keys of text and uuid columns are
+// converted with to_s. Returns one binary String per key index; raises
+// before any driver resource exists.
+VALUE routing_key_encode(VALUE params, VALUE key_indexes, VALUE key_types) {
+    Check_Type(key_indexes, T_ARRAY);
+    Check_Type(key_types, T_ARRAY);
+    if (RARRAY_LEN(key_types) != RARRAY_LEN(key_indexes)) {
+        rb_raise(rb_eArgError, "%ld routing key types given for %ld routing key params",
+                 RARRAY_LEN(key_types), RARRAY_LEN(key_indexes));
+    }
     
-    while (cass_iterator_next(iterator)) {
-        const CassRow* row = cass_iterator_get_row(iterator);
-        size_t column_count = cass_result_column_count(result);
-        
-        VALUE row_hash = rb_hash_new();
+    VALUE encoded = rb_ary_new_capa(RARRAY_LEN(key_indexes));
+    std::string bytes;
+    for (long i = 0; i < RARRAY_LEN(key_indexes); i++) {
+        VALUE type_name = RARRAY_AREF(key_types, i);
+        const sstable_type_t* type = sstable_type_from_cql(type_name);
+        if (!type) {
+            rb_raise(rb_eArgError, "Unsupported routing key type: %" PRIsVALUE, type_name);
+        }
         
-        for (size_t i = 0; i < column_count; i++) {
-            const char* column_name;
-            size_t column_name_length;
-            cass_result_column_name(result, i, &column_name, &column_name_length);
-            
-            const CassValue* value = cass_row_get_column(row, i);
-            VALUE ruby_value = convert_cass_value_to_ruby(value);
-            
-            VALUE column_key = rb_str_new(column_name, column_name_length);
-            rb_hash_aset(row_hash, column_key, ruby_value);
+        VALUE value = rb_ary_entry(params, NUM2LONG(RARRAY_AREF(key_indexes, i)));
+        if (NIL_P(value)) {
+            rb_raise(rb_eArgError, "Routing key param %ld is nil", i);
+        }
+        if ((type->kind == SSTABLE_TYPE_TEXT || type->kind == SSTABLE_TYPE_ASCII || type->kind == SSTABLE_TYPE_UUID ||
+             type->kind == SSTABLE_TYPE_TIMEUUID) && !RB_TYPE_P(value, T_STRING)) {
+            value = rb_obj_as_string(value);
         }
         
-        rb_ary_push(rows, row_hash);
+        bytes.clear();
+        sstable_encode_value(type, value, &bytes);
+        rb_ary_push(encoded, rb_str_new(bytes.data(), (long)bytes.size()));
     }
     
-    cass_iterator_free(iterator);
-    return rows;
+    return encoded;
 }
 
-// Session methods
-static VALUE session_execute(VALUE self, VALUE query_str) {
+// Bind routing_key_encode's values over the params at key_indexes and mark
+// them as the statement's routing key
+void routing_key_bind(CassStatement* statement, VALUE key_indexes, VALUE encoded) {
+    for (long i = 0; i < RARRAY_LEN(key_indexes); i++) {
+        size_t index = NUM2SIZET(RARRAY_AREF(key_indexes, i));
+        VALUE bytes = RARRAY_AREF(encoded, i);
+        cass_statement_bind_bytes(statement, index, (const cass_byte_t*)RSTRING_PTR(bytes), (size_t)RSTRING_LEN(bytes));
+        cass_statement_add_key_index(statement, index);
+    }
+}
+
+// Per-request options of a simple statement, checked before it is created:
+// tracing (Boolean), params (Array of values bound in order), key_indexes
+// (Array of the params forming the partition key, in key order), key_types
+// (their CQL types, see routing_key_encode) and keyspace (String).
+// key_indexes and keyspace give the driver's token-aware policy what it
+// needs to send the statement straight to a replica.
+static void session_check_options(VALUE options) {
+    if (NIL_P(options)) {
+        return;
+    }
+    Check_Type(options, T_HASH);
+    
+    VALUE params = session_option(options, "params");
+    if (!NIL_P(params)) {
+        Check_Type(params, T_ARRAY);
+    }
+    VALUE key_indexes = session_option(options, "key_indexes");
+    if (!NIL_P(key_indexes)) {
+        Check_Type(key_indexes, T_ARRAY);
+        long param_count = NIL_P(params) ? 0 : RARRAY_LEN(params);
+        for (long i = 0; i < RARRAY_LEN(key_indexes); i++) {
+            long index = NUM2LONG(RARRAY_AREF(key_indexes, i));
+            if (index < 0 || index >= param_count) {
+                rb_raise(rb_eArgError, "Routing key index %ld is not one of the %ld parameters", index, param_count);
+            }
+        }
+    }
+    VALUE keyspace = session_option(options, "keyspace");
+    if (!NIL_P(keyspace)) {
+        StringValueCStr(keyspace);
+    }
+}
+
+// Keyspace qualifying unqualified table names for circuit breakers: the
+// statement's keyspace option, else the one the session connected to
+static VALUE session_breaker_keyspace(VALUE self, VALUE options) {
+    VALUE keyspace = session_option(options, "keyspace");
+    return NIL_P(keyspace) ? rb_iv_get(self, "@keyspace") : keyspace;
+}
+
+// Create the simple statement for a query with its (checked) options applied
+static CassStatement* session_new_statement(const char* query, VALUE options) {
+    VALUE params = session_option(options, "params");
+    size_t param_count = NIL_P(params) ? 0 : (size_t)RARRAY_LEN(params);
+    VALUE key_indexes = session_option(options, "key_indexes");
+    VALUE key_bytes = NIL_P(key_indexes)
+        ? Qnil
+        : routing_key_encode(params, key_indexes, session_option(options, "key_types"));
+    std::vector<bool> routing(param_count, false);
+    for (long i = 0; !NIL_P(key_indexes) && i < RARRAY_LEN(key_indexes); i++) {
+        routing[NUM2SIZET(RARRAY_AREF(key_indexes, i))] = true;
+    }
+    CassStatement* statement = cass_statement_new(query, param_count);
+    
+    // Key params are bound at their column types instead
+    for (size_t i = 0; i < param_count; i++) {
+        if (routing[i]) {
+            continue;
+        }
+        CassError rc = bind_ruby_value_to_statement(statement, i, RARRAY_AREF(params, (long)i));
+        if (rc != CASS_OK) {
+            cass_statement_free(statement);
+            rb_raise(rb_eCassandraError, "Failed to bind parameter at index %zu: %s", i, cass_error_desc(rc));
+        }
+    }
+    if (!NIL_P(key_indexes)) {
+        routing_key_bind(statement, key_indexes, key_bytes);
+    }
+    
+    VALUE keyspace = session_option(options, "keyspace");
+    if (!NIL_P(keyspace)) {
+        cass_statement_set_keyspace(statement, StringValueCStr(keyspace));
+    }
+    
+    if (RTEST(session_option(options, "tracing"))) {
+        cass_statement_set_tracing(statement, cass_true);
+    }
+    
+    return statement;
+}
+
+// Capture of a simple statement for the traffic recorder, NULL when not recording
+static traffic_capture_t* session_capture(session_wrapper_t* wrapper, VALUE query_str, VALUE options) {
+    traffic_capture_t* capture = traffic_capture_new(query_str, false, wrapper->consistency);
+    VALUE params = session_option(options, "params");
+    for (long i = 0; capture && !NIL_P(params) && i < RARRAY_LEN(params); i++) {
+        traffic_capture_bind(capture, (size_t)i, RARRAY_AREF(params, i));
+    }
+    return capture;
+}
+
+// Run a simple query to completion and return the driver result (owned by
+// the caller). Timing is stamped up to the moment the GVL was reacquired.
+static const CassResult* session_run_query(VALUE self, VALUE query_str, VALUE options, execution_info_t* info) {
     session_wrapper_t* wrapper;
     TypedData_Get_Struct(self, session_wrapper_t, &session_type, wrapper);
+    session_check_options(options);
     
+    request_timing_t* timing = &info->timing;
+    timing->started_ns = monotonic_now_ns();
+    timing->query_id = probe_query_id_if_traced(query_str);
     const char* query = StringValueCStr(query_str);
     
-    // Create statement
-    CassStatement* statement = cass_statement_new(query, 0);
+    // Create statement; binding may raise, so before anything is admitted
+    CassStatement* statement = session_new_statement(query, options);
+    
+    // Fail fast while the table's breaker is open, then queue behind higher
+    // priority traffic once priorities are configured
+    circuit_breaker_t* breaker = circuit_breaker_for_query(query_str, session_breaker_keyspace(self, options));
+    priority_class_t priority = priority_current();
+    request_admit(breaker, wrapper->gate, priority, statement);
     
     // Execute query
     CassFuture* future = cass_session_execute(wrapper->session, statement);
+    timing->submitted_ns = monotonic_now_ns();
+    cass_statement_free(statement);
+    CASSANDRA_CPP_PROBE3(request__submit, timing->query_id, future, timing->submitted_ns - timing->started_ns);
     
-    // Wait for result
+    // Wait for result without holding the GVL
+    inflight_request_t request = { future, breaker, wrapper->gate, priority, timing->submitted_ns };
+    wait_for_request(&request, 0, timing);
     CassError rc = cass_future_error_code(future);
+    CASSANDRA_CPP_PROBE4(request__complete, timing->query_id, future, timing->ready_ns - timing->submitted_ns, (int)rc);
+    circuit_breaker_record(breaker, rc, timing->ready_ns - timing->submitted_ns);
+    priority_gate_exit(wrapper->gate, priority, timing->ready_ns - timing->submitted_ns);
+    if (traffic_recorder_active()) {
+        traffic_capture_t* capture = session_capture(wrapper, query_str, options);
+        traffic_recorder_write(capture, timing, rc);
+        traffic_capture_free(capture);
+    }
     if (rc != CASS_OK) {
-        cass_statement_free(statement);
         raise_cassandra_error(future, "query execution");
     }
     
     // Get result
     const CassResult* result = cass_future_get_result(future);
-    VALUE rows = convert_result_to_ruby(result);
+    execution_info_capture(info, future, self);
+    cass_future_free(future);
+    
+    return result;
+}
+
+// Ruby method: session.execute(query, options = nil), options being { tracing: true }
+static VALUE session_execute_body(int argc, VALUE* argv, VALUE self) {
+    VALUE query_str, options;
+    rb_scan_args(argc, argv, "11", &query_str, &options);
+    
+    execution_info_t info;
+    execution_info_init(&info);
+    const CassResult* result = session_run_query(self, query_str, options, &info);
+    
+    VALUE rows = convert_result_to_ruby(result, info.timing.query_id);
+    info.timing.decoded_ns = monotonic_now_ns();
+    record_request_timing(NULL, &info.timing);
+    execution_info_attach(rows, &info);
     
     // Cleanup
     cass_result_free(result);
-    cass_future_free(future);
-    cass_statement_free(statement);
     
     return rows;
 }
 
+static VALUE session_execute(int argc, VALUE* argv, VALUE self) {
+    return gvl_span_call(GVL_ENTRY_EXECUTE, session_execute_body, argc, argv, self);
+}
+
+// Execute and keep the driver result natively; rows are converted on demand
+static VALUE session_execute_result_body(int argc, VALUE* argv, VALUE self) {
+    VALUE query_str, options;
+    rb_scan_args(argc, argv, "11", &query_str, &options);
+    
+    execution_info_t info;
+    execution_info_init(&info);
+    const CassResult* result = session_run_query(self, query_str, options, &info);
+    record_request_timing(NULL, &info.timing);
+    
+    VALUE result_obj = create_result_object(result, &info);
+    return result_obj;
+}
+
+static VALUE session_execute_result(int argc, VALUE* argv, VALUE self) {
+    return gvl_span_call(GVL_ENTRY_EXECUTE, session_execute_result_body, argc, argv, self);
+}
+
+// Stream rows page by page, yielding each one as it is decoded
+static VALUE session_each_row(VALUE self, VALUE query_str, VALUE reuse, VALUE as_array, VALUE page_size) {
+    session_wrapper_t* wrapper;
+    TypedData_Get_Struct(self, session_wrapper_t, &session_type, wrapper);
+    
+    rb_need_block();
+    
+    row_stream_options_t options = { RTEST(reuse), RTEST(as_array) };
+    paged_request_t request = {
+        wrapper->session, NULL, true, page_size_from_ruby(page_size), NULL,
+        circuit_breaker_for_query(query_str, session_breaker_keyspace(self, Qnil)),
+        wrapper->gate, priority_current(), NULL, monotonic_now_ns(), "query execution",
+        probe_query_id_if_traced(query_str)
+    };
+    request.statement = cass_statement_new(StringValueCStr(query_str), 0);
+    request.capture = traffic_capture_new(query_str, false, wrapper->consistency);
+    
+    return stream_statement_rows(&request, &options);
+}
+
+// Fold all pages of a query into per-group aggregates natively
+static VALUE session_aggregate(VALUE self, VALUE query_str, VALUE group_columns, VALUE aggregates, VALUE page_size) {
+    session_wrapper_t* wrapper;
+    TypedData_Get_Struct(self, session_wrapper_t, &session_type, wrapper);
+    
+    aggregate_check_arguments(group_columns, aggregates);
+    
+    paged_request_t request = {
+        wrapper->session, NULL, true, page_size_from_ruby(page_size), NULL,
+        circuit_breaker_for_query(query_str, session_breaker_keyspace(self, Qnil)),
+        wrapper->gate, priority_current(), NULL, monotonic_now_ns(), "query execution",
+        probe_query_id_if_traced(query_str)
+    };
+    request.statement = cass_statement_new(StringValueCStr(query_str), 0);
+    request.capture = traffic_capture_new(query_str, false, wrapper->consistency);
+    
+    return aggregate_statement_rows(&request, group_columns, aggregates);
+}
+
 static VALUE session_close(VALUE self) {
     session_wrapper_t* wrapper;
     TypedData_Get_Struct(self, session_wrapper_t, &session_type, wrapper);
     
-    if (wrapper->session) {
+    if (wrapper->shared) {
+        // Other consumers may still use the connection
+        shared_connection_t* shared = wrapper->shared;
+        wrapper->shared = NULL;
+        wrapper->session = NULL;
+        shared_connection_release(shared, false);
+    } else if (wrapper->session) {
         CassFuture* close_future = cass_session_close(wrapper->session);
         cass_future_wait(close_future);
         cass_future_free(close_future);
@@ -97,12 +325,17 @@ static VALUE session_prepare(VALUE self, VALUE query_str) {
     TypedData_Get_Struct(self, session_wrapper_t, &session_type, session_wrapper);
     
     const char* query = StringValueCStr(query_str);
+    uint64_t query_id = probe_query_id(query_str);
     
     // Prepare the statement
+    request_timing_t timing = { 0, monotonic_now_ns(), 0, 0, 0, query_id };
     CassFuture* prepare_future = cass_session_prepare(session_wrapper->session, query);
     
     // Wait for preparation
+    inflight_request_t request = { prepare_future, NULL, NULL, PRIORITY_INTERACTIVE, timing.submitted_ns };
+    wait_for_request(&request, 0, &timing);
     CassError rc = cass_future_error_code(prepare_future);
+    CASSANDRA_CPP_PROBE4(prepare, query_id, query, timing.ready_ns - timing.submitted_ns, (int)rc);
     if (rc != CASS_OK) {
         raise_cassandra_error(prepare_future, "statement preparation");
     }
@@ -115,6 +348,11 @@ static VALUE session_prepare(VALUE self, VALUE query_str) {
     prepared_statement_wrapper_t* prepared_wrapper = ALLOC(prepared_statement_wrapper_t);
     prepared_wrapper->prepared = prepared;
     prepared_wrapper->session_ref = self;
+    prepared_wrapper->stats = phase_stats_new();
+    prepared_wrapper->breaker = NULL;
+    prepared_wrapper->hot = NULL;
+    prepared_wrapper->idempotent = false;
+    prepared_wrapper->query_id = query_id;
     
     VALUE prepared_obj = TypedData_Wrap_Struct(rb_cPreparedStatement, &prepared_statement_type, prepared_wrapper);
     
@@ -142,6 +380,7 @@ static VALUE session_batch(int argc, VALUE* argv, VALUE self) {
     batch_wrapper_t* batch_wrapper = ALLOC(batch_wrapper_t);
     batch_wrapper->batch = batch;
     batch_wrapper->session_ref = self;
+    batch_wrapper->statement_count = 0;
     
     VALUE batch_obj = TypedData_Wrap_Struct(rb_cBatch, &batch_type, batch_wrapper);
     
@@ -152,23 +391,36 @@ static VALUE session_batch(int argc, VALUE* argv, VALUE self) {
 }
 
 // Async execution method - returns a Future object
-static VALUE session_execute_async(VALUE self, VALUE query_str) {
+static VALUE session_execute_async(int argc, VALUE* argv, VALUE self) {
+    VALUE query_str, options;
+    rb_scan_args(argc, argv, "11", &query_str, &options);
+    
     session_wrapper_t* wrapper;
     TypedData_Get_Struct(self, session_wrapper_t, &session_type, wrapper);
+    session_check_options(options);
     
+    request_timing_t timing = { monotonic_now_ns(), 0, 0, 0, 0, probe_query_id_if_traced(query_str) };
     const char* query = StringValueCStr(query_str);
     
-    // Create statement
-    CassStatement* statement = cass_statement_new(query, 0);
+    // Create statement; binding may raise, so before anything is admitted
+    CassStatement* statement = session_new_statement(query, options);
+    
+    // The slot is given back from the driver callback once the request resolves
+    circuit_breaker_t* breaker = circuit_breaker_for_query(query_str, session_breaker_keyspace(self, options));
+    priority_class_t priority = priority_current();
+    request_admit(breaker, wrapper->gate, priority, statement);
     
     // Execute query asynchronously
     CassFuture* future = cass_session_execute(wrapper->session, statement);
+    timing.submitted_ns = monotonic_now_ns();
     
     // Clean up statement (future holds reference to it)
     cass_statement_free(statement);
+    CASSANDRA_CPP_PROBE3(request__submit, timing.query_id, future, timing.submitted_ns - timing.started_ns);
     
     // Create Ruby Future object
-    VALUE future_obj = create_future_from_cass_future(future, self, FUTURE_TYPE_EXECUTE);
+    VALUE future_obj = create_timed_future(future, self, &timing, NULL, Qnil,
+                                           session_capture(wrapper, query_str, options), breaker, wrapper->gate, priority);
     
     return future_obj;
 }
@@ -185,15 +437,50 @@ static VALUE session_prepare_async(VALUE self, VALUE query_str) {
     
     // Create Ruby Future object
     VALUE future_obj = create_future_from_cass_future(future, self, FUTURE_TYPE_PREPARE);
+    rb_iv_set(future_obj, "@query", query_str);
     
     return future_obj;
 }
 
+// Ruby method: NativeSession.routing_token(key_values, key_types) -> Integer
+// Murmur3Partitioner token of a partition key as routed by a simple
+// statement with key_types: one component is hashed as is, several as
+// Cassandra's composite (length, bytes, 0 per component)
+static VALUE session_routing_token(VALUE klass, VALUE key_values, VALUE key_types) {
+    Check_Type(key_values, T_ARRAY);
+    VALUE key_indexes = rb_ary_new_capa(RARRAY_LEN(key_values));
+    for (long i = 0; i < RARRAY_LEN(key_values); i++) {
+        rb_ary_push(key_indexes, LONG2NUM(i));
+    }
+    VALUE encoded = routing_key_encode(key_values, key_indexes, key_types);
+    
+    std::string key;
+    for (long i = 0; i < RARRAY_LEN(encoded); i++) {
+        VALUE bytes = RARRAY_AREF(encoded, i);
+        if (RARRAY_LEN(encoded) == 1) {
+            key.assign(RSTRING_PTR(bytes), (size_t)RSTRING_LEN(bytes));
+            break;
+        }
+        key.push_back((char)((RSTRING_LEN(bytes) >> 8) & 0xff));
+        key.push_back((char)(RSTRING_LEN(bytes) & 0xff));
+        key.append(RSTRING_PTR(bytes), (size_t)RSTRING_LEN(bytes));
+        key.push_back(0);
+    }
+    
+    uint64_t hash[2];
+    sstable_murmur3_hash(key.data(), key.size(), hash);
+    return LL2NUM(sstable_token(hash));
+}
+
 void init_session() {
     rb_cSession = rb_define_class_under(rb_cCassandraCpp, "NativeSession", rb_cObject);
     rb_undef_alloc_func(rb_cSession);
-    rb_define_method(rb_cSession, "execute", (VALUE(*)(...))session_execute, 1);
-    rb_define_method(rb_cSession, "execute_async", (VALUE(*)(...))session_execute_async, 1);
+    rb_define_singleton_method(rb_cSession, "routing_token", (VALUE(*)(...))session_routing_token, 2);
+    rb_define_method(rb_cSession, "execute", (VALUE(*)(...))session_execute, -1);
+    rb_define_method(rb_cSession, "execute_result", (VALUE(*)(...))session_execute_result, -1);
+    rb_define_method(rb_cSession, "execute_async", (VALUE(*)(...))session_execute_async, -1);
+    rb_define_method(rb_cSession, "each_row", (VALUE(*)(...))session_each_row, 4);
+    rb_define_method(rb_cSession, "aggregate", (VALUE(*)(...))session_aggregate, 4);
     rb_define_method(rb_cSession, "close", (VALUE(*)(...))session_close, 0);
     rb_define_method(rb_cSession, "prepare", (VALUE(*)(...))session_prepare, 1);
     rb_define_method(rb_cSession, "prepare_async", (VALUE(*)(...))session_prepare_async, 1);
@@ -0,0 +1,560 @@
+#include "cassandra_cpp.h"
+#include <algorithm>
+#include <atomic>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Read-only table snapshots: rows sorted by an order-preserving key encoding
+// in one file that is memory-mapped by every process reading it, so forked
+// workers share the page cache instead of each caching the table.
+//
+// Layout (native byte order):
+//   header   magic "CCSNAP2\0", entry count, index offset, data size
+//   data     key bytes followed by value bytes, per entry in key order
+//   index    one snapshot_entry_t per entry, 8-byte aligned
+//
+// Values use the traffic log's tagged encoding (traffic_value_append), which
+// only ever decodes to plain data, never to arbitrary objects.
+
+#define SNAPSHOT_MAGIC "CCSNAP2"
+
+// Key component tags; ordering between different types is by tag
+#define SNAPSHOT_KEY_NIL 0x01
+#define SNAPSHOT_KEY_BOOLEAN 0x02
+#define SNAPSHOT_KEY_INTEGER 0x03
+#define SNAPSHOT_KEY_FLOAT 0x04
+#define SNAPSHOT_KEY_STRING 0x05
+#define SNAPSHOT_KEY_TIME 0x06
+
+typedef struct {
+    char magic[8];
+    uint64_t count;
+    uint64_t index_offset;
+    uint64_t data_size;
+} snapshot_header_t;
+
+typedef struct {
+    uint64_t offset;  // Key start; the value follows the key
+    uint32_t key_length;
+    uint32_t value_length;
+} snapshot_entry_t;
+
+typedef struct {
+    const char* map;
+    size_t map_size;
+    const snapshot_entry_t* index;
+    uint64_t count;
+    dev_t device;
+    ino_t inode;
+    VALUE path;
+} snapshot_wrapper_t;
+
+// Snapshot being written, released by the ensure handler
+typedef struct {
+    VALUE path;
+    VALUE keys;
+    VALUE values;
+    std::string* tmp_path;
+    std::vector<std::string>* encoded;
+    std::vector<std::string>* encoded_values;
+    std::vector<size_t>* order;
+    std::vector<snapshot_entry_t>* index;
+    FILE* file;
+    bool renamed;
+} snapshot_write_t;
+
+static VALUE rb_cNativeSnapshot;
+
+// Distinguishes temporary files of concurrent writers in one process
+static std::atomic<unsigned long> snapshot_write_sequence(0);
+
+static void snapshot_append_be64(std::string* out, uint64_t value) {
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        out->push_back((char)((value >> shift) & 0xff));
+    }
+}
+
+// Strings are escaped (0x00 -> 0x00 0xff) and terminated by 0x00 0x00 so a
+// composite key sorts component by component
+static void snapshot_append_string(std::string* out, const char* bytes, long length) {
+    out->push_back((char)SNAPSHOT_KEY_STRING);
+    for (long i = 0; i < length; i++) {
+        out->push_back(bytes[i]);
+        if (bytes[i] == 0) {
+            out->push_back((char)0xff);
+        }
+    }
+    out->push_back(0);
+    out->push_back(0);
+}
+
+static void snapshot_append_component(std::string* out, VALUE value) {
+    if (NIL_P(value)) {
+        out->push_back((char)SNAPSHOT_KEY_NIL);
+    } else if (value == Qtrue || value == Qfalse) {
+        out->push_back((char)SNAPSHOT_KEY_BOOLEAN);
+        out->push_back(value == Qtrue ? 1 : 0);
+    } else if (RB_INTEGER_TYPE_P(value)) {
+        out->push_back((char)SNAPSHOT_KEY_INTEGER);
+        snapshot_append_be64(out, (uint64_t)NUM2LL(value) ^ 0x8000000000000000ULL);
+    } else if (RB_FLOAT_TYPE_P(value)) {
+        // Flip the sign bit of positives and every bit of negatives so the
+        // bytes sort like the numbers
+        double number = RFLOAT_VALUE(value);
+        uint64_t bits;
+        memcpy(&bits, &number, sizeof(bits));
+        bits = (bits & 0x8000000000000000ULL) ? ~bits : bits ^ 0x8000000000000000ULL;
+        out->push_back((char)SNAPSHOT_KEY_FLOAT);
+        snapshot_append_be64(out, bits);
+    } else if (rb_obj_is_kind_of(value, rb_cTime)) {
+        struct timespec ts = rb_time_timespec(value);
+        int64_t ns = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+        out->push_back((char)SNAPSHOT_KEY_TIME);
+        snapshot_append_be64(out, (uint64_t)ns ^ 0x8000000000000000ULL);
+    } else {
+        VALUE str = SYMBOL_P(value) ? rb_sym2str(value) : rb_obj_as_string(value);
+        snapshot_append_string(out, RSTRING_PTR(str), RSTRING_LEN(str));
+    }
+}
+
+// A key is one value, or an Array of values for a composite key; an Array
+// prefix encodes to a byte prefix of the full key
+static void snapshot_encode_key(std::string* out, VALUE key) {
+    if (RB_TYPE_P(key, T_ARRAY)) {
+        for (long i = 0; i < RARRAY_LEN(key); i++) {
+            snapshot_append_component(out, RARRAY_AREF(key, i));
+        }
+    } else {
+        snapshot_append_component(out, key);
+    }
+}
+
+static void snapshot_write_bytes(snapshot_write_t* write, const void* bytes, size_t length) {
+    if (length > 0 && fwrite(bytes, 1, length, write->file) != length) {
+        rb_sys_fail(write->tmp_path->c_str());
+    }
+}
+
+static VALUE snapshot_write_run(VALUE arg) {
+    snapshot_write_t* write = (snapshot_write_t*)arg;
+    std::vector<std::string>& encoded = *write->encoded;
+    std::vector<std::string>& encoded_values = *write->encoded_values;
+    std::vector<size_t>& order = *write->order;
+    long count = RARRAY_LEN(write->keys);
+    
+    for (long i = 0; i < count; i++) {
+        snapshot_encode_key(&encoded[(size_t)i], RARRAY_AREF(write->keys, i));
+        traffic_value_append(&encoded_values[(size_t)i], RARRAY_AREF(write->values, i));
+        if (encoded[(size_t)i].size() > UINT32_MAX || encoded_values[(size_t)i].size() > UINT32_MAX) {
+            rb_raise(rb_eArgError, "Snapshot entry %ld is too large", i);
+        }
+        order[(size_t)i] = (size_t)i;
+    }
+    
+    std::sort(order.begin(), order.end(), [&encoded](size_t a, size_t b) { return encoded[a] < encoded[b]; });
+    for (size_t i = 1; i < order.size(); i++) {
+        if (encoded[order[i]] == encoded[order[i - 1]]) {
+            VALUE key = rb_inspect(RARRAY_AREF(write->keys, (long)order[i]));
+            rb_raise(rb_eArgError, "Duplicate snapshot key: %s", StringValueCStr(key));
+        }
+    }
+    
+    // A unique name per writer: threads and processes may rebuild the same
+    // path at once, and O_EXCL never reuses a file left by a crashed writer.
+    // Only the owner may read or replace the rows.
+    int fd = -1;
+    while (fd < 0) {
+        char suffix[64];
+        snprintf(suffix, sizeof(suffix), ".tmp.%ld.%lu", (long)getpid(), snapshot_write_sequence.fetch_add(1));
+        write->tmp_path->assign(RSTRING_PTR(write->path), (size_t)RSTRING_LEN(write->path));
+        write->tmp_path->append(suffix);
+        fd = open(write->tmp_path->c_str(), O_WRONLY | O_CREAT | O_EXCL, 0600);
+        if (fd < 0 && errno != EEXIST) {
+            write->tmp_path->clear();
+            rb_sys_fail(RSTRING_PTR(write->path));
+        }
+    }
+    write->file = fdopen(fd, "wb");
+    if (!write->file) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        rb_sys_fail(write->tmp_path->c_str());
+    }
+    
+    std::vector<snapshot_entry_t>& index = *write->index;
+    index.resize(order.size());
+    uint64_t offset = sizeof(snapshot_header_t);
+    for (size_t i = 0; i < order.size(); i++) {
+        index[i].offset = offset;
+        index[i].key_length = (uint32_t)encoded[order[i]].size();
+        index[i].value_length = (uint32_t)encoded_values[order[i]].size();
+        offset += index[i].key_length + index[i].value_length;
+    }
+    
+    snapshot_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.count = order.size();
+    header.data_size = offset - sizeof(snapshot_header_t);
+    header.index_offset = (offset + 7) & ~(uint64_t)7;
+    
+    snapshot_write_bytes(write, &header, sizeof(header));
+    for (size_t i = 0; i < order.size(); i++) {
+        snapshot_write_bytes(write, encoded[order[i]].data(), encoded[order[i]].size());
+        snapshot_write_bytes(write, encoded_values[order[i]].data(), encoded_values[order[i]].size());
+    }
+    static const char padding[8] = { 0 };
+    snapshot_write_bytes(write, padding, (size_t)(header.index_offset - offset));
+    snapshot_write_bytes(write, index.data(), index.size() * sizeof(snapshot_entry_t));
+    
+    // Readers only ever see a complete file: flush it to disk, then swap it in
+    if (fflush(write->file) != 0 || fsync(fileno(write->file)) != 0) {
+        rb_sys_fail(write->tmp_path->c_str());
+    }
+    int rc = fclose(write->file);
+    write->file = NULL;
+    if (rc != 0) {
+        rb_sys_fail(write->tmp_path->c_str());
+    }
+    
+    if (rename(write->tmp_path->c_str(), StringValueCStr(write->path)) != 0) {
+        rb_sys_fail(StringValueCStr(write->path));
+    }
+    write->renamed = true;
+    
+    return LONG2NUM(count);
+}
+
+static VALUE snapshot_write_cleanup(VALUE arg) {
+    snapshot_write_t* write = (snapshot_write_t*)arg;
+    
+    if (write->file) {
+        fclose(write->file);
+    }
+    if (!write->renamed && !write->tmp_path->empty()) {
+        unlink(write->tmp_path->c_str());
+    }
+    delete write->tmp_path;
+    delete write->encoded;
+    delete write->encoded_values;
+    delete write->order;
+    delete write->index;
+    
+    return Qnil;
+}
+
+// Ruby method: CassandraCpp::NativeSnapshot.write(path, keys, values)
+// Writes values[i] under keys[i], sorted by key, to a temporary file next to
+// path and renames it over path, so readers switch atomically. Keys must be
+// unique. Values are plain data: nil, booleans, numbers, Strings, Times,
+// BigDecimals and Arrays, Sets and Hashes of them; other objects are stored
+// as their to_s. Returns the number of entries.
+static VALUE native_snapshot_write(VALUE self, VALUE path, VALUE keys, VALUE values) {
+    FilePathValue(path);
+    Check_Type(keys, T_ARRAY);
+    Check_Type(values, T_ARRAY);
+    if (RARRAY_LEN(keys) != RARRAY_LEN(values)) {
+        rb_raise(rb_eArgError, "keys and values must have the same length");
+    }
+    
+    snapshot_write_t write;
+    write.path = path;
+    write.keys = keys;
+    write.values = values;
+    write.tmp_path = new std::string();
+    write.encoded = new std::vector<std::string>((size_t)RARRAY_LEN(keys));
+    write.encoded_values = new std::vector<std::string>((size_t)RARRAY_LEN(keys));
+    write.order = new std::vector<size_t>((size_t)RARRAY_LEN(keys));
+    write.index = new std::vector<snapshot_entry_t>();
+    write.file = NULL;
+    write.renamed = false;
+    
+    return rb_ensure(snapshot_write_run, (VALUE)&write, snapshot_write_cleanup, (VALUE)&write);
+}
+
+static void snapshot_unmap(snapshot_wrapper_t* wrapper) {
+    if (wrapper->map) {
+        munmap((void*)wrapper->map, wrapper->map_size);
+        wrapper->map = NULL;
+        wrapper->index = NULL;
+        wrapper->count = 0;
+    }
+}
+
+static void snapshot_mark(void* ptr) {
+    snapshot_wrapper_t* wrapper = (snapshot_wrapper_t*)ptr;
+    rb_gc_mark(wrapper->path);
+}
+
+static void snapshot_free(void* ptr) {
+    snapshot_wrapper_t* wrapper = (snapshot_wrapper_t*)ptr;
+    snapshot_unmap(wrapper);
+    xfree(wrapper);
+}
+
+static size_t snapshot_memsize(const void* ptr) {
+    // The mapping is shared page cache, not process heap
+    return sizeof(snapshot_wrapper_t);
+}
+
+static const rb_data_type_t snapshot_type = {
+    "CassandraCpp::NativeSnapshot",
+    { snapshot_mark, snapshot_free, snapshot_memsize },
+    0, 0,
+    RUBY_TYPED_FREE_IMMEDIATELY
+};
+
+static snapshot_wrapper_t* snapshot_mapped(VALUE self) {
+    snapshot_wrapper_t* wrapper;
+    TypedData_Get_Struct(self, snapshot_wrapper_t, &snapshot_type, wrapper);
+    
+    if (!wrapper->map) {
+        rb_raise(rb_eIOError, "snapshot is closed");
+    }
+    
+    return wrapper;
+}
+
+// Check every range the header and index describe against the mapped size,
+// so a truncated or corrupt file is rejected instead of read out of bounds.
+// Lookups then trust the index.
+static bool snapshot_valid(const char* map, size_t size) {
+    const snapshot_header_t* header = (const snapshot_header_t*)map;
+    
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+        header->index_offset % 8 != 0 ||
+        header->index_offset < sizeof(snapshot_header_t) ||
+        header->index_offset > size ||
+        header->data_size > header->index_offset - sizeof(snapshot_header_t) ||
+        header->count > (size - header->index_offset) / sizeof(snapshot_entry_t)) {
+        return false;
+    }
+    
+    const snapshot_entry_t* index = (const snapshot_entry_t*)(map + header->index_offset);
+    uint64_t data_end = sizeof(snapshot_header_t) + header->data_size;
+    for (uint64_t i = 0; i < header->count; i++) {
+        uint64_t length = (uint64_t)index[i].key_length + index[i].value_length;
+        if (index[i].offset < sizeof(snapshot_header_t) ||
+            index[i].offset > data_end ||
+            length > data_end - index[i].offset) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+// Ruby method: CassandraCpp::NativeSnapshot.open(path)
+// Maps a snapshot written by .write; the mapping stays valid after the file
+// is replaced, until #close or garbage collection.
+static VALUE native_snapshot_open(VALUE klass, VALUE path) {
+    FilePathValue(path);
+    const char* path_str = StringValueCStr(path);
+    
+    int fd = open(path_str, O_RDONLY);
+    if (fd < 0) {
+        rb_sys_fail(path_str);
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        rb_sys_fail(path_str);
+    }
+    
+    size_t size = (size_t)st.st_size;
+    if (size < sizeof(snapshot_header_t)) {
+        close(fd);
+        rb_raise(rb_eArgError, "Not a snapshot file: %s", path_str);
+    }
+    
+    void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        rb_sys_fail(path_str);
+    }
+    
+    if (!snapshot_valid((const char*)map, size)) {
+        munmap(map, size);
+        rb_raise(rb_eArgError, "Not a snapshot file: %s", path_str);
+    }
+    
+    const snapshot_header_t* header = (const snapshot_header_t*)map;
+    snapshot_wrapper_t* wrapper = ALLOC(snapshot_wrapper_t);
+    wrapper->map = (const char*)map;
+    wrapper->map_size = size;
+    wrapper->index = (const snapshot_entry_t*)(wrapper->map + header->index_offset);
+    wrapper->count = header->count;
+    wrapper->device = st.st_dev;
+    wrapper->inode = st.st_ino;
+    wrapper->path = rb_str_new_frozen(path);
+    
+    return TypedData_Wrap_Struct(klass, &snapshot_type, wrapper);
+}
+
+// Compare the key at position with an encoded key (a Ruby String)
+static int snapshot_compare(const snapshot_wrapper_t* wrapper, uint64_t position, VALUE key) {
+    const snapshot_entry_t& entry = wrapper->index[position];
+    size_t key_length = (size_t)RSTRING_LEN(key);
+    int rc = memcmp(wrapper->map + entry.offset, RSTRING_PTR(key), std::min((size_t)entry.key_length, key_length));
+    
+    if (rc != 0) {
+        return rc;
+    }
+    if (entry.key_length == key_length) {
+        return 0;
+    }
+    return entry.key_length < key_length ? -1 : 1;
+}
+
+// First position whose key is not below the encoded key
+static uint64_t snapshot_lower_bound(const snapshot_wrapper_t* wrapper, VALUE key) {
+    uint64_t low = 0;
+    uint64_t high = wrapper->count;
+    
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        if (snapshot_compare(wrapper, middle, key) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    
+    return low;
+}
+
+// Decode the value at position; trailing bytes mean a corrupt entry
+static VALUE snapshot_value_at(const snapshot_wrapper_t* wrapper, uint64_t position) {
+    const snapshot_entry_t& entry = wrapper->index[position];
+    const char* cursor = wrapper->map + entry.offset + entry.key_length;
+    const char* end = cursor + entry.value_length;
+    
+    VALUE value = traffic_value_read(&cursor, end);
+    if (cursor != end) {
+        rb_raise(rb_eArgError, "Corrupt snapshot entry %llu", (unsigned long long)position);
+    }
+    
+    return value;
+}
+
+typedef struct {
+    VALUE key;
+    std::string* encoded;
+} snapshot_key_t;
+
+static VALUE snapshot_key_encode(VALUE arg) {
+    snapshot_key_t* key = (snapshot_key_t*)arg;
+    snapshot_encode_key(key->encoded, key->key);
+    return rb_str_new(key->encoded->data(), (long)key->encoded->size());
+}
+
+static VALUE snapshot_key_release(VALUE arg) {
+    delete ((snapshot_key_t*)arg)->encoded;
+    return Qnil;
+}
+
+// Encode a key into a Ruby String; encoding may raise (to_s, or an Integer
+// beyond 64 bits). Equal keys encode to equal bytes, so this also serves as
+// the hashing input of key filters.
+VALUE ordered_key_string(VALUE key) {
+    snapshot_key_t encoding = { key, new std::string() };
+    return rb_ensure(snapshot_key_encode, (VALUE)&encoding, snapshot_key_release, (VALUE)&encoding);
+}
+
+// Ruby method: snapshot.get(key) -> value or nil
+static VALUE snapshot_get_value(VALUE self, VALUE key) {
+    snapshot_wrapper_t* wrapper = snapshot_mapped(self);
+    VALUE encoded = ordered_key_string(key);
+    
+    uint64_t position = snapshot_lower_bound(wrapper, encoded);
+    if (position < wrapper->count && snapshot_compare(wrapper, position, encoded) == 0) {
+        return snapshot_value_at(wrapper, position);
+    }
+    
+    return Qnil;
+}
+
+// Ruby method: snapshot.range(from, to, limit) -> Array of values
+// Values with from <= key < to in key order; nil bounds are open. An Array
+// prefix of a composite key bounds on the leading columns. limit may be nil.
+static VALUE snapshot_range(VALUE self, VALUE from, VALUE to, VALUE limit) {
+    snapshot_wrapper_t* wrapper = snapshot_mapped(self);
+    uint64_t max_values = NIL_P(limit) ? UINT64_MAX : (uint64_t)NUM2ULL(limit);
+    
+    uint64_t start = 0;
+    uint64_t end = wrapper->count;
+    if (!NIL_P(from)) {
+        start = snapshot_lower_bound(wrapper, ordered_key_string(from));
+    }
+    if (!NIL_P(to)) {
+        end = snapshot_lower_bound(wrapper, ordered_key_string(to));
+    }
+    if (end < start) {
+        end = start;
+    }
+    if (end - start > max_values) {
+        end = start + max_values;
+    }
+    
+    VALUE values = rb_ary_new_capa((long)(end - start));
+    for (uint64_t position = start; position < end; position++) {
+        rb_ary_push(values, snapshot_value_at(wrapper, position));
+    }
+    
+    return values;
+}
+
+static VALUE snapshot_size(VALUE self) {
+    return ULL2NUM(snapshot_mapped(self)->count);
+}
+
+// Ruby method: snapshot.changed? -> true once another file was renamed over
+// the mapped path. A missing file is not a change; the mapping keeps serving.
+static VALUE snapshot_changed_p(VALUE self) {
+    snapshot_wrapper_t* wrapper = snapshot_mapped(self);
+    
+    struct stat st;
+    if (stat(RSTRING_PTR(wrapper->path), &st) != 0) {
+        return Qfalse;
+    }
+    
+    return (st.st_dev != wrapper->device || st.st_ino != wrapper->inode) ? Qtrue : Qfalse;
+}
+
+static VALUE snapshot_close(VALUE self) {
+    snapshot_wrapper_t* wrapper;
+    TypedData_Get_Struct(self, snapshot_wrapper_t, &snapshot_type, wrapper);
+    
+    snapshot_unmap(wrapper);
+    
+    return Qnil;
+}
+
+static VALUE snapshot_closed_p(VALUE self) {
+    snapshot_wrapper_t* wrapper;
+    TypedData_Get_Struct(self, snapshot_wrapper_t, &snapshot_type, wrapper);
+    
+    return wrapper->map ? Qfalse : Qtrue;
+}
+
+void init_snapshot() {
+    rb_cNativeSnapshot = rb_define_class_under(rb_cCassandraCpp, "NativeSnapshot", rb_cObject);
+    rb_undef_alloc_func(rb_cNativeSnapshot);
+    
+    rb_define_singleton_method(rb_cNativeSnapshot, "write", (VALUE(*)(...))native_snapshot_write, 3);
+    rb_define_singleton_method(rb_cNativeSnapshot, "open", (VALUE(*)(...))native_snapshot_open, 1);
+    rb_define_method(rb_cNativeSnapshot, "get", (VALUE(*)(...))snapshot_get_value, 1);
+    rb_define_method(rb_cNativeSnapshot, "range", (VALUE(*)(...))snapshot_range, 3);
+    rb_define_method(rb_cNativeSnapshot, "size", (VALUE(*)(...))snapshot_size, 0);
+    rb_define_method(rb_cNativeSnapshot, "changed?", (VALUE(*)(...))snapshot_changed_p, 0);
+    rb_define_method(rb_cNativeSnapshot, "close", (VALUE(*)(...))snapshot_close, 0);
+    rb_define_method(rb_cNativeSnapshot, "closed?", (VALUE(*)(...))snapshot_closed_p, 0);
+}
\ No newline at end of file
@@ -0,0 +1,728 @@
+#include "cassandra_cpp.h"
+#include <ruby/encoding.h>
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+// Pieces of Cassandra's on-disk format shared by the offline SSTable writer
+// and reader: column types and their value encodings and orderings, the
+// Murmur3 partitioner hash and unsigned vints. CRC32 is crc32_update in common.cpp.
+//
+// Values are stored in the native protocol's encoding, so the encoders here
+// mirror the bind path of common.cpp. Orderings follow the marshal classes:
+// rows are sorted with them, so they must agree with Cassandra's.
+
+static const sstable_type_t sstable_types[] = {
+    { SSTABLE_TYPE_ASCII, "ascii", "AsciiType", -1 },
+    { SSTABLE_TYPE_BIGINT, "bigint", "LongType", 8 },
+    { SSTABLE_TYPE_BLOB, "blob", "BytesType", -1 },
+    { SSTABLE_TYPE_BOOLEAN, "boolean", "BooleanType", 1 },
+    { SSTABLE_TYPE_DATE, "date", "SimpleDateType", -1 },
+    { SSTABLE_TYPE_DECIMAL, "decimal", "DecimalType", -1 },
+    { SSTABLE_TYPE_DOUBLE, "double", "DoubleType", 8 },
+    { SSTABLE_TYPE_FLOAT, "float", "FloatType", 4 },
+    { SSTABLE_TYPE_INET, "inet", "InetAddressType", -1 },
+    { SSTABLE_TYPE_INT, "int", "Int32Type", 4 },
+    { SSTABLE_TYPE_SMALLINT, "smallint", "ShortType", -1 },
+    { SSTABLE_TYPE_TEXT, "text", "UTF8Type", -1 },
+    { SSTABLE_TYPE_TEXT, "varchar", "UTF8Type", -1 },
+    { SSTABLE_TYPE_TIME, "time", "TimeType", -1 },
+    { SSTABLE_TYPE_TIMESTAMP, "timestamp", "TimestampType", 8 },
+    { SSTABLE_TYPE_TIMEUUID, "timeuuid", "TimeUUIDType", 16 },
+    { SSTABLE_TYPE_TINYINT, "tinyint", "ByteType", -1 },
+    { SSTABLE_TYPE_UUID, "uuid", "UUIDType", 16 },
+    { SSTABLE_TYPE_VARINT, "varint", "IntegerType", -1 }
+};
+
+// Days between -4712-01-01 (Julian Day 0) and 1970-01-01
+#define SSTABLE_UNIX_EPOCH_JD 2440588LL
+#define SSTABLE_NANOS_PER_DAY 86400000000000LL
+
+// Type of a CQL type name such as "int" or "text", NULL when unsupported
+const sstable_type_t* sstable_type_from_cql(VALUE name) {
+    VALUE str = SYMBOL_P(name) ? rb_sym2str(name) : rb_obj_as_string(name);
+    
+    for (size_t i = 0; i < sizeof(sstable_types) / sizeof(sstable_types[0]); i++) {
+        if ((size_t)RSTRING_LEN(str) == strlen(sstable_types[i].cql_name) &&
+            strncasecmp(RSTRING_PTR(str), sstable_types[i].cql_name, (size_t)RSTRING_LEN(str)) == 0) {
+            return &sstable_types[i];
+        }
+    }
+    
+    return NULL;
+}
+
+// Type of a marshal class name such as "Int32Type" (package optional),
+// NULL when unsupported. DateType is the pre-2.0 name of TimestampType.
+const sstable_type_t* sstable_type_from_marshal(const char* name, size_t length) {
+    const char* dot = (const char*)memrchr(name, '.', length);
+    if (dot) {
+        length -= (size_t)(dot + 1 - name);
+        name = dot + 1;
+    }
+    if (length == 8 && memcmp(name, "DateType", 8) == 0) {
+        name = "TimestampType";
+        length = 13;
+    }
+    
+    for (size_t i = 0; i < sizeof(sstable_types) / sizeof(sstable_types[0]); i++) {
+        if (length == strlen(sstable_types[i].marshal_class) &&
+            memcmp(name, sstable_types[i].marshal_class, length) == 0) {
+            return &sstable_types[i];
+        }
+    }
+    
+    return NULL;
+}
+
+// Big-endian integers of 1 to 8 bytes, as every fixed-width field is stored
+void sstable_append_be(std::string* out, uint64_t value, int bytes) {
+    for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+        out->push_back((char)((value >> shift) & 0xff));
+    }
+}
+
+uint64_t sstable_read_be(const char* bytes, size_t length) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < length; i++) {
+        value = (value << 8) | (unsigned char)bytes[i];
+    }
+    return value;
+}
+
+static void sstable_type_error(const sstable_type_t* type, VALUE value) {
+    rb_raise(rb_eTypeError, "Cannot store %s in a %s column", rb_obj_classname(value), type->cql_name);
+}
+
+static int64_t sstable_integer(const sstable_type_t* type, VALUE value, int64_t min, int64_t max) {
+    if (!RB_INTEGER_TYPE_P(value)) {
+        sstable_type_error(type, value);
+    }
+    
+    int64_t number = NUM2LL(value);
+    if (number < min || number > max) {
+        rb_raise(rb_eRangeError, "%lld is out of range for a %s column", (long long)number, type->cql_name);
+    }
+    
+    return number;
+}
+
+// Two's complement, big-endian, in as few bytes as keep the sign
+static void sstable_append_varint(std::string* out, VALUE value) {
+    size_t length = rb_absint_size(value, NULL) + 1;
+    size_t start = out->size();
+    out->resize(start + length);
+    rb_integer_pack(value, &(*out)[start], length, 1, 0, INTEGER_PACK_BIG_ENDIAN | INTEGER_PACK_2COMP);
+    
+    size_t redundant = 0;
+    while (redundant + 1 < length) {
+        unsigned char first = (unsigned char)(*out)[start + redundant];
+        unsigned char next = (unsigned char)(*out)[start + redundant + 1];
+        if (!((first == 0x00 && !(next & 0x80)) || (first == 0xff && (next & 0x80)))) {
+            break;
+        }
+        redundant++;
+    }
+    out->erase(start, redundant);
+}
+
+// 32 hex digits, dashes ignored
+static void sstable_append_uuid(const sstable_type_t* type, std::string* out, VALUE value) {
+    if (!RB_TYPE_P(value, T_STRING)) {
+        sstable_type_error(type, value);
+    }
+    
+    const char* text = RSTRING_PTR(value);
+    long length = RSTRING_LEN(value);
+    unsigned char bytes[16];
+    int digits = 0;
+    for (long i = 0; i < length; i++) {
+        char c = text[i];
+        int nibble;
+        if (c >= '0' && c <= '9') {
+            nibble = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            nibble = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            nibble = c - 'A' + 10;
+        } else if (c == '-') {
+            continue;
+        } else {
+            digits = -1;
+            break;
+        }
+        if (digits == 32) {
+            digits = -1;
+            break;
+        }
+        bytes[digits / 2] = (unsigned char)(digits % 2 == 0 ? nibble << 4 : (bytes[digits / 2] | nibble));
+        digits++;
+    }
+    
+    if (digits != 32) {
+        rb_raise(rb_eArgError, "Invalid UUID: %s", StringValueCStr(value));
+    }
+    if (type->kind == SSTABLE_TYPE_TIMEUUID && (bytes[6] >> 4) != 1) {
+        rb_raise(rb_eArgError, "Not a time-based (version 1) UUID: %s", StringValueCStr(value));
+    }
+    
+    out->append((const char*)bytes, sizeof(bytes));
+}
+
+static void sstable_append_inet(const sstable_type_t* type, std::string* out, VALUE value) {
+    // IPAddr
+    if (rb_respond_to(value, rb_intern("hton"))) {
+        VALUE packed = rb_funcall(value, rb_intern("hton"), 0);
+        StringValue(packed);
+        if (RSTRING_LEN(packed) != 4 && RSTRING_LEN(packed) != 16) {
+            rb_raise(rb_eArgError, "Invalid inet address");
+        }
+        out->append(RSTRING_PTR(packed), (size_t)RSTRING_LEN(packed));
+        return;
+    }
+    if (!RB_TYPE_P(value, T_STRING)) {
+        sstable_type_error(type, value);
+    }
+    
+    unsigned char address[16];
+    const char* text = StringValueCStr(value);
+    if (inet_pton(AF_INET, text, address) == 1) {
+        out->append((const char*)address, 4);
+    } else if (inet_pton(AF_INET6, text, address) == 1) {
+        out->append((const char*)address, 16);
+    } else {
+        rb_raise(rb_eArgError, "Invalid inet address: %s", text);
+    }
+}
+
+// int32 scale followed by the unscaled varint; Integers have scale 0
+static void sstable_append_decimal(const sstable_type_t* type, std::string* out, VALUE value) {
+    if (RB_INTEGER_TYPE_P(value)) {
+        sstable_append_be(out, 0, 4);
+        sstable_append_varint(out, value);
+        return;
+    }
+    if (strcmp(rb_obj_classname(value), "BigDecimal") != 0) {
+        sstable_type_error(type, value);
+    }
+    
+    // [sign, significant digits, 10, exponent]: value = 0.digits * 10**exponent
+    VALUE parts = rb_funcall(value, rb_intern("split"), 0);
+    int sign = NUM2INT(rb_ary_entry(parts, 0));
+    if (sign == 0 || sign == 3 || sign == -3) {
+        rb_raise(rb_eArgError, "Cannot store a non-finite decimal");
+    }
+    
+    VALUE digits = rb_ary_entry(parts, 1);
+    StringValue(digits);
+    long long scale = (long long)RSTRING_LEN(digits) - NUM2LL(rb_ary_entry(parts, 3));
+    if (scale < INT32_MIN || scale > INT32_MAX) {
+        rb_raise(rb_eRangeError, "Decimal scale out of range");
+    }
+    
+    VALUE unscaled = rb_str_to_inum(digits, 10, Qfalse);
+    if (sign < 0) {
+        unscaled = rb_funcall(unscaled, rb_intern("-@"), 0);
+    }
+    sstable_append_be(out, (uint64_t)(int64_t)scale, 4);
+    sstable_append_varint(out, unscaled);
+}
+
+static void sstable_append_string(const sstable_type_t* type, std::string* out, VALUE value) {
+    if (SYMBOL_P(value)) {
+        value = rb_sym2str(value);
+    }
+    if (!RB_TYPE_P(value, T_STRING)) {
+        sstable_type_error(type, value);
+    }
+    
+    if (type->kind == SSTABLE_TYPE_TEXT) {
+        rb_encoding* encoding = rb_enc_get(value);
+        if (encoding != rb_utf8_encoding() && encoding != rb_usascii_encoding() && encoding != rb_ascii8bit_encoding()) {
+            value = rb_str_conv_enc(value, encoding, rb_utf8_encoding());
+        }
+    } else if (type->kind == SSTABLE_TYPE_ASCII) {
+        const unsigned char* bytes = (const unsigned char*)RSTRING_PTR(value);
+        for (long i = 0; i < RSTRING_LEN(value); i++) {
+            if (bytes[i] > 0x7f) {
+                rb_raise(rb_eArgError, "Non-ASCII byte in an ascii column");
+            }
+        }
+    }
+    
+    out->append(RSTRING_PTR(value), (size_t)RSTRING_LEN(value));
+}
+
+// Append value in the storage encoding of type. Raises TypeError,
+// RangeError or ArgumentError for values the column cannot hold; out may
+// then hold a partial value.
+void sstable_encode_value(const sstable_type_t* type, VALUE value, std::string* out) {
+    switch (type->kind) {
+        case SSTABLE_TYPE_ASCII:
+        case SSTABLE_TYPE_TEXT:
+        case SSTABLE_TYPE_BLOB:
+            sstable_append_string(type, out, value);
+            break;
+        case SSTABLE_TYPE_BOOLEAN:
+            if (value != Qtrue && value != Qfalse) {
+                sstable_type_error(type, value);
+            }
+            out->push_back(value == Qtrue ? 1 : 0);
+            break;
+        case SSTABLE_TYPE_TINYINT:
+            sstable_append_be(out, (uint64_t)sstable_integer(type, value, INT8_MIN, INT8_MAX), 1);
+            break;
+        case SSTABLE_TYPE_SMALLINT:
+            sstable_append_be(out, (uint64_t)sstable_integer(type, value, INT16_MIN, INT16_MAX), 2);
+            break;
+        case SSTABLE_TYPE_INT:
+            sstable_append_be(out, (uint64_t)sstable_integer(type, value, INT32_MIN, INT32_MAX), 4);
+            break;
+        case SSTABLE_TYPE_BIGINT:
+            sstable_append_be(out, (uint64_t)sstable_integer(type, value, INT64_MIN, INT64_MAX), 8);
+            break;
+        case SSTABLE_TYPE_VARINT:
+            if (!RB_INTEGER_TYPE_P(value)) {
+                sstable_type_error(type, value);
+            }
+            sstable_append_varint(out, value);
+            break;
+        case SSTABLE_TYPE_DECIMAL:
+            sstable_append_decimal(type, out, value);
+            break;
+        case SSTABLE_TYPE_FLOAT: {
+            if (!RB_FLOAT_TYPE_P(value) && !RB_INTEGER_TYPE_P(value)) {
+                sstable_type_error(type, value);
+            }
+            float number = (float)NUM2DBL(value);
+            uint32_t bits;
+            memcpy(&bits, &number, sizeof(bits));
+            sstable_append_be(out, bits, 4);
+            break;
+        }
+        case SSTABLE_TYPE_DOUBLE: {
+            if (!RB_FLOAT_TYPE_P(value) && !RB_INTEGER_TYPE_P(value)) {
+                sstable_type_error(type, value);
+            }
+            double number = NUM2DBL(value);
+            uint64_t bits;
+            memcpy(&bits, &number, sizeof(bits));
+            sstable_append_be(out, bits, 8);
+            break;
+        }
+        case SSTABLE_TYPE_TIMESTAMP: {
+            // Milliseconds since the epoch; Integers are taken as milliseconds
+            int64_t ms;
+            if (rb_obj_is_kind_of(value, rb_cTime)) {
+                struct timespec ts = rb_time_timespec(value);
+                ms = (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+            } else {
+                ms = sstable_integer(type, value, INT64_MIN, INT64_MAX);
+            }
+            sstable_append_be(out, (uint64_t)ms, 8);
+            break;
+        }
+        case SSTABLE_TYPE_DATE: {
+            // Days since the epoch, offset by 2**31 so the bytes sort as dates
+            int64_t days;
+            if (rb_respond_to(value, rb_intern("jd"))) {
+                days = NUM2LL(rb_funcall(value, rb_intern("jd"), 0)) - SSTABLE_UNIX_EPOCH_JD;
+                if (days < INT32_MIN || days > INT32_MAX) {
+                    rb_raise(rb_eRangeError, "Date out of range for a date column");
+                }
+            } else {
+                days = sstable_integer(type, value, INT32_MIN, INT32_MAX);
+            }
+            sstable_append_be(out, (uint64_t)(days + 2147483648LL), 4);
+            break;
+        }
+        case SSTABLE_TYPE_TIME:
+            // Nanoseconds since midnight
+            sstable_append_be(out, (uint64_t)sstable_integer(type, value, 0, SSTABLE_NANOS_PER_DAY - 1), 8);
+            break;
+        case SSTABLE_TYPE_UUID:
+        case SSTABLE_TYPE_TIMEUUID:
+            sstable_append_uuid(type, out, value);
+            break;
+        case SSTABLE_TYPE_INET:
+            sstable_append_inet(type, out, value);
+            break;
+    }
+}
+
+static int64_t sstable_sign_extend(uint64_t value, int bytes) {
+    int shift = 64 - bytes * 8;
+    return (int64_t)(value << shift) >> shift;
+}
+
+// Ruby value of a stored value of type, matching what a query returns for
+// the types convert_cass_value_to_ruby decodes. Empty values of types other
+// than strings and blobs are nil.
+VALUE sstable_decode_value(const sstable_type_t* type, const char* bytes, size_t length) {
+    if (length == 0 && type->kind != SSTABLE_TYPE_ASCII && type->kind != SSTABLE_TYPE_TEXT &&
+        type->kind != SSTABLE_TYPE_BLOB) {
+        return Qnil;
+    }
+    if (type->fixed_length >= 0 && length != (size_t)type->fixed_length) {
+        rb_raise(rb_eIOError, "Invalid %s value of %zu bytes", type->cql_name, length);
+    }
+    
+    switch (type->kind) {
+        case SSTABLE_TYPE_ASCII:
+        case SSTABLE_TYPE_TEXT:
+        case SSTABLE_TYPE_BLOB:
+            return rb_str_new(bytes, (long)length);
+        case SSTABLE_TYPE_BOOLEAN:
+            return bytes[0] ? Qtrue : Qfalse;
+        case SSTABLE_TYPE_TINYINT:
+        case SSTABLE_TYPE_SMALLINT:
+        case SSTABLE_TYPE_INT:
+        case SSTABLE_TYPE_BIGINT:
+            if (length > 8) {
+                rb_raise(rb_eIOError, "Invalid %s value of %zu bytes", type->cql_name, length);
+            }
+            return LL2NUM(sstable_sign_extend(sstable_read_be(bytes, length), (int)length));
+        case SSTABLE_TYPE_VARINT:
+            return rb_integer_unpack(bytes, length, 1, 0, INTEGER_PACK_BIG_ENDIAN | INTEGER_PACK_2COMP);
+        case SSTABLE_TYPE_DECIMAL: {
+            if (length < 4) {
+                rb_raise(rb_eIOError, "Invalid decimal value of %zu bytes", length);
+            }
+            int32_t scale = (int32_t)(uint32_t)sstable_read_be(bytes, 4);
+            VALUE unscaled = rb_integer_unpack(bytes + 4, length - 4, 1, 0,
+                                               INTEGER_PACK_BIG_ENDIAN | INTEGER_PACK_2COMP);
+            VALUE text = rb_sprintf("%" PRIsVALUE "E%d", unscaled, -scale);
+            if (rb_respond_to(rb_mKernel, rb_intern("BigDecimal"))) {
+                return rb_funcall(rb_mKernel, rb_intern("BigDecimal"), 1, text);
+            }
+            return text;
+        }
+        case SSTABLE_TYPE_FLOAT: {
+            uint32_t bits = (uint32_t)sstable_read_be(bytes, 4);
+            float number;
+            memcpy(&number, &bits, sizeof(number));
+            return DBL2NUM(number);
+        }
+        case SSTABLE_TYPE_DOUBLE: {
+            uint64_t bits = sstable_read_be(bytes, 8);
+            double number;
+            memcpy(&number, &bits, sizeof(number));
+            return DBL2NUM(number);
+        }
+        case SSTABLE_TYPE_TIMESTAMP:
+            return timestamp_to_ruby((cass_int64_t)sstable_read_be(bytes, 8));
+        case SSTABLE_TYPE_DATE: {
+            if (length != 4) {
+                rb_raise(rb_eIOError, "Invalid date value of %zu bytes", length);
+            }
+            long long days = (long long)sstable_read_be(bytes, 4) - 2147483648LL;
+            VALUE date_class = rb_const_defined(rb_cObject, rb_intern("Date")) ? rb_path2class("Date") : Qnil;
+            if (NIL_P(date_class)) {
+                return LL2NUM(days);
+            }
+            return rb_funcall(date_class, rb_intern("jd"), 1, LL2NUM(days + SSTABLE_UNIX_EPOCH_JD));
+        }
+        case SSTABLE_TYPE_TIME:
+            if (length != 8) {
+                rb_raise(rb_eIOError, "Invalid time value of %zu bytes", length);
+            }
+            return LL2NUM((long long)sstable_read_be(bytes, 8));
+        case SSTABLE_TYPE_UUID:
+        case SSTABLE_TYPE_TIMEUUID: {
+            // The driver's layout: time_low, time_mid and time_hi_and_version
+            // from the low bits up
+            uint64_t msb = sstable_read_be(bytes, 8);
+            CassUuid uuid;
+            uuid.time_and_version = ((msb & 0xffff) << 48) | (((msb >> 16) & 0xffff) << 32) | (msb >> 32);
+            uuid.clock_seq_and_node = sstable_read_be(bytes + 8, 8);
+            return uuid_to_ruby(uuid);
+        }
+        case SSTABLE_TYPE_INET: {
+            char text[INET6_ADDRSTRLEN];
+            if ((length != 4 && length != 16) ||
+                !inet_ntop(length == 4 ? AF_INET : AF_INET6, bytes, text, sizeof(text))) {
+                rb_raise(rb_eIOError, "Invalid inet value of %zu bytes", length);
+            }
+            return rb_str_new_cstr(text);
+        }
+    }
+    
+    return rb_str_new(bytes, (long)length);
+}
+
+static int sstable_compare_bytes(const std::string& left, const std::string& right) {
+    int rc = memcmp(left.data(), right.data(), std::min(left.size(), right.size()));
+    if (rc != 0) {
+        return rc < 0 ? -1 : 1;
+    }
+    return left.size() == right.size() ? 0 : (left.size() < right.size() ? -1 : 1);
+}
+
+static int sstable_compare_signed(int64_t left, int64_t right) {
+    return left < right ? -1 : (left > right ? 1 : 0);
+}
+
+// Java's Double.compare: -0.0 before 0.0, NaN after everything
+static int sstable_compare_doubles(double left, double right) {
+    if (left < right) {
+        return -1;
+    }
+    if (left > right) {
+        return 1;
+    }
+    
+    int64_t left_bits, right_bits;
+    double canonical_nan = NAN;
+    memcpy(&left_bits, isnan(left) ? &canonical_nan : &left, sizeof(left_bits));
+    memcpy(&right_bits, isnan(right) ? &canonical_nan : &right, sizeof(right_bits));
+    return sstable_compare_signed(left_bits, right_bits);
+}
+
+// Time-based UUIDs' most significant bits rearranged to time_hi, time_mid, time_low
+static int64_t sstable_timeuuid_msb(uint64_t msb) {
+    return (int64_t)((msb << 48) | ((msb << 16) & 0xFFFF00000000ULL) | (msb >> 32));
+}
+
+static int sstable_compare_uuids(const sstable_type_t* type, const std::string& left, const std::string& right) {
+    uint64_t left_msb = sstable_read_be(left.data(), 8);
+    uint64_t right_msb = sstable_read_be(right.data(), 8);
+    uint64_t left_lsb = sstable_read_be(left.data() + 8, 8);
+    uint64_t right_lsb = sstable_read_be(right.data() + 8, 8);
+    
+    if (type->kind == SSTABLE_TYPE_TIMEUUID) {
+        int rc = sstable_compare_signed(sstable_timeuuid_msb(left_msb), sstable_timeuuid_msb(right_msb));
+        if (rc != 0) {
+            return rc;
+        }
+        // Signed comparison of each byte
+        return sstable_compare_signed((int64_t)(left_lsb ^ 0x0080808080808080ULL),
+                                      (int64_t)(right_lsb ^ 0x0080808080808080ULL));
+    }
+    
+    // UUIDType: by version, then by time for version 1, then unsigned
+    int left_version = (int)((left_msb >> 12) & 0xf);
+    int right_version = (int)((right_msb >> 12) & 0xf);
+    if (left_version != right_version) {
+        return left_version < right_version ? -1 : 1;
+    }
+    if (left_version == 1) {
+        int rc = sstable_compare_signed(sstable_timeuuid_msb(left_msb), sstable_timeuuid_msb(right_msb));
+        if (rc != 0) {
+            return rc;
+        }
+    } else if (left_msb != right_msb) {
+        return left_msb < right_msb ? -1 : 1;
+    }
+    return left_lsb == right_lsb ? 0 : (left_lsb < right_lsb ? -1 : 1);
+}
+
+// Varints of the same sign compare as bytes once sign-extended to one length
+static int sstable_compare_varints(const std::string& left, const std::string& right) {
+    bool left_negative = (unsigned char)left[0] & 0x80;
+    bool right_negative = (unsigned char)right[0] & 0x80;
+    if (left_negative != right_negative) {
+        return left_negative ? -1 : 1;
+    }
+    
+    size_t length = std::max(left.size(), right.size());
+    char fill = left_negative ? (char)0xff : 0;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char l = (unsigned char)(i < length - left.size() ? fill : left[i - (length - left.size())]);
+        unsigned char r = (unsigned char)(i < length - right.size() ? fill : right[i - (length - right.size())]);
+        if (l != r) {
+            return l < r ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+// Order of two encoded values of type, as Cassandra sorts clustering
+// columns in ascending order. Empty values sort first. Decimals have no
+// ordering here; the writer refuses them as clustering columns.
+int sstable_compare_values(const sstable_type_t* type, const std::string& left, const std::string& right) {
+    if (left.empty() || right.empty()) {
+        return left.empty() ? (right.empty() ? 0 : -1) : 1;
+    }
+    
+    switch (type->kind) {
+        case SSTABLE_TYPE_TINYINT:
+        case SSTABLE_TYPE_SMALLINT:
+        case SSTABLE_TYPE_INT:
+        case SSTABLE_TYPE_BIGINT:
+        case SSTABLE_TYPE_TIMESTAMP: {
+            int width = (int)left.size();
+            return sstable_compare_signed(sstable_sign_extend(sstable_read_be(left.data(), width), width),
+                                          sstable_sign_extend(sstable_read_be(right.data(), width), width));
+        }
+        case SSTABLE_TYPE_FLOAT: {
+            uint32_t left_bits = (uint32_t)sstable_read_be(left.data(), 4);
+            uint32_t right_bits = (uint32_t)sstable_read_be(right.data(), 4);
+            float l, r;
+            memcpy(&l, &left_bits, sizeof(l));
+            memcpy(&r, &right_bits, sizeof(r));
+            return sstable_compare_doubles(l, r);
+        }
+        case SSTABLE_TYPE_DOUBLE: {
+            uint64_t left_bits = sstable_read_be(left.data(), 8);
+            uint64_t right_bits = sstable_read_be(right.data(), 8);
+            double l, r;
+            memcpy(&l, &left_bits, sizeof(l));
+            memcpy(&r, &right_bits, sizeof(r));
+            return sstable_compare_doubles(l, r);
+        }
+        case SSTABLE_TYPE_UUID:
+        case SSTABLE_TYPE_TIMEUUID:
+            return sstable_compare_uuids(type, left, right);
+        case SSTABLE_TYPE_VARINT:
+            return sstable_compare_varints(left, right);
+        default:
+            return sstable_compare_bytes(left, right);
+    }
+}
+
+// Cassandra's unsigned vint: the count of extra bytes in the leading one
+// bits of the first byte, then the value big-endian
+void sstable_write_vint(std::string* out, uint64_t value) {
+    int magnitude = __builtin_clzll(value | 1);
+    int size = (639 - magnitude * 9) >> 6;
+    
+    if (size == 1) {
+        out->push_back((char)value);
+        return;
+    }
+    
+    char bytes[9];
+    for (int i = size - 1; i >= 0; i--) {
+        bytes[i] = (char)(value & 0xff);
+        value >>= 8;
+    }
+    bytes[0] = (char)((unsigned char)bytes[0] | (unsigned char)~(0xff >> (size - 1)));
+    out->append(bytes, (size_t)size);
+}
+
+static inline uint64_t sstable_rotl64(uint64_t value, int shift) {
+    return (value << shift) | (value >> (64 - shift));
+}
+
+static inline uint64_t sstable_fmix64(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+static inline uint64_t sstable_le64(const unsigned char* bytes) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; i--) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+// A tail byte as Cassandra reads it: sign-extended, unlike reference Murmur3
+static inline uint64_t sstable_tail(const unsigned char* tail, int index, int shift) {
+    return (uint64_t)(int64_t)(int8_t)tail[index] << shift;
+}
+
+// MurmurHash3 x64 128 with seed 0, as Cassandra's Murmur3Partitioner and
+// Bloom filters compute it
+void sstable_murmur3_hash(const char* bytes, size_t length, uint64_t hash[2]) {
+    const unsigned char* data = (const unsigned char*)bytes;
+    const uint64_t c1 = 0x87c37b91114253d5ULL;
+    const uint64_t c2 = 0x4cf5ad432745937fULL;
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+    
+    size_t blocks = length / 16;
+    for (size_t i = 0; i < blocks; i++) {
+        uint64_t k1 = sstable_le64(data + i * 16);
+        uint64_t k2 = sstable_le64(data + i * 16 + 8);
+        
+        k1 *= c1; k1 = sstable_rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+        h1 = sstable_rotl64(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52dce729;
+        k2 *= c2; k2 = sstable_rotl64(k2, 33); k2 *= c1; h2 ^= k2;
+        h2 = sstable_rotl64(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495ab5;
+    }
+    
+    const unsigned char* tail = data + blocks * 16;
+    uint64_t k1 = 0;
+    uint64_t k2 = 0;
+    switch (length & 15) {
+        case 15: k2 ^= sstable_tail(tail, 14, 48);  // fall through
+        case 14: k2 ^= sstable_tail(tail, 13, 40);  // fall through
+        case 13: k2 ^= sstable_tail(tail, 12, 32);  // fall through
+        case 12: k2 ^= sstable_tail(tail, 11, 24);  // fall through
+        case 11: k2 ^= sstable_tail(tail, 10, 16);  // fall through
+        case 10: k2 ^= sstable_tail(tail, 9, 8);    // fall through
+        case 9:
+            k2 ^= sstable_tail(tail, 8, 0);
+            k2 *= c2; k2 = sstable_rotl64(k2, 33); k2 *= c1; h2 ^= k2;  // fall through
+        case 8: k1 ^= sstable_tail(tail, 7, 56);  // fall through
+        case 7: k1 ^= sstable_tail(tail, 6, 48);  // fall through
+        case 6: k1 ^= sstable_tail(tail, 5, 40);  // fall through
+        case 5: k1 ^= sstable_tail(tail, 4, 32);  // fall through
+        case 4: k1 ^= sstable_tail(tail, 3, 24);  // fall through
+        case 3: k1 ^= sstable_tail(tail, 2, 16);  // fall through
+        case 2: k1 ^= sstable_tail(tail, 1, 8);   // fall through
+        case 1:
+            k1 ^= sstable_tail(tail, 0, 0);
+            k1 *= c1; k1 = sstable_rotl64(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+    
+    h1 ^= length;
+    h2 ^= length;
+    h1 += h2;
+    h2 += h1;
+    h1 = sstable_fmix64(h1);
+    h2 = sstable_fmix64(h2);
+    h1 += h2;
+    h2 += h1;
+    
+    hash[0] = h1;
+    hash[1] = h2;
+}
+
+// MurmurHash2 64-bit with seed 0 (with the same sign-extended tail), which
+// Cassandra feeds its partition cardinality estimator
+uint64_t sstable_murmur2_hash64(const char* bytes, size_t length) {
+    const unsigned char* data = (const unsigned char*)bytes;
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    uint64_t h = m * length;
+    
+    size_t words = length / 8;
+    for (size_t i = 0; i < words; i++) {
+        uint64_t k = sstable_le64(data + i * 8);
+        k *= m;
+        k ^= k >> 47;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+    
+    const unsigned char* tail = data + words * 8;
+    switch (length & 7) {
+        case 7: h ^= sstable_tail(tail, 6, 48);  // fall through
+        case 6: h ^= sstable_tail(tail, 5, 40);  // fall through
+        case 5: h ^= sstable_tail(tail, 4, 32);  // fall through
+        case 4: h ^= sstable_tail(tail, 3, 24);  // fall through
+        case 3: h ^= sstable_tail(tail, 2, 16);  // fall through
+        case 2: h ^= sstable_tail(tail, 1, 8);   // fall through
+        case 1:
+            h ^= sstable_tail(tail, 0, 0);
+            h *= m;
+    }
+    
+    h ^= h >> 47;
+    h *= m;
+    h ^= h >> 47;
+    return h;
+}
+
+// Murmur3Partitioner token of a hashed key; INT64_MIN is reserved for the ring's minimum
+int64_t sstable_token(const uint64_t hash[2]) {
+    int64_t token = (int64_t)hash[0];
+    return token == INT64_MIN ? INT64_MAX : token;
+}
\ No newline at end of file
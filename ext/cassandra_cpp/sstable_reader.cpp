@@ -0,0 +1,1548 @@
+#include "cassandra_cpp.h"
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Offline SSTable reader: iterates the live rows of one BIG-format SSTable
+// (Cassandra 3.0 to 4.1, versions "ma" to "nb") straight from its
+// memory-mapped Data.db, for analytics on snapshots without touching the
+// cluster. Statistics.db supplies the column types and names;
+// CompressionInfo.db, when present, the chunks to decompress (LZ4, Snappy,
+// Deflate or none, each verified against its CRC32).
+//
+// Deletions and expiry are applied within the file: partition deletions,
+// range tombstones, row deletions, collection deletions, cell tombstones,
+// and TTLs expired at the given time. Shadowing by data in other SSTables
+// is not; read a compacted (or single-SSTable) snapshot for exact results.
+//
+// Values decode to the Ruby objects a query returns. Each SSTable is read
+// independently, so a snapshot splits across processes by file.
+
+// Range tombstone bound kinds that close one deletion and open another
+#define SSTABLE_EXCL_END_INCL_START_BOUNDARY 2
+#define SSTABLE_INCL_END_EXCL_START_BOUNDARY 5
+#define SSTABLE_INCL_START_BOUND 1
+#define SSTABLE_EXCL_START_BOUND 7
+
+#define SSTABLE_LIVE INT64_MIN  // Deletion timestamp that deletes nothing
+
+typedef enum {
+    SSTABLE_VALUE_SCALAR,
+    SSTABLE_VALUE_LIST,
+    SSTABLE_VALUE_SET,
+    SSTABLE_VALUE_MAP,
+    SSTABLE_VALUE_TUPLE,
+    SSTABLE_VALUE_UDT,
+    SSTABLE_VALUE_COMPOSITE,
+    SSTABLE_VALUE_DURATION,
+    SSTABLE_VALUE_COUNTER,
+    SSTABLE_VALUE_EMPTY,
+    SSTABLE_VALUE_BYTES  // Types without a decoder (custom types) read as raw bytes
+} sstable_value_kind_t;
+
+typedef enum {
+    SSTABLE_COMPRESSION_NONE,
+    SSTABLE_COMPRESSION_LZ4,
+    SSTABLE_COMPRESSION_SNAPPY,
+    SSTABLE_COMPRESSION_DEFLATE
+} sstable_compression_t;
+
+// A marshal type; parameters are indexes into the reader's type list
+typedef struct {
+    sstable_value_kind_t kind;
+    const sstable_type_t* scalar;
+    bool multi_cell;  // Non-frozen collection or UDT, stored as one cell per element
+    int fixed_length;
+    std::vector<size_t> params;
+    std::vector<std::string> fields;  // UDT field names
+} sstable_marshal_t;
+
+typedef struct {
+    std::string name;
+    size_t type;
+} sstable_read_column_t;
+
+typedef struct {
+    const char* map;
+    size_t map_size;
+    VALUE path;
+    VALUE names;          // Frozen column names in row order
+    VALUE key_values;     // Partition key of the current partition
+    VALUE static_values;  // Static columns of the current partition
+    VALUE row_values;     // Clustering and regular columns of the current row
+    char version[3];
+    
+    // Compressed files: Data.db holds chunks of chunk_length bytes, each
+    // compressed and followed by the CRC32 of the compressed bytes
+    sstable_compression_t compression;
+    uint32_t chunk_length;
+    uint32_t max_compressed_length;
+    uint64_t data_length;
+    std::vector<uint64_t>* chunk_offsets;
+    std::string* chunk;
+    size_t next_chunk;
+    
+    // Read position: a window of the uncompressed data (all of it for
+    // uncompressed files, one chunk otherwise)
+    const char* window;
+    const char* cursor;
+    const char* limit;
+    uint64_t window_start;
+    std::string* straddle;  // Reads spanning chunks are copied here
+    
+    // Serialization header
+    int64_t min_timestamp;
+    int32_t min_deletion_time;
+    int32_t min_ttl;
+    std::vector<sstable_marshal_t>* types;
+    size_t key_type;
+    std::vector<size_t>* clustering_types;
+    std::vector<sstable_read_column_t>* statics;
+    std::vector<sstable_read_column_t>* regulars;
+    std::vector<char>* present;
+    std::string* cell_path;
+    std::string* key;
+    
+    bool iterating;
+} sstable_reader_t;
+
+static VALUE rb_cNativeSSTableReader;
+
+static void sstable_reader_unmap(sstable_reader_t* reader) {
+    if (reader->map) {
+        munmap((void*)reader->map, reader->map_size);
+        reader->map = NULL;
+    }
+}
+
+static void sstable_reader_mark(void* ptr) {
+    sstable_reader_t* reader = (sstable_reader_t*)ptr;
+    rb_gc_mark(reader->path);
+    rb_gc_mark(reader->names);
+    rb_gc_mark(reader->key_values);
+    rb_gc_mark(reader->static_values);
+    rb_gc_mark(reader->row_values);
+}
+
+static void sstable_reader_free(void* ptr) {
+    sstable_reader_t* reader = (sstable_reader_t*)ptr;
+    sstable_reader_unmap(reader);
+    delete reader->chunk_offsets;
+    delete reader->chunk;
+    delete reader->straddle;
+    delete reader->types;
+    delete reader->clustering_types;
+    delete reader->statics;
+    delete reader->regulars;
+    delete reader->present;
+    delete reader->cell_path;
+    delete reader->key;
+    xfree(reader);
+}
+
+static size_t sstable_reader_memsize(const void* ptr) {
+    // The mapping is shared page cache, not process heap
+    const sstable_reader_t* reader = (const sstable_reader_t*)ptr;
+    return sizeof(sstable_reader_t) + (reader->chunk ? reader->chunk->capacity() : 0);
+}
+
+static const rb_data_type_t sstable_reader_type = {
+    "CassandraCpp::NativeSSTableReader",
+    { sstable_reader_mark, sstable_reader_free, sstable_reader_memsize },
+    0, 0,
+    RUBY_TYPED_FREE_IMMEDIATELY
+};
+
+static sstable_reader_t* sstable_reader_get(VALUE self) {
+    sstable_reader_t* reader;
+    TypedData_Get_Struct(self, sstable_reader_t, &sstable_reader_type, reader);
+    
+    if (!reader->map) {
+        rb_raise(rb_eIOError, "SSTable reader is closed");
+    }
+    
+    return reader;
+}
+
+static void sstable_corrupt(const sstable_reader_t* reader, const char* what) {
+    rb_raise(rb_eIOError, "Corrupt SSTable %" PRIsVALUE ": %s", reader->path, what);
+}
+
+// Bounded reads from an in-memory buffer (metadata components, values)
+typedef struct {
+    const char* cursor;
+    const char* limit;
+    const sstable_reader_t* reader;
+} sstable_buffer_t;
+
+static const char* sstable_buffer_read(sstable_buffer_t* buffer, size_t length) {
+    if ((size_t)(buffer->limit - buffer->cursor) < length) {
+        sstable_corrupt(buffer->reader, "truncated metadata or value");
+    }
+    const char* bytes = buffer->cursor;
+    buffer->cursor += length;
+    return bytes;
+}
+
+static uint64_t sstable_buffer_be(sstable_buffer_t* buffer, int length) {
+    return sstable_read_be(sstable_buffer_read(buffer, (size_t)length), (size_t)length);
+}
+
+static uint64_t sstable_buffer_vint(sstable_buffer_t* buffer) {
+    unsigned char first = (unsigned char)*sstable_buffer_read(buffer, 1);
+    int extra = __builtin_clz(~((unsigned)first << 24) | 0x7f);
+    uint64_t value = extra == 8 ? 0 : (uint64_t)(first & (0xff >> extra));
+    for (int i = 0; i < extra; i++) {
+        value = (value << 8) | (unsigned char)*sstable_buffer_read(buffer, 1);
+    }
+    return value;
+}
+
+// Read a whole (small) component file; false with errno set on failure
+static bool sstable_read_file(const char* path, std::string* out) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    
+    char buffer[65536];
+    size_t count;
+    out->clear();
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        out->append(buffer, count);
+    }
+    bool failed = ferror(file) != 0;
+    int saved_errno = errno;
+    fclose(file);
+    errno = saved_errno;
+    return !failed;
+}
+
+// LZ4 block format; false on malformed input
+static bool sstable_lz4_decompress(const unsigned char* input, size_t input_length, char* output,
+                                   size_t output_length) {
+    const unsigned char* in = input;
+    const unsigned char* in_end = input + input_length;
+    char* out = output;
+    char* out_end = output + output_length;
+    
+    while (in < in_end) {
+        unsigned token = *in++;
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            unsigned char more;
+            do {
+                if (in >= in_end) {
+                    return false;
+                }
+                more = *in++;
+                literals += more;
+            } while (more == 255);
+        }
+        if ((size_t)(in_end - in) < literals || (size_t)(out_end - out) < literals) {
+            return false;
+        }
+        memcpy(out, in, literals);
+        in += literals;
+        out += literals;
+        if (in >= in_end) {
+            break;  // The last sequence has literals only
+        }
+        
+        if (in_end - in < 2) {
+            return false;
+        }
+        size_t offset = (size_t)in[0] | ((size_t)in[1] << 8);
+        in += 2;
+        if (offset == 0 || offset > (size_t)(out - output)) {
+            return false;
+        }
+        size_t match = token & 15;
+        if (match == 15) {
+            unsigned char more;
+            do {
+                if (in >= in_end) {
+                    return false;
+                }
+                more = *in++;
+                match += more;
+            } while (more == 255);
+        }
+        match += 4;
+        if ((size_t)(out_end - out) < match) {
+            return false;
+        }
+        const char* from = out - offset;
+        for (size_t i = 0; i < match; i++) {
+            out[i] = from[i];  // Byte by byte: matches may overlap their output
+        }
+        out += match;
+    }
+    
+    return out == out_end;
+}
+
+// Snappy raw format: varint length, then literal and copy elements
+static bool sstable_snappy_decompress(const unsigned char* input, size_t input_length, char* output,
+                                      size_t output_length) {
+    const unsigned char* in = input;
+    const unsigned char* in_end = input + input_length;
+    uint64_t length = 0;
+    for (int shift = 0; ; shift += 7) {
+        if (in >= in_end || shift > 28) {
+            return false;
+        }
+        length |= (uint64_t)(*in & 0x7f) << shift;
+        if (!(*in++ & 0x80)) {
+            break;
+        }
+    }
+    if (length != output_length) {
+        return false;
+    }
+    
+    char* out = output;
+    char* out_end = output + output_length;
+    while (in < in_end) {
+        unsigned tag = *in++;
+        size_t copy_length;
+        size_t offset;
+        switch (tag & 3) {
+            case 0: {
+                size_t literal = tag >> 2;
+                if (literal >= 60) {
+                    int bytes = (int)literal - 59;
+                    if (in_end - in < bytes) {
+                        return false;
+                    }
+                    literal = 0;
+                    for (int i = 0; i < bytes; i++) {
+                        literal |= (size_t)in[i] << (8 * i);
+                    }
+                    in += bytes;
+                }
+                literal++;
+                if ((size_t)(in_end - in) < literal || (size_t)(out_end - out) < literal) {
+                    return false;
+                }
+                memcpy(out, in, literal);
+                in += literal;
+                out += literal;
+                continue;
+            }
+            case 1:
+                if (in >= in_end) {
+                    return false;
+                }
+                copy_length = 4 + ((tag >> 2) & 7);
+                offset = ((size_t)(tag >> 5) << 8) | *in++;
+                break;
+            case 2:
+                if (in_end - in < 2) {
+                    return false;
+                }
+                copy_length = 1 + (tag >> 2);
+                offset = (size_t)in[0] | ((size_t)in[1] << 8);
+                in += 2;
+                break;
+            default:
+                if (in_end - in < 4) {
+                    return false;
+                }
+                copy_length = 1 + (tag >> 2);
+                offset = (size_t)in[0] | ((size_t)in[1] << 8) | ((size_t)in[2] << 16) | ((size_t)in[3] << 24);
+                in += 4;
+                break;
+        }
+        if (offset == 0 || offset > (size_t)(out - output) || (size_t)(out_end - out) < copy_length) {
+            return false;
+        }
+        const char* from = out - offset;
+        for (size_t i = 0; i < copy_length; i++) {
+            out[i] = from[i];
+        }
+        out += copy_length;
+    }
+    
+    return out == out_end;
+}
+
+// Decompress the next chunk into the window
+static void sstable_load_chunk(sstable_reader_t* reader) {
+    const std::vector<uint64_t>& offsets = *reader->chunk_offsets;
+    size_t index = reader->next_chunk;
+    uint64_t start = offsets[index];
+    uint64_t end = index + 1 < offsets.size() ? offsets[index + 1] : reader->map_size;
+    if (end > reader->map_size || end < start + 4) {
+        sstable_corrupt(reader, "chunk offsets out of range");
+    }
+    
+    const unsigned char* compressed = (const unsigned char*)reader->map + start;
+    size_t compressed_length = (size_t)(end - start - 4);
+    uint32_t stored_crc = ((uint32_t)compressed[compressed_length] << 24) |
+                          ((uint32_t)compressed[compressed_length + 1] << 16) |
+                          ((uint32_t)compressed[compressed_length + 2] << 8) | compressed[compressed_length + 3];
+    if (crc32_update(0, compressed, compressed_length) != stored_crc) {
+        sstable_corrupt(reader, "chunk checksum mismatch");
+    }
+    
+    uint64_t chunk_start = (uint64_t)index * reader->chunk_length;
+    size_t length = (size_t)std::min((uint64_t)reader->chunk_length, reader->data_length - chunk_start);
+    reader->chunk->resize(length);
+    char* out = &(*reader->chunk)[0];
+    
+    bool ok;
+    if (compressed_length >= reader->max_compressed_length || reader->compression == SSTABLE_COMPRESSION_NONE) {
+        // Stored as is: compressing it would not have saved enough
+        ok = compressed_length == length;
+        if (ok) {
+            memcpy(out, compressed, length);
+        }
+    } else if (reader->compression == SSTABLE_COMPRESSION_LZ4) {
+        // Four-byte little-endian uncompressed length, then one LZ4 block
+        ok = compressed_length >= 4 &&
+             ((size_t)compressed[0] | ((size_t)compressed[1] << 8) | ((size_t)compressed[2] << 16) |
+              ((size_t)compressed[3] << 24)) == length &&
+             sstable_lz4_decompress(compressed + 4, compressed_length - 4, out, length);
+    } else if (reader->compression == SSTABLE_COMPRESSION_SNAPPY) {
+        ok = sstable_snappy_decompress(compressed, compressed_length, out, length);
+    } else {
+        uLongf out_length = (uLongf)length;
+        ok = uncompress((Bytef*)out, &out_length, compressed, (uLong)compressed_length) == Z_OK &&
+             out_length == length;
+    }
+    if (!ok) {
+        sstable_corrupt(reader, "chunk does not decompress");
+    }
+    
+    reader->window = reader->chunk->data();
+    reader->cursor = reader->window;
+    reader->limit = reader->window + length;
+    reader->window_start = chunk_start;
+    reader->next_chunk++;
+}
+
+static uint64_t sstable_position(const sstable_reader_t* reader) {
+    return reader->window_start + (uint64_t)(reader->cursor - reader->window);
+}
+
+static bool sstable_more_data(sstable_reader_t* reader) {
+    return sstable_position(reader) < reader->data_length;
+}
+
+// length bytes at the read position; valid until the next read
+static const char* sstable_read(sstable_reader_t* reader, size_t length) {
+    while (reader->cursor == reader->limit && reader->next_chunk < reader->chunk_offsets->size()) {
+        sstable_load_chunk(reader);
+    }
+    if ((size_t)(reader->limit - reader->cursor) >= length) {
+        const char* bytes = reader->cursor;
+        reader->cursor += length;
+        return bytes;
+    }
+    if (reader->chunk_offsets->empty() || length > reader->data_length - sstable_position(reader)) {
+        sstable_corrupt(reader, "unexpected end of data");
+    }
+    
+    reader->straddle->clear();
+    while (length > 0) {
+        if (reader->cursor == reader->limit) {
+            sstable_load_chunk(reader);
+        }
+        size_t part = std::min(length, (size_t)(reader->limit - reader->cursor));
+        reader->straddle->append(reader->cursor, part);
+        reader->cursor += part;
+        length -= part;
+    }
+    return reader->straddle->data();
+}
+
+static uint64_t sstable_next_be(sstable_reader_t* reader, int length) {
+    return sstable_read_be(sstable_read(reader, (size_t)length), (size_t)length);
+}
+
+static uint64_t sstable_read_vint(sstable_reader_t* reader) {
+    unsigned char first = (unsigned char)*sstable_read(reader, 1);
+    int extra = __builtin_clz(~((unsigned)first << 24) | 0x7f);
+    uint64_t value = extra == 8 ? 0 : (uint64_t)(first & (0xff >> extra));
+    if (extra > 0) {
+        const char* bytes = sstable_read(reader, (size_t)extra);
+        for (int i = 0; i < extra; i++) {
+            value = (value << 8) | (unsigned char)bytes[i];
+        }
+    }
+    return value;
+}
+
+// Skip forward to position, which must not be behind the read position
+static void sstable_seek(sstable_reader_t* reader, uint64_t position) {
+    uint64_t current = sstable_position(reader);
+    if (position < current || position > reader->data_length) {
+        sstable_corrupt(reader, "row size does not match its contents");
+    }
+    uint64_t skip = position - current;
+    while (skip > 0) {
+        size_t part = (size_t)std::min(skip, (uint64_t)SIZE_MAX);
+        size_t available = (size_t)(reader->limit - reader->cursor);
+        if (available == 0) {
+            sstable_read(reader, 0);
+            available = (size_t)(reader->limit - reader->cursor);
+            if (available == 0) {
+                sstable_corrupt(reader, "unexpected end of data");
+            }
+        }
+        part = std::min(part, available);
+        reader->cursor += part;
+        skip -= part;
+    }
+}
+
+// Delta-encoded times, relative to the minimums in the serialization header
+static int64_t sstable_read_timestamp(sstable_reader_t* reader) {
+    return (int64_t)(sstable_read_vint(reader) + (uint64_t)reader->min_timestamp);
+}
+
+static int32_t sstable_read_deletion_time(sstable_reader_t* reader) {
+    return (int32_t)((uint32_t)sstable_read_vint(reader) + (uint32_t)reader->min_deletion_time);
+}
+
+static int32_t sstable_read_ttl(sstable_reader_t* reader) {
+    return (int32_t)((uint32_t)sstable_read_vint(reader) + (uint32_t)reader->min_ttl);
+}
+
+static size_t sstable_add_type(sstable_reader_t* reader, sstable_value_kind_t kind, const sstable_type_t* scalar,
+                               bool multi_cell) {
+    sstable_marshal_t type;
+    type.kind = kind;
+    type.scalar = scalar;
+    type.multi_cell = multi_cell;
+    type.fixed_length = scalar ? scalar->fixed_length : (kind == SSTABLE_VALUE_EMPTY ? 0 : -1);
+    reader->types->push_back(type);
+    return reader->types->size() - 1;
+}
+
+// End of the type parameter starting at text: the next comma outside
+// parentheses, or end
+static const char* sstable_param_end(const char* text, const char* end) {
+    int depth = 0;
+    for (; text < end; text++) {
+        if (*text == '(') {
+            depth++;
+        } else if (*text == ')') {
+            depth--;
+        } else if (*text == ',' && depth == 0) {
+            break;
+        }
+    }
+    return text;
+}
+
+static bool sstable_unhex(const char* text, size_t length, std::string* out) {
+    if (length % 2 != 0) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i += 2) {
+        int value = 0;
+        for (size_t j = i; j < i + 2; j++) {
+            char c = text[j];
+            int nibble = c >= '0' && c <= '9' ? c - '0' : (c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+                         (c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1));
+            if (nibble < 0) {
+                return false;
+            }
+            value = value * 16 + nibble;
+        }
+        out->push_back((char)value);
+    }
+    return true;
+}
+
+static bool sstable_name_is(const char* name, size_t length, const char* expected) {
+    return length == strlen(expected) && memcmp(name, expected, length) == 0;
+}
+
+// Parse a marshal type name such as
+// "org.apache.cassandra.db.marshal.MapType(...UTF8Type,...Int32Type)"
+static size_t sstable_parse_type(sstable_reader_t* reader, const char* text, size_t length, bool frozen) {
+    while (length > 0 && *text == ' ') {
+        text++;
+        length--;
+    }
+    while (length > 0 && text[length - 1] == ' ') {
+        length--;
+    }
+    
+    const char* paren = (const char*)memchr(text, '(', length);
+    size_t name_length = paren ? (size_t)(paren - text) : length;
+    const char* name = text;
+    const char* dot = (const char*)memrchr(text, '.', name_length);
+    if (dot) {
+        name_length -= (size_t)(dot + 1 - text);
+        name = dot + 1;
+    }
+    const char* inner = paren ? paren + 1 : NULL;
+    const char* inner_end = text + length - 1;
+    if (paren && *inner_end != ')') {
+        sstable_corrupt(reader, "malformed column type");
+    }
+    
+    if (sstable_name_is(name, name_length, "ReversedType") || sstable_name_is(name, name_length, "FrozenType")) {
+        if (!paren) {
+            sstable_corrupt(reader, "malformed column type");
+        }
+        return sstable_parse_type(reader, inner, (size_t)(inner_end - inner),
+                                  frozen || sstable_name_is(name, name_length, "FrozenType"));
+    }
+    
+    sstable_value_kind_t kind;
+    size_t first_param = 0;
+    size_t expected_params = 0;  // 0 for any number
+    if (sstable_name_is(name, name_length, "ListType")) {
+        kind = SSTABLE_VALUE_LIST;
+        expected_params = 1;
+    } else if (sstable_name_is(name, name_length, "SetType")) {
+        kind = SSTABLE_VALUE_SET;
+        expected_params = 1;
+    } else if (sstable_name_is(name, name_length, "MapType")) {
+        kind = SSTABLE_VALUE_MAP;
+        expected_params = 2;
+    } else if (sstable_name_is(name, name_length, "TupleType")) {
+        kind = SSTABLE_VALUE_TUPLE;
+    } else if (sstable_name_is(name, name_length, "UserType")) {
+        kind = SSTABLE_VALUE_UDT;
+        first_param = 2;  // Keyspace and hex-encoded type name
+    } else if (sstable_name_is(name, name_length, "CompositeType")) {
+        kind = SSTABLE_VALUE_COMPOSITE;
+    } else if (sstable_name_is(name, name_length, "DurationType")) {
+        return sstable_add_type(reader, SSTABLE_VALUE_DURATION, NULL, false);
+    } else if (sstable_name_is(name, name_length, "CounterColumnType")) {
+        return sstable_add_type(reader, SSTABLE_VALUE_COUNTER, NULL, false);
+    } else if (sstable_name_is(name, name_length, "EmptyType")) {
+        return sstable_add_type(reader, SSTABLE_VALUE_EMPTY, NULL, false);
+    } else {
+        const sstable_type_t* scalar = sstable_type_from_marshal(name, name_length);
+        return sstable_add_type(reader, scalar ? SSTABLE_VALUE_SCALAR : SSTABLE_VALUE_BYTES, scalar, false);
+    }
+    if (!paren) {
+        sstable_corrupt(reader, "malformed column type");
+    }
+    
+    // Elements of collections and fields of tuples and UDTs are frozen.
+    // Parameters are parsed into the type in place; the type list may grow
+    // meanwhile, so it is indexed afresh each time.
+    bool collection = expected_params > 0;
+    size_t index = sstable_add_type(reader, kind, NULL, !frozen && (collection || kind == SSTABLE_VALUE_UDT));
+    size_t position = 0;
+    for (const char* param = inner; param < inner_end; position++) {
+        const char* param_end = sstable_param_end(param, inner_end);
+        if (position >= first_param) {
+            if (kind == SSTABLE_VALUE_UDT) {
+                const char* colon = (const char*)memchr(param, ':', (size_t)(param_end - param));
+                (*reader->types)[index].fields.push_back(std::string());
+                while (param < param_end && *param == ' ') {
+                    param++;
+                }
+                if (!colon || !sstable_unhex(param, (size_t)(colon - param), &(*reader->types)[index].fields.back())) {
+                    sstable_corrupt(reader, "malformed user type");
+                }
+                param = colon + 1;
+            }
+            size_t child = sstable_parse_type(reader, param, (size_t)(param_end - param), true);
+            (*reader->types)[index].params.push_back(child);
+        }
+        param = param_end + 1;
+    }
+    if (expected_params > 0 && (*reader->types)[index].params.size() != expected_params) {
+        sstable_corrupt(reader, "malformed column type");
+    }
+    return index;
+}
+
+static void sstable_type_to_cql(const sstable_reader_t* reader, size_t index, VALUE out) {
+    const sstable_marshal_t& type = (*reader->types)[index];
+    const char* names[] = { "", "list", "set", "map", "tuple", "udt", "composite", "duration", "counter",
+                            "empty", "blob" };
+    
+    if (type.kind == SSTABLE_VALUE_SCALAR) {
+        rb_str_cat_cstr(out, type.scalar->cql_name);
+        return;
+    }
+    if (type.params.empty()) {
+        rb_str_cat_cstr(out, names[type.kind]);
+        return;
+    }
+    
+    bool frozen = !type.multi_cell && type.kind != SSTABLE_VALUE_TUPLE && type.kind != SSTABLE_VALUE_COMPOSITE;
+    if (frozen) {
+        rb_str_cat_cstr(out, "frozen<");
+    }
+    rb_str_cat_cstr(out, names[type.kind]);
+    rb_str_cat_cstr(out, "<");
+    for (size_t i = 0; i < type.params.size(); i++) {
+        if (i > 0) {
+            rb_str_cat_cstr(out, ", ");
+        }
+        if (type.kind == SSTABLE_VALUE_UDT) {
+            rb_str_cat(out, type.fields[i].data(), (long)type.fields[i].size());
+            rb_str_cat_cstr(out, " ");
+        }
+        sstable_type_to_cql(reader, type.params[i], out);
+    }
+    rb_str_cat_cstr(out, frozen ? ">>" : ">");
+}
+
+static VALUE sstable_decode(const sstable_reader_t* reader, size_t index, const char* bytes, size_t length);
+
+// Protocol v3+ element: int32 length (negative for null), then the bytes
+static VALUE sstable_decode_element(const sstable_reader_t* reader, size_t index, sstable_buffer_t* buffer) {
+    int32_t length = (int32_t)(uint32_t)sstable_buffer_be(buffer, 4);
+    if (length < 0) {
+        return Qnil;
+    }
+    const char* bytes = sstable_buffer_read(buffer, (size_t)length);
+    return sstable_decode(reader, index, bytes, (size_t)length);
+}
+
+static int64_t sstable_unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+// Ruby value of one stored value of the type at index, frozen form for
+// collections and UDTs
+static VALUE sstable_decode(const sstable_reader_t* reader, size_t index, const char* bytes, size_t length) {
+    const sstable_marshal_t& type = (*reader->types)[index];
+    sstable_buffer_t buffer = { bytes, bytes + length, reader };
+    
+    switch (type.kind) {
+        case SSTABLE_VALUE_SCALAR:
+            return sstable_decode_value(type.scalar, bytes, length);
+        case SSTABLE_VALUE_BYTES:
+            return rb_str_new(bytes, (long)length);
+        case SSTABLE_VALUE_EMPTY:
+            return Qnil;
+        case SSTABLE_VALUE_LIST:
+        case SSTABLE_VALUE_SET:
+        case SSTABLE_VALUE_MAP: {
+            if (length == 0) {
+                return Qnil;
+            }
+            int32_t count = (int32_t)(uint32_t)sstable_buffer_be(&buffer, 4);
+            if (count < 0) {
+                sstable_corrupt(reader, "negative collection size");
+            }
+            VALUE collection = type.kind == SSTABLE_VALUE_MAP ? rb_hash_new() : rb_ary_new_capa(count);
+            for (int32_t i = 0; i < count; i++) {
+                VALUE element = sstable_decode_element(reader, type.params[0], &buffer);
+                if (type.kind == SSTABLE_VALUE_MAP) {
+                    rb_hash_aset(collection, element, sstable_decode_element(reader, type.params[1], &buffer));
+                } else {
+                    rb_ary_push(collection, element);
+                }
+            }
+            if (type.kind == SSTABLE_VALUE_SET) {
+                return rb_funcall(rb_path2class("Set"), rb_intern("new"), 1, collection);
+            }
+            return collection;
+        }
+        case SSTABLE_VALUE_TUPLE:
+        case SSTABLE_VALUE_UDT: {
+            if (length == 0) {
+                return Qnil;
+            }
+            // Trailing fields added to a UDT after the value was written are absent
+            VALUE fields = type.kind == SSTABLE_VALUE_UDT ? rb_hash_new() : rb_ary_new_capa((long)type.params.size());
+            for (size_t i = 0; i < type.params.size(); i++) {
+                VALUE field = buffer.cursor < buffer.limit ? sstable_decode_element(reader, type.params[i], &buffer)
+                                                            : Qnil;
+                if (type.kind == SSTABLE_VALUE_UDT) {
+                    rb_hash_aset(fields, rb_str_new(type.fields[i].data(), (long)type.fields[i].size()), field);
+                } else {
+                    rb_ary_push(fields, field);
+                }
+            }
+            return fields;
+        }
+        case SSTABLE_VALUE_COMPOSITE: {
+            // Per component: unsigned short length, bytes, end-of-component byte
+            VALUE components = rb_ary_new_capa((long)type.params.size());
+            for (size_t i = 0; i < type.params.size(); i++) {
+                size_t component_length = (size_t)sstable_buffer_be(&buffer, 2);
+                const char* component = sstable_buffer_read(&buffer, component_length);
+                sstable_buffer_read(&buffer, 1);
+                rb_ary_push(components, sstable_decode(reader, type.params[i], component, component_length));
+            }
+            return components;
+        }
+        case SSTABLE_VALUE_DURATION: {
+            if (length == 0) {
+                return Qnil;
+            }
+            // [months, days, nanoseconds], each a zigzag-encoded vint
+            int64_t months = sstable_unzigzag(sstable_buffer_vint(&buffer));
+            int64_t days = sstable_unzigzag(sstable_buffer_vint(&buffer));
+            int64_t nanoseconds = sstable_unzigzag(sstable_buffer_vint(&buffer));
+            return rb_ary_new_from_args(3, LL2NUM(months), LL2NUM(days), LL2NUM(nanoseconds));
+        }
+        case SSTABLE_VALUE_COUNTER: {
+            if (length == 0) {
+                return Qnil;
+            }
+            // Counter context: a header of shard indexes, then 32-byte
+            // (counter id, clock, count) shards; the value is their sum
+            int16_t header_count = (int16_t)(uint16_t)sstable_buffer_be(&buffer, 2);
+            sstable_buffer_read(&buffer, (size_t)std::abs((int)header_count) * 2);
+            int64_t total = 0;
+            while (buffer.cursor < buffer.limit) {
+                sstable_buffer_read(&buffer, 24);
+                total += (int64_t)sstable_buffer_be(&buffer, 8);
+            }
+            return LL2NUM(total);
+        }
+    }
+    
+    return Qnil;
+}
+
+static void sstable_read_columns(sstable_reader_t* reader, sstable_buffer_t* buffer,
+                                 std::vector<sstable_read_column_t>* columns) {
+    uint64_t count = sstable_buffer_vint(buffer);
+    for (uint64_t i = 0; i < count; i++) {
+        size_t name_length = (size_t)sstable_buffer_vint(buffer);
+        const char* name = sstable_buffer_read(buffer, name_length);
+        size_t type_length = (size_t)sstable_buffer_vint(buffer);
+        const char* type = sstable_buffer_read(buffer, type_length);
+        
+        columns->push_back(sstable_read_column_t());
+        columns->back().name.assign(name, name_length);
+        size_t type_index = sstable_parse_type(reader, type, type_length, false);
+        columns->back().type = type_index;
+    }
+}
+
+// Statistics.db: component table of contents, then the serialization header
+static void sstable_read_statistics(sstable_reader_t* reader, const std::string& contents) {
+    sstable_buffer_t buffer = { contents.data(), contents.data() + contents.size(), reader };
+    uint32_t count = (uint32_t)sstable_buffer_be(&buffer, 4);
+    if (strcmp(reader->version, "na") >= 0) {
+        sstable_buffer_read(&buffer, 4);  // CRC32 of the count
+    }
+    
+    uint32_t header_offset = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t type = (uint32_t)sstable_buffer_be(&buffer, 4);
+        uint32_t offset = (uint32_t)sstable_buffer_be(&buffer, 4);
+        if (type == SSTABLE_METADATA_HEADER) {
+            header_offset = offset;
+        }
+    }
+    if (header_offset == 0 || header_offset >= contents.size()) {
+        sstable_corrupt(reader, "no serialization header in Statistics.db");
+    }
+    
+    buffer.cursor = contents.data() + header_offset;
+    reader->min_timestamp = (int64_t)(sstable_buffer_vint(&buffer) + (uint64_t)SSTABLE_TIMESTAMP_EPOCH);
+    reader->min_deletion_time = (int32_t)((uint32_t)sstable_buffer_vint(&buffer) + (uint32_t)SSTABLE_DELETION_TIME_EPOCH);
+    reader->min_ttl = (int32_t)(uint32_t)sstable_buffer_vint(&buffer);
+    
+    size_t key_length = (size_t)sstable_buffer_vint(&buffer);
+    const char* key_type = sstable_buffer_read(&buffer, key_length);
+    reader->key_type = sstable_parse_type(reader, key_type, key_length, true);
+    
+    uint64_t clustering_count = sstable_buffer_vint(&buffer);
+    for (uint64_t i = 0; i < clustering_count; i++) {
+        size_t type_length = (size_t)sstable_buffer_vint(&buffer);
+        const char* type = sstable_buffer_read(&buffer, type_length);
+        reader->clustering_types->push_back(sstable_parse_type(reader, type, type_length, true));
+    }
+    
+    sstable_read_columns(reader, &buffer, reader->statics);
+    sstable_read_columns(reader, &buffer, reader->regulars);
+}
+
+// CompressionInfo.db: compressor, chunk length and chunk offsets
+static void sstable_read_compression_info(sstable_reader_t* reader, const std::string& contents) {
+    sstable_buffer_t buffer = { contents.data(), contents.data() + contents.size(), reader };
+    size_t name_length = (size_t)sstable_buffer_be(&buffer, 2);
+    const char* name = sstable_buffer_read(&buffer, name_length);
+    const char* dot = (const char*)memrchr(name, '.', name_length);
+    if (dot) {
+        name_length -= (size_t)(dot + 1 - name);
+        name = dot + 1;
+    }
+    
+    if (sstable_name_is(name, name_length, "LZ4Compressor")) {
+        reader->compression = SSTABLE_COMPRESSION_LZ4;
+    } else if (sstable_name_is(name, name_length, "SnappyCompressor")) {
+        reader->compression = SSTABLE_COMPRESSION_SNAPPY;
+    } else if (sstable_name_is(name, name_length, "DeflateCompressor")) {
+        reader->compression = SSTABLE_COMPRESSION_DEFLATE;
+    } else if (sstable_name_is(name, name_length, "NoopCompressor")) {
+        reader->compression = SSTABLE_COMPRESSION_NONE;
+    } else {
+        rb_raise(rb_eArgError, "SSTable %" PRIsVALUE " is compressed with %.*s, which cannot be read "
+                 "(LZ4, Snappy, Deflate and uncompressed SSTables can)", reader->path, (int)name_length, name);
+    }
+    
+    uint32_t options = (uint32_t)sstable_buffer_be(&buffer, 4);
+    for (uint32_t i = 0; i < options * 2; i++) {
+        sstable_buffer_read(&buffer, (size_t)sstable_buffer_be(&buffer, 2));
+    }
+    reader->chunk_length = (uint32_t)sstable_buffer_be(&buffer, 4);
+    reader->max_compressed_length = INT32_MAX;
+    if (strcmp(reader->version, "na") >= 0) {
+        reader->max_compressed_length = (uint32_t)sstable_buffer_be(&buffer, 4);
+    }
+    reader->data_length = sstable_buffer_be(&buffer, 8);
+    uint32_t chunks = (uint32_t)sstable_buffer_be(&buffer, 4);
+    if (reader->chunk_length == 0 || (uint64_t)chunks * reader->chunk_length < reader->data_length) {
+        sstable_corrupt(reader, "chunk count does not cover the data");
+    }
+    
+    reader->chunk_offsets->reserve(chunks);
+    for (uint32_t i = 0; i < chunks; i++) {
+        reader->chunk_offsets->push_back(sstable_buffer_be(&buffer, 8));
+    }
+}
+
+static void sstable_rewind(sstable_reader_t* reader) {
+    reader->window_start = 0;
+    if (reader->chunk_offsets->empty()) {
+        reader->window = reader->map;
+        reader->limit = reader->map + reader->map_size;
+    } else {
+        reader->window = reader->chunk->data();
+        reader->limit = reader->window;
+        reader->next_chunk = 0;
+    }
+    reader->cursor = reader->window;
+}
+
+// A clustering prefix: per 32 values a vint header flagging null and empty
+// values, then the other values
+static void sstable_read_clustering(sstable_reader_t* reader, long count, VALUE values, long output) {
+    const std::vector<size_t>& types = *reader->clustering_types;
+    uint64_t header = 0;
+    
+    for (long i = 0; i < count; i++) {
+        if (i % 32 == 0) {
+            header = sstable_read_vint(reader);
+        }
+        int shift = (int)(i % 32) * 2;
+        VALUE value = Qnil;
+        if (header & (1ULL << (shift + 1))) {
+            value = Qnil;
+        } else if (header & (1ULL << shift)) {
+            value = sstable_decode(reader, types[(size_t)i], "", 0);
+        } else {
+            const sstable_marshal_t& type = (*reader->types)[types[(size_t)i]];
+            size_t length = type.fixed_length >= 0 ? (size_t)type.fixed_length : (size_t)sstable_read_vint(reader);
+            const char* bytes = sstable_read(reader, length);
+            value = sstable_decode(reader, types[(size_t)i], bytes, length);
+        }
+        if (!NIL_P(values)) {
+            rb_ary_store(values, output + i, value);
+        }
+    }
+}
+
+// Which columns of the superset a row has: all, a bitmap of the missing
+// ones below 64 columns, else the indexes of the present or missing ones
+static void sstable_read_subset(sstable_reader_t* reader, bool all, size_t superset) {
+    std::vector<char>& present = *reader->present;
+    present.assign(superset, all ? 1 : 0);
+    if (all) {
+        return;
+    }
+    
+    uint64_t encoded = sstable_read_vint(reader);
+    if (encoded == 0) {
+        present.assign(superset, 1);
+    } else if (superset < 64) {
+        for (size_t i = 0; i < superset; i++) {
+            present[i] = (encoded & (1ULL << i)) ? 0 : 1;
+        }
+    } else {
+        if (encoded > superset) {
+            sstable_corrupt(reader, "column subset larger than the header");
+        }
+        size_t count = superset - (size_t)encoded;
+        if (count < superset / 2) {
+            for (size_t i = 0; i < count; i++) {
+                uint64_t index = sstable_read_vint(reader);
+                if (index >= superset) {
+                    sstable_corrupt(reader, "column index out of range");
+                }
+                present[(size_t)index] = 1;
+            }
+        } else {
+            present.assign(superset, 1);
+            for (uint64_t i = 0; i < encoded; i++) {
+                uint64_t index = sstable_read_vint(reader);
+                if (index >= superset) {
+                    sstable_corrupt(reader, "column index out of range");
+                }
+                present[(size_t)index] = 0;
+            }
+        }
+    }
+}
+
+typedef struct {
+    int64_t timestamp;  // SSTABLE_LIVE when the row has no primary key liveness
+    int32_t ttl;
+    int32_t expires_at;
+} sstable_read_liveness_t;
+
+// One cell; returns whether it is live, leaving its value's bytes (valid
+// until the next read) in *bytes and *length. Values are stored without a
+// length when fixed_length >= 0.
+static bool sstable_read_cell(sstable_reader_t* reader, int fixed_length, bool complex,
+                              const sstable_read_liveness_t* row, int64_t deleted_at, int32_t now,
+                              const char** bytes, size_t* length) {
+    int flags = (unsigned char)*sstable_read(reader, 1);
+    bool use_row_timestamp = flags & SSTABLE_CELL_USE_ROW_TIMESTAMP;
+    bool use_row_ttl = flags & SSTABLE_CELL_USE_ROW_TTL;
+    bool deleted = flags & SSTABLE_CELL_IS_DELETED;
+    bool expiring = flags & SSTABLE_CELL_IS_EXPIRING;
+    
+    int64_t timestamp = use_row_timestamp ? row->timestamp : sstable_read_timestamp(reader);
+    int32_t expires_at = SSTABLE_NO_DELETION_TIME;
+    if (use_row_ttl) {
+        expires_at = row->expires_at;
+    } else if (deleted || expiring) {
+        expires_at = sstable_read_deletion_time(reader);
+    }
+    if (!use_row_ttl && expiring) {
+        sstable_read_ttl(reader);
+    }
+    
+    reader->cell_path->clear();
+    if (complex) {
+        size_t path_length = (size_t)sstable_read_vint(reader);
+        reader->cell_path->assign(sstable_read(reader, path_length), path_length);
+    }
+    
+    *length = 0;
+    *bytes = "";
+    if (!(flags & SSTABLE_CELL_HAS_EMPTY_VALUE)) {
+        *length = fixed_length >= 0 ? (size_t)fixed_length : (size_t)sstable_read_vint(reader);
+        *bytes = sstable_read(reader, *length);
+    }
+    return !deleted && timestamp > deleted_at && !(expiring && expires_at <= now);
+}
+
+// A non-frozen collection or UDT: optional column deletion, then one cell
+// per element with the element's key (list timeuuid, set element, map key,
+// UDT field number) as its path. Cell values always carry their length.
+// Returns whether any element is live.
+static bool sstable_read_complex(sstable_reader_t* reader, const sstable_read_column_t& column, bool has_deletion,
+                                 const sstable_read_liveness_t* row, int64_t deleted_at, int32_t now,
+                                 VALUE* result) {
+    const sstable_marshal_t& type = (*reader->types)[column.type];
+    if (has_deletion) {
+        int64_t column_deleted_at = sstable_read_timestamp(reader);
+        sstable_read_deletion_time(reader);
+        deleted_at = std::max(deleted_at, column_deleted_at);
+    }
+    
+    uint64_t count = sstable_read_vint(reader);
+    VALUE container = Qnil;
+    for (uint64_t i = 0; i < count; i++) {
+        const char* bytes;
+        size_t length;
+        if (!sstable_read_cell(reader, -1, true, row, deleted_at, now, &bytes, &length)) {
+            continue;
+        }
+        
+        const std::string& path = *reader->cell_path;
+        switch (type.kind) {
+            case SSTABLE_VALUE_LIST:
+                if (NIL_P(container)) {
+                    container = rb_ary_new();
+                }
+                rb_ary_push(container, sstable_decode(reader, type.params[0], bytes, length));
+                break;
+            case SSTABLE_VALUE_SET:
+                if (NIL_P(container)) {
+                    container = rb_ary_new();
+                }
+                rb_ary_push(container, sstable_decode(reader, type.params[0], path.data(), path.size()));
+                break;
+            case SSTABLE_VALUE_MAP: {
+                if (NIL_P(container)) {
+                    container = rb_hash_new();
+                }
+                VALUE key = sstable_decode(reader, type.params[0], path.data(), path.size());
+                rb_hash_aset(container, key, sstable_decode(reader, type.params[1], bytes, length));
+                break;
+            }
+            default: {
+                // UDT: the path is the field's two-byte position; fields
+                // unknown to this header are skipped
+                if (path.size() != 2) {
+                    sstable_corrupt(reader, "malformed user type field path");
+                }
+                size_t field = ((size_t)(unsigned char)path[0] << 8) | (unsigned char)path[1];
+                if (field >= type.params.size()) {
+                    break;
+                }
+                if (NIL_P(container)) {
+                    container = rb_hash_new();
+                }
+                VALUE value = sstable_decode(reader, type.params[field], bytes, length);
+                rb_hash_aset(container, rb_str_new(type.fields[field].data(), (long)type.fields[field].size()), value);
+                break;
+            }
+        }
+    }
+    
+    if (type.kind == SSTABLE_VALUE_SET && !NIL_P(container)) {
+        container = rb_funcall(rb_path2class("Set"), rb_intern("new"), 1, container);
+    }
+    *result = container;
+    return !NIL_P(container);
+}
+
+typedef struct {
+    sstable_reader_t* reader;
+    VALUE self;
+    bool as_array;
+    int32_t now;
+    long yielded;
+} sstable_iteration_t;
+
+static void sstable_yield_row(sstable_iteration_t* iteration) {
+    sstable_reader_t* reader = iteration->reader;
+    long keys = RARRAY_LEN(reader->key_values);
+    long statics = RARRAY_LEN(reader->static_values);
+    long total = RARRAY_LEN(reader->names);
+    VALUE row;
+    
+    if (iteration->as_array) {
+        row = rb_ary_new_capa(total);
+        rb_ary_cat(row, RARRAY_CONST_PTR(reader->key_values), keys);
+        rb_ary_cat(row, RARRAY_CONST_PTR(reader->row_values), (long)reader->clustering_types->size());
+        rb_ary_cat(row, RARRAY_CONST_PTR(reader->static_values), statics);
+        rb_ary_cat(row, RARRAY_CONST_PTR(reader->row_values) + reader->clustering_types->size(),
+                   RARRAY_LEN(reader->row_values) - (long)reader->clustering_types->size());
+    } else {
+        row = rb_hash_new();
+        for (long i = 0; i < total; i++) {
+            VALUE value;
+            long clustering = (long)reader->clustering_types->size();
+            if (i < keys) {
+                value = RARRAY_AREF(reader->key_values, i);
+            } else if (i < keys + clustering) {
+                value = RARRAY_AREF(reader->row_values, i - keys);
+            } else if (i < keys + clustering + statics) {
+                value = RARRAY_AREF(reader->static_values, i - keys - clustering);
+            } else {
+                value = RARRAY_AREF(reader->row_values, i - keys - statics);
+            }
+            rb_hash_aset(row, RARRAY_AREF(reader->names, i), value);
+        }
+    }
+    
+    iteration->yielded++;
+    rb_yield(row);
+}
+
+static void sstable_clear(VALUE values) {
+    for (long i = 0; i < RARRAY_LEN(values); i++) {
+        rb_ary_store(values, i, Qnil);
+    }
+}
+
+// Range tombstone marker: bound, sizes, then the deletion it closes and/or opens
+static int64_t sstable_read_marker(sstable_reader_t* reader) {
+    int kind = (unsigned char)*sstable_read(reader, 1);
+    long size = (long)sstable_next_be(reader, 2);
+    if (size > (long)reader->clustering_types->size()) {
+        sstable_corrupt(reader, "range tombstone bound longer than the clustering");
+    }
+    sstable_read_clustering(reader, size, Qnil, 0);
+    
+    uint64_t body_size = sstable_read_vint(reader);
+    uint64_t body_start = sstable_position(reader);
+    sstable_read_vint(reader);  // Previous unfiltered size
+    
+    int64_t open = SSTABLE_LIVE;
+    if (kind == SSTABLE_EXCL_END_INCL_START_BOUNDARY || kind == SSTABLE_INCL_END_EXCL_START_BOUNDARY) {
+        sstable_read_timestamp(reader);  // Closed deletion
+        sstable_read_deletion_time(reader);
+        open = sstable_read_timestamp(reader);
+        sstable_read_deletion_time(reader);
+    } else {
+        int64_t deleted_at = sstable_read_timestamp(reader);
+        sstable_read_deletion_time(reader);
+        if (kind == SSTABLE_INCL_START_BOUND || kind == SSTABLE_EXCL_START_BOUND) {
+            open = deleted_at;
+        }
+    }
+    sstable_seek(reader, body_start + body_size);
+    return open;
+}
+
+static VALUE sstable_iterate(VALUE arg) {
+    sstable_iteration_t* iteration = (sstable_iteration_t*)arg;
+    sstable_reader_t* reader = iteration->reader;
+    long clustering = (long)reader->clustering_types->size();
+    sstable_rewind(reader);
+    
+    while (sstable_more_data(reader)) {
+        size_t key_length = (size_t)sstable_next_be(reader, 2);
+        reader->key->assign(sstable_read(reader, key_length), key_length);
+        VALUE key = sstable_decode(reader, reader->key_type, reader->key->data(), reader->key->size());
+        if ((*reader->types)[reader->key_type].kind == SSTABLE_VALUE_COMPOSITE) {
+            for (long i = 0; i < RARRAY_LEN(reader->key_values); i++) {
+                rb_ary_store(reader->key_values, i, rb_ary_entry(key, i));
+            }
+        } else {
+            rb_ary_store(reader->key_values, 0, key);
+        }
+        
+        int32_t partition_deletion_time = (int32_t)(uint32_t)sstable_next_be(reader, 4);
+        int64_t partition_deleted_at = (int64_t)sstable_next_be(reader, 8);
+        if (partition_deletion_time == SSTABLE_NO_DELETION_TIME) {
+            partition_deleted_at = SSTABLE_LIVE;
+        }
+        
+        sstable_clear(reader->static_values);
+        bool static_live = false;
+        long rows = 0;
+        int64_t range_deleted_at = SSTABLE_LIVE;
+        
+        for (;;) {
+            int flags = (unsigned char)*sstable_read(reader, 1);
+            if (flags & SSTABLE_END_OF_PARTITION) {
+                break;
+            }
+            if (flags & SSTABLE_IS_MARKER) {
+                range_deleted_at = sstable_read_marker(reader);
+                continue;
+            }
+            int extended = (flags & SSTABLE_EXTENSION_FLAG) ? (unsigned char)*sstable_read(reader, 1) : 0;
+            bool is_static = extended & SSTABLE_IS_STATIC;
+            
+            sstable_clear(reader->row_values);
+            if (!is_static) {
+                sstable_read_clustering(reader, clustering, reader->row_values, 0);
+            }
+            uint64_t body_size = sstable_read_vint(reader);
+            uint64_t body_start = sstable_position(reader);
+            sstable_read_vint(reader);  // Previous unfiltered size
+            
+            sstable_read_liveness_t liveness = { SSTABLE_LIVE, 0, SSTABLE_NO_DELETION_TIME };
+            if (flags & SSTABLE_HAS_TIMESTAMP) {
+                liveness.timestamp = sstable_read_timestamp(reader);
+            }
+            if (flags & SSTABLE_HAS_TTL) {
+                liveness.ttl = sstable_read_ttl(reader);
+                liveness.expires_at = sstable_read_deletion_time(reader);
+            }
+            int64_t deleted_at = std::max(partition_deleted_at, is_static ? SSTABLE_LIVE : range_deleted_at);
+            if (flags & SSTABLE_HAS_DELETION) {
+                deleted_at = std::max(deleted_at, sstable_read_timestamp(reader));
+                sstable_read_deletion_time(reader);
+            }
+            bool live = (flags & SSTABLE_HAS_TIMESTAMP) && liveness.timestamp > deleted_at &&
+                        !((flags & SSTABLE_HAS_TTL) && liveness.expires_at <= iteration->now);
+            
+            const std::vector<sstable_read_column_t>& columns = is_static ? *reader->statics : *reader->regulars;
+            VALUE values = is_static ? reader->static_values : reader->row_values;
+            long offset = is_static ? 0 : clustering;
+            sstable_read_subset(reader, flags & SSTABLE_HAS_ALL_COLUMNS, columns.size());
+            for (size_t i = 0; i < columns.size(); i++) {
+                if (!(*reader->present)[i]) {
+                    continue;
+                }
+                const sstable_read_column_t& column = columns[i];
+                VALUE value;
+                bool cell_live;
+                if ((*reader->types)[column.type].multi_cell) {
+                    cell_live = sstable_read_complex(reader, column, flags & SSTABLE_HAS_COMPLEX_DELETION,
+                                                     &liveness, deleted_at, iteration->now, &value);
+                } else {
+                    const char* bytes;
+                    size_t length;
+                    cell_live = sstable_read_cell(reader, (*reader->types)[column.type].fixed_length, false, &liveness,
+                                                  deleted_at, iteration->now, &bytes, &length);
+                    value = cell_live ? sstable_decode(reader, column.type, bytes, length) : Qnil;
+                }
+                if (cell_live) {
+                    rb_ary_store(values, offset + (long)i, value);
+                    live = true;
+                }
+            }
+            sstable_seek(reader, body_start + body_size);
+            
+            if (is_static) {
+                static_live = live;
+            } else if (live) {
+                rows++;
+                sstable_yield_row(iteration);
+            }
+        }
+        
+        // A partition with live static columns and no live rows still reads
+        // as one row, with null clustering and regular columns
+        if (rows == 0 && static_live) {
+            sstable_clear(reader->row_values);
+            sstable_yield_row(iteration);
+        }
+    }
+    
+    RB_GC_GUARD(iteration->self);
+    return LONG2NUM(iteration->yielded);
+}
+
+static VALUE sstable_iteration_done(VALUE arg) {
+    sstable_iteration_t* iteration = (sstable_iteration_t*)arg;
+    iteration->reader->iterating = false;
+    return Qnil;
+}
+
+// Ruby method: reader.each_row(as_array, now) { |row| } -> rows yielded
+// Rows are Hashes keyed by column name, or Arrays in #columns order.
+// Cells and rows whose TTL expired at now (seconds since the epoch) are
+// treated as deleted.
+static VALUE sstable_reader_each_row(VALUE self, VALUE as_array, VALUE now) {
+    sstable_reader_t* reader = sstable_reader_get(self);
+    rb_need_block();
+    if (reader->iterating) {
+        rb_raise(rb_eRuntimeError, "SSTable reader is already iterating");
+    }
+    
+    sstable_iteration_t iteration;
+    iteration.reader = reader;
+    iteration.self = self;
+    iteration.as_array = RTEST(as_array);
+    iteration.now = NUM2INT(now);
+    iteration.yielded = 0;
+    
+    reader->iterating = true;
+    return rb_ensure(sstable_iterate, (VALUE)&iteration, sstable_iteration_done, (VALUE)&iteration);
+}
+
+// Ruby method: reader.columns -> [[name, cql_type, kind], ...] in row order
+static VALUE sstable_reader_columns(VALUE self) {
+    sstable_reader_t* reader = sstable_reader_get(self);
+    VALUE columns = rb_ary_new();
+    VALUE kinds[] = { ID2SYM(rb_intern("partition_key")), ID2SYM(rb_intern("clustering")),
+                      ID2SYM(rb_intern("static")), ID2SYM(rb_intern("regular")) };
+    
+    long keys = RARRAY_LEN(reader->key_values);
+    const sstable_marshal_t& key_type = (*reader->types)[reader->key_type];
+    for (long i = 0; i < RARRAY_LEN(reader->names); i++) {
+        size_t type_index;
+        int kind;
+        if (i < keys) {
+            type_index = key_type.kind == SSTABLE_VALUE_COMPOSITE ? key_type.params[(size_t)i] : reader->key_type;
+            kind = 0;
+        } else if (i < keys + (long)reader->clustering_types->size()) {
+            type_index = (*reader->clustering_types)[(size_t)(i - keys)];
+            kind = 1;
+        } else if (i < keys + (long)(reader->clustering_types->size() + reader->statics->size())) {
+            type_index = (*reader->statics)[(size_t)i - (size_t)keys - reader->clustering_types->size()].type;
+            kind = 2;
+        } else {
+            type_index = (*reader->regulars)[(size_t)i - (size_t)keys - reader->clustering_types->size() -
+                                             reader->statics->size()].type;
+            kind = 3;
+        }
+        VALUE type = rb_str_new_cstr("");
+        sstable_type_to_cql(reader, type_index, type);
+        rb_ary_push(columns, rb_ary_new_from_args(3, RARRAY_AREF(reader->names, i), type, kinds[kind]));
+    }
+    
+    return columns;
+}
+
+static VALUE sstable_reader_data_size(VALUE self) {
+    return ULL2NUM(sstable_reader_get(self)->data_length);
+}
+
+static VALUE sstable_reader_version(VALUE self) {
+    return rb_str_new_cstr(sstable_reader_get(self)->version);
+}
+
+static VALUE sstable_reader_compression(VALUE self) {
+    sstable_reader_t* reader = sstable_reader_get(self);
+    const char* names[] = { "none", "lz4", "snappy", "deflate" };
+    return reader->chunk_offsets->empty() ? Qnil : ID2SYM(rb_intern(names[reader->compression]));
+}
+
+static VALUE sstable_reader_close(VALUE self) {
+    sstable_reader_t* reader;
+    TypedData_Get_Struct(self, sstable_reader_t, &sstable_reader_type, reader);
+    
+    if (reader->iterating) {
+        rb_raise(rb_eRuntimeError, "Cannot close an SSTable reader while it is iterating");
+    }
+    sstable_reader_unmap(reader);
+    return Qnil;
+}
+
+static void sstable_add_names(sstable_reader_t* reader, VALUE given, long count, const char* first,
+                              const char* prefix) {
+    for (long i = 0; i < count; i++) {
+        VALUE name;
+        if (!NIL_P(given)) {
+            name = rb_str_dup(rb_obj_as_string(rb_ary_entry(given, i)));
+        } else if (i == 0 && first) {
+            name = rb_str_new_cstr(first);
+        } else {
+            name = rb_sprintf("%s%ld", prefix, i + 1);
+        }
+        rb_ary_push(reader->names, rb_str_freeze(name));
+    }
+}
+
+// Ruby method: CassandraCpp::NativeSSTableReader.open(data_path, key_names, clustering_names)
+// Names of the partition key and clustering columns are not stored in the
+// SSTable; without them they are key, key2, ... and column1, column2, ...
+static VALUE sstable_reader_open(VALUE klass, VALUE data_path, VALUE key_names, VALUE clustering_names) {
+    FilePathValue(data_path);
+    if (!NIL_P(key_names)) {
+        Check_Type(key_names, T_ARRAY);
+    }
+    if (!NIL_P(clustering_names)) {
+        Check_Type(clustering_names, T_ARRAY);
+    }
+    
+    const char* path = StringValueCStr(data_path);
+    const char* base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    size_t path_length = strlen(path);
+    const char* suffix = "-big-Data.db";
+    bool named = path_length > strlen(suffix) && strcmp(path + path_length - strlen(suffix), suffix) == 0 &&
+                 strlen(base) > 3 && base[2] == '-';
+    if (!named) {
+        rb_raise(rb_eArgError, "Not a BIG-format Data.db file: %s", path);
+    }
+    if (base[0] < 'm' || base[0] > 'n' || base[1] < 'a' || base[1] > 'z') {
+        rb_raise(rb_eArgError, "SSTable version %.2s is not supported (Cassandra 3.0 to 4.1 versions ma to nb are)",
+                 base);
+    }
+    
+    sstable_reader_t* reader = ALLOC(sstable_reader_t);
+    memset(reader, 0, sizeof(sstable_reader_t));
+    reader->path = rb_str_new_frozen(data_path);
+    reader->names = rb_ary_new();
+    reader->key_values = rb_ary_new();
+    reader->static_values = rb_ary_new();
+    reader->row_values = rb_ary_new();
+    VALUE obj = TypedData_Wrap_Struct(klass, &sstable_reader_type, reader);
+    
+    memcpy(reader->version, base, 2);
+    reader->version[2] = '\0';
+    reader->compression = SSTABLE_COMPRESSION_NONE;
+    reader->chunk_offsets = new std::vector<uint64_t>();
+    reader->chunk = new std::string();
+    reader->straddle = new std::string();
+    reader->types = new std::vector<sstable_marshal_t>();
+    reader->clustering_types = new std::vector<size_t>();
+    reader->statics = new std::vector<sstable_read_column_t>();
+    reader->regulars = new std::vector<sstable_read_column_t>();
+    reader->present = new std::vector<char>();
+    reader->cell_path = new std::string();
+    reader->key = new std::string();
+    
+    // The other components share the Data.db path up to "Data.db"
+    long prefix_length = (long)(path_length - strlen("Data.db"));
+    VALUE statistics_path = rb_str_cat_cstr(rb_str_new(path, prefix_length), "Statistics.db");
+    VALUE compression_path = rb_str_cat_cstr(rb_str_new(path, prefix_length), "CompressionInfo.db");
+    std::string* contents = reader->key;  // Scratch until iteration
+    if (!sstable_read_file(StringValueCStr(statistics_path), contents)) {
+        rb_sys_fail_str(statistics_path);
+    }
+    sstable_read_statistics(reader, *contents);
+    
+    if (sstable_read_file(StringValueCStr(compression_path), contents)) {
+        sstable_read_compression_info(reader, *contents);
+    } else if (errno != ENOENT) {
+        rb_sys_fail_str(compression_path);
+    }
+    contents->clear();
+    
+    const sstable_marshal_t& key_type = (*reader->types)[reader->key_type];
+    long key_count = key_type.kind == SSTABLE_VALUE_COMPOSITE ? (long)key_type.params.size() : 1;
+    long clustering_count = (long)reader->clustering_types->size();
+    if (!NIL_P(key_names) && RARRAY_LEN(key_names) != key_count) {
+        rb_raise(rb_eArgError, "SSTable has %ld partition key columns, %ld names given", key_count,
+                 RARRAY_LEN(key_names));
+    }
+    if (!NIL_P(clustering_names) && RARRAY_LEN(clustering_names) != clustering_count) {
+        rb_raise(rb_eArgError, "SSTable has %ld clustering columns, %ld names given", clustering_count,
+                 RARRAY_LEN(clustering_names));
+    }
+    
+    sstable_add_names(reader, key_names, key_count, "key", "key");
+    sstable_add_names(reader, clustering_names, clustering_count, NULL, "column");
+    for (size_t i = 0; i < reader->statics->size(); i++) {
+        const std::string& name = (*reader->statics)[i].name;
+        rb_ary_push(reader->names, rb_str_freeze(rb_str_new(name.data(), (long)name.size())));
+    }
+    for (size_t i = 0; i < reader->regulars->size(); i++) {
+        const std::string& name = (*reader->regulars)[i].name;
+        rb_ary_push(reader->names, rb_str_freeze(rb_str_new(name.data(), (long)name.size())));
+    }
+    rb_ary_resize(reader->key_values, key_count);
+    rb_ary_resize(reader->static_values, (long)reader->statics->size());
+    rb_ary_resize(reader->row_values, clustering_count + (long)reader->regulars->size());
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        rb_sys_fail(path);
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        rb_sys_fail(path);
+    }
+    
+    size_t size = (size_t)st.st_size;
+    if (size == 0) {
+        close(fd);
+        rb_raise(rb_eArgError, "Empty SSTable: %s", path);
+    }
+    
+    void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        int saved_errno = errno;
+        close(fd);
+        errno = saved_errno;
+        rb_sys_fail(path);
+    }
+    close(fd);
+    madvise(map, size, MADV_SEQUENTIAL);
+    reader->map = (const char*)map;
+    reader->map_size = size;
+    if (reader->chunk_offsets->empty()) {
+        reader->data_length = size;
+    }
+    
+    return obj;
+}
+
+void init_sstable_reader() {
+    rb_cNativeSSTableReader = rb_define_class_under(rb_cCassandraCpp, "NativeSSTableReader", rb_cObject);
+    rb_undef_alloc_func(rb_cNativeSSTableReader);
+    
+    rb_define_singleton_method(rb_cNativeSSTableReader, "open", (VALUE(*)(...))sstable_reader_open, 3);
+    rb_define_method(rb_cNativeSSTableReader, "each_row", (VALUE(*)(...))sstable_reader_each_row, 2);
+    rb_define_method(rb_cNativeSSTableReader, "columns", (VALUE(*)(...))sstable_reader_columns, 0);
+    rb_define_method(rb_cNativeSSTableReader, "data_size", (VALUE(*)(...))sstable_reader_data_size, 0);
+    rb_define_method(rb_cNativeSSTableReader, "version", (VALUE(*)(...))sstable_reader_version, 0);
+    rb_define_method(rb_cNativeSSTableReader, "compression", (VALUE(*)(...))sstable_reader_compression, 0);
+    rb_define_method(rb_cNativeSSTableReader, "close", (VALUE(*)(...))sstable_reader_close, 0);
+}
\ No newline at end of file
@@ -0,0 +1,1244 @@
+#include "cassandra_cpp.h"
+#include <ruby/thread.h>
+#include <algorithm>
+#include <map>
+#include <math.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// Offline SSTable writer for bulk loading. Rows are buffered in memory,
+// sorted by token, partition key and clustering, and written as one
+// uncompressed SSTable in Cassandra 4's "nb" (BIG) format each time the
+// buffer fills, so the files can be streamed in with sstableloader or
+// nodetool import without going through the write path. Each SSTable is
+// the set of files
+//
+//   nb-<generation>-big-Data.db        partitions: key, rows, end marker
+//   nb-<generation>-big-Index.db       partition key -> Data.db position
+//   nb-<generation>-big-Summary.db     every 128th Index.db entry
+//   nb-<generation>-big-Filter.db      Bloom filter over partition keys
+//   nb-<generation>-big-Statistics.db  schema header and statistics
+//   nb-<generation>-big-CRC.db         CRC32 of each 64 KiB Data.db chunk
+//   nb-<generation>-big-Digest.crc32   CRC32 of the whole Data.db
+//   nb-<generation>-big-TOC.txt        the component list, written last
+//
+// Rows are INSERTs: every row carries a primary key liveness timestamp, an
+// optional TTL, and one cell per non-nil column. Static columns,
+// collections, counters and partition deletions are not written. Row index
+// blocks inside large partitions are not written either; Cassandra reads
+// such partitions from their start.
+
+#define SSTABLE_CHUNK_SIZE 65536
+#define SSTABLE_MIN_INDEX_INTERVAL 128
+#define SSTABLE_BASE_SAMPLING_LEVEL 128
+#define SSTABLE_BLOOM_EXCESS_BITS 20
+#define SSTABLE_BLOOM_MAX_BUCKETS 20
+
+#define SSTABLE_MAX_TTL 630720000
+
+#define SSTABLE_PARTITION_SIZE_BUCKETS 150
+#define SSTABLE_CELL_COUNT_BUCKETS 114
+#define SSTABLE_TOMBSTONE_BINS 100
+#define SSTABLE_TOMBSTONE_ROUND_SECONDS 60
+#define SSTABLE_HLL_P 13
+#define SSTABLE_HLL_SP 25
+
+#define SSTABLE_PARTITIONER "org.apache.cassandra.dht.Murmur3Partitioner"
+#define SSTABLE_MARSHAL_PACKAGE "org.apache.cassandra.db.marshal."
+
+typedef struct {
+    std::string name;
+    const sstable_type_t* type;
+    bool reversed;     // Clustering column in descending order
+    long input_index;  // Position of the column's value in #add's Array
+} sstable_column_t;
+
+typedef struct {
+    int64_t timestamp;   // Microseconds
+    int32_t ttl;         // Seconds; 0 when not expiring
+    int32_t expires_at;  // Local deletion time; SSTABLE_NO_DELETION_TIME when not expiring
+} sstable_liveness_t;
+
+typedef struct {
+    sstable_liveness_t liveness;
+    bool present;
+    std::string value;
+} sstable_cell_t;
+
+typedef struct {
+    int64_t token;
+    std::string key;  // Serialized partition key (CompositeType for compound keys)
+    std::vector<std::string> clustering;
+    sstable_liveness_t liveness;
+    std::vector<sstable_cell_t> cells;  // One per regular column, in header order
+} sstable_row_t;
+
+typedef struct {
+    std::string* directory;
+    std::vector<sstable_column_t>* partition_key;
+    std::vector<sstable_column_t>* clustering;
+    std::vector<sstable_column_t>* columns;  // Regular columns, in Cassandra's column order
+    std::vector<sstable_row_t>* rows;
+    sstable_row_t* pending;    // Row being encoded by #add, buffered once every value is
+    std::string* scratch;      // One compound key component being encoded
+    std::vector<std::string>* written;
+    size_t buffered_bytes;
+    size_t buffer_limit;
+    double fp_chance;
+    long generation;
+    long input_count;
+    bool flushing;
+} sstable_writer_t;
+
+// One component file; Data.db also checksums every chunk and the whole file
+typedef struct {
+    FILE* file;
+    const std::string* path;
+    uint64_t position;
+    bool checksummed;
+    uint32_t digest;
+    uint32_t chunk_crc;
+    size_t chunk_fill;
+    std::string chunk_crcs;
+} sstable_output_t;
+
+// Statistics gathered while Data.db is written
+typedef struct {
+    std::vector<int64_t> size_offsets;
+    std::vector<int64_t> size_buckets;
+    std::vector<int64_t> cell_offsets;
+    std::vector<int64_t> cell_buckets;
+    std::map<int32_t, int64_t> drop_times;  // Expiry second (rounded up to a minute) -> cells and rows
+    std::vector<uint8_t> registers;         // HyperLogLog registers over partition keys
+    int64_t min_timestamp;
+    int64_t max_timestamp;
+    int32_t min_deletion_time;
+    int32_t max_deletion_time;
+    int32_t min_ttl;
+    int32_t max_ttl;
+    int64_t total_cells;
+    int64_t total_rows;
+} sstable_stats_t;
+
+// A flush running without the GVL; errors are reported once it is back
+typedef struct {
+    sstable_writer_t* writer;
+    std::string prefix;  // Directory and "nb-<generation>-big-"
+    int error;
+    std::string error_path;
+} sstable_flush_t;
+
+static VALUE rb_cNativeSSTableWriter;
+
+static void sstable_writer_free(void* ptr) {
+    sstable_writer_t* writer = (sstable_writer_t*)ptr;
+    if (writer) {
+        delete writer->directory;
+        delete writer->partition_key;
+        delete writer->clustering;
+        delete writer->columns;
+        delete writer->rows;
+        delete writer->pending;
+        delete writer->scratch;
+        delete writer->written;
+        xfree(writer);
+    }
+}
+
+static size_t sstable_writer_memsize(const void* ptr) {
+    const sstable_writer_t* writer = (const sstable_writer_t*)ptr;
+    return sizeof(sstable_writer_t) + writer->buffered_bytes;
+}
+
+static const rb_data_type_t sstable_writer_type = {
+    "CassandraCpp::NativeSSTableWriter",
+    { 0, sstable_writer_free, sstable_writer_memsize },
+    0, 0,
+    RUBY_TYPED_FREE_IMMEDIATELY
+};
+
+static sstable_writer_t* sstable_writer_get(VALUE self) {
+    sstable_writer_t* writer;
+    TypedData_Get_Struct(self, sstable_writer_t, &sstable_writer_type, writer);
+    
+    if (writer->flushing) {
+        rb_raise(rb_eRuntimeError, "SSTable writer is flushing in another thread");
+    }
+    
+    return writer;
+}
+
+static void sstable_append_le(std::string* out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out->push_back((char)((value >> (i * 8)) & 0xff));
+    }
+}
+
+static void sstable_append_double(std::string* out, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    sstable_append_be(out, bits, 8);
+}
+
+static void sstable_append_vint_bytes(std::string* out, const std::string& bytes) {
+    sstable_write_vint(out, bytes.size());
+    out->append(bytes);
+}
+
+static size_t sstable_vint_size(uint64_t value) {
+    return (size_t)((639 - __builtin_clzll(value | 1) * 9) >> 6);
+}
+
+static int64_t sstable_now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Cassandra's column order: by a prefix of the name with its top bit
+// flipped, then by the name's bytes
+static uint64_t sstable_column_prefix(const std::string& name) {
+    uint64_t prefix = 0;
+    size_t count = std::min(name.size(), (size_t)8);
+    for (size_t i = 0; i < count; i++) {
+        prefix = (prefix << 8) | (unsigned char)name[i];
+    }
+    if (count < 8) {
+        prefix <<= (8 - count) * 8;
+    }
+    return (prefix ^ 0x8000000000000000ULL) >> 16;
+}
+
+static bool sstable_column_less(const sstable_column_t& left, const sstable_column_t& right) {
+    uint64_t left_prefix = sstable_column_prefix(left.name);
+    uint64_t right_prefix = sstable_column_prefix(right.name);
+    if (left_prefix != right_prefix) {
+        return left_prefix < right_prefix;
+    }
+    return left.name.compare(right.name) < 0;  // std::string compares bytes unsigned
+}
+
+static std::string sstable_marshal_name(const sstable_column_t& column) {
+    std::string name = SSTABLE_MARSHAL_PACKAGE;
+    name += column.type->marshal_class;
+    if (column.reversed) {
+        name = SSTABLE_MARSHAL_PACKAGE "ReversedType(" + name + ")";
+    }
+    return name;
+}
+
+// EstimatedHistogram bucket offsets: 1, 2, 3, ... growing by 20% per bucket
+static std::vector<int64_t> sstable_histogram_offsets(int size) {
+    std::vector<int64_t> offsets((size_t)size);
+    int64_t last = 1;
+    offsets[0] = last;
+    for (int i = 1; i < size; i++) {
+        int64_t next = (int64_t)floor((double)last * 1.2 + 0.5);
+        if (next == last) {
+            next++;
+        }
+        offsets[(size_t)i] = next;
+        last = next;
+    }
+    return offsets;
+}
+
+static void sstable_histogram_add(const std::vector<int64_t>& offsets, std::vector<int64_t>* buckets, int64_t value) {
+    size_t index = (size_t)(std::lower_bound(offsets.begin(), offsets.end(), value) - offsets.begin());
+    (*buckets)[index]++;
+}
+
+static void sstable_append_histogram(std::string* out, const std::vector<int64_t>& offsets,
+                                     const std::vector<int64_t>& buckets) {
+    sstable_append_be(out, buckets.size(), 4);
+    for (size_t i = 0; i < buckets.size(); i++) {
+        sstable_append_be(out, (uint64_t)offsets[i == 0 ? 0 : i - 1], 8);
+        sstable_append_be(out, (uint64_t)buckets[i], 8);
+    }
+}
+
+static void sstable_stats_init(sstable_stats_t* stats) {
+    stats->size_offsets = sstable_histogram_offsets(SSTABLE_PARTITION_SIZE_BUCKETS);
+    stats->size_buckets.assign(SSTABLE_PARTITION_SIZE_BUCKETS + 1, 0);
+    stats->cell_offsets = sstable_histogram_offsets(SSTABLE_CELL_COUNT_BUCKETS);
+    stats->cell_buckets.assign(SSTABLE_CELL_COUNT_BUCKETS + 1, 0);
+    stats->registers.assign((size_t)1 << SSTABLE_HLL_P, 0);
+    stats->min_timestamp = INT64_MAX;
+    stats->max_timestamp = INT64_MIN;
+    stats->min_deletion_time = SSTABLE_NO_DELETION_TIME;
+    stats->max_deletion_time = SSTABLE_NO_DELETION_TIME;
+    stats->min_ttl = 0;
+    stats->max_ttl = 0;
+    stats->total_cells = 0;
+    stats->total_rows = 0;
+}
+
+static void sstable_stats_liveness(sstable_stats_t* stats, const sstable_liveness_t& liveness, bool* deletion_seen) {
+    stats->min_timestamp = std::min(stats->min_timestamp, liveness.timestamp);
+    stats->max_timestamp = std::max(stats->max_timestamp, liveness.timestamp);
+    
+    if (!*deletion_seen) {
+        stats->min_deletion_time = stats->max_deletion_time = liveness.expires_at;
+        stats->min_ttl = stats->max_ttl = liveness.ttl;
+        *deletion_seen = true;
+    } else {
+        stats->min_deletion_time = std::min(stats->min_deletion_time, liveness.expires_at);
+        stats->max_deletion_time = std::max(stats->max_deletion_time, liveness.expires_at);
+        stats->min_ttl = std::min(stats->min_ttl, liveness.ttl);
+        stats->max_ttl = std::max(stats->max_ttl, liveness.ttl);
+    }
+    
+    if (liveness.expires_at != SSTABLE_NO_DELETION_TIME) {
+        int32_t point = liveness.expires_at;
+        int32_t remainder = point % SSTABLE_TOMBSTONE_ROUND_SECONDS;
+        if (remainder > 0 && point <= INT32_MAX - SSTABLE_TOMBSTONE_ROUND_SECONDS) {
+            point += SSTABLE_TOMBSTONE_ROUND_SECONDS - remainder;
+        }
+        stats->drop_times[point]++;
+    }
+}
+
+// HyperLogLog++ (p = 13) in its dense form, as stream-lib serializes it
+static void sstable_stats_key(sstable_stats_t* stats, const std::string& key) {
+    uint64_t hash = sstable_murmur2_hash64(key.data(), key.size());
+    size_t index = (size_t)(hash >> (64 - SSTABLE_HLL_P));
+    uint64_t rest = (hash << SSTABLE_HLL_P) | (1ULL << (SSTABLE_HLL_P - 1));
+    uint8_t run = (uint8_t)(__builtin_clzll(rest) + 1);
+    if (run > stats->registers[index]) {
+        stats->registers[index] = run;
+    }
+}
+
+static void sstable_append_varint32(std::string* out, uint32_t value) {
+    while (value & 0xffffff80U) {
+        out->push_back((char)((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out->push_back((char)value);
+}
+
+static void sstable_append_cardinality(std::string* out, const sstable_stats_t* stats) {
+    // Registers packed six to a 32-bit word, five bits each
+    size_t register_count = stats->registers.size();
+    size_t word_count = register_count / 6 + (register_count % 6 ? 1 : 0);
+    std::vector<uint32_t> words(word_count, 0);
+    for (size_t i = 0; i < register_count; i++) {
+        words[i / 6] |= (uint32_t)stats->registers[i] << (5 * (i % 6));
+    }
+    
+    std::string hll;
+    sstable_append_be(&hll, (uint64_t)(int64_t)-2, 4);  // Format version 2
+    sstable_append_varint32(&hll, SSTABLE_HLL_P);
+    sstable_append_varint32(&hll, SSTABLE_HLL_SP);
+    sstable_append_varint32(&hll, 0);  // Dense
+    sstable_append_varint32(&hll, (uint32_t)(word_count * 4));
+    for (size_t i = 0; i < word_count; i++) {
+        sstable_append_be(&hll, words[i], 4);
+    }
+    
+    sstable_append_be(out, hll.size(), 4);
+    out->append(hll);
+}
+
+// Streaming histogram of expiry times, merged down to the closest bins
+static void sstable_append_drop_times(std::string* out, const sstable_stats_t* stats) {
+    std::vector<std::pair<double, int64_t> > bins;
+    for (std::map<int32_t, int64_t>::const_iterator it = stats->drop_times.begin(); it != stats->drop_times.end(); ++it) {
+        bins.push_back(std::make_pair((double)it->first, it->second));
+    }
+    while (bins.size() > SSTABLE_TOMBSTONE_BINS) {
+        size_t closest = 0;
+        for (size_t i = 1; i + 1 < bins.size(); i++) {
+            if (bins[i + 1].first - bins[i].first < bins[closest + 1].first - bins[closest].first) {
+                closest = i;
+            }
+        }
+        int64_t count = bins[closest].second + bins[closest + 1].second;
+        double point = ceil((bins[closest].first * (double)bins[closest].second +
+                             bins[closest + 1].first * (double)bins[closest + 1].second) / (double)count);
+        bins[closest] = std::make_pair(point, count);
+        bins.erase(bins.begin() + (long)closest + 1);
+    }
+    
+    sstable_append_be(out, bins.size(), 4);
+    sstable_append_be(out, bins.size(), 4);
+    for (size_t i = 0; i < bins.size(); i++) {
+        sstable_append_double(out, bins[i].first);
+        sstable_append_be(out, (uint64_t)bins[i].second, 8);
+    }
+}
+
+static bool sstable_output_open(sstable_output_t* output, const std::string* path, bool checksummed) {
+    output->file = fopen(path->c_str(), "wb");
+    output->path = path;
+    output->position = 0;
+    output->checksummed = checksummed;
+    output->digest = 0;
+    output->chunk_crc = 0;
+    output->chunk_fill = 0;
+    output->chunk_crcs.clear();
+    
+    if (output->file) {
+        setvbuf(output->file, NULL, _IOFBF, 1 << 20);
+    }
+    return output->file != NULL;
+}
+
+static void sstable_output_end_chunk(sstable_output_t* output) {
+    sstable_append_be(&output->chunk_crcs, output->chunk_crc, 4);
+    output->chunk_crc = 0;
+    output->chunk_fill = 0;
+}
+
+static bool sstable_output_write(sstable_output_t* output, const char* bytes, size_t length) {
+    if (length == 0) {
+        return true;
+    }
+    if (fwrite(bytes, 1, length, output->file) != length) {
+        return false;
+    }
+    output->position += length;
+    
+    if (output->checksummed) {
+        output->digest = crc32_update(output->digest, bytes, length);
+        while (length > 0) {
+            size_t part = std::min(length, (size_t)SSTABLE_CHUNK_SIZE - output->chunk_fill);
+            output->chunk_crc = crc32_update(output->chunk_crc, bytes, part);
+            output->chunk_fill += part;
+            bytes += part;
+            length -= part;
+            if (output->chunk_fill == SSTABLE_CHUNK_SIZE) {
+                sstable_output_end_chunk(output);
+            }
+        }
+    }
+    
+    return true;
+}
+
+static bool sstable_output_close(sstable_output_t* output) {
+    if (output->checksummed && output->chunk_fill > 0) {
+        sstable_output_end_chunk(output);
+    }
+    
+    FILE* file = output->file;
+    output->file = NULL;
+    return fclose(file) == 0;
+}
+
+// Write a whole component file; false with errno set on failure
+static bool sstable_write_file(sstable_flush_t* flush, const char* component, const std::string& contents) {
+    std::string path = flush->prefix + component;
+    sstable_output_t output;
+    
+    if (!sstable_output_open(&output, &path, false)) {
+        flush->error = errno;
+        flush->error_path = path;
+        return false;
+    }
+    
+    bool written = sstable_output_write(&output, contents.data(), contents.size());
+    int saved_errno = errno;
+    bool closed = sstable_output_close(&output);
+    if (!written || !closed) {
+        flush->error = written ? errno : saved_errno;
+        flush->error_path = path;
+        return false;
+    }
+    
+    return true;
+}
+
+// Clustering prefix: per 32 values a vint header flagging empty values, then
+// the non-empty values
+static void sstable_append_clustering(std::string* out, const std::vector<sstable_column_t>& columns,
+                                      const std::vector<std::string>& values) {
+    size_t offset = 0;
+    while (offset < values.size()) {
+        size_t limit = std::min(values.size(), offset + 32);
+        uint64_t header = 0;
+        for (size_t i = offset; i < limit; i++) {
+            if (values[i].empty()) {
+                header |= 1ULL << ((i - offset) * 2);
+            }
+        }
+        sstable_write_vint(out, header);
+        
+        for (; offset < limit; offset++) {
+            if (values[offset].empty()) {
+                continue;
+            }
+            if (columns[offset].type->fixed_length < 0) {
+                sstable_write_vint(out, values[offset].size());
+            }
+            out->append(values[offset]);
+        }
+    }
+}
+
+// Columns of the row missing from the header's: a bitmap of the missing
+// ones below 64 columns, otherwise the count and indexes of whichever of
+// present or missing is smaller
+static void sstable_append_column_subset(std::string* out, const sstable_row_t& row, size_t present) {
+    size_t total = row.cells.size();
+    
+    if (total < 64) {
+        uint64_t missing = 0;
+        for (size_t i = 0; i < total; i++) {
+            if (!row.cells[i].present) {
+                missing |= 1ULL << i;
+            }
+        }
+        sstable_write_vint(out, missing);
+        return;
+    }
+    
+    sstable_write_vint(out, total - present);
+    for (size_t i = 0; i < total; i++) {
+        if (row.cells[i].present == (present < total / 2)) {
+            sstable_write_vint(out, i);
+        }
+    }
+}
+
+static void sstable_append_cell(std::string* out, const sstable_column_t& column, const sstable_cell_t& cell,
+                                const sstable_liveness_t& row_liveness) {
+    bool expiring = cell.liveness.ttl > 0;
+    bool use_row_timestamp = cell.liveness.timestamp == row_liveness.timestamp;
+    bool use_row_ttl = expiring && row_liveness.ttl == cell.liveness.ttl &&
+                       row_liveness.expires_at == cell.liveness.expires_at;
+    
+    int flags = 0;
+    if (cell.value.empty()) {
+        flags |= SSTABLE_CELL_HAS_EMPTY_VALUE;
+    }
+    if (expiring) {
+        flags |= SSTABLE_CELL_IS_EXPIRING;
+    }
+    if (use_row_timestamp) {
+        flags |= SSTABLE_CELL_USE_ROW_TIMESTAMP;
+    }
+    if (use_row_ttl) {
+        flags |= SSTABLE_CELL_USE_ROW_TTL;
+    }
+    out->push_back((char)flags);
+    
+    if (!use_row_timestamp) {
+        sstable_write_vint(out, (uint64_t)(cell.liveness.timestamp - SSTABLE_TIMESTAMP_EPOCH));
+    }
+    if (expiring && !use_row_ttl) {
+        sstable_write_vint(out, (uint64_t)((int64_t)cell.liveness.expires_at - SSTABLE_DELETION_TIME_EPOCH));
+        sstable_write_vint(out, (uint64_t)cell.liveness.ttl);
+    }
+    if (!cell.value.empty()) {
+        if (column.type->fixed_length < 0) {
+            sstable_write_vint(out, cell.value.size());
+        }
+        out->append(cell.value);
+    }
+}
+
+// Flags, clustering, then the body prefixed with its size and the size of
+// the previous row (which readers use to scan backwards)
+static void sstable_append_row(std::string* out, std::string* body, const sstable_writer_t* writer,
+                               const sstable_row_t& row, uint64_t previous_size) {
+    size_t present = 0;
+    for (size_t i = 0; i < row.cells.size(); i++) {
+        present += row.cells[i].present ? 1 : 0;
+    }
+    bool expiring = row.liveness.ttl > 0;
+    
+    int flags = SSTABLE_HAS_TIMESTAMP;
+    if (expiring) {
+        flags |= SSTABLE_HAS_TTL;
+    }
+    if (present == row.cells.size()) {
+        flags |= SSTABLE_HAS_ALL_COLUMNS;
+    }
+    
+    body->clear();
+    sstable_write_vint(body, (uint64_t)(row.liveness.timestamp - SSTABLE_TIMESTAMP_EPOCH));
+    if (expiring) {
+        sstable_write_vint(body, (uint64_t)row.liveness.ttl);
+        sstable_write_vint(body, (uint64_t)((int64_t)row.liveness.expires_at - SSTABLE_DELETION_TIME_EPOCH));
+    }
+    if (!(flags & SSTABLE_HAS_ALL_COLUMNS)) {
+        sstable_append_column_subset(body, row, present);
+    }
+    for (size_t i = 0; i < row.cells.size(); i++) {
+        if (row.cells[i].present) {
+            sstable_append_cell(body, (*writer->columns)[i], row.cells[i], row.liveness);
+        }
+    }
+    
+    out->push_back((char)flags);
+    sstable_append_clustering(out, *writer->clustering, row.clustering);
+    sstable_write_vint(out, body->size() + sstable_vint_size(previous_size));
+    sstable_write_vint(out, previous_size);
+    out->append(*body);
+}
+
+static int sstable_compare_clustering(const sstable_writer_t* writer, const sstable_row_t& left,
+                                      const sstable_row_t& right) {
+    for (size_t i = 0; i < left.clustering.size(); i++) {
+        const sstable_column_t& column = (*writer->clustering)[i];
+        int rc = sstable_compare_values(column.type, left.clustering[i], right.clustering[i]);
+        if (rc != 0) {
+            return column.reversed ? -rc : rc;
+        }
+    }
+    return 0;
+}
+
+// Partition order (token, then key bytes), then clustering order
+static int sstable_compare_rows(const sstable_writer_t* writer, const sstable_row_t& left,
+                                const sstable_row_t& right, bool* same_partition) {
+    *same_partition = false;
+    if (left.token != right.token) {
+        return left.token < right.token ? -1 : 1;
+    }
+    int rc = left.key.compare(right.key);
+    if (rc != 0) {
+        return rc < 0 ? -1 : 1;
+    }
+    *same_partition = true;
+    return sstable_compare_clustering(writer, left, right);
+}
+
+// Fold a later write of the same row into row: newer timestamps win, and a
+// later row wins ties
+static void sstable_merge_row(sstable_row_t* row, sstable_row_t* later) {
+    if (later->liveness.timestamp >= row->liveness.timestamp) {
+        row->liveness = later->liveness;
+    }
+    for (size_t i = 0; i < row->cells.size(); i++) {
+        sstable_cell_t& cell = row->cells[i];
+        sstable_cell_t& update = later->cells[i];
+        if (update.present && (!cell.present || update.liveness.timestamp >= cell.liveness.timestamp)) {
+            cell.liveness = update.liveness;
+            cell.present = true;
+            cell.value.swap(update.value);
+        }
+    }
+}
+
+typedef struct {
+    const sstable_writer_t* writer;
+    
+    bool operator()(size_t left, size_t right) const {
+        bool same_partition;
+        int rc = sstable_compare_rows(writer, (*writer->rows)[left], (*writer->rows)[right], &same_partition);
+        return rc != 0 ? rc < 0 : left < right;
+    }
+} sstable_row_order_t;
+
+static std::string sstable_statistics(const sstable_writer_t* writer, const sstable_stats_t* stats) {
+    std::string components[4];
+    
+    // Validation: partitioner and Bloom filter false positive chance
+    std::string& validation = components[SSTABLE_METADATA_VALIDATION];
+    sstable_append_be(&validation, strlen(SSTABLE_PARTITIONER), 2);
+    validation += SSTABLE_PARTITIONER;
+    sstable_append_double(&validation, writer->fp_chance);
+    
+    sstable_append_cardinality(&components[SSTABLE_METADATA_COMPACTION], stats);
+    
+    // Stats. Clustering bounds are left empty, which readers take as
+    // "may contain any clustering"; the commit log intervals are empty as
+    // the data never went through one.
+    std::string& out = components[SSTABLE_METADATA_STATS];
+    sstable_append_histogram(&out, stats->size_offsets, stats->size_buckets);
+    sstable_append_histogram(&out, stats->cell_offsets, stats->cell_buckets);
+    sstable_append_be(&out, (uint64_t)(int64_t)-1, 8);  // Commit log upper bound: none
+    sstable_append_be(&out, 0, 4);
+    sstable_append_be(&out, (uint64_t)stats->min_timestamp, 8);
+    sstable_append_be(&out, (uint64_t)stats->max_timestamp, 8);
+    sstable_append_be(&out, (uint32_t)stats->min_deletion_time, 4);
+    sstable_append_be(&out, (uint32_t)stats->max_deletion_time, 4);
+    sstable_append_be(&out, (uint32_t)stats->min_ttl, 4);
+    sstable_append_be(&out, (uint32_t)stats->max_ttl, 4);
+    sstable_append_double(&out, -1.0);  // Compression ratio: uncompressed
+    sstable_append_drop_times(&out, stats);
+    sstable_append_be(&out, 0, 4);  // Level
+    sstable_append_be(&out, 0, 8);  // Repaired at: unrepaired
+    sstable_append_be(&out, 0, 4);  // Min clustering values
+    sstable_append_be(&out, 0, 4);  // Max clustering values
+    out.push_back(0);               // Legacy counter shards
+    sstable_append_be(&out, (uint64_t)stats->total_cells, 8);
+    sstable_append_be(&out, (uint64_t)stats->total_rows, 8);
+    sstable_append_be(&out, (uint64_t)(int64_t)-1, 8);  // Commit log lower bound: none
+    sstable_append_be(&out, 0, 4);
+    sstable_append_be(&out, 0, 4);  // Commit log intervals
+    out.push_back(0);               // Pending repair
+    out.push_back(0);               // Transient
+    out.push_back(0);               // Originating host id
+    
+    // Serialization header: encoding stats (NO_STATS), key, clustering and column types
+    std::string& header = components[SSTABLE_METADATA_HEADER];
+    sstable_write_vint(&header, 0);
+    sstable_write_vint(&header, 0);
+    sstable_write_vint(&header, 0);
+    if (writer->partition_key->size() == 1) {
+        sstable_append_vint_bytes(&header, sstable_marshal_name((*writer->partition_key)[0]));
+    } else {
+        std::string key_type = SSTABLE_MARSHAL_PACKAGE "CompositeType(";
+        for (size_t i = 0; i < writer->partition_key->size(); i++) {
+            key_type += (i > 0 ? "," : "") + sstable_marshal_name((*writer->partition_key)[i]);
+        }
+        key_type += ")";
+        sstable_append_vint_bytes(&header, key_type);
+    }
+    sstable_write_vint(&header, writer->clustering->size());
+    for (size_t i = 0; i < writer->clustering->size(); i++) {
+        sstable_append_vint_bytes(&header, sstable_marshal_name((*writer->clustering)[i]));
+    }
+    sstable_write_vint(&header, 0);  // Static columns
+    sstable_write_vint(&header, writer->columns->size());
+    for (size_t i = 0; i < writer->columns->size(); i++) {
+        sstable_append_vint_bytes(&header, (*writer->columns)[i].name);
+        sstable_append_vint_bytes(&header, sstable_marshal_name((*writer->columns)[i]));
+    }
+    
+    // Component count and table of contents, each followed by a CRC32, then
+    // every component followed by its own
+    std::string file;
+    sstable_append_be(&file, 4, 4);
+    uint32_t crc = crc32_update(0, file.data(), file.size());
+    sstable_append_be(&file, crc, 4);
+    
+    std::string toc;
+    uint32_t position = 4 + 8 * 4 + 2 * 4;
+    for (int type = 0; type < 4; type++) {
+        sstable_append_be(&toc, (uint64_t)type, 4);
+        sstable_append_be(&toc, position, 4);
+        position += (uint32_t)components[type].size() + 4;
+    }
+    file += toc;
+    sstable_append_be(&file, crc32_update(crc, toc.data(), toc.size()), 4);
+    
+    for (int type = 0; type < 4; type++) {
+        file += components[type];
+        sstable_append_be(&file, crc32_update(0, components[type].data(), components[type].size()), 4);
+    }
+    
+    return file;
+}
+
+// Sort, merge and write the buffered rows as one SSTable
+static void sstable_flush_rows(sstable_flush_t* flush) {
+    sstable_writer_t* writer = flush->writer;
+    std::vector<sstable_row_t>& rows = *writer->rows;
+    
+    std::vector<size_t> order(rows.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    sstable_row_order_t row_order = { writer };
+    std::sort(order.begin(), order.end(), row_order);
+    
+    // Merge writes of the same row, leaving only the first of each in order
+    std::vector<size_t> merged;
+    size_t partitions = 0;
+    merged.reserve(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        bool same_partition = false;
+        if (!merged.empty()) {
+            int rc = sstable_compare_rows(writer, rows[merged.back()], rows[order[i]], &same_partition);
+            if (rc == 0) {
+                sstable_merge_row(&rows[merged.back()], &rows[order[i]]);
+                continue;
+            }
+        }
+        partitions += same_partition ? 0 : 1;
+        merged.push_back(order[i]);
+    }
+    
+    // Bloom filter sized for the partitions, as Cassandra's FilterFactory does
+    double buckets = ceil(-log(writer->fp_chance) / (M_LN2 * M_LN2));
+    buckets = std::max(1.0, std::min(buckets, (double)SSTABLE_BLOOM_MAX_BUCKETS));
+    int hashes = std::max(1, (int)lround(buckets * M_LN2));
+    uint64_t filter_bits = (uint64_t)partitions * (uint64_t)buckets + SSTABLE_BLOOM_EXCESS_BITS;
+    std::vector<uint8_t> filter((size_t)((filter_bits + 63) / 64) * 8, 0);
+    uint64_t filter_capacity = (uint64_t)filter.size() * 8;
+    
+    sstable_stats_t stats;
+    sstable_stats_init(&stats);
+    
+    std::string data_path = flush->prefix + "Data.db";
+    std::string index_path = flush->prefix + "Index.db";
+    sstable_output_t data;
+    sstable_output_t index;
+    data.file = index.file = NULL;
+    
+    if (!sstable_output_open(&data, &data_path, true) || !sstable_output_open(&index, &index_path, false)) {
+        flush->error = errno;
+        flush->error_path = data.file ? index_path : data_path;
+        if (data.file) {
+            sstable_output_close(&data);
+        }
+        return;
+    }
+    
+    std::string summary_offsets;
+    std::string summary_entries;
+    std::string buffer;
+    std::string body;
+    bool deletion_seen = false;
+    bool ok = true;
+    size_t partition_count = 0;
+    const sstable_output_t* failed = NULL;
+    
+    size_t i = 0;
+    while (ok && i < merged.size()) {
+        const sstable_row_t& first = rows[merged[i]];
+        uint64_t partition_start = data.position;
+        
+        // Index entry: key, Data.db position, no row index
+        uint64_t index_start = index.position;
+        buffer.clear();
+        sstable_append_be(&buffer, first.key.size(), 2);
+        buffer += first.key;
+        sstable_write_vint(&buffer, partition_start);
+        sstable_write_vint(&buffer, 0);
+        if (!sstable_output_write(&index, buffer.data(), buffer.size())) {
+            ok = false;
+            failed = &index;
+            break;
+        }
+        if (partition_count % SSTABLE_MIN_INDEX_INTERVAL == 0) {
+            sstable_append_le(&summary_offsets, summary_entries.size(), 4);
+            summary_entries += first.key;
+            sstable_append_le(&summary_entries, index_start, 8);
+        }
+        
+        uint64_t hash[2];
+        sstable_murmur3_hash(first.key.data(), first.key.size(), hash);
+        uint64_t probe = hash[1];
+        for (int h = 0; h < hashes; h++) {
+            uint64_t bit = (uint64_t)llabs((long long)((int64_t)probe % (int64_t)filter_capacity));
+            filter[(size_t)(bit >> 3)] |= (uint8_t)(1 << (bit & 7));
+            probe += hash[0];
+        }
+        sstable_stats_key(&stats, first.key);
+        
+        // Partition header: key and a live partition deletion
+        buffer.clear();
+        sstable_append_be(&buffer, first.key.size(), 2);
+        buffer += first.key;
+        sstable_append_be(&buffer, SSTABLE_NO_DELETION_TIME, 4);
+        sstable_append_be(&buffer, 0x8000000000000000ULL, 8);
+        
+        uint64_t previous_start = 0;
+        int64_t cells = 0;
+        size_t end = i;
+        while (end < merged.size() && rows[merged[end]].token == first.token && rows[merged[end]].key == first.key) {
+            const sstable_row_t& row = rows[merged[end]];
+            uint64_t row_start = data.position - partition_start + buffer.size();
+            sstable_append_row(&buffer, &body, writer, row, row_start - previous_start);
+            previous_start = row_start;
+            
+            sstable_stats_liveness(&stats, row.liveness, &deletion_seen);
+            for (size_t c = 0; c < row.cells.size(); c++) {
+                if (row.cells[c].present) {
+                    sstable_stats_liveness(&stats, row.cells[c].liveness, &deletion_seen);
+                    cells++;
+                }
+            }
+            stats.total_rows++;
+            
+            if (buffer.size() >= SSTABLE_CHUNK_SIZE) {
+                if (!sstable_output_write(&data, buffer.data(), buffer.size())) {
+                    ok = false;
+                    break;
+                }
+                buffer.clear();
+            }
+            end++;
+        }
+        buffer.push_back((char)SSTABLE_END_OF_PARTITION);
+        if (!ok || !sstable_output_write(&data, buffer.data(), buffer.size())) {
+            ok = false;
+            failed = &data;
+            break;
+        }
+        
+        sstable_histogram_add(stats.size_offsets, &stats.size_buckets, (int64_t)(data.position - partition_start));
+        sstable_histogram_add(stats.cell_offsets, &stats.cell_buckets, cells);
+        stats.total_cells += cells;
+        partition_count++;
+        i = end;
+    }
+    
+    int saved_errno = errno;
+    bool data_closed = sstable_output_close(&data);
+    bool index_closed = sstable_output_close(&index);
+    if (!ok || !data_closed || !index_closed) {
+        flush->error = ok ? errno : saved_errno;
+        flush->error_path = failed ? *failed->path : (!data_closed ? data_path : index_path);
+        return;
+    }
+    
+    // Summary: sampling parameters, entry offsets (native order, counted
+    // from the start of the offsets), entries, then the first and last keys
+    std::string summary;
+    uint32_t offsets_size = (uint32_t)summary_offsets.size();
+    sstable_append_be(&summary, SSTABLE_MIN_INDEX_INTERVAL, 4);
+    sstable_append_be(&summary, offsets_size / 4, 4);
+    sstable_append_be(&summary, offsets_size + summary_entries.size(), 8);
+    sstable_append_be(&summary, SSTABLE_BASE_SAMPLING_LEVEL, 4);
+    sstable_append_be(&summary, (partition_count + SSTABLE_MIN_INDEX_INTERVAL - 1) / SSTABLE_MIN_INDEX_INTERVAL, 4);
+    for (size_t offset = 0; offset < summary_offsets.size(); offset += 4) {
+        uint32_t entry = 0;
+        for (int b = 3; b >= 0; b--) {
+            entry = (entry << 8) | (unsigned char)summary_offsets[offset + (size_t)b];
+        }
+        sstable_append_le(&summary, entry + offsets_size, 4);
+    }
+    summary += summary_entries;
+    const std::string& first_key = rows[merged.front()].key;
+    const std::string& last_key = rows[merged.back()].key;
+    sstable_append_be(&summary, first_key.size(), 4);
+    summary += first_key;
+    sstable_append_be(&summary, last_key.size(), 4);
+    summary += last_key;
+    
+    std::string filter_file;
+    sstable_append_be(&filter_file, (uint64_t)hashes, 4);
+    sstable_append_be(&filter_file, filter.size() / 8, 4);
+    filter_file.append((const char*)filter.data(), filter.size());
+    
+    std::string crc_file;
+    sstable_append_be(&crc_file, SSTABLE_CHUNK_SIZE, 4);
+    crc_file += data.chunk_crcs;
+    
+    char digest[16];
+    snprintf(digest, sizeof(digest), "%u", data.digest);
+    
+    const char* toc = "Data.db\nIndex.db\nSummary.db\nFilter.db\nStatistics.db\nCRC.db\nDigest.crc32\nTOC.txt\n";
+    
+    // TOC.txt last: an SSTable without one is incomplete
+    if (sstable_write_file(flush, "Summary.db", summary) &&
+        sstable_write_file(flush, "Filter.db", filter_file) &&
+        sstable_write_file(flush, "Statistics.db", sstable_statistics(writer, &stats)) &&
+        sstable_write_file(flush, "CRC.db", crc_file) &&
+        sstable_write_file(flush, "Digest.crc32", digest)) {
+        sstable_write_file(flush, "TOC.txt", toc);
+    }
+}
+
+static void* sstable_flush_without_gvl(void* ptr) {
+    sstable_flush_t* flush = (sstable_flush_t*)ptr;
+    
+    try {
+        sstable_flush_rows(flush);
+    } catch (const std::bad_alloc&) {
+        flush->error = ENOMEM;
+        flush->error_path = flush->prefix + "Data.db";
+    }
+    
+    return NULL;
+}
+
+// Write the buffered rows as the next generation; nil when nothing is buffered
+static VALUE sstable_writer_flush_buffer(VALUE self, sstable_writer_t* writer) {
+    if (writer->rows->empty()) {
+        return Qnil;
+    }
+    
+    sstable_flush_t* flush = new sstable_flush_t();
+    flush->writer = writer;
+    flush->error = 0;
+    char name[48];
+    snprintf(name, sizeof(name), "/nb-%ld-big-", writer->generation);
+    flush->prefix = *writer->directory + name;
+    
+    writer->flushing = true;
+    gvl_release_call(sstable_flush_without_gvl, flush, NULL, NULL);
+    writer->flushing = false;
+    
+    // On failure the rows stay buffered, so a retry rewrites the same generation
+    int error = flush->error;
+    VALUE path = error ? rb_str_new(flush->error_path.data(), (long)flush->error_path.size())
+                       : rb_str_new_cstr((flush->prefix + "Data.db").c_str());
+    delete flush;
+    if (error) {
+        rb_syserr_fail_str(error, path);
+    }
+    
+    writer->written->push_back(StringValueCStr(path));
+    writer->generation++;
+    std::vector<sstable_row_t>().swap(*writer->rows);
+    writer->buffered_bytes = 0;
+    RB_GC_GUARD(self);
+    
+    return path;
+}
+
+static void sstable_encode_required(const sstable_column_t& column, VALUE value, std::string* out) {
+    if (NIL_P(value)) {
+        rb_raise(rb_eArgError, "Missing value for primary key column %s", column.name.c_str());
+    }
+    sstable_encode_value(column.type, value, out);
+}
+
+// Ruby method: writer.add(values, timestamp, ttl) -> Data.db path or nil
+// values holds one value per column, in the order given to .new; nil
+// values of regular columns are left unset. timestamp is in microseconds
+// (nil for now), ttl in seconds (nil or 0 for none). Returns the path of
+// the SSTable written when the row filled the buffer.
+static VALUE sstable_writer_add(VALUE self, VALUE values, VALUE timestamp, VALUE ttl) {
+    sstable_writer_t* writer = sstable_writer_get(self);
+    Check_Type(values, T_ARRAY);
+    if (RARRAY_LEN(values) != writer->input_count) {
+        rb_raise(rb_eArgError, "Expected %ld values, got %ld", writer->input_count, RARRAY_LEN(values));
+    }
+    
+    sstable_liveness_t liveness;
+    liveness.timestamp = NIL_P(timestamp) ? sstable_now_us() : NUM2LL(timestamp);
+    liveness.ttl = NIL_P(ttl) ? 0 : NUM2INT(ttl);
+    liveness.expires_at = SSTABLE_NO_DELETION_TIME;
+    if (liveness.ttl < 0 || liveness.ttl > SSTABLE_MAX_TTL) {
+        rb_raise(rb_eArgError, "ttl must be between 0 and %d seconds", SSTABLE_MAX_TTL);
+    }
+    if (liveness.ttl > 0) {
+        int64_t expires_at = (int64_t)time(NULL) + liveness.ttl;
+        if (expires_at >= SSTABLE_NO_DELETION_TIME) {
+            rb_raise(rb_eArgError, "ttl expires after 2038-01-19, past Cassandra's limit");
+        }
+        liveness.expires_at = (int32_t)expires_at;
+    }
+    
+    sstable_row_t* row = writer->pending;
+    row->key.clear();
+    row->liveness = liveness;
+    
+    const std::vector<sstable_column_t>& partition_key = *writer->partition_key;
+    if (partition_key.size() == 1) {
+        sstable_encode_required(partition_key[0], rb_ary_entry(values, partition_key[0].input_index), &row->key);
+    } else {
+        // CompositeType: each component length-prefixed and followed by an end-of-component byte
+        for (size_t i = 0; i < partition_key.size(); i++) {
+            writer->scratch->clear();
+            sstable_encode_required(partition_key[i], rb_ary_entry(values, partition_key[i].input_index),
+                                    writer->scratch);
+            if (writer->scratch->size() > 0xffff) {
+                rb_raise(rb_eArgError, "Partition key component %s is longer than 65535 bytes",
+                         partition_key[i].name.c_str());
+            }
+            sstable_append_be(&row->key, writer->scratch->size(), 2);
+            row->key += *writer->scratch;
+            row->key.push_back(0);
+        }
+    }
+    if (row->key.empty()) {
+        rb_raise(rb_eArgError, "Partition key must not be empty");
+    }
+    if (row->key.size() > 0xffff) {
+        rb_raise(rb_eArgError, "Partition key is longer than 65535 bytes");
+    }
+    
+    row->clustering.resize(writer->clustering->size());
+    for (size_t i = 0; i < writer->clustering->size(); i++) {
+        const sstable_column_t& column = (*writer->clustering)[i];
+        row->clustering[i].clear();
+        sstable_encode_required(column, rb_ary_entry(values, column.input_index), &row->clustering[i]);
+    }
+    
+    row->cells.resize(writer->columns->size());
+    for (size_t i = 0; i < writer->columns->size(); i++) {
+        const sstable_column_t& column = (*writer->columns)[i];
+        sstable_cell_t& cell = row->cells[i];
+        VALUE value = rb_ary_entry(values, column.input_index);
+        cell.liveness = liveness;
+        cell.value.clear();
+        cell.present = !NIL_P(value);
+        if (cell.present) {
+            sstable_encode_value(column.type, value, &cell.value);
+        }
+    }
+    
+    uint64_t hash[2];
+    sstable_murmur3_hash(row->key.data(), row->key.size(), hash);
+    row->token = sstable_token(hash);
+    
+    size_t size = sizeof(sstable_row_t) + row->key.size() + row->cells.size() * sizeof(sstable_cell_t);
+    for (size_t i = 0; i < row->clustering.size(); i++) {
+        size += sizeof(std::string) + row->clustering[i].size();
+    }
+    for (size_t i = 0; i < row->cells.size(); i++) {
+        size += row->cells[i].value.size();
+    }
+    
+    writer->rows->push_back(std::move(*row));
+    *row = sstable_row_t();
+    writer->buffered_bytes += size;
+    
+    if (writer->buffered_bytes >= writer->buffer_limit) {
+        return sstable_writer_flush_buffer(self, writer);
+    }
+    return Qnil;
+}
+
+// Ruby method: writer.flush -> Data.db path, or nil when nothing is buffered
+static VALUE sstable_writer_flush(VALUE self) {
+    return sstable_writer_flush_buffer(self, sstable_writer_get(self));
+}
+
+static VALUE sstable_writer_buffered_rows(VALUE self) {
+    return SIZET2NUM(sstable_writer_get(self)->rows->size());
+}
+
+static VALUE sstable_writer_buffered_bytes(VALUE self) {
+    return SIZET2NUM(sstable_writer_get(self)->buffered_bytes);
+}
+
+// Ruby method: writer.sstables -> Data.db paths written so far
+static VALUE sstable_writer_sstables(VALUE self) {
+    sstable_writer_t* writer = sstable_writer_get(self);
+    VALUE paths = rb_ary_new_capa((long)writer->written->size());
+    
+    for (size_t i = 0; i < writer->written->size(); i++) {
+        rb_ary_push(paths, rb_str_new((*writer->written)[i].data(), (long)(*writer->written)[i].size()));
+    }
+    
+    return paths;
+}
+
+// Ruby method: CassandraCpp::NativeSSTableWriter.new(directory, columns, generation, buffer_size, fp_chance)
+// columns: [[name, cql_type, kind, descending], ...] with kind :partition_key,
+// :clustering or :regular, key and clustering columns in their declared
+// order. SSTables are numbered from generation; rows are flushed once
+// about buffer_size bytes are buffered.
+static VALUE sstable_writer_new(VALUE klass, VALUE directory, VALUE columns, VALUE generation, VALUE buffer_size,
+                                VALUE fp_chance) {
+    FilePathValue(directory);
+    Check_Type(columns, T_ARRAY);
+    long first_generation = NUM2LONG(generation);
+    long long limit = NUM2LL(buffer_size);
+    double chance = NUM2DBL(fp_chance);
+    
+    if (first_generation < 1) {
+        rb_raise(rb_eArgError, "generation must be at least 1");
+    }
+    if (limit < 1) {
+        rb_raise(rb_eArgError, "buffer_size must be positive");
+    }
+    if (!(chance > 0.0 && chance <= 1.0)) {
+        rb_raise(rb_eArgError, "bloom_filter_fp_chance must be in (0, 1]");
+    }
+    
+    // Check every column before building anything
+    ID partition_key_id = rb_intern("partition_key");
+    ID clustering_id = rb_intern("clustering");
+    ID regular_id = rb_intern("regular");
+    long key_count = 0;
+    for (long i = 0; i < RARRAY_LEN(columns); i++) {
+        VALUE column = rb_ary_entry(columns, i);
+        Check_Type(column, T_ARRAY);
+        if (RARRAY_LEN(column) != 4) {
+            rb_raise(rb_eArgError, "Columns must be [name, type, kind, descending]");
+        }
+        
+        VALUE name = rb_ary_entry(column, 0);
+        VALUE type_name = rb_ary_entry(column, 1);
+        VALUE kind = rb_ary_entry(column, 2);
+        StringValue(name);
+        const sstable_type_t* type = sstable_type_from_cql(type_name);
+        if (!type) {
+            rb_raise(rb_eArgError, "Column %s has type %" PRIsVALUE ", which SSTables cannot be written with",
+                     StringValueCStr(name), type_name);
+        }
+        
+        ID kind_id = SYMBOL_P(kind) ? SYM2ID(kind) : 0;
+        if (kind_id == partition_key_id) {
+            key_count++;
+        } else if (kind_id == clustering_id) {
+            if (type->kind == SSTABLE_TYPE_DECIMAL) {
+                rb_raise(rb_eArgError, "Clustering column %s is a decimal, which SSTables cannot be written with",
+                         StringValueCStr(name));
+            }
+        } else if (kind_id != regular_id) {
+            rb_raise(rb_eArgError, "Column %s is %" PRIsVALUE "; only partition key, clustering and regular "
+                     "columns can be written", StringValueCStr(name), kind);
+        }
+    }
+    if (key_count == 0) {
+        rb_raise(rb_eArgError, "A partition key column is required");
+    }
+    
+    sstable_writer_t* writer = ALLOC(sstable_writer_t);
+    writer->directory = NULL;
+    writer->partition_key = NULL;
+    writer->clustering = NULL;
+    writer->columns = NULL;
+    writer->rows = NULL;
+    writer->pending = NULL;
+    writer->scratch = NULL;
+    writer->written = NULL;
+    writer->buffered_bytes = 0;
+    writer->buffer_limit = (size_t)limit;
+    writer->fp_chance = chance;
+    writer->generation = first_generation;
+    writer->input_count = RARRAY_LEN(columns);
+    writer->flushing = false;
+    VALUE obj = TypedData_Wrap_Struct(klass, &sstable_writer_type, writer);
+    
+    writer->directory = new std::string(RSTRING_PTR(directory), (size_t)RSTRING_LEN(directory));
+    writer->partition_key = new std::vector<sstable_column_t>();
+    writer->clustering = new std::vector<sstable_column_t>();
+    writer->columns = new std::vector<sstable_column_t>();
+    writer->rows = new std::vector<sstable_row_t>();
+    writer->pending = new sstable_row_t();
+    writer->scratch = new std::string();
+    writer->written = new std::vector<std::string>();
+    
+    for (long i = 0; i < RARRAY_LEN(columns); i++) {
+        VALUE column = rb_ary_entry(columns, i);
+        VALUE name = rb_ary_entry(column, 0);
+        ID kind_id = SYM2ID(rb_ary_entry(column, 2));
+        
+        sstable_column_t entry;
+        entry.name.assign(RSTRING_PTR(name), (size_t)RSTRING_LEN(name));
+        entry.type = sstable_type_from_cql(rb_ary_entry(column, 1));
+        entry.reversed = kind_id == clustering_id && RTEST(rb_ary_entry(column, 3));
+        entry.input_index = i;
+        
+        if (kind_id == partition_key_id) {
+            writer->partition_key->push_back(entry);
+        } else if (kind_id == clustering_id) {
+            writer->clustering->push_back(entry);
+        } else {
+            writer->columns->push_back(entry);
+        }
+    }
+    std::stable_sort(writer->columns->begin(), writer->columns->end(), sstable_column_less);
+    
+    return obj;
+}
+
+// Ruby method: NativeSSTableWriter.token(partition_key) -> Integer
+// Murmur3Partitioner token of a serialized partition key, the order rows
+// are written in
+static VALUE sstable_writer_token(VALUE klass, VALUE partition_key) {
+    StringValue(partition_key);
+    
+    uint64_t hash[2];
+    sstable_murmur3_hash(RSTRING_PTR(partition_key), (size_t)RSTRING_LEN(partition_key), hash);
+    
+    return LL2NUM(sstable_token(hash));
+}
+
+void init_sstable_writer() {
+    rb_cNativeSSTableWriter = rb_define_class_under(rb_cCassandraCpp, "NativeSSTableWriter", rb_cObject);
+    rb_undef_alloc_func(rb_cNativeSSTableWriter);
+    
+    rb_define_singleton_method(rb_cNativeSSTableWriter, "new", (VALUE(*)(...))sstable_writer_new, 5);
+    rb_define_singleton_method(rb_cNativeSSTableWriter, "token", (VALUE(*)(...))sstable_writer_token, 1);
+    rb_define_method(rb_cNativeSSTableWriter, "add", (VALUE(*)(...))sstable_writer_add, 3);
+    rb_define_method(rb_cNativeSSTableWriter, "flush", (VALUE(*)(...))sstable_writer_flush, 0);
+    rb_define_method(rb_cNativeSSTableWriter, "buffered_rows", (VALUE(*)(...))sstable_writer_buffered_rows, 0);
+    rb_define_method(rb_cNativeSSTableWriter, "buffered_bytes", (VALUE(*)(...))sstable_writer_buffered_bytes, 0);
+    rb_define_method(rb_cNativeSSTableWriter, "sstables", (VALUE(*)(...))sstable_writer_sstables, 0);
+}
\ No newline at end of file
@@ -2,19 +2,29 @@
 #include <limits.h>
 
 // Memory management functions
+static void statement_mark(void* ptr) {
+    statement_wrapper_t* wrapper = (statement_wrapper_t*)ptr;
+    if (wrapper) {
+        rb_gc_mark(wrapper->partition_key);
+    }
+}
+
 static void statement_free(void* ptr) {
     statement_wrapper_t* wrapper = (statement_wrapper_t*)ptr;
     if (wrapper) {
         if (wrapper->statement) {
             cass_statement_free(wrapper->statement);
         }
+        if (wrapper->capture) {
+            traffic_capture_free(wrapper->capture);
+        }
         xfree(wrapper);
     }
 }
 
 const rb_data_type_t statement_type = {
     "CassandraCpp::NativeStatement",
-    { 0, statement_free, 0 },
+    { statement_mark, statement_free, 0 },
     0, 0,
     RUBY_TYPED_FREE_IMMEDIATELY
 };
@@ -235,6 +245,10 @@ CassError bind_ruby_value_to_statement(CassStatement* statement, size_t index, V
                 return cass_statement_bind_int64(statement, index, timestamp_ms);
             }
             
+            if (float_vector_p(value)) {
+                return bind_float_vector_to_statement(statement, index, 0, value);
+            }
+            
             // Get class name for other types
             VALUE klass_name = rb_class_name(klass);
             const char* class_name = StringValueCStr(klass_name);
@@ -280,7 +294,7 @@ CassError bind_ruby_value_to_statement(CassStatement* statement, size_t index, V
 }
 
 // Statement methods
-static VALUE statement_bind_by_index(int argc, VALUE* argv, VALUE self) {
+static VALUE statement_bind_by_index_body(int argc, VALUE* argv, VALUE self) {
     VALUE index, value;
     rb_scan_args(argc, argv, "2", &index, &value);
     
@@ -288,18 +302,42 @@ static VALUE statement_bind_by_index(int argc, VALUE* argv, VALUE self) {
     TypedData_Get_Struct(self, statement_wrapper_t, &statement_type, wrapper);
     
     size_t idx = NUM2SIZET(index);
-    CassError rc = bind_ruby_value_to_statement(wrapper->statement, idx, value);
+    size_t dimensions = wrapper->prepared
+        ? float_vector_dimensions(cass_prepared_parameter_data_type(wrapper->prepared, idx))
+        : 0;
+    CassError rc;
+    if (dimensions > 0 && !NIL_P(value)) {
+        rc = bind_float_vector_to_statement(wrapper->statement, idx, dimensions, value);
+    } else {
+        rc = bind_ruby_value_to_statement(wrapper->statement, idx, value);
+    }
+    CASSANDRA_CPP_PROBE3(bind, wrapper->query_id, idx, (int)rc);
     
     if (rc != CASS_OK) {
         rb_raise(rb_eCassandraError, "Failed to bind parameter at index %zu: %s", idx, cass_error_desc(rc));
     }
     
+    if (wrapper->capture) {
+        traffic_capture_bind(wrapper->capture, idx, value);
+    }
+    
+    prepared_statement_wrapper_t* prepared_wrapper;
+    TypedData_Get_Struct(wrapper->prepared_ref, prepared_statement_wrapper_t, &prepared_statement_type, prepared_wrapper);
+    wrapper->partition_key = hot_partitions_bind(prepared_wrapper->hot, wrapper->partition_key, idx, value);
+    
     return self;
 }
 
-static VALUE statement_execute(VALUE self) {
+static VALUE statement_bind_by_index(int argc, VALUE* argv, VALUE self) {
+    return gvl_span_call(GVL_ENTRY_BIND, statement_bind_by_index_body, argc, argv, self);
+}
+
+// Run the bound statement to completion and return the driver result (owned
+// by the caller), with timing stamped up to the moment the GVL was reacquired
+static const CassResult* statement_run(VALUE self, execution_info_t* info, phase_stats_t** stats) {
     statement_wrapper_t* statement_wrapper;
     TypedData_Get_Struct(self, statement_wrapper_t, &statement_type, statement_wrapper);
+    request_timing_t* timing = &info->timing;
     
     // Get session from prepared statement
     VALUE prepared_statement = rb_iv_get(self, "@prepared_statement");
@@ -308,51 +346,166 @@ static VALUE statement_execute(VALUE self) {
     session_wrapper_t* session_wrapper;
     TypedData_Get_Struct(session, session_wrapper_t, &session_type, session_wrapper);
     
+    prepared_statement_wrapper_t* prepared_wrapper;
+    TypedData_Get_Struct(prepared_statement, prepared_statement_wrapper_t, &prepared_statement_type, prepared_wrapper);
+    *stats = prepared_wrapper->stats;
+    
+    // Queue time starts now, however long ago the statement was bound
+    timing->started_ns = monotonic_now_ns();
+    timing->query_id = statement_wrapper->query_id;
+    
+    // The bound statement stays with its wrapper if admission raises
+    circuit_breaker_t* breaker = circuit_breaker_for_prepared(prepared_statement, prepared_wrapper);
+    priority_class_t priority = priority_current();
+    request_admit(breaker, session_wrapper->gate, priority, NULL);
+    
     // Execute statement
+    adaptive_timeout_t adaptive = adaptive_timeout_apply(statement_wrapper->statement, prepared_wrapper->stats);
     CassFuture* future = cass_session_execute(session_wrapper->session, statement_wrapper->statement);
+    timing->submitted_ns = monotonic_now_ns();
+    CASSANDRA_CPP_PROBE3(request__submit, timing->query_id, future, timing->submitted_ns - timing->started_ns);
     
-    // Wait for result
+    // Wait for result without holding the GVL, racing a speculative
+    // execution once the adaptive delay has passed
+    inflight_request_t request = { future, breaker, session_wrapper->gate, priority, timing->submitted_ns };
+    future = adaptive_timeout_wait(session_wrapper->session, statement_wrapper->statement, &request, &adaptive,
+                                   prepared_wrapper->idempotent, timing);
     CassError rc = cass_future_error_code(future);
+    CASSANDRA_CPP_PROBE4(request__complete, timing->query_id, future, timing->ready_ns - timing->submitted_ns, (int)rc);
+    circuit_breaker_record(breaker, rc, timing->ready_ns - timing->submitted_ns);
+    priority_gate_exit(session_wrapper->gate, priority, timing->ready_ns - timing->submitted_ns);
+    traffic_recorder_write(statement_wrapper->capture, timing, rc);
     if (rc != CASS_OK) {
         raise_cassandra_error(future, "prepared statement execution");
     }
     
     // Get result
     const CassResult* result = cass_future_get_result(future);
+    execution_info_capture(info, future, session);
+    cass_future_free(future);
+    hot_partitions_record(prepared_wrapper->hot, statement_wrapper->partition_key, result);
     
-    // Convert result to Ruby array (reuse from session.cpp)
-    VALUE rows = rb_ary_new();
-    CassIterator* iterator = cass_iterator_from_result(result);
-    
-    while (cass_iterator_next(iterator)) {
-        const CassRow* row = cass_iterator_get_row(iterator);
-        size_t column_count = cass_result_column_count(result);
-        
-        VALUE row_hash = rb_hash_new();
-        
-        for (size_t i = 0; i < column_count; i++) {
-            const char* column_name;
-            size_t column_name_length;
-            cass_result_column_name(result, i, &column_name, &column_name_length);
-            
-            const CassValue* value = cass_row_get_column(row, i);
-            VALUE ruby_value = convert_cass_value_to_ruby(value);
-            
-            VALUE column_key = rb_str_new(column_name, column_name_length);
-            rb_hash_aset(row_hash, column_key, ruby_value);
-        }
-        
-        rb_ary_push(rows, row_hash);
-    }
+    return result;
+}
+
+static VALUE statement_execute_body(int argc, VALUE* argv, VALUE self) {
+    execution_info_t info;
+    execution_info_init(&info);
+    phase_stats_t* stats;
+    const CassResult* result = statement_run(self, &info, &stats);
+    
+    VALUE rows = convert_result_to_ruby(result, info.timing.query_id);
+    info.timing.decoded_ns = monotonic_now_ns();
+    record_request_timing(stats, &info.timing);
+    execution_info_attach(rows, &info);
     
     // Cleanup
-    cass_iterator_free(iterator);
     cass_result_free(result);
-    cass_future_free(future);
     
     return rows;
 }
 
+static VALUE statement_execute(VALUE self) {
+    return gvl_span_call(GVL_ENTRY_EXECUTE, statement_execute_body, 0, NULL, self);
+}
+
+// Execute and keep the driver result natively; rows are converted on demand
+static VALUE statement_execute_result_body(int argc, VALUE* argv, VALUE self) {
+    execution_info_t info;
+    execution_info_init(&info);
+    phase_stats_t* stats;
+    const CassResult* result = statement_run(self, &info, &stats);
+    record_request_timing(stats, &info.timing);
+    
+    VALUE result_obj = create_result_object(result, &info);
+    return result_obj;
+}
+
+static VALUE statement_execute_result(VALUE self) {
+    return gvl_span_call(GVL_ENTRY_EXECUTE, statement_execute_result_body, 0, NULL, self);
+}
+
+// Ruby method: statement.tracing = true, to read the request's trace afterwards
+static VALUE statement_set_tracing(VALUE self, VALUE enabled) {
+    statement_wrapper_t* statement_wrapper;
+    TypedData_Get_Struct(self, statement_wrapper_t, &statement_type, statement_wrapper);
+    
+    cass_statement_set_tracing(statement_wrapper->statement, RTEST(enabled) ? cass_true : cass_false);
+    return enabled;
+}
+
+// Describe this bound statement as a paged request
+static void statement_paged_request(VALUE self, VALUE page_size, paged_request_t* request) {
+    statement_wrapper_t* statement_wrapper;
+    TypedData_Get_Struct(self, statement_wrapper_t, &statement_type, statement_wrapper);
+    
+    // Get session from prepared statement
+    VALUE prepared_statement = rb_iv_get(self, "@prepared_statement");
+    VALUE session = rb_iv_get(prepared_statement, "@session");
+    
+    session_wrapper_t* session_wrapper;
+    TypedData_Get_Struct(session, session_wrapper_t, &session_type, session_wrapper);
+    
+    prepared_statement_wrapper_t* prepared_wrapper;
+    TypedData_Get_Struct(prepared_statement, prepared_statement_wrapper_t, &prepared_statement_type, prepared_wrapper);
+    
+    adaptive_timeout_apply(statement_wrapper->statement, prepared_wrapper->stats);
+    
+    request->session = session_wrapper->session;
+    request->statement = statement_wrapper->statement;
+    request->owns_statement = false;
+    request->page_size = page_size_from_ruby(page_size);
+    request->stats = prepared_wrapper->stats;
+    request->breaker = circuit_breaker_for_prepared(prepared_statement, prepared_wrapper);
+    request->gate = session_wrapper->gate;
+    request->priority = priority_current();
+    request->capture = traffic_capture_copy(statement_wrapper->capture);
+    request->started_ns = monotonic_now_ns();
+    request->operation = "prepared statement execution";
+    request->query_id = statement_wrapper->query_id;
+}
+
+// Stream rows page by page, yielding each one as it is decoded
+static VALUE statement_each_row(VALUE self, VALUE reuse, VALUE as_array, VALUE page_size) {
+    rb_need_block();
+    
+    row_stream_options_t options = { RTEST(reuse), RTEST(as_array) };
+    paged_request_t request;
+    statement_paged_request(self, page_size, &request);
+    
+    return stream_statement_rows(&request, &options);
+}
+
+// Yield the rows page by page with the paging state that resumes after
+// each page; paging_state (from an earlier page) resumes a previous scan
+static VALUE statement_each_page(VALUE self, VALUE as_array, VALUE page_size, VALUE paging_state) {
+    rb_need_block();
+    if (!NIL_P(paging_state)) {
+        StringValue(paging_state);
+    }
+    
+    paged_request_t request;
+    statement_paged_request(self, page_size, &request);
+    
+    // The bound statement is not shared, so the token can go straight onto it
+    if (!NIL_P(paging_state)) {
+        cass_statement_set_paging_state_token(request.statement, RSTRING_PTR(paging_state),
+                                              (size_t)RSTRING_LEN(paging_state));
+    }
+    
+    return stream_statement_pages(&request, RTEST(as_array));
+}
+
+// Fold all pages into per-group aggregates natively
+static VALUE statement_aggregate(VALUE self, VALUE group_columns, VALUE aggregates, VALUE page_size) {
+    aggregate_check_arguments(group_columns, aggregates);
+    
+    paged_request_t request;
+    statement_paged_request(self, page_size, &request);
+    
+    return aggregate_statement_rows(&request, group_columns, aggregates);
+}
+
 static VALUE statement_execute_async(VALUE self) {
     statement_wrapper_t* statement_wrapper;
     TypedData_Get_Struct(self, statement_wrapper_t, &statement_type, statement_wrapper);
@@ -364,11 +517,33 @@ static VALUE statement_execute_async(VALUE self) {
     session_wrapper_t* session_wrapper;
     TypedData_Get_Struct(session, session_wrapper_t, &session_type, session_wrapper);
     
+    prepared_statement_wrapper_t* prepared_wrapper;
+    TypedData_Get_Struct(prepared_statement, prepared_statement_wrapper_t, &prepared_statement_type, prepared_wrapper);
+    
+    request_timing_t timing = { monotonic_now_ns(), 0, 0, 0, 0, statement_wrapper->query_id };
+    
+    circuit_breaker_t* breaker = circuit_breaker_for_prepared(prepared_statement, prepared_wrapper);
+    priority_class_t priority = priority_current();
+    request_admit(breaker, session_wrapper->gate, priority, NULL);
+    
     // Execute statement asynchronously
+    adaptive_timeout_apply(statement_wrapper->statement, prepared_wrapper->stats);
     CassFuture* future = cass_session_execute(session_wrapper->session, statement_wrapper->statement);
+    timing.submitted_ns = monotonic_now_ns();
+    CASSANDRA_CPP_PROBE3(request__submit, timing.query_id, future, timing.submitted_ns - timing.started_ns);
     
     // Create Ruby Future object
-    VALUE future_obj = create_future_from_cass_future(future, session, FUTURE_TYPE_EXECUTE);
+    VALUE future_obj = create_timed_future(future, session, &timing, prepared_wrapper->stats, prepared_statement,
+                                           traffic_capture_copy(statement_wrapper->capture), breaker,
+                                           session_wrapper->gate, priority);
+    
+    future_wrapper_t* future_wrapper;
+    TypedData_Get_Struct(future_obj, future_wrapper_t, &future_type, future_wrapper);
+    // A copy: rebinding the statement before the future resolves must not
+    // change the partition the future records
+    if (!NIL_P(statement_wrapper->partition_key)) {
+        future_wrapper->partition_key = rb_obj_freeze(rb_ary_dup(statement_wrapper->partition_key));
+    }
     
     return future_obj;
 }
@@ -378,5 +553,10 @@ void init_statement() {
     rb_undef_alloc_func(rb_cStatement);
     rb_define_method(rb_cStatement, "bind", (VALUE(*)(...))statement_bind_by_index, -1);
     rb_define_method(rb_cStatement, "execute", (VALUE(*)(...))statement_execute, 0);
+    rb_define_method(rb_cStatement, "execute_result", (VALUE(*)(...))statement_execute_result, 0);
     rb_define_method(rb_cStatement, "execute_async", (VALUE(*)(...))statement_execute_async, 0);
+    rb_define_method(rb_cStatement, "tracing=", (VALUE(*)(...))statement_set_tracing, 1);
+    rb_define_method(rb_cStatement, "each_row", (VALUE(*)(...))statement_each_row, 3);
+    rb_define_method(rb_cStatement, "each_page", (VALUE(*)(...))statement_each_page, 3);
+    rb_define_method(rb_cStatement, "aggregate", (VALUE(*)(...))statement_aggregate, 3);
 }
\ No newline at end of file
@@ -0,0 +1,304 @@
+#include "cassandra_cpp.h"
+#include <math.h>
+#include <algorithm>
+
+// Cassandra 5 vector<float, n> values. The driver reports them as a custom
+// type whose value is n big-endian float32s. They surface in Ruby as
+// CassandraCpp::FloatVector, holding the same floats packed in native byte
+// order, and bind from a FloatVector, a packed String or an Array of
+// numbers as raw bytes instead of a list collection.
+
+#define FLOAT_VECTOR_CLASS_PREFIX "org.apache.cassandra.db.marshal.VectorType(org.apache.cassandra.db.marshal.FloatType"
+
+static VALUE rb_mNativeVector;
+static VALUE float_vector_class = Qnil;  // Resolved on first use (autoloaded)
+static ID id_buffer;
+
+typedef struct {
+    long index;
+    double score;
+} vector_score_t;
+
+static VALUE float_vector_class_get() {
+    if (NIL_P(float_vector_class)) {
+        float_vector_class = rb_const_get(rb_cCassandraCpp, rb_intern("FloatVector"));
+    }
+    return float_vector_class;
+}
+
+static float float_from_be(const unsigned char* bytes) {
+    uint32_t bits = ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) |
+                    ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3];
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static void float_to_be(float value, unsigned char* bytes) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bytes[0] = (unsigned char)(bits >> 24);
+    bytes[1] = (unsigned char)(bits >> 16);
+    bytes[2] = (unsigned char)(bits >> 8);
+    bytes[3] = (unsigned char)bits;
+}
+
+static float float_at(const char* buffer, size_t i) {
+    float value;
+    memcpy(&value, buffer + i * sizeof(float), sizeof(value));
+    return value;
+}
+
+// Dimensions of a vector<float, n> type, or 0 for any other type. The class
+// name reads "...VectorType(...FloatType, n)".
+size_t float_vector_dimensions(const CassDataType* data_type) {
+    if (data_type == NULL || cass_data_type_type(data_type) != CASS_VALUE_TYPE_CUSTOM) {
+        return 0;
+    }
+    
+    const char* name;
+    size_t name_length;
+    if (cass_data_type_class_name(data_type, &name, &name_length) != CASS_OK) {
+        return 0;
+    }
+    
+    size_t prefix_length = sizeof(FLOAT_VECTOR_CLASS_PREFIX) - 1;
+    if (name_length <= prefix_length || memcmp(name, FLOAT_VECTOR_CLASS_PREFIX, prefix_length) != 0) {
+        return 0;
+    }
+    
+    size_t dimensions = 0;
+    for (size_t i = prefix_length; i < name_length; i++) {
+        if (name[i] >= '0' && name[i] <= '9') {
+            dimensions = dimensions * 10 + (size_t)(name[i] - '0');
+        }
+    }
+    
+    return dimensions;
+}
+
+bool float_vector_p(VALUE value) {
+    return RTEST(rb_obj_is_kind_of(value, float_vector_class_get()));
+}
+
+// Decode a vector<float, n> value into a FloatVector
+VALUE float_vector_from_cass_value(const CassValue* value) {
+    const cass_byte_t* bytes;
+    size_t size;
+    cass_value_get_bytes(value, &bytes, &size);
+    
+    size_t count = size / sizeof(float);
+    VALUE buffer = rb_str_new(NULL, (long)(count * sizeof(float)));
+    char* out = RSTRING_PTR(buffer);
+    for (size_t i = 0; i < count; i++) {
+        float element = float_from_be(bytes + i * sizeof(float));
+        memcpy(out + i * sizeof(float), &element, sizeof(element));
+    }
+    rb_obj_freeze(buffer);
+    
+    VALUE vector = rb_obj_alloc(float_vector_class_get());
+    rb_ivar_set(vector, id_buffer, buffer);
+    return vector;
+}
+
+// Bind count native-order float32s as a vector value. The driver takes raw
+// bytes for custom types.
+CassError bind_float_vector_buffer(CassStatement* statement, size_t index, const char* floats, size_t count) {
+    VALUE tmp;
+    unsigned char* bytes = ALLOCV_N(unsigned char, tmp, count * sizeof(float) + 1);
+    for (size_t i = 0; i < count; i++) {
+        float_to_be(float_at(floats, i), bytes + i * sizeof(float));
+    }
+    
+    CassError rc = cass_statement_bind_bytes(statement, index, bytes, count * sizeof(float));
+    ALLOCV_END(tmp);
+    return rc;
+}
+
+// Bind a FloatVector, a String of native-order float32s or an Array of
+// numbers as a vector value. dimensions of 0 accepts any length (the
+// parameter type is unknown).
+CassError bind_float_vector_to_statement(CassStatement* statement, size_t index, size_t dimensions, VALUE value) {
+    if (!RB_TYPE_P(value, T_STRING) && !RB_TYPE_P(value, T_ARRAY) && float_vector_p(value)) {
+        value = rb_ivar_get(value, id_buffer);
+    }
+    
+    if (RB_TYPE_P(value, T_STRING)) {
+        size_t count = (size_t)RSTRING_LEN(value) / sizeof(float);
+        if ((size_t)RSTRING_LEN(value) % sizeof(float) != 0) {
+            return CASS_ERROR_LIB_INVALID_VALUE_TYPE;
+        }
+        if (dimensions != 0 && count != dimensions) {
+            return CASS_ERROR_LIB_BAD_PARAMS;
+        }
+        return bind_float_vector_buffer(statement, index, RSTRING_PTR(value), count);
+    }
+    
+    if (!RB_TYPE_P(value, T_ARRAY)) {
+        return CASS_ERROR_LIB_INVALID_VALUE_TYPE;
+    }
+    
+    size_t count = (size_t)RARRAY_LEN(value);
+    if (dimensions != 0 && count != dimensions) {
+        return CASS_ERROR_LIB_BAD_PARAMS;
+    }
+    for (size_t i = 0; i < count; i++) {
+        VALUE item = RARRAY_AREF(value, (long)i);
+        if (!RB_FLOAT_TYPE_P(item) && !RB_INTEGER_TYPE_P(item)) {
+            return CASS_ERROR_LIB_INVALID_VALUE_TYPE;
+        }
+    }
+    
+    VALUE tmp;
+    unsigned char* bytes = ALLOCV_N(unsigned char, tmp, count * sizeof(float) + 1);
+    for (size_t i = 0; i < count; i++) {
+        float_to_be((float)NUM2DBL(RARRAY_AREF(value, (long)i)), bytes + i * sizeof(float));
+    }
+    
+    CassError rc = cass_statement_bind_bytes(statement, index, bytes, count * sizeof(float));
+    ALLOCV_END(tmp);
+    return rc;
+}
+
+// Packed buffer of a FloatVector or String argument
+static VALUE vector_buffer(VALUE value) {
+    if (!RB_TYPE_P(value, T_STRING) && float_vector_p(value)) {
+        value = rb_ivar_get(value, id_buffer);
+    }
+    StringValue(value);
+    if (RSTRING_LEN(value) % sizeof(float) != 0) {
+        rb_raise(rb_eArgError, "vector buffer size must be a multiple of %d bytes", (int)sizeof(float));
+    }
+    return value;
+}
+
+static size_t vector_dimensions_checked(VALUE a, VALUE b) {
+    if (RSTRING_LEN(a) != RSTRING_LEN(b)) {
+        rb_raise(rb_eArgError, "vector dimensions differ (%ld and %ld)",
+                 RSTRING_LEN(a) / (long)sizeof(float), RSTRING_LEN(b) / (long)sizeof(float));
+    }
+    return (size_t)RSTRING_LEN(a) / sizeof(float);
+}
+
+static double vector_dot(const char* a, const char* b, size_t dimensions) {
+    double sum = 0.0;
+    for (size_t i = 0; i < dimensions; i++) {
+        sum += (double)float_at(a, i) * (double)float_at(b, i);
+    }
+    return sum;
+}
+
+static double vector_norm(const char* a, size_t dimensions) {
+    return sqrt(vector_dot(a, a, dimensions));
+}
+
+static double vector_cosine(const char* a, const char* b, size_t dimensions, double a_norm) {
+    double denominator = a_norm * vector_norm(b, dimensions);
+    return denominator == 0.0 ? 0.0 : vector_dot(a, b, dimensions) / denominator;
+}
+
+static bool vector_metric_cosine(VALUE metric) {
+    if (metric == ID2SYM(rb_intern("cosine"))) {
+        return true;
+    }
+    if (metric == ID2SYM(rb_intern("dot"))) {
+        return false;
+    }
+    rb_raise(rb_eArgError, "Unknown similarity metric: %" PRIsVALUE ". Use :cosine or :dot", metric);
+}
+
+// Ruby method: CassandraCpp::NativeVector.dot(a, b)
+static VALUE native_vector_dot(VALUE self, VALUE a, VALUE b) {
+    a = vector_buffer(a);
+    b = vector_buffer(b);
+    size_t dimensions = vector_dimensions_checked(a, b);
+    
+    return DBL2NUM(vector_dot(RSTRING_PTR(a), RSTRING_PTR(b), dimensions));
+}
+
+// Ruby method: CassandraCpp::NativeVector.cosine(a, b) -> 0.0 when either norm is 0
+static VALUE native_vector_cosine(VALUE self, VALUE a, VALUE b) {
+    a = vector_buffer(a);
+    b = vector_buffer(b);
+    size_t dimensions = vector_dimensions_checked(a, b);
+    
+    return DBL2NUM(vector_cosine(RSTRING_PTR(a), RSTRING_PTR(b), dimensions, vector_norm(RSTRING_PTR(a), dimensions)));
+}
+
+static VALUE native_vector_norm(VALUE self, VALUE a) {
+    a = vector_buffer(a);
+    
+    return DBL2NUM(vector_norm(RSTRING_PTR(a), (size_t)RSTRING_LEN(a) / sizeof(float)));
+}
+
+static bool vector_score_greater(const vector_score_t& a, const vector_score_t& b) {
+    return a.score > b.score || (a.score == b.score && a.index < b.index);
+}
+
+// Ruby method: CassandraCpp::NativeVector.top_k(query, candidates, k, metric)
+// -> [[candidate_index, score], ...] best first. nil candidates are skipped.
+static VALUE native_vector_top_k(VALUE self, VALUE query, VALUE candidates, VALUE k_value, VALUE metric) {
+    query = vector_buffer(query);
+    Check_Type(candidates, T_ARRAY);
+    long k = NUM2LONG(k_value);
+    bool cosine = vector_metric_cosine(metric);
+    
+    if (k < 0) {
+        rb_raise(rb_eArgError, "k must not be negative");
+    }
+    
+    // Resolve every buffer first so nothing raises while scoring
+    long candidate_count = RARRAY_LEN(candidates);
+    VALUE buffers = rb_ary_new_capa(candidate_count);
+    for (long i = 0; i < candidate_count; i++) {
+        VALUE candidate = RARRAY_AREF(candidates, i);
+        if (NIL_P(candidate)) {
+            rb_ary_push(buffers, Qnil);
+            continue;
+        }
+        VALUE buffer = vector_buffer(candidate);
+        vector_dimensions_checked(query, buffer);
+        rb_ary_push(buffers, buffer);
+    }
+    
+    size_t dimensions = (size_t)RSTRING_LEN(query) / sizeof(float);
+    double query_norm = vector_norm(RSTRING_PTR(query), dimensions);
+    
+    VALUE tmp;
+    vector_score_t* scores = ALLOCV_N(vector_score_t, tmp, (size_t)candidate_count + 1);
+    long scored = 0;
+    for (long i = 0; i < candidate_count; i++) {
+        VALUE buffer = RARRAY_AREF(buffers, i);
+        if (NIL_P(buffer)) {
+            continue;
+        }
+        const char* candidate = RSTRING_PTR(buffer);
+        scores[scored].index = i;
+        scores[scored].score = cosine ? vector_cosine(RSTRING_PTR(query), candidate, dimensions, query_norm)
+                                      : vector_dot(RSTRING_PTR(query), candidate, dimensions);
+        scored++;
+    }
+    
+    long kept = k < scored ? k : scored;
+    std::partial_sort(scores, scores + kept, scores + scored, vector_score_greater);
+    
+    VALUE result = rb_ary_new_capa(kept);
+    for (long i = 0; i < kept; i++) {
+        rb_ary_push(result, rb_assoc_new(LONG2NUM(scores[i].index), DBL2NUM(scores[i].score)));
+    }
+    ALLOCV_END(tmp);
+    
+    RB_GC_GUARD(buffers);
+    return result;
+}
+
+void init_vector() {
+    id_buffer = rb_intern("@buffer");
+    rb_gc_register_address(&float_vector_class);
+    
+    rb_mNativeVector = rb_define_module_under(rb_cCassandraCpp, "NativeVector");
+    rb_define_module_function(rb_mNativeVector, "dot", (VALUE(*)(...))native_vector_dot, 2);
+    rb_define_module_function(rb_mNativeVector, "cosine", (VALUE(*)(...))native_vector_cosine, 2);
+    rb_define_module_function(rb_mNativeVector, "norm", (VALUE(*)(...))native_vector_norm, 1);
+    rb_define_module_function(rb_mNativeVector, "top_k", (VALUE(*)(...))native_vector_top_k, 4);
+}
\ No newline at end of file
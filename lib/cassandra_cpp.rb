@@ -9,6 +9,8 @@ module CassandraCpp
   class ConnectionError < Error; end
   class QueryError < Error; end
   class TimeoutError < Error; end
+  class IntegrityError < Error; end
+  class CircuitOpenError < Error; end
 
   # Load native extension
   begin
@@ -25,11 +27,25 @@ module CassandraCpp
   autoload :Session, File.expand_path('cassandra_cpp/session', __dir__)
   autoload :SessionMetrics, File.expand_path('cassandra_cpp/session_metrics', __dir__)
   autoload :Result, File.expand_path('cassandra_cpp/result', __dir__)
+  autoload :ExecutionInfo, File.expand_path('cassandra_cpp/execution_info', __dir__)
   autoload :PreparedStatement, File.expand_path('cassandra_cpp/prepared_statement', __dir__)
   autoload :Statement, File.expand_path('cassandra_cpp/statement', __dir__)
   autoload :Batch, File.expand_path('cassandra_cpp/batch', __dir__)
+  autoload :BatchLoader, File.expand_path('cassandra_cpp/batch_loader', __dir__)
   autoload :Future, File.expand_path('cassandra_cpp/future', __dir__)
+  autoload :NativeSettings, File.expand_path('cassandra_cpp/native_settings', __dir__)
+  autoload :CircuitBreaker, File.expand_path('cassandra_cpp/circuit_breaker', __dir__)
+  autoload :AdaptiveTimeout, File.expand_path('cassandra_cpp/adaptive_timeout', __dir__)
+  autoload :PackedColumn, File.expand_path('cassandra_cpp/packed_column', __dir__)
+  autoload :FloatVector, File.expand_path('cassandra_cpp/float_vector', __dir__)
+  autoload :TableSnapshot, File.expand_path('cassandra_cpp/table_snapshot', __dir__)
+  autoload :TokenRangeScan, File.expand_path('cassandra_cpp/token_range_scan', __dir__)
+  autoload :SSTableWriter, File.expand_path('cassandra_cpp/sstable_writer', __dir__)
+  autoload :SSTableReader, File.expand_path('cassandra_cpp/sstable_reader', __dir__)
+  autoload :KeyFilter, File.expand_path('cassandra_cpp/key_filter', __dir__)
   autoload :Uuid, File.expand_path('cassandra_cpp/uuid', __dir__)
+  autoload :TrafficLog, File.expand_path('cassandra_cpp/traffic_log', __dir__)
+  autoload :TrafficReplay, File.expand_path('cassandra_cpp/traffic_replay', __dir__)
   autoload :Schema, File.expand_path('cassandra_cpp/schema', __dir__)
   autoload :Model, File.expand_path('cassandra_cpp/model', __dir__)
 
@@ -44,6 +60,98 @@ module CassandraCpp
       NATIVE_EXTENSION_LOADED
     end
     
+    # Native latency breakdown across all sessions, per request phase:
+    # :queue (execute until handed to the driver), :network (until the
+    # future resolved), :gvl_wait (until Ruby got the GVL back) and :decode
+    # (until rows were Ruby objects). Values are in milliseconds.
+    # @return [Hash] Phase name => histogram summary, empty without the native extension
+    def phase_latencies
+      return {} unless native_extension_loaded?
+      
+      NativeMetrics.phase_latencies
+    end
+    
+    # Clear the process-wide phase latency histograms
+    def reset_phase_latencies
+      NativeMetrics.reset_phase_latencies if native_extension_loaded?
+    end
+    
+    # Native GVL accounting across all sessions. :hold has, per entry point
+    # (:execute, :bind, :value, :batch_add, :batch_execute), how long each
+    # call held the GVL, leaving out the time it waited with the GVL
+    # released; calls that raise are counted too. :reacquire is how long each such wait took to get the GVL
+    # back once its work was done. Values are in milliseconds.
+    # @return [Hash] :hold (entry point => histogram summary) and :reacquire
+    #   (histogram summary), empty without the native extension
+    def gvl_stats
+      return {} unless native_extension_loaded?
+      
+      NativeMetrics.gvl_stats
+    end
+    
+    # Clear the process-wide GVL histograms
+    def reset_gvl_stats
+      NativeMetrics.reset_gvl_stats if native_extension_loaded?
+    end
+    
+    # Connections shared by CassandraCpp::Cluster.shared clusters
+    # @return [Hash] Registry key => number of open sessions using it, empty without the native extension
+    def shared_connections
+      return {} unless native_extension_loaded?
+      
+      NativeCluster.shared_connections
+    end
+    
+    # Memory allocated by the C++ driver through the extension's counting
+    # hooks, installed only when CASSANDRA_CPP_ALLOCATOR names an allocator
+    # @return [Hash] :allocator, :thread_arenas, :arenas, :live_bytes,
+    #   :peak_bytes, :allocations and :frees (all zero with allocator :off),
+    #   empty without the native extension
+    def driver_memory
+      return {} unless native_extension_loaded?
+      
+      NativeMetrics.driver_memory
+    end
+    
+    # Restart driver memory peak tracking from the current live bytes
+    def reset_driver_memory_peak
+      NativeMetrics.reset_driver_memory_peak if native_extension_loaded?
+    end
+    
+    # Copy a table into another one, on the same or another cluster. The
+    # source is read by several token-range readers at once and each row is
+    # re-bound natively into dest_prepared, with reads and writes pipelined;
+    # rows never become Ruby objects (collection, tuple and UDT values are
+    # the exception and pass through Ruby values).
+    #
+    # @example Rename a column while moving to a new cluster
+    #   CassandraCpp.copy(old_session, 'app.users', new_session,
+    #                     'INSERT INTO app.users_v2 (id, email, display_name) VALUES (?, ?, ?)',
+    #                     transform: { display_name: 'name' }, concurrency: 256)
+    #
+    # @param source_session [Session] Session on the source cluster
+    # @param source_table [String] Source table, optionally keyspace-qualified
+    # @param dest_session [Session] Session on the destination cluster
+    # @param dest_prepared [PreparedStatement, String] Destination statement (or its CQL) with named parameters
+    # @param transform [Hash] Destination parameter => source column or CQL selector; unmapped parameters read the same-named column
+    # @param concurrency [Integer] Writes in flight at once
+    # @param readers [Integer] Source token ranges read at once
+    # @param splits [Integer] Token ranges the source is split into
+    # @param page_size [Integer] Source rows fetched per round trip
+    # @return [Integer] Rows copied
+    def copy(source_session, source_table, dest_session, dest_prepared, transform: {}, concurrency: 64, readers: 4,
+             splits: 64, page_size: 5000)
+      dest = dest_prepared.is_a?(String) ? dest_session.prepare(dest_prepared) : dest_prepared
+      columns = transform.to_h { |param, source| [param.to_s, source.to_s] }
+      selected = dest.parameter_names.map { |name| columns.fetch(name, name) }
+      
+      scan = source_session.token_range_scan(source_table, columns: selected.join(', '), splits: splits)
+      source = source_session.prepare(scan.range_query)
+      ranges = scan.ranges.map { |from, to, _| [from, to] }
+      
+      dest.copy_from(source, ranges, page_size: page_size, readers: readers, concurrency: concurrency)
+    end
+    
     # Quick cluster creation with connection pool presets
     # @param preset [Symbol] Preset name (:high_throughput, :low_latency, :development)
     # @param config [Hash] Additional cluster configuration
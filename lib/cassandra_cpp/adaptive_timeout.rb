@@ -0,0 +1,68 @@
+# frozen_string_literal: true
+
+module CassandraCpp
+  # Per-statement request timeouts learned from observed latency
+  #
+  # While enabled, every execution of a prepared statement gets a request
+  # timeout of timeout_multiplier times the timeout_percentile of that
+  # statement's network latency, clamped to timeout_floor_ms and
+  # timeout_ceiling_ms, instead of the cluster's request_timeout. A statement
+  # keeps the cluster timeout until minimum_samples executions were recorded
+  # (see PreparedStatement#phase_latencies).
+  #
+  # Statements marked idempotent (PreparedStatement#idempotent=) also get a
+  # speculative delay, derived the same way: when a synchronous execution has
+  # not finished by then, a second one is sent, usually to another replica, and
+  # the first to succeed is used. It is only sent when the statement's circuit
+  # breaker admits it and a slot of the session's priority gate is free right
+  # away. Set speculative_multiplier to nil to only adapt timeouts.
+  #
+  # Settings are shared by every session in the process. Simple statements
+  # and batches keep the cluster timeout.
+  #
+  # @example
+  #   CassandraCpp::AdaptiveTimeout.enable(timeout_multiplier: 4, timeout_floor_ms: 20)
+  #   session.prepare('SELECT * FROM app.users WHERE id = ?').idempotent = true
+  #   CassandraCpp::AdaptiveTimeout.stats
+  #   # => { speculative_executions: 120, speculative_wins: 87 }
+  module AdaptiveTimeout
+    DEFAULTS = {
+      timeout_percentile: 0.99,      # Network latency percentile the timeout is based on
+      timeout_multiplier: 3.0,       # Timeout as a multiple of that percentile
+      timeout_floor_ms: 50,          # Shortest timeout given
+      timeout_ceiling_ms: 12_000,    # Longest timeout given
+      speculative_percentile: 0.95,  # Percentile the speculative delay is based on
+      speculative_multiplier: 1.0,   # Delay as a multiple of it, nil for no speculative executions
+      speculative_floor_ms: 5,       # Shortest speculative delay
+      speculative_ceiling_ms: 1_000, # Longest speculative delay
+      minimum_samples: 100           # Executions recorded before a statement adapts
+    }.freeze
+
+    extend NativeSettings
+
+    class << self
+      # Start adapting timeouts
+      # @param options [Hash] Overrides for DEFAULTS
+      def enable(**options)
+        NativeAdaptiveTimeouts.enable(*native_arguments(options))
+      end
+
+      # Go back to the cluster's request timeout
+      def disable
+        NativeAdaptiveTimeouts.disable if CassandraCpp.native_extension_loaded?
+      end
+
+      # @return [Boolean] true while timeouts adapt
+      def enabled?
+        CassandraCpp.native_extension_loaded? && NativeAdaptiveTimeouts.enabled?
+      end
+
+      # @return [Hash] :speculative_executions sent and :speculative_wins among them
+      def stats
+        return { speculative_executions: 0, speculative_wins: 0 } unless CassandraCpp.native_extension_loaded?
+
+        NativeAdaptiveTimeouts.stats
+      end
+    end
+  end
+end
@@ -3,25 +3,43 @@
 module CassandraCpp
   # Ruby wrapper for native batch operations
   class Batch
-    def initialize(native_batch, session)
+    def initialize(native_batch, session, routing_key: nil)
       @native_batch = native_batch
       @session = session
+      @routing_key = routing_key
     end
 
     # Add a statement to the batch
     # @param statement_or_query [String, PreparedStatement] Query string or prepared statement
     # @param params [Array] Parameters to bind (only used with query strings)
-    def add(statement_or_query, params = nil)
+    # @param routing_key [Array<Integer>, true, nil] Partition key params of a
+    #   query string, see Session#execute; defaults to the batch's
+    def add(statement_or_query, params = nil, routing_key: @routing_key)
       case statement_or_query
       when String
-        @native_batch.add_statement(statement_or_query, params)
+        @session.key_filter_admit(statement_or_query, Array(params), reads: false)
+        if routing_key
+          key_indexes = @session.routing_key_indexes(statement_or_query, routing_key)
+          key_types = @session.routing_key_types(statement_or_query, key_indexes.size)
+          @native_batch.add_statement(statement_or_query, Array(params), key_indexes, key_types)
+        else
+          @native_batch.add_statement(statement_or_query, params)
+        end
       when PreparedStatement
+        @session.key_filter_admit(statement_or_query.query, Array(params), reads: false)
         # Bind the prepared statement and add to batch
-        bound_statement = statement_or_query.bind(*params) if params
-        bound_statement ||= statement_or_query.bind
-        @native_batch.add_statement(bound_statement, nil)
+        bound_statement = statement_or_query.bind(*Array(params))
+        @native_batch.add_statement(bound_statement.native_statement, nil)
+      when Statement
+        if statement_or_query.query
+          @session.key_filter_admit(statement_or_query.query, statement_or_query.params, reads: false)
+        else
+          @session.invalidate_key_filters
+        end
+        @native_batch.add_statement(statement_or_query.native_statement, nil)
       else
-        # Assume it's already a bound statement
+        # Assume it's already a native bound statement; its table is unknown
+        @session.invalidate_key_filters
         @native_batch.add_statement(statement_or_query, nil)
       end
       
@@ -36,8 +54,10 @@ module CassandraCpp
     end
 
     # Execute the batch
+    # @param trace [Boolean] Have Cassandra trace the request, see Result#execution_info
     # @return [Result] Batch execution result (typically empty)
-    def execute
+    def execute(trace: false)
+      @native_batch.tracing = true if trace
       rows = @native_batch.execute
       Result.new(rows)
     end
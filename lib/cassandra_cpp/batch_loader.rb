@@ -0,0 +1,155 @@
+# frozen_string_literal: true
+
+module CassandraCpp
+  # Request-scoped loader that coalesces point reads
+  #
+  # #load only records the key and returns a Promise. The first Promise#value
+  # (or an explicit #dispatch) reads every key recorded so far at once: keys
+  # are deduplicated and each one becomes a bound read that the driver routes
+  # straight to a replica of its partition, all in flight together. Resolving
+  # N entities then costs about one round trip instead of N.
+  #
+  # Results are cached by key for the life of the loader, so create one per
+  # request (GraphQL query, web request, job) and do not share it between
+  # threads.
+  #
+  # @example Resolvers queue keys, the first value reads them all
+  #   loader = session.batch_loader('SELECT * FROM users WHERE id = ?')
+  #   promises = post_rows.map { |post| loader.load(post['author_id']) }
+  #   authors = promises.map { |promise| promise.value.first }
+  #
+  # @example As a GraphQL::Dataloader source, which already collects keys
+  #   # across fibers before calling fetch
+  #   class UserSource < GraphQL::Dataloader::Source
+  #     def initialize(session)
+  #       @loader = session.batch_loader('SELECT * FROM users WHERE id = ?')
+  #     end
+  #
+  #     def fetch(ids)
+  #       @loader.fetch(ids).map(&:first)
+  #     end
+  #   end
+  class BatchLoader
+    # A key's eventual Result
+    class Promise
+      attr_reader :key
+
+      def initialize(loader, key)
+        @loader = loader
+        @key = key
+        @state = :pending
+      end
+
+      # The key's rows, reading every pending key of the loader first if needed
+      # @return [Result]
+      # @raise [CassandraCpp::Error] when the read of this key's batch failed
+      def value
+        @loader.dispatch if pending?
+        raise @error if @state == :rejected
+
+        @result
+      end
+
+      def pending?
+        @state == :pending
+      end
+
+      # @api private
+      def fulfill(result)
+        @result = result
+        @state = :fulfilled
+      end
+
+      # @api private
+      def reject(error)
+        @error = error
+        @state = :rejected
+      end
+    end
+
+    attr_reader :statement
+
+    # @param session [Session]
+    # @param statement [PreparedStatement, String] Single-partition read (or query to
+    #   prepare) whose bind parameters are the key
+    # @param concurrency [Integer] Reads kept in flight per dispatch
+    def initialize(session, statement, concurrency: 64)
+      @session = session
+      @statement = statement.is_a?(String) ? session.prepare(statement) : statement
+      @concurrency = concurrency
+      @promises = {}
+      @pending = []
+    end
+
+    # Queue a key
+    # @param key [Object, Array] Bind value, or values in parameter order for a
+    #   statement with several parameters
+    # @return [Promise] The same Promise for a key loaded before
+    def load(key)
+      @promises.fetch(key) do
+        promise = Promise.new(self, key)
+        @pending << promise
+        @promises[key] = promise
+      end
+    end
+
+    # @return [Array<Promise>]
+    def load_many(keys)
+      keys.map { |key| load(key) }
+    end
+
+    # Load keys and wait for them
+    # @return [Array<Result>] One Result per key, in order
+    def fetch(keys)
+      promises = load_many(keys)
+      dispatch
+      promises.map(&:value)
+    end
+
+    # Read every pending key. A failed read rejects all promises of the dispatch.
+    # @return [Integer] Number of keys read
+    def dispatch
+      batch = @pending
+      return 0 if batch.empty?
+
+      @pending = []
+      # Keys a key filter rules out resolve without a read
+      keys = batch.map { |promise| key_params(promise.key) }
+      reads = []
+      batch.zip(keys) do |promise, key|
+        if @session.key_filter_admit(@statement.query, key)
+          reads << [promise, key]
+        else
+          promise.fulfill(Result.new([]))
+        end
+      end
+      return batch.size if reads.empty?
+
+      start_time = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+      begin
+        results = @statement.load_keys(reads.map(&:last), concurrency: @concurrency)
+      rescue StandardError => e
+        @session.metrics.record_error if e.is_a?(CassandraCpp::Error)
+        reads.each { |promise, _key| promise.reject(e) }
+        raise e
+      end
+
+      execution_time = (Process.clock_gettime(Process::CLOCK_MONOTONIC) - start_time) * 1000
+      @session.metrics.record_query(execution_time)
+      reads.zip(results) { |(promise, _key), result| promise.fulfill(result) }
+      batch.size
+    end
+
+    # Forget cached results, so later loads read again; pending keys stay queued
+    def clear
+      @promises.select! { |_key, promise| promise.pending? }
+      self
+    end
+
+    private
+
+    def key_params(key)
+      @statement.param_count == 1 ? [key] : Array(key)
+    end
+  end
+end
\ No newline at end of file
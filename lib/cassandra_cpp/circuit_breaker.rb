@@ -0,0 +1,76 @@
+# frozen_string_literal: true
+
+module CassandraCpp
+  # Native circuit breakers that fail fast while a table is unhealthy
+  #
+  # Each table named by a query (after FROM, INTO or UPDATE) gets its own
+  # breaker, keyed keyspace.table; unqualified names are qualified with the
+  # session's keyspace. A prepared statement can be given an explicit key
+  # instead with PreparedStatement#circuit_breaker=. A breaker opens when, within a window
+  # of at least minimum_requests requests, the share of timeouts,
+  # unavailable/overloaded replies and calls slower than slow_call_ms reaches
+  # failure_rate. While open, requests raise CircuitOpenError immediately
+  # instead of waiting for the request timeout. After open_ms, up to probes
+  # requests are let through; the breaker closes once they all succeed and
+  # reopens on the first failure.
+  #
+  # Breakers are off until enabled and are shared by every session in the
+  # process. Batches are not guarded.
+  #
+  # @example
+  #   CassandraCpp::CircuitBreaker.enable(failure_rate: 0.5, open_ms: 2_000)
+  #   CassandraCpp::CircuitBreaker.configure('app.events', slow_call_ms: 500)
+  #   CassandraCpp::CircuitBreaker.states
+  #   # => { 'app.events' => { state: :open, requests: 840, failures: 430, timeouts: 410, rejected: 1200, trips: 1 } }
+  module CircuitBreaker
+    DEFAULTS = {
+      failure_rate: 0.5,       # Share of failed requests that trips the breaker
+      minimum_requests: 20,    # Requests in a window before the rate is judged
+      window_ms: 10_000,       # Counting window while closed
+      open_ms: 5_000,          # Time spent failing fast before probing
+      slow_call_ms: nil,       # Slower successful calls count as timeouts
+      probes: 3                # Successful probes needed to close again
+    }.freeze
+
+    extend NativeSettings
+
+    class << self
+      # Start guarding requests, with options applied to every breaker
+      # without its own configuration
+      # @param options [Hash] Overrides for DEFAULTS
+      def enable(**options)
+        NativeCircuitBreakers.enable(*native_arguments(options))
+      end
+
+      # Stop guarding requests; breaker states are kept
+      def disable
+        NativeCircuitBreakers.disable if CassandraCpp.native_extension_loaded?
+      end
+
+      # @return [Boolean] true while requests are guarded
+      def enabled?
+        CassandraCpp.native_extension_loaded? && NativeCircuitBreakers.enabled?
+      end
+
+      # Tune one breaker
+      # @param key [String] keyspace.table (lowercased unless quoted; just the table for
+      #   sessions without a keyspace), or a key given to PreparedStatement#circuit_breaker=
+      # @param options [Hash] Overrides for DEFAULTS
+      def configure(key, **options)
+        NativeCircuitBreakers.configure(key.to_s, *native_arguments(options))
+      end
+
+      # @return [Hash] Breaker key => { state:, requests:, failures:, timeouts:, rejected:, trips: }
+      def states
+        return {} unless CassandraCpp.native_extension_loaded?
+
+        NativeCircuitBreakers.states
+      end
+
+      # Close every breaker and clear its counters
+      def reset
+        NativeCircuitBreakers.reset if CassandraCpp.native_extension_loaded?
+      end
+    end
+  end
+end
@@ -7,6 +7,17 @@ module CassandraCpp
       new(config)
     end
 
+    # A cluster whose sessions share one native connection with every other
+    # shared cluster configured the same way, so the process keeps a single
+    # set of driver IO threads and pools per distinct configuration. Each
+    # session keeps its own metrics, prepared statement cache and priority
+    # gate; the connection closes when the last of them is closed.
+    # @param config [Hash] Cluster configuration
+    # @return [Cluster] Shared cluster instance
+    def self.shared(config = {})
+      new(config.merge(shared: true))
+    end
+
     def initialize(config = {})
       @config = default_config.merge(config)
       @connection_pool = config[:connection_pool] || ConnectionPool.new
@@ -42,8 +53,12 @@ module CassandraCpp
           consistency: CONSISTENCY_QUORUM
         }.merge(@connection_pool.to_native_config)
         
-        @native_cluster ||= NativeCluster.new(options)
-        session = @native_cluster.connect(keyspace)
+        session = if @config[:shared]
+                    NativeCluster.acquire_shared(registry_key(options, keyspace), options, keyspace)
+                  else
+                    @native_cluster ||= NativeCluster.new(options)
+                    @native_cluster.connect(keyspace)
+                  end
         Session.new(session, self, keyspace)
       rescue CassandraCpp::Error => e
         raise ConnectionError, "Connection failed: #{e.message}"
@@ -102,10 +117,21 @@ module CassandraCpp
         compression: :none,
         timeout: 12,
         heartbeat_interval: 30,
-        idle_timeout: 60
+        idle_timeout: 60,
+        shared: false
       }
     end
 
+    # Options in a fixed order, with hosts sorted, so equivalent
+    # configurations share a registry entry
+    def registry_key(options, keyspace)
+      normalized = options.map do |name, value|
+        value = value.split(',').map(&:strip).sort.join(',') if name == :hosts
+        "#{name}=#{value}"
+      end
+      normalized.sort.push("keyspace=#{keyspace}").join(';')
+    end
+
     def validate_config!
       raise ArgumentError, 'hosts must be provided' if @config[:hosts].empty?
       
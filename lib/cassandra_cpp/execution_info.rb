@@ -0,0 +1,115 @@
+# frozen_string_literal: true
+
+module CassandraCpp
+  # How the request behind a Result executed
+  #
+  # Phase times are taken on every execute, whether or not metrics are
+  # enabled. Where the request went is only known to the server, so the
+  # coordinator, server-side latency and the server's event log come from
+  # the request's trace: execute with trace: true, and the trace is read from
+  # system_traces on first access.
+  #
+  # @example
+  #   result = session.execute('SELECT * FROM users WHERE id = ?', id, trace: true)
+  #   info = result.execution_info
+  #   info.phases           # => { queue: 0.01, network: 41.7, gvl_wait: 0.02, decode: 0.05 }
+  #   info.coordinator      # => "10.0.0.12"
+  #   info.server_latency   # => 38.9
+  class ExecutionInfo
+    # Trace sessions are written asynchronously by the coordinator, after it
+    # has replied; an incomplete trace is read again this many times
+    TRACE_ATTEMPTS = 5
+    TRACE_RETRY_INTERVAL = 0.2
+
+    # system_traces.sessions row of a request, with its events
+    Trace = Struct.new(:id, :coordinator, :duration, :started_at, :request, :parameters, :client, :events,
+                       keyword_init: true)
+
+    # One system_traces.events row
+    TraceEvent = Struct.new(:activity, :source, :source_elapsed, :thread, keyword_init: true)
+
+    # @param native [NativeExecutionInfo]
+    def initialize(native)
+      @native = native
+    end
+
+    # @return [String, nil] Tracing session id, nil unless executed with trace: true
+    def tracing_id
+      @native.tracing_id
+    end
+
+    def traced?
+      !tracing_id.nil?
+    end
+
+    # Milliseconds spent in each phase as seen by the client: queue (until
+    # handed to the driver), network (until the response arrived), gvl_wait
+    # and decode. A phase is nil when the request never reached it, such as
+    # decode for lazy results.
+    # @return [Hash{Symbol => Float, nil}]
+    def phases
+      @phases ||= @native.phases.freeze
+    end
+
+    # @return [Float] Client-side latency in milliseconds
+    def latency
+      phases.values.compact.sum
+    end
+
+    # @return [Integer, nil] Query id reported by the USDT probes, when tracing them
+    def query_id
+      @native.query_id
+    end
+
+    # @return [String, nil] Address of the node that coordinated the request
+    def coordinator
+      trace&.coordinator
+    end
+
+    # @return [Float, nil] Server-side latency at the coordinator in milliseconds
+    def server_latency
+      trace&.duration
+    end
+
+    # The request's trace, read once from system_traces
+    # @return [Trace, nil] nil unless executed with trace: true, or when the
+    #   coordinator did not finish writing the trace in time
+    def trace
+      return @trace if defined?(@trace)
+      return @trace = nil unless traced?
+
+      @trace = load_trace
+    end
+
+    def to_h
+      { tracing_id: tracing_id, phases: phases, latency: latency, query_id: query_id }
+    end
+
+    private
+
+    def load_trace
+      # Tracing ids come from the driver, so they are safe to inline
+      id = tracing_id
+      TRACE_ATTEMPTS.times do |attempt|
+        sleep(TRACE_RETRY_INTERVAL) if attempt > 0
+        row = @native.session.execute(
+          "SELECT coordinator, duration, started_at, request, parameters, client " \
+          "FROM system_traces.sessions WHERE session_id = #{id}"
+        ).first
+        next if row.nil? || row['duration'].nil?
+
+        events = @native.session.execute(
+          "SELECT activity, source, source_elapsed, thread FROM system_traces.events WHERE session_id = #{id}"
+        ).map do |event|
+          TraceEvent.new(activity: event['activity'], source: event['source'],
+                         source_elapsed: event['source_elapsed'] && event['source_elapsed'] / 1000.0,
+                         thread: event['thread'])
+        end
+        return Trace.new(id: id, coordinator: row['coordinator'], duration: row['duration'] / 1000.0,
+                         started_at: row['started_at'], request: row['request'],
+                         parameters: row['parameters'] || {}, client: row['client'], events: events)
+      end
+      nil
+    end
+  end
+end
\ No newline at end of file
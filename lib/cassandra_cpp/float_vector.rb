@@ -0,0 +1,107 @@
+# frozen_string_literal: true
+
+module CassandraCpp
+  # A Cassandra 5 vector<float, n> value: n floats packed into a binary
+  # String in native byte order. Rows decode vector columns into
+  # FloatVectors, and vector parameters bind from a FloatVector, a packed
+  # String or an Array of numbers without building a collection.
+  #
+  # Similarity helpers run natively over the packed buffers, so reranking
+  # candidates creates no Ruby object per dimension.
+  #
+  # @example
+  #   query = CassandraCpp::FloatVector.pack(embedding)
+  #   rows = session.execute('SELECT id, embedding FROM docs ORDER BY embedding ANN OF ? LIMIT 200', query)
+  #   CassandraCpp::FloatVector.top_k(query, rows.map { |row| row['embedding'] }, 10)
+  #   # => [[17, 0.93], [4, 0.91], ...] (candidate index, cosine similarity)
+  class FloatVector
+    include Enumerable
+
+    METRICS = %i[cosine dot].freeze
+
+    attr_reader :buffer
+
+    # @param values [Array<Numeric>] Vector elements
+    # @return [FloatVector]
+    def self.pack(values)
+      new(values.pack('f*'))
+    end
+
+    # Best matches for query among candidates, scored natively
+    # @param query [FloatVector, String] Query vector or packed buffer
+    # @param candidates [Array<FloatVector, String, nil>] Vectors to rank; nil entries are skipped
+    # @param k [Integer] Number of matches to return
+    # @param metric [Symbol] :cosine or :dot
+    # @return [Array<Array(Integer, Float)>] [candidate index, score] pairs, best first
+    def self.top_k(query, candidates, k, metric: :cosine)
+      raise ArgumentError, "Unknown metric: #{metric}. Use #{METRICS.map(&:inspect).join(' or ')}" unless METRICS.include?(metric)
+
+      NativeVector.top_k(query, candidates, k, metric)
+    end
+
+    # @param buffer [String] float32 values in native byte order, e.g. from Array#pack('f*')
+    def initialize(buffer)
+      raise ArgumentError, 'buffer size must be a multiple of 4 bytes' unless (buffer.bytesize % 4).zero?
+
+      @buffer = buffer.b.freeze
+    end
+
+    # @return [Integer] Number of dimensions
+    def size
+      @buffer.bytesize / 4
+    end
+    alias dimensions size
+
+    # @param index [Integer] Dimension
+    # @return [Float, nil] Element, nil when out of range
+    def [](index)
+      index += size if index.negative?
+      return nil if index.negative? || index >= size
+
+      @buffer.byteslice(index * 4, 4).unpack1('f')
+    end
+
+    def each(&block)
+      return enum_for(:each) unless block
+
+      to_a.each(&block)
+    end
+
+    # @return [Array<Float>] Elements unpacked into Ruby Floats
+    def to_a
+      @buffer.unpack('f*')
+    end
+
+    # @param other [FloatVector, String] Vector or packed buffer of the same size
+    # @return [Float] Dot product
+    def dot(other)
+      NativeVector.dot(@buffer, other)
+    end
+
+    # @param other [FloatVector, String] Vector or packed buffer of the same size
+    # @return [Float] Cosine similarity, 0.0 when either vector is zero
+    def cosine(other)
+      NativeVector.cosine(@buffer, other)
+    end
+
+    # @return [Float] Euclidean norm
+    def norm
+      NativeVector.norm(@buffer)
+    end
+
+    def ==(other)
+      other.is_a?(FloatVector) && other.buffer == @buffer
+    end
+    alias eql? ==
+
+    def hash
+      @buffer.hash
+    end
+
+    def inspect
+      preview = to_a.first(4).map { |value| value.round(4) }
+      preview << '...' if size > 4
+      "#<#{self.class.name} dimensions=#{size} [#{preview.join(', ')}]>"
+    end
+  end
+end
@@ -0,0 +1,251 @@
+# frozen_string_literal: true
+
+module CassandraCpp
+  # Negative-lookup filter for one table: a native Bloom filter over the
+  # table's partition keys, so reads of keys that definitely do not exist
+  # return an empty result without a round trip.
+  #
+  # The filter is populated by scanning the table's keys token range by
+  # token range, and kept current by the session, which adds the key of
+  # every write it can attribute, including prepared and bound statements
+  # it prepared. Writes it cannot attribute, such as literal keys in the
+  # query text or bound statements of unknown origin, switch filtering off
+  # until the next rebuild. Writes from other clients are only picked up by
+  # a rebuild, so set rebuild_every when they happen.
+  #
+  # Keys are converted to the key column's CQL type before hashing, so a
+  # bound "42" and the 42 read back from an int column hash alike.
+  #
+  # @see Session#key_filter
+  class KeyFilter
+    # Murmur3 partitioner token bounds
+    TOKEN_MIN = -2**63
+    TOKEN_MAX = 2**63 - 1
+
+    INTEGER_TYPES = %w[int bigint smallint tinyint varint counter].freeze
+    FLOAT_TYPES = %w[float double].freeze
+    STRING_TYPES = %w[text varchar ascii].freeze
+    UUID_TYPES = %w[uuid timeuuid].freeze
+
+    attr_reader :table, :key_column, :key_type, :false_positive_rate, :rebuild_every
+
+    # @param session [Session] Session used for rebuild scans
+    # @param table [String] Table name, optionally keyspace-qualified
+    # @param key [String] Partition key column (single-column partition keys only)
+    # @param expected_keys [Integer] Keys the filter is sized for; grows with the table on rebuilds
+    # @param false_positive_rate [Float] Share of absent keys still read from the cluster
+    # @param rebuild_every [Integer, nil] Rebuild interval in milliseconds, nil rebuilds only on #rebuild!
+    # @param splits [Integer] Token ranges scanned one after another per rebuild
+    # @param type [String, nil] CQL type of the key column, read from system_schema when nil
+    # @param build [Boolean] Run the first #rebuild! now; with false the caller
+    #   runs it, typically once the filter is registered. Keys written from
+    #   construction on reach the first build either way.
+    def initialize(session, table, key:, expected_keys:, false_positive_rate: 0.01, rebuild_every: nil, splits: 16,
+                   type: nil, build: true)
+      raise ArgumentError, 'splits must be at least 1' if splits < 1
+
+      @session = session
+      @table = table
+      @key_column = key.to_s
+      @key_type = (type || key_column_type).to_s.downcase
+      @expected_keys = expected_keys
+      @false_positive_rate = false_positive_rate
+      @rebuild_every = rebuild_every
+      @splits = splits
+      @mutex = Mutex.new
+      @filter = nil
+      @building = nil
+      @building_generation = nil
+      @generation = 0
+      @rebuilding = false
+      @built_at = nil
+      @lookups = 0
+      @skipped = 0
+
+      @mutex.synchronize { start_building }
+      rebuild! if build
+    end
+
+    # @param key [Object] Partition key value
+    # @return [Boolean] false only when the key was never written
+    def might_contain?(key)
+      schedule_rebuild if rebuild_due?
+
+      filter = @filter
+      return true unless filter
+
+      key = normalize(key)
+      return true if key.equal?(UNCONVERTIBLE)
+
+      @lookups += 1
+      return true if filter.include?(key)
+
+      @skipped += 1
+      false
+    end
+
+    # Record a written key
+    # @param key [Object] Partition key value
+    def add(key)
+      key = written_key(key)
+      @mutex.synchronize do
+        @filter&.add(key)
+        @building&.add(key)
+      end
+      self
+    end
+
+    # Record many written keys
+    # @param keys [Array] Partition key values
+    def add_all(keys)
+      keys = keys.map { |key| written_key(key) }
+      @mutex.synchronize do
+        @filter&.add_all(keys)
+        @building&.add_all(keys)
+      end
+      self
+    end
+
+    # Stop filtering until the next rebuild, after a write whose key is unknown
+    def invalidate!
+      @mutex.synchronize do
+        @filter = nil
+        @generation += 1
+      end
+      self
+    end
+
+    # Scan all keys of the table into a new filter and switch to it. Keys
+    # written during the scan are added to both filters.
+    # @return [KeyFilter] self
+    def rebuild!
+      building, generation = @mutex.synchronize { start_building }
+
+      count = 0
+      token_ranges.each do |query|
+        count += @session.each_row(query, as: :array) { |row| building.add(row[0]) }
+      end
+
+      @mutex.synchronize do
+        # A write with an unknown key during the scan may have been missed
+        @filter = building if @generation == generation
+        @built_at = monotonic_ms
+      end
+      @expected_keys = (count * 1.25).ceil if count > @expected_keys
+      self
+    ensure
+      @mutex.synchronize { @building = nil if @building.equal?(building) }
+    end
+
+    # @return [Boolean] true while absent keys are being filtered
+    def active?
+      !@filter.nil?
+    end
+
+    # @return [Hash] :lookups, :skipped, :active and, while active, the
+    #   native :keys, :bits, :hashes, :fill_ratio and estimated :false_positive_rate
+    def stats
+      stats = { lookups: @lookups, skipped: @skipped, active: active? }
+      filter = @filter
+      filter ? stats.merge(filter.stats) : stats
+    end
+
+    # The key as the driver reads it back from the key column, so written,
+    # bound and scanned keys hash alike. Keys that do not convert are
+    # returned as UNCONVERTIBLE, which lookups treat as possibly present.
+    # @param key [Object] Key value
+    # @return [Object] Converted key
+    def normalize(key)
+      return key if key.nil?
+
+      case @key_type
+      when *INTEGER_TYPES
+        integer = key.is_a?(String) ? Integer(key, 10) : Integer(key)
+        integer == key || key.is_a?(String) ? integer : UNCONVERTIBLE
+      when *FLOAT_TYPES
+        Float(key)
+      when *STRING_TYPES
+        key.to_s
+      when *UUID_TYPES
+        key.to_s.downcase
+      when 'timestamp'
+        key.is_a?(Integer) ? Time.at(Rational(key, 1000)) : key
+      when 'boolean'
+        key.is_a?(String) ? key.casecmp?('true') : key
+      else
+        key
+      end
+    rescue ArgumentError, TypeError, FloatDomainError
+      UNCONVERTIBLE
+    end
+
+    private
+
+    UNCONVERTIBLE = Object.new.freeze
+    private_constant :UNCONVERTIBLE
+
+    # A write whose key does not convert would fail in the driver; hashing it
+    # unconverted keeps the filter conservative either way
+    def written_key(key)
+      converted = normalize(key)
+      converted.equal?(UNCONVERTIBLE) ? key : converted
+    end
+
+    # The filter being built, with the generation it started at; one
+    # started before the scan (see #initialize) is reused so the keys
+    # written since are kept. Call with the mutex held.
+    def start_building
+      unless @building
+        @building = NativeBloomFilter.new(@expected_keys, @false_positive_rate)
+        @building_generation = @generation
+      end
+      [@building, @building_generation]
+    end
+
+    def key_column_type
+      keyspace_name, table_name = @table.include?('.') ? @table.split('.', 2) : [@session.keyspace, @table]
+      row = @session.execute('SELECT type FROM system_schema.columns ' \
+                             'WHERE keyspace_name = ? AND table_name = ? AND column_name = ?',
+                             keyspace_name.delete('"'), table_name.delete('"'), @key_column).first
+      raise ArgumentError, "Unknown column #{@key_column} of #{@table}" unless row
+
+      row['type']
+    end
+
+    def token_ranges
+      step = (TOKEN_MAX - TOKEN_MIN) / @splits
+      (0...@splits).map do |i|
+        from = TOKEN_MIN + i * step
+        upper = i == @splits - 1 ? "<= #{TOKEN_MAX}" : "< #{from + step}"
+        "SELECT DISTINCT #{@key_column} FROM #{@table} " \
+          "WHERE token(#{@key_column}) >= #{from} AND token(#{@key_column}) #{upper}"
+      end
+    end
+
+    def rebuild_due?
+      @rebuild_every && !@rebuilding && @built_at && monotonic_ms - @built_at >= @rebuild_every
+    end
+
+    # Rebuild in the background; lookups keep using the current filter
+    def schedule_rebuild
+      @mutex.synchronize do
+        return if @rebuilding
+
+        @rebuilding = true
+      end
+
+      Thread.new do
+        rebuild!
+      rescue CassandraCpp::Error => e
+        CassandraCpp.logger&.warn("Key filter rebuild of #{@table} failed: #{e.message}")
+        @built_at = monotonic_ms
+      ensure
+        @rebuilding = false
+      end
+    end
+
+    def monotonic_ms
+      Process.clock_gettime(Process::CLOCK_MONOTONIC, :millisecond)
+    end
+  end
+end
\ No newline at end of file
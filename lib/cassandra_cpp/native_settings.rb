@@ -0,0 +1,26 @@
+# frozen_string_literal: true
+
+module CassandraCpp
+  # Option handling shared by the modules configuring a process-wide native
+  # feature (CircuitBreaker, AdaptiveTimeout); each defines DEFAULTS in the
+  # order its native enable takes them
+  #
+  # @api private
+  module NativeSettings
+    # @return [Array] Options over DEFAULTS, in native argument order
+    def native_arguments(options)
+      defaults = self::DEFAULTS
+      unknown = options.keys - defaults.keys
+      raise ArgumentError, "Unknown #{settings_name} options: #{unknown.join(', ')}" unless unknown.empty?
+
+      defaults.merge(options).values_at(*defaults.keys)
+    end
+
+    private
+
+    # 'circuit breaker' for CassandraCpp::CircuitBreaker
+    def settings_name
+      name.split('::').last.gsub(/(?<=[a-z])(?=[A-Z])/, ' ').downcase
+    end
+  end
+end
@@ -0,0 +1,53 @@
+# frozen_string_literal: true
+
+module CassandraCpp
+  # A column of fixed-width numbers packed into a binary String in native
+  # byte order, as produced by Array#pack or the raw buffer of a numeric
+  # array library. Session#write_columns binds straight from the buffer
+  # without creating a Ruby object per value.
+  #
+  # @example
+  #   CassandraCpp::PackedColumn.new(:double, scores.pack('d*'))
+  #   CassandraCpp::PackedColumn.pack(:int64, [1, 2, 3])
+  class PackedColumn
+    # Element type => Array#pack directive
+    DIRECTIVES = {
+      int32: 'l',
+      int64: 'q',
+      float: 'f',
+      double: 'd'
+    }.freeze
+
+    attr_reader :type, :buffer
+
+    # Pack Ruby numbers into a column
+    # @param type [Symbol] :int32, :int64, :float or :double
+    # @param values [Array<Numeric>] Column values
+    # @return [PackedColumn]
+    def self.pack(type, values)
+      directive = DIRECTIVES.fetch(type) { raise ArgumentError, "Unknown packed type: #{type}" }
+      new(type, values.pack("#{directive}*"))
+    end
+
+    # @param type [Symbol] :int32 (int), :int64 (bigint, counter, timestamp), :float or :double
+    # @param buffer [String] Packed values in native byte order
+    def initialize(type, buffer)
+      unless DIRECTIVES.key?(type)
+        raise ArgumentError, "Unknown packed type: #{type}. Use #{DIRECTIVES.keys.map(&:inspect).join(', ')}"
+      end
+
+      @type = type
+      @buffer = buffer
+    end
+
+    # @return [Integer] Number of values in the buffer
+    def size
+      @buffer.bytesize / [0].pack(DIRECTIVES[@type]).bytesize
+    end
+
+    # @return [Array<Numeric>] Values unpacked into Ruby numbers
+    def to_a
+      @buffer.unpack("#{DIRECTIVES[@type]}*")
+    end
+  end
+end
@@ -20,18 +20,32 @@ module CassandraCpp
     #
     # @param native_prepared [NativePreparedStatement] The native prepared statement object
     # @param query [String] The original CQL query
-    def initialize(native_prepared, query)
+    # @param session [Session, nil] Session whose key filters see this statement's writes
+    def initialize(native_prepared, query, session = nil)
       @native_prepared = native_prepared
       @query = query
+      @session = session
       @param_count = count_parameters(query)
     end
     
     # Execute the prepared statement with the given parameters
     #
     # @param args [Array] The parameters to bind to the statement
+    # @param lazy [Boolean] Keep rows in the native result until accessed
+    # @param trace [Boolean] Have Cassandra trace the request, see Result#execution_info
     # @return [Result] The query result
     # @raise [CassandraCpp::Error] if parameter count doesn't match or execution fails
-    def execute(*args)
+    def execute(*args, lazy: false, trace: false)
+      validate_parameter_count(args.length)
+      return Result.new([]) unless key_filter_admit(args)
+      
+      execute_admitted(args, lazy: lazy, trace: trace)
+    end
+    
+    # Execute bound to args once the session's key filters have seen them
+    #
+    # @api private
+    def execute_admitted(args, lazy: false, trace: false)
       validate_parameter_count(args.length)
       
       # Create a bound statement
@@ -43,16 +57,28 @@ module CassandraCpp
       end
       
       # Execute and wrap result
-      rows = statement.execute
+      statement.tracing = true if trace
+      rows = lazy ? statement.execute_result : statement.execute
       Result.new(rows)
     end
 
     # Execute the prepared statement asynchronously with the given parameters
     #
     # @param args [Array] The parameters to bind to the statement
+    # @param trace [Boolean] Have Cassandra trace the request, see Result#execution_info
     # @return [Future] Future object for async result handling
     # @raise [CassandraCpp::Error] if parameter count doesn't match or execution fails
-    def execute_async(*args)
+    def execute_async(*args, trace: false)
+      validate_parameter_count(args.length)
+      key_filter_admit(args, reads: false)
+      
+      execute_async_admitted(args, trace: trace)
+    end
+    
+    # Asynchronous counterpart of #execute_admitted
+    #
+    # @api private
+    def execute_async_admitted(args, trace: false)
       validate_parameter_count(args.length)
       
       # Create a bound statement
@@ -64,12 +90,125 @@ module CassandraCpp
       end
       
       # Execute asynchronously and wrap in Future
+      statement.tracing = true if trace
       native_future = statement.execute_async
       
       # Create a mapped future that converts result rows to Result object
       Future.new(native_future).map { |rows| Result.new(rows) }
     end
     
+    # Stream the rows of the statement page by page, see Session#each_row
+    #
+    # @param args [Array] The parameters to bind to the statement
+    # @param reuse [Boolean] Refill one row object instead of allocating per row;
+    #   ignored without a block
+    # @param as [Symbol] :hash or :array rows
+    # @param page_size [Integer] Rows fetched per round trip
+    # @yield [Hash, Array] Each row
+    # @return [Integer] Number of rows yielded
+    def each_row(*args, reuse: true, as: :hash, page_size: 5000, &block)
+      return enum_for(:each_row, *args, reuse: false, as: as, page_size: page_size) unless block
+      
+      unless %i[hash array].include?(as)
+        raise ArgumentError, "Unknown row format: #{as}. Use :hash or :array"
+      end
+      
+      validate_parameter_count(args.length)
+      
+      statement = @native_prepared.bind
+      args.each_with_index do |value, index|
+        statement.bind(index, value)
+      end
+      
+      statement.each_row(reuse, as == :array, page_size, &block)
+    end
+    
+    # Fetch the statement's rows page by page, yielding each page with the
+    # driver paging state that resumes after it. Pass a saved paging_state
+    # to continue an earlier scan from that point.
+    #
+    # @param args [Array] The parameters to bind to the statement
+    # @param as [Symbol] :hash or :array rows
+    # @param page_size [Integer] Rows fetched per round trip
+    # @param paging_state [String, nil] Paging state yielded by an earlier call
+    # @yield [Array, String] The page's rows and the paging state after them, nil after the last page
+    # @return [Integer] Number of rows yielded
+    def each_page(*args, as: :hash, page_size: 5000, paging_state: nil, &block)
+      unless %i[hash array].include?(as)
+        raise ArgumentError, "Unknown row format: #{as}. Use :hash or :array"
+      end
+      
+      validate_parameter_count(args.length)
+      
+      statement = @native_prepared.bind
+      args.each_with_index do |value, index|
+        statement.bind(index, value)
+      end
+      
+      statement.each_page(as == :array, page_size, paging_state, &block)
+    end
+    
+    # Fold the statement's rows into per-group aggregates natively, see Session#aggregate
+    #
+    # @param args [Array] The parameters to bind to the statement
+    # @param group_by [String, Symbol, Array] Grouping column(s)
+    # @param aggregates [Hash] :sum, :min and :max mapped to a column or columns
+    # @param page_size [Integer] Rows fetched per round trip
+    # @return [Hash] Group key => { count:, sum:, min:, max: }
+    def aggregate(*args, group_by:, aggregates: {}, page_size: 5000)
+      group_columns, pairs = self.class.aggregate_arguments(group_by, aggregates)
+      validate_parameter_count(args.length)
+      
+      statement = @native_prepared.bind
+      args.each_with_index do |value, index|
+        statement.bind(index, value)
+      end
+      
+      statement.aggregate(group_columns, pairs, page_size)
+    end
+    
+    # Normalize aggregate options for the native layer:
+    # { sum: 'a', max: %w[a b], count: true } becomes
+    # [[:sum, 'a'], [:max, 'a'], [:max, 'b']]; counts are always returned.
+    #
+    # @api private
+    # @return [Array] Group column names and [op, column] pairs
+    def self.aggregate_arguments(group_by, aggregates)
+      group_columns = Array(group_by).map(&:to_s)
+      raise ArgumentError, 'group_by needs at least one column' if group_columns.empty?
+      
+      pairs = aggregates.each_with_object([]) do |(op, columns), list|
+        op = op.to_sym
+        next if op == :count
+        raise ArgumentError, "Unknown aggregate: #{op}. Use :count, :sum, :min or :max" unless %i[sum min max].include?(op)
+        
+        Array(columns).each { |column| list << [op, column.to_s] }
+      end
+      
+      [group_columns, pairs]
+    end
+    
+    # Bind parameters to a new Statement, for Statement#execute or Batch#add
+    #
+    # @param args [Array] The parameters to bind, in order; more can be bound later
+    # @return [Statement] The bound statement
+    def bind(*args)
+      statement = Statement.new(@native_prepared.bind, self)
+      args.each_with_index do |value, index|
+        statement.bind(index, value)
+      end
+      statement
+    end
+    
+    # Pass bound values of this statement through the session's key filters,
+    # see Session#key_filter_admit
+    #
+    # @api private
+    # @return [Boolean] false for reads of keys that were never written
+    def key_filter_admit(params, reads: true)
+      @session.nil? || @session.key_filter_admit(@query, params, reads: reads)
+    end
+    
     # Execute the prepared statement with named parameters
     # This is a convenience method that will be implemented in the future
     #
@@ -94,6 +233,96 @@ module CassandraCpp
       @param_count > 0
     end
     
+    # Names of the statement's bind markers, in bind order
+    #
+    # @return [Array<String>] Parameter names
+    def parameter_names
+      @native_prepared.parameter_names
+    end
+    
+    # Execute this statement once per row of source run over each token
+    # range, binding the row's columns as parameters in order. Rows never
+    # become Ruby objects; see CassandraCpp.copy.
+    #
+    # @param source [PreparedStatement] Query taking a range's exclusive lower and inclusive upper token
+    # @param ranges [Array<Array(Integer, Integer)>] Token ranges to read
+    # @param page_size [Integer] Source rows fetched per round trip
+    # @param readers [Integer] Ranges read at once
+    # @param concurrency [Integer] Writes in flight at once
+    # @return [Integer] Rows copied
+    def copy_from(source, ranges, page_size: 5000, readers: 4, concurrency: 64)
+      # The copied keys never reach Ruby, so a filtered table stops filtering
+      key_filter_admit([], reads: false)
+      @native_prepared.copy_from(source.native_prepared, ranges, page_size, readers, concurrency)
+    end
+    
+    # Latency breakdown of this statement's executions, recorded natively
+    #
+    # @return [Hash] Histogram summaries for :queue, :network, :gvl_wait and :decode
+    def phase_latencies
+      @native_prepared.phase_latencies
+    end
+    
+    # Most requested partitions and the partitions returning the most bytes,
+    # once tracked (see Session#track_hot_partitions)
+    #
+    # @return [Hash, nil] :requests counted, :hot and :heavy lists of
+    #   { key:, requests:, bytes:, rows:, max_bytes: }; nil when not tracked
+    def hot_partitions
+      @native_prepared.hot_partitions
+    end
+    
+    # @api private
+    def track_partitions(key_indexes, top:, width:, depth:)
+      @native_prepared.track_partitions(key_indexes, top, width, depth)
+    end
+    
+    # Guard this statement with the named circuit breaker instead of the one
+    # for its table (see CircuitBreaker)
+    #
+    # @param key [String, nil] Breaker key, nil to go back to the table's breaker
+    def circuit_breaker=(key)
+      @native_prepared.circuit_breaker = key&.to_s
+    end
+    
+    # Mark the statement safe to run more than once. Executions bound
+    # afterwards are flagged idempotent for the driver and, with
+    # AdaptiveTimeout enabled, may be sent again after the speculative delay.
+    #
+    # @param value [Boolean]
+    def idempotent=(value)
+      @native_prepared.idempotent = value
+    end
+    
+    # @return [Boolean] true when marked idempotent
+    def idempotent?
+      @native_prepared.idempotent?
+    end
+    
+    # Timeout and speculative delay the next execution gets (see AdaptiveTimeout)
+    #
+    # @return [Hash, nil] :timeout_ms and :speculative_delay_ms (nil unless
+    #   speculative); nil while disabled or the statement is still learning
+    def adaptive_timeouts
+      @native_prepared.adaptive_timeouts
+    end
+    
+    # Execute the statement once per key, all reads in flight together, see
+    # BatchLoader
+    #
+    # @param keys [Array<Array>] Bind values of each read, in parameter order
+    # @param concurrency [Integer] Reads kept in flight
+    # @return [Array<Result>] One Result per key, in order
+    def load_keys(keys, concurrency: 64)
+      keys.each { |key| validate_parameter_count(key.length) }
+      keys.each { |key| key_filter_admit(key, reads: false) }
+      
+      @native_prepared.load_keys(keys, concurrency).map { |rows| Result.new(rows) }
+    end
+    
+    # @api private
+    attr_reader :native_prepared
+    
     private
     
     # Count the number of ? parameters in the query
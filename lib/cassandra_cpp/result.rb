@@ -2,9 +2,53 @@
 
 module CassandraCpp
   # Result set wrapper for native C++ implementation
+  #
+  # Wraps either the array of row hashes returned by an execute, or a lazy
+  # NativeResult (execute with lazy: true) that keeps the driver result and
+  # converts rows only when they are accessed.
   class Result
     include Enumerable
 
+    # Inner hash join of two results
+    #
+    # When both results are lazy the hash table is built natively on the raw
+    # column bytes and only matching rows are converted to Ruby. Left values
+    # win when both sides have a column of the same name. Rows whose join key
+    # is null never match.
+    #
+    # @example
+    #   users = session.execute('SELECT id, name FROM users', lazy: true)
+    #   orders = session.execute('SELECT user_id, total FROM orders', lazy: true)
+    #   CassandraCpp::Result.join(users, orders, on: { 'id' => 'user_id' })
+    #
+    # @param left [Result] Left side, output follows its row order
+    # @param right [Result] Right side
+    # @param on [String, Symbol, Hash] Shared column name, or { left_column => right_column }
+    # @return [Result] Joined rows
+    def self.join(left, right, on:)
+      left_column, right_column = on.is_a?(Hash) ? on.first : [on, on]
+      left_column = left_column.to_s
+      right_column = right_column.to_s
+
+      if left.lazy? && right.lazy?
+        return new(NativeResult.join(left.native_result, right.native_result, left_column, right_column))
+      end
+
+      table = right.each_with_object({}) do |row, index|
+        key = row[right_column]
+        (index[key] ||= []) << row unless key.nil?
+      end
+
+      joined = left.each_with_object([]) do |row, rows|
+        key = row[left_column]
+        next if key.nil?
+
+        table.fetch(key, []).each { |match| rows << row.merge(match) { |_column, value, _| value } }
+      end
+
+      new(joined)
+    end
+
     def initialize(native_result)
       @native_result = native_result
     end
@@ -12,8 +56,8 @@ module CassandraCpp
     def each
       return enum_for(:each) unless block_given?
       
-      # Native extension returns array of hashes directly
-      @native_result.each do |row|
+      # Native extension returns array of hashes, or converts them on first access
+      rows.each do |row|
         yield row
       end
     end
@@ -29,20 +73,63 @@ module CassandraCpp
     end
 
     def first
-      @native_result.first
+      rows.first
     end
 
     def last
-      @native_result.last
+      rows.last
     end
 
     def to_a
-      @native_result
+      rows
     end
 
     def columns
+      return @native_result.columns if lazy?
+
       # Get column names from the first row if available
       @columns ||= first&.keys || []
     end
+
+    # Index rows by a column value (the last row wins for duplicate keys)
+    #
+    # Lazy results deduplicate on the raw column bytes natively and convert
+    # only the surviving rows. Rows with a null key are skipped.
+    #
+    # @param column [String, Symbol] Column to index by
+    # @return [Hash] Column value => row
+    def index_by(column)
+      return @native_result.index_by(column.to_s) if lazy?
+
+      column = column.to_s
+      rows.each_with_object({}) do |row, index|
+        key = row[column]
+        index[key] = row unless key.nil?
+      end
+    end
+
+    # @return [Boolean] true when rows are still held by the native result
+    def lazy?
+      !@native_result.is_a?(Array)
+    end
+
+    # How the request behind this result executed
+    # @return [ExecutionInfo, nil] nil for results not read from the cluster,
+    #   such as joins or reads skipped by a key filter
+    def execution_info
+      return @execution_info if defined?(@execution_info)
+
+      native = lazy? ? @native_result.execution_info : NativeExecutionInfo.of(@native_result)
+      @execution_info = native && ExecutionInfo.new(native)
+    end
+
+    # @api private
+    attr_reader :native_result
+
+    private
+
+    def rows
+      lazy? ? @native_result.rows : @native_result
+    end
   end
 end
\ No newline at end of file
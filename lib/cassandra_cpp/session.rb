@@ -1,8 +1,34 @@
 # frozen_string_literal: true
 
+require 'securerandom'
+require 'stringio'
+
 module CassandraCpp
   # Session wrapper for native C++ implementation
   class Session
+    # Default chunk size for #put_object, well below Cassandra's mutation size limit
+    OBJECT_CHUNK_SIZE = 1024 * 1024
+    
+    # Request priority classes, see #configure_priorities
+    PRIORITIES = %i[interactive batch].freeze
+    
+    # Fiber-local read natively when a request is submitted
+    PRIORITY_KEY = :cassandra_cpp_priority
+    
+    # Statement shapes recognized for key filters
+    KEY_FILTER_READ = /\A\s*SELECT\s.+?\sFROM\s+([\w."]+)\s+WHERE\s+"?(\w+)"?\s*=\s*(\?)\s*(?:LIMIT\s+\d+\s*)?;?\s*\z/im
+    KEY_FILTER_WRITE = /\A\s*(?:INSERT\s+INTO|UPDATE)\s+([\w."]+)/i
+    
+    # Any write to a table within a query, such as the entries of a
+    # BEGIN BATCH ... APPLY BATCH string
+    KEY_FILTER_ANY_WRITE = /\b(?:INSERT\s+INTO|UPDATE)\s+([\w."]+)/i
+    
+    # Table of a statement, for hot-partition tracking
+    STATEMENT_TABLE = /\b(?:FROM|INTO|UPDATE)\s+([\w."]+)/i
+    
+    # Keyspaces whose statements are never tracked
+    SYSTEM_KEYSPACE = /\Asystem(?:_\w+)?\./
+    
     attr_reader :metrics
     
     def initialize(native_session, cluster, keyspace = nil)
@@ -11,22 +37,56 @@ module CassandraCpp
       @keyspace = keyspace
       @prepared_statements = {}
       @metrics = SessionMetrics.new
+      @key_filters = {}
+      @key_filter_plans = {}
+      @hot_partition_sizes = nil
+      @partition_key_columns = {}
+      @partition_key_types = {}
     end
 
-    def execute(query, *params)
-      start_time = Time.now
+    # Execute a query
+    #
+    # A routing key runs the query unprepared, with params bound in order,
+    # and tells the driver which of them form the partition key, so the
+    # statement goes straight to a replica instead of through a coordinator
+    # that forwards it. Key params are encoded at the types of the table's
+    # partition key columns, so the driver hashes the bytes Cassandra does.
+    # Without one, params are bound through a prepared statement, which the
+    # driver already routes.
+    #
+    # @param query [String] CQL query to execute
+    # @param params [Array] Parameters, bound through a prepared statement
+    # @param lazy [Boolean] Keep rows in the native result until accessed (see Result#index_by)
+    # @param priority [Symbol, nil] :interactive or :batch, see #with_priority
+    # @param trace [Boolean] Have Cassandra trace the request, see Result#execution_info
+    # @param routing_key [Array<Integer>, true, nil] Positions of the params
+    #   forming the partition key, in key order, or true to find them from the
+    #   table's schema
+    # @param keyspace [String, nil] Keyspace whose replicas are used for routing;
+    #   defaults to the query's keyspace qualifier, then the session's
+    # @return [Result] Query result
+    def execute(query, *params, lazy: false, priority: nil, trace: false, routing_key: nil, keyspace: nil)
+      if priority
+        return with_priority(priority) do
+          execute(query, *params, lazy: lazy, trace: trace, routing_key: routing_key, keyspace: keyspace)
+        end
+      end
+      return Result.new([]) unless key_filter_admit(query, params)
+      
+      start_time = Process.clock_gettime(Process::CLOCK_MONOTONIC)
       begin
-        result = if params.empty?
-                   # Simple query without parameters
-                   native_result = @native_session.execute(query)
+        result = if params.empty? || routing_key
+                   # Simple statement, routed when a routing key is given
+                   args = simple_statement_args(query, params, trace, routing_key, keyspace)
+                   native_result = lazy ? @native_session.execute_result(*args) : @native_session.execute(*args)
                    Result.new(native_result)
                  else
                    # Use prepared statement for parameterized queries
                    statement = prepare(query)
-                   statement.execute(*params)
+                   statement.execute_admitted(params, lazy: lazy, trace: trace)
                  end
         
-        execution_time = (Time.now - start_time) * 1000  # Convert to milliseconds
+        execution_time = (Process.clock_gettime(Process::CLOCK_MONOTONIC) - start_time) * 1000
         @metrics.record_query(execution_time)
         result
       rescue CassandraCpp::Error => e
@@ -38,18 +98,408 @@ module CassandraCpp
       end
     end
 
+    # Stream the rows of a query page by page instead of materializing the
+    # whole result. With reuse: true (the default) the same Hash or Array is
+    # refilled in place and yielded for every row, so it is only valid until
+    # the block returns; dup it to keep a row. Without a block an Enumerator
+    # is returned and rows are always fresh objects.
+    #
+    # @param query [String] CQL query to execute
+    # @param params [Array] Parameters, bound through a prepared statement
+    # @param reuse [Boolean] Refill one row object instead of allocating per row;
+    #   ignored without a block
+    # @param as [Symbol] :hash (column name => value) or :array (column order)
+    # @param page_size [Integer] Rows fetched per round trip
+    # @yield [Hash, Array] Each row
+    # @return [Integer] Number of rows yielded
+    def each_row(query, *params, reuse: true, as: :hash, page_size: 5000, &block)
+      # Enumerator consumers (to_a, map, lazy chains) keep the rows they are
+      # handed, so a refilled row would alias every element
+      return enum_for(:each_row, query, *params, reuse: false, as: as, page_size: page_size) unless block
+      
+      unless %i[hash array].include?(as)
+        raise ArgumentError, "Unknown row format: #{as}. Use :hash or :array"
+      end
+      
+      start_time = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+      begin
+        count = if params.empty?
+                  @native_session.each_row(query, reuse, as == :array, page_size, &block)
+                else
+                  prepare(query).each_row(*params, reuse: reuse, as: as, page_size: page_size, &block)
+                end
+        
+        execution_time = (Process.clock_gettime(Process::CLOCK_MONOTONIC) - start_time) * 1000
+        @metrics.record_query(execution_time)
+        count
+      rescue CassandraCpp::Error => e
+        # Exceptions raised by the caller's block pass through uncounted
+        @metrics.record_error
+        raise e
+      end
+    end
+
+    # Group the rows of a query and fold them into counts, sums, minimums and
+    # maximums natively across all pages. Only the final groups become Ruby
+    # objects; rows are never materialized.
+    #
+    # @example Bytes per tenant and day
+    #   session.aggregate('SELECT tenant, day, bytes FROM usage',
+    #                     group_by: %w[tenant day], aggregates: { count: true, sum: 'bytes', max: 'bytes' })
+    #   # => { ['acme', day] => { count: 31, sum: { 'bytes' => 1024 }, max: { 'bytes' => 200 } } }
+    #
+    # @param query [String] CQL query to scan
+    # @param params [Array] Parameters, bound through a prepared statement
+    # @param group_by [String, Symbol, Array] Grouping column(s); several columns give Array keys
+    # @param aggregates [Hash] :sum, :min and :max mapped to a column or columns.
+    #   The row count per group is always included; count: true is accepted for clarity.
+    # @param page_size [Integer] Rows fetched per round trip
+    # @return [Hash] Group key => { count:, sum:, min:, max: } with per-column values
+    def aggregate(query, *params, group_by:, aggregates: {}, page_size: 5000)
+      start_time = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+      begin
+        groups = if params.empty?
+                   group_columns, pairs = PreparedStatement.aggregate_arguments(group_by, aggregates)
+                   @native_session.aggregate(query, group_columns, pairs, page_size)
+                 else
+                   prepare(query).aggregate(*params, group_by: group_by, aggregates: aggregates, page_size: page_size)
+                 end
+        
+        execution_time = (Process.clock_gettime(Process::CLOCK_MONOTONIC) - start_time) * 1000
+        @metrics.record_query(execution_time)
+        groups
+      rescue CassandraCpp::Error => e
+        @metrics.record_error
+        raise e
+      end
+    end
+
+    # Write rows held as columns, binding row i from element i of every
+    # column inside a native submission loop: no per-row Arrays are built and
+    # packed numeric columns create no Ruby objects at all. Up to concurrency
+    # rows are in flight at once.
+    #
+    # @example
+    #   session.write_columns('INSERT INTO readings (sensor, ts, value) VALUES (?, ?, ?)',
+    #                         { 'sensor' => sensors,
+    #                           'ts' => CassandraCpp::PackedColumn.new(:int64, timestamp_buffer),
+    #                           'value' => CassandraCpp::PackedColumn.pack(:double, values) },
+    #                         concurrency: 64)
+    #
+    # @param prepared [PreparedStatement, String] Statement (or query to prepare) whose
+    #   bind parameters are named after the columns, e.g. an INSERT
+    # @param columns [Hash] Parameter name => Array or PackedColumn, one entry per parameter,
+    #   all with the same number of rows. A :float PackedColumn feeding a vector<float, n>
+    #   parameter holds n floats per row.
+    # @param concurrency [Integer] Rows kept in flight
+    # @return [Integer] Number of rows written
+    def write_columns(prepared, columns, concurrency: 32)
+      prepared = prepare(prepared) if prepared.is_a?(String)
+      key_filter_write_columns(prepared.query, columns) unless @key_filters.empty?
+      
+      names = []
+      values = []
+      packed_types = []
+      columns.each do |name, column|
+        names << name.to_s
+        if column.is_a?(PackedColumn)
+          values << column.buffer
+          packed_types << column.type
+        else
+          values << column
+          packed_types << nil
+        end
+      end
+      
+      start_time = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+      begin
+        rows = prepared.native_prepared.write_columns(names, values, packed_types, concurrency)
+        
+        execution_time = (Process.clock_gettime(Process::CLOCK_MONOTONIC) - start_time) * 1000
+        @metrics.record_query(execution_time)
+        rows
+      rescue CassandraCpp::Error => e
+        @metrics.record_error
+        raise e
+      end
+    end
+
+    # Store a large object as fixed-size chunks written concurrently, one
+    # partition per (key, version, chunk_no), followed by a manifest row
+    # (version 0, chunk_no -1) holding the size, chunk count, CRC32 and chunk
+    # version of the whole object. The table layout is
+    #
+    #   CREATE TABLE objects (
+    #     key text, version bigint, chunk_no int,
+    #     data blob, checksum bigint, object_size bigint, chunk_count int, chunk_version bigint,
+    #     PRIMARY KEY ((key, version, chunk_no)))
+    #
+    # Every write goes to a fresh random version and the manifest is switched
+    # last, so readers see either the old or the new object, never a mix. The
+    # previous version's chunks are deleted once the manifest points away from
+    # them; a reader still fetching that version re-reads the manifest and
+    # starts over on the new object (see #get_object).
+    #
+    # @param table [String] Object table, optionally keyspace-qualified
+    # @param key [String] Object key
+    # @param io [IO, String] Source, read in chunk_size pieces
+    # @param chunk_size [Integer] Bytes per chunk row
+    # @param concurrency [Integer] Chunk writes kept in flight
+    # @return [Hash] :size, :chunks and :checksum (CRC32) of the stored object
+    def put_object(table, key, io, chunk_size: OBJECT_CHUNK_SIZE, concurrency: 8)
+      io = StringIO.new(io) if io.is_a?(String)
+      key = key.to_s
+      insert = prepare("INSERT INTO #{table} (key, version, chunk_no, data, checksum, object_size, chunk_count, " \
+                       'chunk_version) VALUES (?, ?, ?, ?, ?, ?, ?, ?)')
+      
+      start_time = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+      begin
+        previous = object_select(table).native_prepared.object_manifest(key)
+        version = SecureRandom.random_number(1 << 62) + 1
+        size, chunks, checksum = insert.native_prepared.put_object(key, version, io, chunk_size, concurrency)
+        
+        if previous
+          delete = prepare("DELETE FROM #{table} WHERE key = ? AND version = ? AND chunk_no = ?")
+          delete.native_prepared.delete_object_chunks(key, previous[0], previous[1], concurrency)
+        end
+        
+        execution_time = (Process.clock_gettime(Process::CLOCK_MONOTONIC) - start_time) * 1000
+        @metrics.record_query(execution_time)
+        { size: size, chunks: chunks, checksum: checksum }
+      rescue CassandraCpp::Error => e
+        @metrics.record_error
+        raise e
+      end
+    end
+
+    # Read a large object stored with #put_object, fetching chunks in
+    # parallel and verifying every chunk's checksum as well as the size and
+    # checksum of the whole object. When a concurrent #put_object replaces
+    # the object mid-read, the read starts over on the new manifest, unless
+    # chunks were already written to io: that read raises IntegrityError and
+    # the caller has to rewind io and retry.
+    #
+    # @param table [String] Object table
+    # @param key [String] Object key
+    # @param io [IO, nil] Destination written in chunk order; nil returns a binary String
+    # @param concurrency [Integer] Chunk reads kept in flight
+    # @return [IO, String, nil] io, the object's bytes, or nil when the key does not exist
+    # @raise [IntegrityError] if a chunk is missing, a checksum does not match
+    #   or the object was replaced after chunks were written to io
+    def get_object(table, key, io = nil, concurrency: 8)
+      start_time = Process.clock_gettime(Process::CLOCK_MONOTONIC)
+      begin
+        object = object_select(table).native_prepared.get_object(key.to_s, io, concurrency)
+        
+        execution_time = (Process.clock_gettime(Process::CLOCK_MONOTONIC) - start_time) * 1000
+        @metrics.record_query(execution_time)
+        object
+      rescue CassandraCpp::Error => e
+        @metrics.record_error
+        raise e
+      end
+    end
+
+    # Copy a small reference table into a sorted, memory-mapped file shared
+    # by every process on the host, for native point and range lookups
+    # without network round trips. The file is built if missing or older
+    # than refresh, and rebuilt and swapped in atomically once it expires.
+    # See TableSnapshot.
+    #
+    # @param table [String] Table name, optionally keyspace-qualified
+    # @param path [String] Snapshot file
+    # @param refresh [Integer, nil] Maximum age in milliseconds; nil never rebuilds automatically
+    # @param key [String, Array<String>, nil] Lookup key column(s); defaults to the primary key
+    # @return [TableSnapshot] Snapshot
+    def snapshot_table(table, path:, refresh: nil, key: nil)
+      key_columns = key ? Array(key).map(&:to_s) : primary_key_columns(table)
+      TableSnapshot.new(self, table, path: path, key_columns: key_columns, refresh: refresh)
+    end
+
+    # Scan a whole table token range by token range, saving progress to a
+    # checkpoint so a restarted job resumes instead of starting over. See
+    # TokenRangeScan.
+    #
+    # @param table [String] Table name, optionally keyspace-qualified
+    # @param key [String, Array<String>, nil] Partition key column(s); defaults to the table's partition key
+    # @param checkpoint [String, TokenRangeScan::FileCheckpoint, TokenRangeScan::TableCheckpoint, nil]
+    #   Checkpoint file path or store; nil keeps progress in memory only
+    # @param columns [String] Selected columns
+    # @param splits [Integer] Token ranges planned for a new job
+    # @param page_size [Integer] Rows fetched per round trip
+    # @param checkpoint_interval [Integer] Minimum milliseconds between checkpoint saves within a range
+    # @return [TokenRangeScan] Scan; call #each_row to run or resume it
+    def token_range_scan(table, key: nil, checkpoint: nil, columns: '*', splits: 64, page_size: 5000,
+                         checkpoint_interval: 5000)
+      key_columns = key ? Array(key).map(&:to_s) : primary_key_columns(table, kinds: %w[partition_key])
+      checkpoint = TokenRangeScan::FileCheckpoint.new(checkpoint) if checkpoint.is_a?(String)
+      TokenRangeScan.new(self, table, key_columns: key_columns, checkpoint: checkpoint, columns: columns,
+                         splits: splits, page_size: page_size, checkpoint_interval: checkpoint_interval)
+    end
+
+    # Write rows of a table offline as SSTable files for sstableloader or
+    # nodetool import, with the table's schema and Bloom filter settings
+    # read from system_schema. See SSTableWriter.
+    #
+    # @param table [String] Table name, optionally keyspace-qualified
+    # @param directory [String] Output directory
+    # @param buffer_size [Integer] Bytes of rows buffered per SSTable
+    # @yield [SSTableWriter] Writer, closed when the block returns
+    # @return [SSTableWriter, Array<String>] The writer, or with a block the Data.db paths written
+    def sstable_writer(table, directory, buffer_size: SSTableWriter::DEFAULT_BUFFER_SIZE)
+      keyspace_name, table_name = table.include?('.') ? table.split('.', 2) : [keyspace, table]
+      rows = execute('SELECT column_name, kind, position, type, clustering_order FROM system_schema.columns ' \
+                     'WHERE keyspace_name = ? AND table_name = ?', keyspace_name, table_name).to_a
+      raise ArgumentError, "Unknown table: #{table}" if rows.empty?
+      
+      columns = rows.map do |row|
+        { name: row['column_name'], type: row['type'], kind: row['kind'], position: row['position'],
+          descending: row['clustering_order'] == 'desc' }
+      end
+      options = execute('SELECT bloom_filter_fp_chance FROM system_schema.tables ' \
+                        'WHERE keyspace_name = ? AND table_name = ?', keyspace_name, table_name).first
+      fp_chance = options&.fetch('bloom_filter_fp_chance', nil) || 0.01
+      
+      writer = SSTableWriter.new(directory, schema: columns, buffer_size: buffer_size,
+                                 bloom_filter_fp_chance: fp_chance)
+      return writer unless block_given?
+      
+      yield writer
+      writer.close
+    end
+
+    # Skip reads of partition keys that were never written. Builds a native
+    # Bloom filter over the table's keys with a token-range scan, then keeps
+    # it current with every write made through this session. Reads shaped
+    # SELECT ... FROM table WHERE key = ? with a bound key the filter has
+    # never seen return an empty Result without a round trip. See KeyFilter
+    # for what keeps it exact.
+    #
+    # @param table [String] Table name, optionally keyspace-qualified
+    # @param key [String] Partition key column
+    # @param expected_keys [Integer] Keys the filter is sized for
+    # @param false_positive_rate [Float] Share of absent keys still read
+    # @param rebuild_every [Integer, nil] Background rebuild interval in milliseconds
+    # @param splits [Integer] Token ranges per rebuild scan
+    # @return [KeyFilter] The table's filter
+    def key_filter(table, key:, expected_keys:, false_positive_rate: 0.01, rebuild_every: nil, splits: 16)
+      filter = KeyFilter.new(self, table, key: key, expected_keys: expected_keys,
+                             false_positive_rate: false_positive_rate, rebuild_every: rebuild_every, splits: splits,
+                             build: false)
+      name = qualified_table(table)
+      
+      # Registered before the first scan so writes made meanwhile reach it;
+      # it filters nothing until the scan completes
+      @key_filters[name] = filter
+      @key_filter_plans = {}
+      begin
+        filter.rebuild!
+      rescue StandardError
+        remove_key_filter(table) if @key_filters[name].equal?(filter)
+        raise
+      end
+      filter
+    end
+
+    # Stop filtering reads of a table
+    # @param table [String] Table name
+    def remove_key_filter(table)
+      @key_filters.delete(qualified_table(table))
+      @key_filter_plans = {}
+    end
+
+    # Bind positions of a routing key: the given ones, or with true the
+    # partition key columns found from the table's schema
+    #
+    # @api private
+    def routing_key_indexes(query, routing_key)
+      return Array(routing_key).map { |index| Integer(index) } unless routing_key == true
+      
+      partition_key_indexes(query) || raise(ArgumentError, "No bound partition key found in: #{query}")
+    end
+
+    # CQL types of the query table's partition key columns, in key order,
+    # which routing key params are bound at (see #execute)
+    #
+    # @api private
+    def routing_key_types(query, key_count)
+      match = STATEMENT_TABLE.match(query)
+      raise ArgumentError, "No table found to route: #{query}" unless match
+      
+      table = qualified_table(match[1])
+      types = @partition_key_types[table] ||= partition_key_types(table)
+      unless types.size == key_count
+        raise ArgumentError, "#{table} has #{types.size} partition key columns, routing key has #{key_count} params"
+      end
+      
+      types
+    end
+
+    # Tell key filters about a write that bypasses #execute, such as a batch
+    # entry. Returns false for reads of keys that were never written.
+    #
+    # @api private
+    def key_filter_admit(query, params, reads: true)
+      return true if @key_filters.empty?
+      
+      kind, filter, index = key_filter_plan(query)
+      case kind
+      when :read
+        !reads || params.size <= index || filter.might_contain?(params[index])
+      when :write
+        if params.size > index
+          filter.add(params[index])
+        else
+          filter.invalidate!
+        end
+        true
+      when :untracked_write
+        filter.invalidate!
+        true
+      when :untracked_writes
+        filter.each(&:invalidate!)
+        true
+      else
+        true
+      end
+    end
+
+    # Stop filtering every table, after a write whose table is unknown
+    #
+    # @api private
+    def invalidate_key_filters
+      @key_filters.each_value(&:invalidate!)
+    end
+
+    # Loader that coalesces point reads of one statement, see BatchLoader
+    # @param statement [PreparedStatement, String] Single-partition read
+    # @param concurrency [Integer] Reads kept in flight per dispatch
+    # @return [BatchLoader]
+    def batch_loader(statement, concurrency: 64)
+      BatchLoader.new(self, statement, concurrency: concurrency)
+    end
+
     def prepare(query)
-      @prepared_statements[query] ||= begin
+      @prepared_statements.fetch(query) do
         native_prepared = @native_session.prepare(query)
         @metrics.record_prepared_statement
-        PreparedStatement.new(native_prepared, query)
+        prepared = @prepared_statements[query] = PreparedStatement.new(native_prepared, query, self)
+        track_partitions(prepared)
+        prepared
       end
     end
 
     # Create a new batch for atomic operations
+    #
+    # The driver routes a batch by its first entry with a routing key. Bound
+    # prepared statements usually carry one; query strings only with a
+    # routing key (see #execute), given here for all of them or per Batch#add.
+    #
     # @param type [Symbol] Batch type (:logged, :unlogged, :counter)
+    # @param routing_key [Array<Integer>, true, nil] Partition key params of query string entries
+    # @param keyspace [String, nil] Keyspace whose replicas are used for routing
     # @return [Batch] New batch instance
-    def batch(type = :logged)
+    def batch(type = :logged, routing_key: nil, keyspace: nil)
       batch_type = case type
                    when :logged then CassandraCpp::BATCH_TYPE_LOGGED
                    when :unlogged then CassandraCpp::BATCH_TYPE_UNLOGGED
@@ -59,24 +509,37 @@ module CassandraCpp
                    end
       
       native_batch = @native_session.batch(batch_type)
+      native_batch.keyspace = keyspace.to_s if keyspace
       @metrics.record_batch
-      Batch.new(native_batch, self)
+      Batch.new(native_batch, self, routing_key: routing_key)
     end
 
     # Execute query asynchronously
     # @param query [String] CQL query to execute
     # @param params [Array] Parameters for prepared statements
+    # @param priority [Symbol, nil] :interactive or :batch, see #with_priority
+    # @param trace [Boolean] Have Cassandra trace the request, see Result#execution_info
+    # @param routing_key [Array<Integer>, true, nil] Partition key params, see #execute
+    # @param keyspace [String, nil] Keyspace used for routing, see #execute
     # @return [Future] Future object for async result handling
-    def execute_async(query, *params)
+    def execute_async(query, *params, priority: nil, trace: false, routing_key: nil, keyspace: nil)
+      if priority
+        return with_priority(priority) do
+          execute_async(query, *params, trace: trace, routing_key: routing_key, keyspace: keyspace)
+        end
+      end
+      
+      key_filter_admit(query, params, reads: false)
       begin
-        result = if params.empty?
-                   # Simple query without parameters - use native async
-                   native_future = @native_session.execute_async(query)
+        result = if params.empty? || routing_key
+                   # Simple statement - use native async
+                   args = simple_statement_args(query, params, trace, routing_key, keyspace)
+                   native_future = @native_session.execute_async(*args)
                    Future.new(native_future)
                  else
                    # Use prepared statement for parameterized queries
                    statement = prepare(query)
-                   statement.execute_async(*params)
+                   statement.execute_async_admitted(params, trace: trace)
                  end
         
         @metrics.record_async_query
@@ -99,7 +562,7 @@ module CassandraCpp
         
         # Create a mapped future that converts the result to PreparedStatement
         Future.new(native_future).map do |native_prepared|
-          PreparedStatement.new(native_prepared, query)
+          PreparedStatement.new(native_prepared, query, self)
         end
       rescue CassandraCpp::Error => e
         raise e
@@ -108,6 +571,94 @@ module CassandraCpp
       end
     end
 
+    # Put a native admission gate in front of every request of this session.
+    # At most max_in_flight requests are outstanding; interactive requests
+    # always get free slots first, and batch requests only run while no
+    # interactive request is waiting, using at most batch_share of the slots.
+    # With a latency target, that batch share is halved whenever interactive
+    # latency rises above it and grows back slot by slot once it recovers.
+    # Calling it again retunes the gate.
+    #
+    # @param max_in_flight [Integer] Requests outstanding across both classes
+    # @param batch_share [Float] Largest share of slots batch traffic may hold
+    # @param interactive_latency_target_ms [Numeric, nil] Throttle batch traffic above this
+    # @return [Session] self
+    def configure_priorities(max_in_flight:, batch_share: 0.25, interactive_latency_target_ms: nil)
+      @native_session.configure_priorities(max_in_flight, batch_share, interactive_latency_target_ms)
+      self
+    end
+
+    # Run the block with every request it submits on this fiber in the given
+    # priority class. Requests default to :interactive; the class only has an
+    # effect once #configure_priorities was called.
+    #
+    # @param priority [Symbol] :interactive or :batch
+    # @return [Object] The block's result
+    def with_priority(priority)
+      unless PRIORITIES.include?(priority)
+        raise ArgumentError, "Unknown priority: #{priority.inspect}. Use :interactive or :batch"
+      end
+      
+      previous = Thread.current[PRIORITY_KEY]
+      Thread.current[PRIORITY_KEY] = priority
+      begin
+        yield
+      ensure
+        Thread.current[PRIORITY_KEY] = previous
+      end
+    end
+
+    # Queue depths and waits of the priority gate
+    # @return [Hash, nil] :capacity, :batch_limit, :interactive_latency_ms and,
+    #   per class (:interactive, :batch), :in_flight, :queued, :max_queued,
+    #   :granted and a :queue_wait histogram summary; nil until configured
+    def priority_stats
+      @native_session.priority_stats
+    end
+
+    # Count requests and returned bytes per partition for every statement this
+    # session prepares, now and later. Each statement keeps two native
+    # count-min sketches (requests, bytes) of depth x width counters and the
+    # top keys of each, so memory stays fixed however many partitions are
+    # read and the cost per request is a few counter updates; returned bytes
+    # are measured on a random 1 in 16 responses and scaled. Partition keys
+    # are the values bound to the partition key columns, found from the
+    # table's schema; statements that do not bind the whole partition key are
+    # not tracked. Calling it again starts over with the new sizes.
+    #
+    # @param top [Integer] Keys kept per list and statement
+    # @param width [Integer] Counters per sketch row; estimates exceed true
+    #   counts by at most about 2/width of the statement's total
+    # @param depth [Integer] Sketch rows, each halving the odds of a bad estimate
+    # @return [Session] self
+    def track_hot_partitions(top: 10, width: 1024, depth: 4)
+      @hot_partition_sizes = { top: top, width: width, depth: depth }
+      @prepared_statements.each_value { |prepared| track_partitions(prepared) }
+      self
+    end
+
+    # Most requested partitions across this session's tracked statements
+    # @param limit [Integer] Entries returned
+    # @return [Array<Hash>] { query:, key:, requests:, bytes:, rows:, max_bytes: },
+    #   most requested first; requests and bytes are upper-bound estimates
+    def hot_partitions(limit: 10)
+      partition_ranking(:hot, :requests, limit)
+    end
+
+    # Partitions returning the most bytes across this session's tracked
+    # statements, ordered by bytes; entries as in #hot_partitions
+    # @param limit [Integer] Entries returned
+    # @return [Array<Hash>]
+    def heavy_partitions(limit: 10)
+      partition_ranking(:heavy, :bytes, limit)
+    end
+
+    # Process-wide latency breakdown recorded by the native layer
+    # @return [Hash] Histogram summaries for :queue, :network, :gvl_wait and :decode
+    def phase_latencies
+      CassandraCpp.phase_latencies
+    end
+
     # Get the current keyspace for this session
     # @return [String, nil] Current keyspace name
     def keyspace
@@ -117,5 +668,147 @@ module CassandraCpp
     def close
       @native_session&.close
     end
+
+    private
+
+    # Row lookup shared by #get_object and the manifest read of #put_object
+    def object_select(table)
+      prepare('SELECT key, version, chunk_no, data, checksum, object_size, chunk_count, chunk_version ' \
+              "FROM #{table} WHERE key = ? AND version = ? AND chunk_no = ?")
+    end
+
+    def qualified_table(table)
+      name = table.to_s.delete('"').downcase
+      name.include?('.') || keyspace.nil? ? name : "#{keyspace.downcase}.#{name}"
+    end
+
+    # How a query relates to the key filters, cached per query string:
+    # [:read, filter, param index], [:write, filter, param index],
+    # [:untracked_write, filter], [:untracked_writes, filters] or nil
+    def key_filter_plan(query)
+      @key_filter_plans.fetch(query) do
+        @key_filter_plans[query] = parse_key_filter_plan(query)
+      end
+    end
+
+    def parse_key_filter_plan(query)
+      if (match = KEY_FILTER_READ.match(query))
+        filter = @key_filters[qualified_table(match[1])]
+        return nil unless filter && match[2].casecmp?(filter.key_column)
+        
+        [:read, filter, query[0...match.begin(3)].count('?')]
+      elsif (match = KEY_FILTER_WRITE.match(query))
+        filter = @key_filters[qualified_table(match[1])]
+        return nil unless filter
+        
+        index = key_parameter_index(query, filter.key_column)
+        index ? [:write, filter, index] : [:untracked_write, filter]
+      else
+        # Writes this does not attribute, e.g. inside a batch string
+        filters = query.scan(KEY_FILTER_ANY_WRITE).filter_map { |(table)| @key_filters[qualified_table(table)] }.uniq
+        [:untracked_writes, filters] unless filters.empty?
+      end
+    end
+
+    # Bind position of the key in an INSERT ... (columns) VALUES (...) or an
+    # UPDATE ... WHERE key = ?, nil when the key is not a plain placeholder
+    def key_parameter_index(query, key_column)
+      if (match = /\(([^)]*)\)\s*VALUES\s*\(([^)]*)\)/im.match(query))
+        columns = match[1].split(',').map { |column| column.strip.delete('"').downcase }
+        values = match[2].split(',').map(&:strip)
+        position = columns.index(key_column.downcase)
+        return nil unless position && columns.size == values.size && values[position] == '?'
+        
+        query[0...match.begin(2)].count('?') + values[0...position].sum { |value| value.count('?') }
+      elsif (match = /\bWHERE\s+(?:.*\bAND\s+)?"?#{Regexp.escape(key_column)}"?\s*=\s*(\?)/im.match(query))
+        query[0...match.begin(1)].count('?')
+      end
+    end
+
+    def key_filter_write_columns(query, columns)
+      kind, filter = key_filter_plan(query)
+      return unless kind == :write || kind == :untracked_write
+      
+      _, keys = columns.find { |name, _| name.to_s.casecmp?(filter.key_column) }
+      if keys
+        filter.add_all(keys.to_a)
+      else
+        filter.invalidate!
+      end
+    end
+
+    # Arguments of a native simple statement execution: the query and, when
+    # any apply, its options
+    def simple_statement_args(query, params, trace, routing_key, keyspace)
+      options = {}
+      options[:tracing] = true if trace
+      options[:params] = params unless params.empty?
+      if routing_key
+        options[:key_indexes] = routing_key_indexes(query, routing_key)
+        options[:key_types] = routing_key_types(query, options[:key_indexes].size)
+        keyspace ||= query_keyspace(query)
+      end
+      options[:keyspace] = keyspace.to_s if keyspace
+      options.empty? ? [query] : [query, options]
+    end
+
+    # Keyspace qualifier of the query's table, nil when unqualified
+    def query_keyspace(query)
+      table = STATEMENT_TABLE.match(query)&.[](1)&.delete('"')
+      table.split('.', 2).first if table&.include?('.')
+    end
+
+    def track_partitions(prepared)
+      return unless @hot_partition_sizes
+      
+      key_indexes = partition_key_indexes(prepared.query)
+      prepared.track_partitions(key_indexes, **@hot_partition_sizes) if key_indexes
+    end
+
+    # Bind positions of the statement's partition key columns, in key order,
+    # or nil when the statement does not bind all of them
+    def partition_key_indexes(query)
+      match = STATEMENT_TABLE.match(query)
+      return nil unless match
+      
+      table = qualified_table(match[1])
+      return nil if SYSTEM_KEYSPACE.match?(table)
+      
+      columns = @partition_key_columns[table] ||= primary_key_columns(table, kinds: %w[partition_key])
+      indexes = columns.map { |column| key_parameter_index(query, column) }
+      indexes.include?(nil) ? nil : indexes
+    rescue CassandraCpp::Error, ArgumentError
+      nil
+    end
+
+    def partition_ranking(list, metric, limit)
+      entries = @prepared_statements.each_value.flat_map do |prepared|
+        stats = prepared.hot_partitions
+        stats ? stats[list].map { |entry| entry.merge(query: prepared.query) } : []
+      end
+      entries.max_by(limit) { |entry| entry[metric] }
+    end
+
+    # CQL types of the partition key columns, in key order
+    def partition_key_types(table)
+      keyspace_name, table_name = table.include?('.') ? table.split('.', 2) : [keyspace, table]
+      rows = execute('SELECT kind, position, type FROM system_schema.columns ' \
+                     'WHERE keyspace_name = ? AND table_name = ?', keyspace_name, table_name).to_a
+      raise ArgumentError, "Unknown table: #{table}" if rows.empty?
+      
+      rows.select { |row| row['kind'] == 'partition_key' }.sort_by { |row| row['position'] }.map { |row| row['type'] }
+    end
+
+    # Partition key columns, then clustering columns, in declaration order
+    def primary_key_columns(table, kinds: %w[partition_key clustering])
+      keyspace_name, table_name = table.include?('.') ? table.split('.', 2) : [keyspace, table]
+      rows = execute('SELECT column_name, kind, position FROM system_schema.columns ' \
+                     'WHERE keyspace_name = ? AND table_name = ?', keyspace_name, table_name).to_a
+      raise ArgumentError, "Unknown table: #{table}" if rows.empty?
+      
+      kinds.flat_map do |kind|
+        rows.select { |row| row['kind'] == kind }.sort_by { |row| row['position'] }.map { |row| row['column_name'] }
+      end
+    end
   end
 end
\ No newline at end of file
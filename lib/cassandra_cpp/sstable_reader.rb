@@ -0,0 +1,256 @@
+# frozen_string_literal: true
+
+require 'bigdecimal'
+require 'date'
+require 'etc'
+require 'set'
+
+module CassandraCpp
+  # Offline reads of SSTables, such as a node's nightly snapshot, for
+  # analytics that should not load the live cluster.
+  #
+  # Each reader memory-maps one BIG-format Data.db (Cassandra 3.0 to 4.1)
+  # and yields its live rows in partition and clustering order, decoded to
+  # the same Ruby values a query returns. Partition, range, row, collection
+  # and cell deletions in the file are applied, as are TTLs expired at now.
+  # Deletions in other SSTables are not: a row deleted by a newer SSTable
+  # is still read from an older one, so read a compacted table (or merge
+  # by primary key) when that matters.
+  #
+  # The partition key and clustering column names are not stored in
+  # SSTables; they come from the snapshot's schema.cql when there is one,
+  # from key_columns:/clustering_columns: otherwise, and default to key,
+  # key2, ... and column1, column2, ...
+  #
+  # SSTables are independent, so a snapshot splits across cores by file
+  # with SSTableReader.map.
+  #
+  # @example
+  #   dir = '/var/lib/cassandra/data/app/events-1b2c.../snapshots/nightly'
+  #   counts = CassandraCpp::SSTableReader.map(dir) do |reader|
+  #     reader.each_row.each_with_object(Hash.new(0)) { |row, totals| totals[row['kind']] += 1 }
+  #   end
+  #   counts.reduce { |a, b| a.merge(b) { |_, x, y| x + y } }
+  class SSTableReader
+    include Enumerable
+
+    DATA_FILE = /\A[a-z]{2}-\d+-big-Data\.db\z/.freeze
+    ROW_FORMATS = %i[hash array].freeze
+
+    attr_reader :path
+
+    # Data.db files of the SSTables in a directory, largest first so work
+    # split across processes finishes together
+    # @param directory [String] Table data or snapshot directory
+    # @return [Array<String>]
+    def self.sstables(directory)
+      Dir.children(directory.to_s)
+         .select { |name| DATA_FILE.match?(name) }
+         .map { |name| File.join(directory.to_s, name) }
+         .sort_by { |path| [-File.size(path), path] }
+    end
+
+    # Open a reader, closing it after the block when one is given
+    # @return [SSTableReader, Object] The reader, or the block's value
+    def self.open(path, **options)
+      reader = new(path, **options)
+      return reader unless block_given?
+
+      begin
+        yield reader
+      ensure
+        reader.close
+      end
+    end
+
+    # Run the block on a reader for each SSTable, in forked worker processes
+    # (one per core by default), and collect what it returns. Results are
+    # passed back with Marshal, so they must be marshalable; exceptions in a
+    # worker are raised here.
+    #
+    # @param sstables [String, Array<String>] Directory, or Data.db paths
+    # @param processes [Integer] Worker processes; 1 (or no fork) runs in this process
+    # @param options [Hash] Options for SSTableReader.new
+    # @yieldparam reader [SSTableReader]
+    # @return [Array] The block's results, in the order of the SSTables
+    def self.map(sstables, processes: Etc.nprocessors, **options, &block)
+      raise ArgumentError, 'SSTableReader.map needs a block' unless block
+
+      paths = sstables.is_a?(Array) ? sstables.map(&:to_s) : self.sstables(sstables)
+      processes = [processes.to_i, paths.size].min
+      if processes <= 1 || !Process.respond_to?(:fork)
+        return paths.map { |path| open(path, **options, &block) }
+      end
+
+      # Largest files first onto the least loaded worker
+      shares = Array.new(processes) { [] }
+      loads = Array.new(processes, 0)
+      paths.each_with_index.sort_by { |path, index| [-File.size(path), index] }.each do |path, index|
+        worker = loads.index(loads.min)
+        shares[worker] << index
+        loads[worker] += File.size(path)
+      end
+
+      workers = shares.map do |indexes|
+        output, input = IO.pipe
+        pid = fork do
+          output.close
+          begin
+            payload = [:ok, indexes.map { |index| open(paths[index], **options, &block) }]
+          rescue StandardError, ScriptError => e
+            payload = [:error, e]
+          end
+          begin
+            input.write(Marshal.dump(payload))
+          rescue TypeError => e
+            input.write(Marshal.dump([:error, RuntimeError.new("#{e.message} in SSTableReader.map worker")]))
+          end
+          input.close
+          exit!(0)
+        end
+        input.close
+        [pid, output, indexes]
+      end
+
+      results = Array.new(paths.size)
+      failure = nil
+      workers.each do |pid, output, indexes|
+        data = output.read
+        output.close
+        Process.wait(pid)
+        if data.empty?
+          failure ||= RuntimeError.new("SSTableReader.map worker #{pid} exited with #{$?.exitstatus}")
+          next
+        end
+
+        status, value = Marshal.load(data)
+        if status == :ok
+          indexes.zip(value) { |index, result| results[index] = result }
+        else
+          failure ||= value
+        end
+      end
+      raise failure if failure
+
+      results
+    end
+
+    # @param path [String] Data.db file, e.g. nb-12-big-Data.db
+    # @param key_columns [Array<String>, nil] Partition key column names, in key order
+    # @param clustering_columns [Array<String>, nil] Clustering column names, in order
+    # @param schema [String, nil] CREATE TABLE statement naming them; defaults to a
+    #   schema.cql next to the file
+    def initialize(path, key_columns: nil, clustering_columns: nil, schema: nil)
+      @path = File.expand_path(path.to_s)
+      schema ||= File.read(schema_file) if File.exist?(schema_file)
+      if schema
+        columns = SSTableWriter.parse_schema(schema[/CREATE\s+TABLE\b.*/im] || schema)
+        key_columns ||= key_names(columns, :partition_key)
+        clustering_columns ||= key_names(columns, :clustering)
+      end
+
+      @native = NativeSSTableReader.open(@path, key_columns&.map(&:to_s), clustering_columns&.map(&:to_s))
+      @closed = false
+    end
+
+    # Live rows in partition and clustering order. Hash rows are keyed by
+    # column name; Array rows list values in #columns order (partition key,
+    # clustering, static, then regular columns).
+    #
+    # A partition with static values but no live rows reads as one row with
+    # nil clustering and regular columns, as a query returns it.
+    #
+    # @param as [Symbol] :hash or :array
+    # @param now [Time, Integer] When TTLs are evaluated; seconds since the epoch if an Integer
+    # @return [Integer, Enumerator] Rows yielded, or an Enumerator without a block
+    def each_row(as: :hash, now: Time.now, &block)
+      return enum_for(:each_row, as: as, now: now) unless block
+      raise ArgumentError, "as: must be one of #{ROW_FORMATS.join(', ')}" unless ROW_FORMATS.include?(as)
+
+      @native.each_row(as == :array, now.to_i, &block)
+    end
+
+    def each(&block)
+      each_row(&block)
+    end
+
+    # Rows grouped by partition
+    # @yieldparam key [Array] Partition key values
+    # @yieldparam rows [Array<Hash, Array>] The partition's live rows
+    # @return [Enumerator] without a block
+    def each_partition(as: :hash, now: Time.now)
+      return enum_for(:each_partition, as: as, now: now) unless block_given?
+
+      names = key_columns
+      key = nil
+      rows = []
+      each_row(as: as, now: now) do |row|
+        row_key = as == :array ? row.first(names.size) : row.values_at(*names)
+        if key && row_key != key
+          yield key, rows
+          rows = []
+        end
+        key = row_key
+        rows << row
+      end
+      yield key, rows if key
+      nil
+    end
+
+    # Columns in row order
+    # @return [Array<SSTableWriter::Column>] with the CQL types of the SSTable's
+    #   serialization header
+    def columns
+      @columns ||= begin
+        positions = Hash.new(-1)
+        @native.columns.map do |name, type, kind|
+          position = kind == :partition_key || kind == :clustering ? positions[kind] += 1 : -1
+          SSTableWriter::Column.new(name: name, type: type, kind: kind, position: position, descending: false).freeze
+        end.freeze
+      end
+    end
+
+    # @return [Array<String>] Partition key column names
+    def key_columns
+      columns.select { |column| column.kind == :partition_key }.map(&:name)
+    end
+
+    # @return [String] SSTable format version, e.g. "nb"
+    def version
+      @native.version
+    end
+
+    # @return [Symbol, nil] :lz4, :snappy, :deflate or :none for compressed
+    #   SSTables, nil for uncompressed ones
+    def compression
+      @native.compression
+    end
+
+    # @return [Integer] Uncompressed size of the partition data
+    def data_size
+      @native.data_size
+    end
+
+    def close
+      return if @closed
+
+      @native.close
+      @closed = true
+      nil
+    end
+
+    def closed?
+      @closed
+    end
+
+    private
+
+    def schema_file
+      File.join(File.dirname(@path), 'schema.cql')
+    end
+
+    def key_names(columns, kind)
+      columns.select { |column| column.kind == kind }.sort_by(&:position).map(&:name)
+    end
+  end
+end
\ No newline at end of file
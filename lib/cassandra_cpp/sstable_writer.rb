@@ -0,0 +1,281 @@
+# frozen_string_literal: true
+
+require 'fileutils'
+
+module CassandraCpp
+  # Offline bulk loading: write rows straight into SSTable files in
+  # Cassandra 4's format, without a cluster, for sstableloader or
+  # nodetool import to stream in.
+  #
+  # Rows are buffered natively, sorted by token, partition key and
+  # clustering, and written as one SSTable each time about buffer_size bytes
+  # are buffered, plus one for the rest on #close. Writes of the same
+  # primary key are merged the way Cassandra would, cell by cell by
+  # timestamp. Each SSTable holds the Data, Index, Summary, Filter,
+  # Statistics, CRC, Digest and TOC components, numbered from the first
+  # generation not already in the directory.
+  #
+  # Supported column types are the native scalar types (ascii, bigint, blob,
+  # boolean, date, decimal, double, float, inet, int, smallint, text, time,
+  # timestamp, timeuuid, tinyint, uuid, varchar, varint). Tables with static,
+  # collection, UDT or counter columns cannot be written.
+  #
+  # @example
+  #   writer = CassandraCpp::SSTableWriter.new('/data/load/app/events', schema: <<~CQL)
+  #     CREATE TABLE app.events (day date, at timestamp, kind text, payload blob,
+  #                              PRIMARY KEY (day, at)) WITH CLUSTERING ORDER BY (at DESC)
+  #   CQL
+  #   events.each { |event| writer << event }
+  #   writer.close # => ["/data/load/app/events/nb-1-big-Data.db", ...]
+  class SSTableWriter
+    # A table column; kind is :partition_key, :clustering or :regular,
+    # position orders key columns
+    Column = Struct.new(:name, :type, :kind, :position, :descending, keyword_init: true)
+
+    DEFAULT_BUFFER_SIZE = 128 * 1024 * 1024
+    KINDS = %i[partition_key clustering regular static].freeze
+    IDENTIFIER = /(?:"(?:[^"]|"")+"|\w+)/.freeze
+
+    attr_reader :directory, :columns
+
+    # Columns of a CREATE TABLE statement, in declaration order. Unquoted
+    # identifiers are lowercased as Cassandra does.
+    # @param cql [String] CREATE TABLE statement
+    # @return [Array<Column>]
+    def self.parse_schema(cql)
+      match = cql.match(/\A\s*CREATE\s+TABLE\s+(?:IF\s+NOT\s+EXISTS\s+)?#{IDENTIFIER}(?:\s*\.\s*#{IDENTIFIER})?\s*\(/im)
+      raise ArgumentError, 'schema must be a CREATE TABLE statement' unless match
+
+      body, options = split_parenthesized(cql, match.end(0) - 1)
+      definitions = split_top_level(body)
+      columns = []
+      partition_key = []
+      clustering = []
+
+      definitions.each do |definition|
+        if (key = definition.match(/\APRIMARY\s+KEY\s*\((.*)\)\z/im))
+          parts = split_top_level(key[1])
+          partition_key = parts.shift
+          partition_key = partition_key.start_with?('(') ? split_top_level(partition_key[1..-2]) : [partition_key]
+          partition_key = partition_key.map { |name| identifier(name) }
+          clustering = parts.map { |name| identifier(name) }
+          next
+        end
+
+        name, type, modifiers = split_column_definition(definition)
+        column = Column.new(name: name, type: type, kind: :regular, position: -1, descending: false)
+        column.kind = :static if modifiers =~ /\bSTATIC\b/i
+        partition_key = [name] if modifiers =~ /\bPRIMARY\s+KEY\b/i
+        columns << column
+      end
+      raise ArgumentError, 'schema has no PRIMARY KEY' if partition_key.empty?
+
+      descending = {}
+      if (order = options.match(/CLUSTERING\s+ORDER\s+BY\s*\(([^)]*)\)/i))
+        split_top_level(order[1]).each do |entry|
+          name, direction = entry.split(/\s+(?=(?:ASC|DESC)\s*\z)/i)
+          descending[identifier(name)] = direction.to_s.strip.casecmp?('DESC')
+        end
+      end
+
+      by_name = columns.to_h { |column| [column.name, column] }
+      [[partition_key, :partition_key], [clustering, :clustering]].each do |names, kind|
+        names.each_with_index do |name, position|
+          column = by_name[name] or raise ArgumentError, "PRIMARY KEY column #{name} is not defined"
+          column.kind = kind
+          column.position = position
+          column.descending = descending.fetch(name, false)
+        end
+      end
+      columns
+    end
+
+    # @param directory [String] Output directory, created if missing; normally <keyspace>/<table>
+    # @param schema [String, Schema::DDL::TableBuilder, Array<Column, Hash>] CREATE TABLE
+    #   statement, table builder, or columns (Hashes with :name, :type, :kind, :position and
+    #   :descending, as Session#sstable_writer reads them from system_schema)
+    # @param buffer_size [Integer] Bytes of rows buffered before an SSTable is written
+    # @param bloom_filter_fp_chance [Float] The table's bloom_filter_fp_chance
+    def initialize(directory, schema:, buffer_size: DEFAULT_BUFFER_SIZE, bloom_filter_fp_chance: 0.01)
+      @directory = File.expand_path(directory.to_s)
+      @columns = normalize_schema(schema).freeze
+
+      static = @columns.find { |column| column.kind == :static }
+      raise ArgumentError, "Static column #{static.name} cannot be written to SSTables" if static
+
+      ordered = ordered_columns
+      @index = ordered.each_with_index.to_h { |column, i| [column.name, i] }.freeze
+      native_columns = ordered.map { |column| [column.name, column.type, column.kind, column.descending] }
+
+      FileUtils.mkdir_p(@directory)
+      @native = NativeSSTableWriter.new(@directory, native_columns, next_generation, buffer_size,
+                                        bloom_filter_fp_chance)
+      @closed = false
+    end
+
+    # Buffer one row, writing an SSTable if the buffer is full
+    # @param row [Hash] Column name (String or Symbol) => value; nil or missing regular columns are left unset
+    # @param timestamp [Integer, Time, nil] Write time, microseconds since the epoch; nil for now
+    # @param ttl [Integer, nil] Seconds until the row expires; nil for never
+    # @return [self]
+    def add(row, timestamp: nil, ttl: nil)
+      raise IOError, 'SSTable writer is closed' if @closed
+
+      values = Array.new(@index.size)
+      row.each do |name, value|
+        index = @index[name.to_s]
+        raise ArgumentError, "Unknown column #{name}" unless index
+
+        values[index] = value
+      end
+      timestamp = (timestamp.to_r * 1_000_000).to_i if timestamp.is_a?(Time)
+      @native.add(values, timestamp, ttl)
+      self
+    end
+
+    def <<(row)
+      add(row)
+    end
+
+    # Write the buffered rows as an SSTable now
+    # @return [String, nil] Path of its Data.db, nil when nothing was buffered
+    def flush
+      raise IOError, 'SSTable writer is closed' if @closed
+
+      @native.flush
+    end
+
+    # Write the remaining rows
+    # @return [Array<String>] Data.db paths of every SSTable written
+    def close
+      unless @closed
+        @native.flush
+        @closed = true
+      end
+      sstables
+    end
+
+    def closed?
+      @closed
+    end
+
+    # @return [Array<String>] Data.db paths of the SSTables written so far
+    def sstables
+      @native.sstables
+    end
+
+    # @return [Integer] Rows waiting for the next SSTable
+    def buffered_rows
+      @native.buffered_rows
+    end
+
+    # @return [Integer] Approximate memory held by buffered rows
+    def buffered_bytes
+      @native.buffered_bytes
+    end
+
+    class << self
+      private
+
+      # Contents of the parentheses opening at start, and the text after them
+      def split_parenthesized(text, start)
+        depth = 0
+        quoted = nil
+        (start...text.size).each do |i|
+          char = text[i]
+          if quoted
+            quoted = nil if char == quoted
+          elsif char == '"' || char == "'"
+            quoted = char
+          elsif char == '('
+            depth += 1
+          elsif char == ')'
+            depth -= 1
+            return [text[(start + 1)...i], text[(i + 1)..]] if depth.zero?
+          end
+        end
+        raise ArgumentError, 'Unbalanced parentheses in schema'
+      end
+
+      # Split on commas outside parentheses, angle brackets and quotes
+      def split_top_level(text)
+        parts = []
+        depth = 0
+        quoted = nil
+        current = +''
+        text.each_char do |char|
+          if quoted
+            quoted = nil if char == quoted
+          elsif char == '"' || char == "'"
+            quoted = char
+          elsif '(<'.include?(char)
+            depth += 1
+          elsif ')>'.include?(char)
+            depth -= 1
+          elsif char == ',' && depth.zero?
+            parts << current.strip
+            current = +''
+            next
+          end
+          current << char
+        end
+        parts << current.strip
+        parts.reject(&:empty?)
+      end
+
+      # [name, type, modifiers] of one column definition
+      def split_column_definition(definition)
+        match = definition.match(/\A(#{IDENTIFIER})\s+(.*)\z/m)
+        raise ArgumentError, "Cannot parse column definition: #{definition}" unless match
+
+        rest = match[2]
+        depth = 0
+        type_end = rest.size
+        rest.each_char.with_index do |char, i|
+          depth += 1 if char == '<'
+          depth -= 1 if char == '>'
+          next unless depth.zero? && char =~ /\s/
+
+          type_end = i
+          break
+        end
+        [identifier(match[1]), rest[0...type_end].gsub(/\s+/, '').downcase, rest[type_end..].to_s]
+      end
+
+      def identifier(text)
+        text = text.strip
+        text.start_with?('"') ? text[1..-2].gsub('""', '"') : text.downcase
+      end
+    end
+
+    private
+
+    def normalize_schema(schema)
+      schema = schema.to_cql if schema.respond_to?(:to_cql)
+      return self.class.parse_schema(schema) if schema.is_a?(String)
+
+      Array(schema).map do |column|
+        column = column.to_h
+        kind = column.fetch(:kind).to_sym
+        raise ArgumentError, "Column #{column[:name]} has unknown kind #{kind}" unless KINDS.include?(kind)
+
+        Column.new(name: column.fetch(:name).to_s, type: column.fetch(:type).to_s, kind: kind,
+                   position: column.fetch(:position, -1), descending: column.fetch(:descending, false) ? true : false)
+      end
+    end
+
+    # Partition key and clustering columns by position, then the rest
+    def ordered_columns
+      key = @columns.select { |column| column.kind == :partition_key }.sort_by(&:position)
+      clustering = @columns.select { |column| column.kind == :clustering }.sort_by(&:position)
+      key + clustering + @columns.select { |column| column.kind == :regular }
+    end
+
+    # One past the highest generation in the directory, so existing
+    # SSTables are never overwritten
+    def next_generation
+      generations = Dir.children(@directory).filter_map { |name| name[/\A[a-z]{2}-(\d+)-big-/, 1]&.to_i }
+      (generations.max || 0) + 1
+    end
+  end
+end
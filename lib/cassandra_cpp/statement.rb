@@ -14,8 +14,12 @@ module CassandraCpp
   class Statement
     # This class wraps the native statement and is initialized internally
     # Users should not instantiate this class directly
-    def initialize(native_statement)
+    #
+    # @param native_statement [NativeStatement] The bound native statement
+    # @param prepared [PreparedStatement, nil] Statement it was bound from
+    def initialize(native_statement, prepared = nil)
       @native_statement = native_statement
+      @prepared = prepared
       @bound_params = {}
     end
     
@@ -34,6 +38,8 @@ module CassandraCpp
     #
     # @return [Array<Hash>] The raw result rows
     def execute
+      return [] if @prepared && !@prepared.key_filter_admit(params)
+      
       @native_statement.execute
     end
     
@@ -43,5 +49,21 @@ module CassandraCpp
     def bound_params
       @bound_params.dup
     end
+    
+    # Bound values in parameter order, nil where unbound
+    #
+    # @return [Array] The bound values
+    def params
+      count = @bound_params.empty? ? 0 : @bound_params.keys.max + 1
+      Array.new(count) { |index| @bound_params[index] }
+    end
+    
+    # @return [String, nil] Query of the prepared statement, when known
+    def query
+      @prepared&.query
+    end
+    
+    # @api private
+    attr_reader :native_statement, :prepared
   end
 end
\ No newline at end of file
@@ -0,0 +1,179 @@
+# frozen_string_literal: true
+
+require 'bigdecimal'
+require 'set'
+
+module CassandraCpp
+  # Read-only copy of a small table in a sorted, memory-mapped file, for
+  # reference data read far more often than it changes.
+  #
+  # The file is written once per host: every process opening the same path
+  # maps the same file, so forked workers share one copy in the page cache
+  # and look rows up without touching the network. A rebuild scans the table
+  # into a new file and renames it over the old one, so readers switch
+  # atomically; processes pick up the new file on their next lookup.
+  #
+  # Rows are stored as plain data in the extension's own value encoding, not
+  # with Marshal, and the file is readable by its owner only, so another user
+  # on the host can neither read the rows nor plant objects in them.
+  #
+  # @example
+  #   countries = session.snapshot_table('app.countries', path: '/var/cache/app/countries.snap',
+  #                                      refresh: 10 * 60 * 1000)
+  #   countries['DE']         # => { 'code' => 'DE', 'name' => 'Germany', ... }
+  #   countries.range('A', 'C') # rows with 'A' <= code < 'C'
+  class TableSnapshot
+    include Enumerable
+
+    # How often (ms) lookups check for a replaced or expired file
+    CHECK_INTERVAL_MS = 1000
+
+    attr_reader :table, :path, :key_columns
+
+    # @param session [Session] Session used to scan the table on rebuilds
+    # @param table [String] Table name, optionally keyspace-qualified
+    # @param path [String] Snapshot file shared by all processes on the host
+    # @param key_columns [Array<String>] Columns forming the lookup key
+    # @param refresh [Integer, nil] Maximum age (ms) before the file is rebuilt; nil keeps it until #refresh!
+    def initialize(session, table, path:, key_columns:, refresh: nil)
+      @session = session
+      @table = table
+      @path = path.to_s
+      @key_columns = key_columns.map(&:to_s).freeze
+      @refresh = refresh
+
+      with_lock(File::LOCK_EX) do
+        build unless File.exist?(@path) && !expired?
+      end
+      begin
+        open_snapshot
+      rescue ArgumentError
+        # Left behind by a release that wrote another layout
+        with_lock(File::LOCK_EX) { build }
+        open_snapshot
+      end
+    end
+
+    # Row stored under key. Each hit decodes the row into fresh objects (a few
+    # microseconds for a small row); callers reading the same row in a tight
+    # loop should keep the Hash rather than look it up again.
+    # @param key [Object, Array] Key value, or an Array of values for a composite key
+    # @return [Hash, nil] Row, or nil when absent
+    def [](key)
+      check_for_update
+
+      @native.get(key)
+    end
+    alias get []
+
+    # Rows with from <= key < to, in key order. Bounds may be nil (open) and,
+    # for composite keys, an Array of leading key values.
+    #
+    # @param from [Object, Array, nil] Inclusive lower bound
+    # @param to [Object, Array, nil] Exclusive upper bound
+    # @param limit [Integer, nil] Maximum number of rows
+    # @return [Array<Hash>] Rows
+    def range(from = nil, to = nil, limit: nil)
+      check_for_update
+
+      @native.range(from, to, limit)
+    end
+
+    def each(&block)
+      return enum_for(:each) unless block
+
+      range.each(&block)
+    end
+
+    # @return [Integer] Number of rows in the mapped snapshot
+    def size
+      @native.size
+    end
+
+    # Rebuild the file from the table now and switch to it. Processes
+    # refreshing at the same time wait for one rebuild instead of repeating it.
+    # @return [TableSnapshot] self
+    def refresh!
+      started = File.exist?(@path) ? File.mtime(@path) : nil
+      with_lock(File::LOCK_EX) do
+        build if started.nil? || File.mtime(@path) <= started
+      end
+      reopen
+      self
+    end
+
+    # @return [Float] Age of the snapshot file in milliseconds
+    def age_ms
+      (Time.now - File.mtime(@path)) * 1000
+    end
+
+    def close
+      @native&.close
+    end
+
+    private
+
+    # Scan the table and write the new file; the caller holds the lock
+    def build
+      keys = []
+      values = []
+      @session.each_row("SELECT * FROM #{@table}", reuse: false) do |row|
+        keys << (@key_columns.size == 1 ? row[@key_columns.first] : row.values_at(*@key_columns))
+        values << row
+      end
+
+      NativeSnapshot.write(@path, keys, values)
+    end
+
+    def open_snapshot
+      @native = NativeSnapshot.open(@path)
+      @checked_at = monotonic_ms
+    end
+
+    def reopen
+      previous = @native
+      open_snapshot
+      previous.close
+    end
+
+    # Switch to a file renamed in by another process, or rebuild an expired
+    # one unless another process is already rebuilding it. A failed rebuild
+    # keeps the current snapshot and is retried after CHECK_INTERVAL_MS.
+    def check_for_update
+      now = monotonic_ms
+      return if now - @checked_at < CHECK_INTERVAL_MS
+
+      @checked_at = now
+      if @native.changed?
+        reopen
+      elsif expired?
+        rebuilt = with_lock(File::LOCK_EX | File::LOCK_NB) do
+          build if expired?
+          true
+        end
+        reopen if rebuilt
+      end
+    rescue CassandraCpp::Error => e
+      CassandraCpp.logger&.warn("Snapshot refresh of #{@table} failed: #{e.message}")
+    end
+
+    def expired?
+      @refresh && age_ms >= @refresh
+    end
+
+    # Serialize rebuilds across processes with an advisory lock next to the
+    # file. Returns nil without running the block when a non-blocking lock is
+    # held elsewhere.
+    def with_lock(mode)
+      File.open("#{@path}.lock", File::RDWR | File::CREAT, 0o600) do |lock|
+        return nil unless lock.flock(mode)
+
+        yield
+      end
+    end
+
+    def monotonic_ms
+      Process.clock_gettime(Process::CLOCK_MONOTONIC, :millisecond)
+    end
+  end
+end
\ No newline at end of file
@@ -0,0 +1,325 @@
+# frozen_string_literal: true
+
+require 'json'
+
+module CassandraCpp
+  # Full-table scan split into token ranges, with progress saved to a
+  # checkpoint so a restarted job continues where the last one stopped
+  # instead of from the first row.
+  #
+  # The checkpoint records the range plan, the ranges already finished and,
+  # for ranges in progress, the driver paging state after the last page
+  # handed to the block. Ranges are planned once per job from
+  # system.size_estimates, so each covers about the same number of
+  # partitions, and the same estimates drive #progress.
+  #
+  # Delivery is at least once: rows of the page being processed, and of
+  # pages processed since the last save, are yielded again after a restart.
+  #
+  # @example
+  #   scan = session.token_range_scan('app.events', checkpoint: '/var/lib/jobs/backfill.json')
+  #   scan.each_row do |row|
+  #     backfill(row)
+  #     puts scan.progress.inspect if rand < 0.0001
+  #   end
+  class TokenRangeScan
+    # Murmur3 partitioner token bounds; no key hashes to TOKEN_MIN
+    TOKEN_MIN = -2**63
+    TOKEN_MAX = 2**63 - 1
+
+    # Progress kept in a local JSON file, replaced atomically on every save
+    class FileCheckpoint
+      attr_reader :path
+
+      # @param path [String] Checkpoint file
+      def initialize(path)
+        @path = path.to_s
+      end
+
+      # @return [Hash, nil] Saved state, nil before the first save
+      def load
+        JSON.parse(File.read(@path))
+      rescue Errno::ENOENT
+        nil
+      end
+
+      # @param state [Hash] State to persist
+      def save(state)
+        temp = "#{@path}.#{Process.pid}.tmp"
+        File.write(temp, JSON.generate(state))
+        File.rename(temp, @path)
+      end
+
+      def clear
+        File.delete(@path) if File.exist?(@path)
+      end
+    end
+
+    # Progress kept in a Cassandra table, one row per job, so any worker can
+    # resume it. The table is created if missing.
+    class TableCheckpoint
+      attr_reader :table, :job
+
+      # @param session [Session] Session used for checkpoint reads and writes
+      # @param job [String] Job name; jobs sharing a table are kept apart by name
+      # @param table [String] Progress table, optionally keyspace-qualified
+      def initialize(session, job, table: 'scan_checkpoints')
+        @session = session
+        @job = job.to_s
+        @table = table
+        @session.execute("CREATE TABLE IF NOT EXISTS #{@table} (job text PRIMARY KEY, state text, updated_at timestamp)")
+      end
+
+      def load
+        row = @session.execute("SELECT state FROM #{@table} WHERE job = ?", @job).first
+        row && JSON.parse(row['state'])
+      end
+
+      def save(state)
+        @session.execute("INSERT INTO #{@table} (job, state, updated_at) VALUES (?, ?, toTimestamp(now()))",
+                         @job, JSON.generate(state))
+      end
+
+      def clear
+        @session.execute("DELETE FROM #{@table} WHERE job = ?", @job)
+      end
+    end
+
+    attr_reader :table, :key_columns, :checkpoint
+
+    # @param session [Session] Session to scan with
+    # @param table [String] Table name, optionally keyspace-qualified
+    # @param key_columns [Array<String>] Partition key columns, in order
+    # @param checkpoint [FileCheckpoint, TableCheckpoint, #load/#save/#clear, nil] Where progress is kept; nil keeps it in memory only
+    # @param columns [String] Selected columns
+    # @param splits [Integer] Token ranges planned for a new job
+    # @param page_size [Integer] Rows fetched per round trip
+    # @param checkpoint_interval [Integer] Minimum milliseconds between saves within a range; finished ranges are always saved
+    def initialize(session, table, key_columns:, checkpoint: nil, columns: '*', splits: 64, page_size: 5000,
+                   checkpoint_interval: 5000)
+      raise ArgumentError, 'splits must be at least 1' if splits < 1
+      raise ArgumentError, 'key_columns must not be empty' if key_columns.empty?
+
+      @session = session
+      @table = table
+      @key_columns = key_columns.map(&:to_s).freeze
+      @checkpoint = checkpoint
+      @columns = columns
+      @splits = splits
+      @page_size = page_size
+      @checkpoint_interval = checkpoint_interval
+      @state = nil
+      @run_started_at = nil
+      @run_completed = []
+    end
+
+    # Yield every row of the ranges not finished yet, resuming ranges in
+    # progress from their saved paging state
+    # @param as [Symbol] :hash or :array rows
+    # @yield [Hash, Array] Each row
+    # @return [Integer] Rows yielded by this call
+    def each_row(as: :hash)
+      return enum_for(:each_row, as: as) unless block_given?
+
+      state = load_state
+      statement = @session.prepare(range_query)
+      @run_started_at = monotonic_ms
+      @run_completed = []
+      saved_at = monotonic_ms
+      yielded = 0
+
+      state['ranges'].each_with_index do |(from, to, _weight), index|
+        next if state['completed'].include?(index)
+
+        paging_state = state['paging'][index.to_s]&.unpack1('m0')
+        statement.each_page(from, to, as: as, page_size: @page_size, paging_state: paging_state) do |rows, next_state|
+          rows.each { |row| yield row }
+          yielded += rows.size
+          state['rows'] += rows.size
+
+          # The last page is recorded with the finished range below
+          next unless next_state
+
+          state['paging'][index.to_s] = [next_state].pack('m0')
+          next unless monotonic_ms - saved_at >= @checkpoint_interval
+
+          save_state
+          saved_at = monotonic_ms
+        end
+
+        state['paging'].delete(index.to_s)
+        state['completed'] << index
+        @run_completed << index
+        save_state
+        saved_at = monotonic_ms
+      end
+
+      yielded
+    end
+
+    # @return [Boolean] true once every range has been scanned
+    def done?
+      state = load_state
+      state['completed'].size == state['ranges'].size
+    end
+
+    # @return [Hash] :ranges, :completed_ranges, :rows (across runs),
+    #   :estimated_partitions, :fraction_done (by estimated partitions, by
+    #   ranges without estimates) and :eta_seconds (from this run's rate, nil
+    #   until a range finishes)
+    def progress
+      state = load_state
+      estimated = state['ranges'].sum { |range| range[2] }
+      weight = ->(index) { estimated.positive? ? state['ranges'][index][2] : 1.0 }
+      total = estimated.positive? ? estimated : state['ranges'].size.to_f
+      done = state['completed'].sum(0.0) { |index| weight.call(index) }
+      fraction = total.positive? ? done / total : 1.0
+
+      eta = nil
+      run_done = @run_completed.sum(0.0) { |index| weight.call(index) }
+      if @run_started_at && run_done.positive?
+        elapsed = (monotonic_ms - @run_started_at) / 1000.0
+        eta = (elapsed * (total - done) / run_done).round
+      end
+
+      {
+        ranges: state['ranges'].size,
+        completed_ranges: state['completed'].size,
+        rows: state['rows'],
+        estimated_partitions: estimated.round,
+        fraction_done: fraction,
+        eta_seconds: eta
+      }
+    end
+
+    # Forget all progress; the next #each_row plans and scans from scratch
+    def reset!
+      @checkpoint&.clear
+      @state = nil
+      @run_completed = []
+      self
+    end
+
+    # @return [Array<Array(Integer, Integer, Float)>] Planned [from, to, estimated partitions]
+    #   ranges, each holding the rows with from < token <= to
+    def ranges
+      load_state['ranges']
+    end
+
+    # @return [String] CQL selecting the rows of one range, bound with from and to
+    def range_query
+      key = "token(#{@key_columns.join(', ')})"
+      "SELECT #{@columns} FROM #{@table} WHERE #{key} > ? AND #{key} <= ?"
+    end
+
+    private
+
+    def load_state
+      @state ||= begin
+        saved = @checkpoint&.load
+        if saved && saved['table'] == @table
+          saved
+        else
+          { 'table' => @table, 'ranges' => plan_ranges, 'completed' => [], 'paging' => {}, 'rows' => 0 }
+        end
+      end
+    end
+
+    def save_state
+      @checkpoint&.save(@state)
+    end
+
+    # [from, to, estimated partitions] ranges covering the ring, balanced by
+    # the size estimates; even token splits when there are none
+    def plan_ranges
+      segments = estimate_segments
+      return uniform_ranges if segments.empty?
+
+      filled = fill_gaps(segments)
+      total = filled.sum(&:last)
+      return uniform_ranges unless total.positive?
+
+      target = total / @splits
+      ranges = []
+      start = TOKEN_MIN
+      acc = 0.0
+      filled.each do |from, to, count|
+        while ranges.size < @splits - 1 && count.positive? && acc + count >= target
+          needed = target - acc
+          cut = from + ((to - from) * (needed / count)).floor
+          cut = to if cut > to
+          if cut > start
+            ranges << [start, cut, target]
+            start = cut
+          end
+          count -= needed
+          from = cut
+          acc = 0.0
+        end
+        acc += count
+      end
+      ranges << [start, TOKEN_MAX, acc]
+    end
+
+    def uniform_ranges
+      step = (TOKEN_MAX - TOKEN_MIN) / @splits
+      (0...@splits).map do |i|
+        from = TOKEN_MIN + i * step
+        [from, i == @splits - 1 ? TOKEN_MAX : from + step, 0.0]
+      end
+    end
+
+    # Estimated ranges of this table as sorted, non-wrapping [from, to, partitions]
+    def estimate_segments
+      keyspace_name, table_name = @table.include?('.') ? @table.split('.', 2) : [@session.keyspace, @table]
+      rows = @session.execute('SELECT range_start, range_end, partitions_count FROM system.size_estimates ' \
+                              'WHERE keyspace_name = ? AND table_name = ?', keyspace_name, table_name).to_a
+
+      segments = rows.flat_map do |row|
+        from = Integer(row['range_start'])
+        to = Integer(row['range_end'])
+        count = row['partitions_count'].to_f
+        to = TOKEN_MAX if to == TOKEN_MIN
+        next [[from, to, count]] if from < to
+
+        # Wrapping range: split its estimate over both ends of the ring
+        span = (TOKEN_MAX - from) + (to - TOKEN_MIN)
+        next [] unless span.positive?
+
+        high = count * (TOKEN_MAX - from) / span
+        [[from, TOKEN_MAX, high], [TOKEN_MIN, to, count - high]]
+      end
+      segments.reject { |from, to, _| to <= from }.sort_by(&:first)
+    rescue CassandraCpp::Error => e
+      CassandraCpp.logger&.warn("Size estimates for #{@table} unavailable, splitting evenly: #{e.message}")
+      []
+    end
+
+    # Cover the whole ring: token spans without an estimate (ranges owned by
+    # nodes that did not report) get the mean density of the estimated ones
+    def fill_gaps(segments)
+      covered = segments.sum { |from, to, _| to - from }
+      density = segments.sum(&:last) / covered
+
+      filled = []
+      cursor = TOKEN_MIN
+      segments.each do |from, to, count|
+        filled << [cursor, from, (from - cursor) * density] if from > cursor
+        if from < cursor
+          next if to <= cursor
+
+          count = count * (to - cursor) / (to - from)
+          from = cursor
+        end
+        filled << [from, to, count]
+        cursor = to
+      end
+      filled << [cursor, TOKEN_MAX, (TOKEN_MAX - cursor) * density] if cursor < TOKEN_MAX
+      filled
+    end
+
+    def monotonic_ms
+      Process.clock_gettime(Process::CLOCK_MONOTONIC, :millisecond)
+    end
+  end
+end
@@ -0,0 +1,193 @@
+# frozen_string_literal: true
+
+require 'set'
+require 'bigdecimal'
+
+module CassandraCpp
+  # Reader for the binary traffic logs written by the native recorder, plus
+  # helpers to start and stop recording.
+  #
+  # Recording is opt-in and process-wide: while active, every executed simple
+  # query and prepared statement is appended with its bound values, relative
+  # submit time, observed network latency and outcome.
+  #
+  # @example Capture production traffic
+  #   CassandraCpp::TrafficLog.record('/tmp/traffic.cctr') do
+  #     run_workload
+  #   end
+  #
+  # @example Inspect a log
+  #   CassandraCpp::TrafficLog.new('/tmp/traffic.cctr').each do |request|
+  #     puts "#{request.offset_us}us #{request.query} #{request.params.inspect}"
+  #   end
+  class TrafficLog
+    include Enumerable
+
+    MAGIC = 'CCTR'
+    VERSION = 1
+
+    ENTRY_QUERY = 1
+    ENTRY_REQUEST = 2
+    FLAG_PREPARED = 1
+
+    # One captured request
+    Request = Struct.new(:query, :prepared, :offset_us, :latency_us, :consistency, :status, :params,
+                         keyword_init: true) do
+      def prepared?
+        prepared
+      end
+
+      def error?
+        status != 0
+      end
+    end
+
+    class FormatError < Error; end
+
+    attr_reader :path, :started_at
+
+    # Start recording all executed requests to path
+    # @param path [String] Log file to create (truncated if it exists)
+    # @yield Optional block; recording stops when it returns
+    # @return [Hash, true] Recorder stats when a block is given, true otherwise
+    def self.record(path)
+      NativeRecorder.start(path)
+      return true unless block_given?
+
+      begin
+        yield
+      ensure
+        stats = NativeRecorder.stop
+      end
+      stats
+    end
+
+    # Stop recording
+    # @return [Hash, nil] Stats of the finished log (requests, queries, bytes)
+    def self.stop
+      NativeRecorder.stop
+    end
+
+    # @return [Boolean] true while requests are being recorded
+    def self.recording?
+      NativeRecorder.recording?
+    end
+
+    def initialize(path)
+      @path = path
+    end
+
+    # Iterate over captured requests in log order
+    # @yield [Request] Each captured request
+    def each
+      return enum_for(:each) unless block_given?
+
+      File.open(@path, 'rb') do |io|
+        read_header(io)
+        queries = {}
+
+        until io.eof?
+          case read_byte(io)
+          when ENTRY_QUERY
+            id = read_varint(io)
+            queries[id] = read_string(io, Encoding::UTF_8)
+          when ENTRY_REQUEST
+            yield read_request(io, queries)
+          else
+            raise FormatError, "Unknown traffic log entry at offset #{io.pos - 1}"
+          end
+        end
+      end
+    end
+
+    private
+
+    def read_header(io)
+      raise FormatError, "#{@path} is not a traffic log" unless io.read(4) == MAGIC
+
+      version = read_byte(io)
+      raise FormatError, "Unsupported traffic log version #{version}" unless version == VERSION
+
+      started_us = read_exact(io, 8).unpack1('Q<')
+      @started_at = Time.at(started_us / 1_000_000, started_us % 1_000_000, :usec)
+    end
+
+    def read_request(io, queries)
+      id = read_varint(io)
+      query = queries.fetch(id) { raise FormatError, "Request references unknown query #{id}" }
+      flags = read_byte(io)
+      offset_us = read_varint(io)
+      latency_us = read_varint(io)
+      consistency = read_varint(io)
+      status = read_varint(io)
+      params = Array.new(read_varint(io)) { read_value(io) }
+
+      Request.new(
+        query: query,
+        prepared: (flags & FLAG_PREPARED) != 0,
+        offset_us: offset_us,
+        latency_us: latency_us,
+        consistency: consistency.zero? ? nil : consistency - 1,
+        status: status,
+        params: params
+      )
+    end
+
+    # Decode one tagged value (see ext/cassandra_cpp/recorder.cpp)
+    def read_value(io)
+      case read_byte(io)
+      when 0 then nil
+      when 1 then true
+      when 2 then false
+      when 3 then read_zigzag(io)
+      when 4 then read_exact(io, 8).unpack1('E')
+      when 5 then read_string(io, Encoding::UTF_8)
+      when 6 then read_string(io, Encoding::BINARY)
+      when 7
+        micros = read_zigzag(io)
+        Time.at(micros / 1_000_000, micros % 1_000_000, :usec)
+      when 8 then Array.new(read_varint(io)) { read_value(io) }
+      when 9 then Set.new(Array.new(read_varint(io)) { read_value(io) })
+      when 10 then Array.new(read_varint(io)) { [read_value(io), read_value(io)] }.to_h
+      when 11 then BigDecimal(read_string(io, Encoding::UTF_8))
+      else
+        raise FormatError, "Unknown value tag at offset #{io.pos - 1}"
+      end
+    end
+
+    def read_byte(io)
+      byte = io.getbyte
+      raise FormatError, 'Unexpected end of traffic log' if byte.nil?
+
+      byte
+    end
+
+    def read_exact(io, length)
+      data = io.read(length)
+      raise FormatError, 'Unexpected end of traffic log' if data.nil? || data.bytesize < length
+
+      data
+    end
+
+    def read_varint(io)
+      value = 0
+      shift = 0
+      loop do
+        byte = read_byte(io)
+        value |= (byte & 0x7f) << shift
+        return value if byte < 0x80
+
+        shift += 7
+      end
+    end
+
+    def read_zigzag(io)
+      value = read_varint(io)
+      (value >> 1) ^ -(value & 1)
+    end
+
+    def read_string(io, encoding)
+      read_exact(io, read_varint(io)).force_encoding(encoding)
+    end
+  end
+end
@@ -0,0 +1,148 @@
+# frozen_string_literal: true
+
+require 'tempfile'
+
+module CassandraCpp
+  # Re-issues a recorded traffic log against a session and compares the
+  # latencies observed during replay with the ones recorded originally.
+  #
+  # Requests are dispatched at their recorded offsets scaled by +speed+
+  # (1.0 = original pace, 2.0 = twice as fast) or as fast as the worker
+  # threads allow with +speed: :max+. The replay itself is recorded natively,
+  # so recorded and replayed latencies both measure submit-to-ready time.
+  #
+  # @example Evaluate a connection pool preset on real traffic
+  #   session = CassandraCpp.cluster_with_preset(:low_latency, hosts: ['staging-1']).connect('app')
+  #   report = CassandraCpp::TrafficReplay.new(session, '/tmp/traffic.cctr', speed: 2.0).run
+  #   report[:overall][:delta_p99_ms]
+  class TrafficReplay
+    PERCENTILES = { p50: 0.50, p95: 0.95, p99: 0.99 }.freeze
+
+    attr_reader :session, :log, :speed, :concurrency
+
+    # @param session [Session] Session to replay against
+    # @param log [TrafficLog, String] Log to replay, or its path
+    # @param speed [Float, Symbol] Pace multiplier, or :max for no pacing
+    # @param concurrency [Integer] Number of worker threads issuing requests
+    def initialize(session, log, speed: 1.0, concurrency: 16)
+      @session = session
+      @log = log.is_a?(TrafficLog) ? log : TrafficLog.new(log)
+      @speed = speed
+      @concurrency = concurrency
+      validate_options!
+    end
+
+    # Replay the log and compare latencies per query
+    # @param record_to [String, nil] Where to keep the replay's own traffic log
+    # @return [Hash] :overall and :queries (query => comparison) latency reports
+    def run(record_to: nil)
+      tempfile = Tempfile.new(['replay', '.cctr']) unless record_to
+      replay_path = record_to || tempfile.path
+
+      TrafficLog.record(replay_path) { dispatch_all }
+      self.class.compare(@log.to_a, TrafficLog.new(replay_path).to_a)
+    ensure
+      tempfile&.close!
+    end
+
+    # Compare two sets of captured requests
+    # @param recorded [Array<TrafficLog::Request>] Original requests
+    # @param replayed [Array<TrafficLog::Request>] Requests captured during replay
+    # @return [Hash] :overall and :queries latency comparisons
+    def self.compare(recorded, replayed)
+      recorded_by_query = recorded.group_by(&:query)
+      replayed_by_query = replayed.group_by(&:query)
+
+      queries = recorded_by_query.keys.each_with_object({}) do |query, report|
+        report[query] = comparison(recorded_by_query[query], replayed_by_query.fetch(query, []))
+      end
+
+      { overall: comparison(recorded, replayed), queries: queries }
+    end
+
+    def self.comparison(recorded, replayed)
+      report = {
+        recorded_count: recorded.size,
+        replayed_count: replayed.size,
+        recorded_errors: recorded.count(&:error?),
+        replayed_errors: replayed.count(&:error?)
+      }
+
+      recorded_ms = latencies_ms(recorded)
+      replayed_ms = latencies_ms(replayed)
+
+      PERCENTILES.each do |name, percentile|
+        before = percentile(recorded_ms, percentile)
+        after = percentile(replayed_ms, percentile)
+        report[:"recorded_#{name}_ms"] = before.round(3)
+        report[:"replayed_#{name}_ms"] = after.round(3)
+        report[:"delta_#{name}_ms"] = (after - before).round(3)
+      end
+
+      report
+    end
+
+    def self.latencies_ms(requests)
+      requests.reject(&:error?).map { |request| request.latency_us / 1000.0 }.sort
+    end
+
+    def self.percentile(sorted, percentile)
+      return 0.0 if sorted.empty?
+
+      sorted[(percentile * (sorted.length - 1)).round]
+    end
+
+    private_class_method :comparison, :latencies_ms, :percentile
+
+    private
+
+    def validate_options!
+      unless @speed == :max || (@speed.is_a?(Numeric) && @speed.positive?)
+        raise ArgumentError, 'speed must be a positive number or :max'
+      end
+
+      raise ArgumentError, 'concurrency must be positive' unless @concurrency.to_i.positive?
+    end
+
+    def dispatch_all
+      queue = SizedQueue.new(@concurrency * 4)
+      workers = Array.new(@concurrency) do
+        Thread.new do
+          while (request = queue.pop)
+            issue(request)
+          end
+        end
+      end
+
+      started = monotonic_now
+      @log.each do |request|
+        pace(started, request) unless @speed == :max
+        queue << request
+      end
+    ensure
+      @concurrency.times { queue << nil } if queue
+      workers&.each(&:join)
+    end
+
+    def pace(started, request)
+      due = started + (request.offset_us / 1_000_000.0 / @speed)
+      delay = due - monotonic_now
+      sleep(delay) if delay.positive?
+    end
+
+    # Failures are expected to be captured by the recorder, not raised
+    def issue(request)
+      if request.prepared?
+        @session.prepare(request.query).execute(*request.params)
+      else
+        @session.execute(request.query)
+      end
+    rescue CassandraCpp::Error => e
+      CassandraCpp.logger&.debug("Replayed request failed: #{e.message}")
+    end
+
+    def monotonic_now
+      Process.clock_gettime(Process::CLOCK_MONOTONIC)
+    end
+  end
+end
@@ -0,0 +1,143 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+
+RSpec.describe CassandraCpp::AdaptiveTimeout, type: :integration do
+  include CassandraCppTestHelpers
+  
+  let(:cluster) { create_test_cluster }
+  let(:session) { cluster.connect }
+  let(:lookup) { session.prepare('SELECT release_version FROM system.local WHERE key = ?') }
+  
+  # Speculate on every execution: the delay is clamped to 1 microsecond
+  let(:eager) do
+    { speculative_floor_ms: 0, speculative_ceiling_ms: 0.001, minimum_samples: 1 }
+  end
+  
+  before(:all) do
+    skip_unless_cassandra_available
+  end
+  
+  before do
+    skip 'Native extension not available' unless CassandraCpp.native_extension_loaded?
+  end
+  
+  after do
+    described_class.disable
+    session.close
+    cluster.close
+  end
+  
+  def run(prepared, times)
+    times.times.map { prepared.execute('local').to_a.first['release_version'] }
+  end
+  
+  def speculative_executions
+    described_class.stats[:speculative_executions]
+  end
+  
+  # Losing executions give their slot back from the driver callback
+  def wait_for_idle_gate
+    deadline = Process.clock_gettime(Process::CLOCK_MONOTONIC) + 5
+    while session.priority_stats[:interactive][:in_flight] > 0
+      break if Process.clock_gettime(Process::CLOCK_MONOTONIC) > deadline
+      
+      sleep 0.01
+    end
+  end
+  
+  describe 'delay derivation' do
+    it 'keeps the cluster timeout until enough executions were recorded' do
+      described_class.enable(minimum_samples: 5)
+      
+      run(lookup, 4)
+      expect(lookup.adaptive_timeouts).to be_nil
+      
+      run(lookup, 1)
+      expect(lookup.adaptive_timeouts).to include(:timeout_ms)
+    end
+    
+    it 'scales the recorded network latency' do
+      described_class.enable(timeout_percentile: 0.5, timeout_multiplier: 10, timeout_floor_ms: 1,
+                             timeout_ceiling_ms: 60_000, speculative_percentile: 0.5, speculative_multiplier: 2,
+                             speculative_floor_ms: 0, speculative_ceiling_ms: 60_000, minimum_samples: 5)
+      run(lookup, 5)
+      
+      p50_ms = lookup.phase_latencies[:network][:p50_ms]
+      adaptive = lookup.adaptive_timeouts
+      
+      expect(adaptive[:timeout_ms]).to be_within(1).of(p50_ms * 10)
+      expect(adaptive[:speculative_delay_ms]).to be_within(0.002).of(p50_ms * 2)
+    end
+    
+    it 'clamps to the floors and ceilings' do
+      described_class.enable(timeout_floor_ms: 20, timeout_ceiling_ms: 20,
+                             speculative_floor_ms: 5, speculative_ceiling_ms: 5, minimum_samples: 1)
+      run(lookup, 1)
+      
+      expect(lookup.adaptive_timeouts).to eq(timeout_ms: 20, speculative_delay_ms: 5.0)
+    end
+    
+    it 'drops a speculative delay that would not come before the timeout' do
+      described_class.enable(timeout_floor_ms: 20, timeout_ceiling_ms: 20,
+                             speculative_floor_ms: 30, speculative_ceiling_ms: 30, minimum_samples: 1)
+      run(lookup, 1)
+      
+      expect(lookup.adaptive_timeouts).to eq(timeout_ms: 20, speculative_delay_ms: nil)
+    end
+  end
+  
+  describe 'speculative executions' do
+    it 'returns the result of whichever execution wins' do
+      described_class.enable(**eager)
+      lookup.idempotent = true
+      run(lookup, 1)
+      before_stats = described_class.stats
+      
+      versions = run(lookup, 20)
+      
+      after_stats = described_class.stats
+      sent = after_stats[:speculative_executions] - before_stats[:speculative_executions]
+      won = after_stats[:speculative_wins] - before_stats[:speculative_wins]
+      expect(versions.uniq.size).to eq(1)
+      expect(versions.first).to be_a(String)
+      expect(sent).to be > 0
+      expect(won).to be_between(0, sent)
+    end
+    
+    it 'never speculates on statements not marked idempotent' do
+      described_class.enable(**eager)
+      run(lookup, 1)
+      
+      expect { run(lookup, 10) }.not_to(change { speculative_executions })
+      expect(lookup.idempotent?).to be(false)
+    end
+    
+    it 'takes a priority slot for each speculative execution and gives it back' do
+      session.configure_priorities(max_in_flight: 8)
+      described_class.enable(**eager)
+      lookup.idempotent = true
+      run(lookup, 1)
+      wait_for_idle_gate
+      granted = session.priority_stats[:interactive][:granted]
+      sent = speculative_executions
+      
+      run(lookup, 10)
+      wait_for_idle_gate
+      
+      stats = session.priority_stats[:interactive]
+      expect(stats[:granted] - granted).to eq(10 + speculative_executions - sent)
+      expect(stats[:in_flight]).to eq(0)
+    end
+    
+    it 'does not speculate without a free priority slot' do
+      session.configure_priorities(max_in_flight: 1)
+      described_class.enable(**eager)
+      lookup.idempotent = true
+      run(lookup, 1)
+      
+      expect { run(lookup, 10) }.not_to(change { speculative_executions })
+      expect(session.priority_stats[:interactive][:in_flight]).to eq(0)
+    end
+  end
+end
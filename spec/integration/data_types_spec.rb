@@ -307,6 +307,27 @@ RSpec.describe 'Advanced Data Types', type: :integration do
     end
   end
   
+  describe 'Column writes to narrow integers' do
+    before do
+      session.execute('CREATE TABLE IF NOT EXISTS narrow_int_test (id int PRIMARY KEY, tiny tinyint, small smallint)')
+    end
+    
+    let(:insert) { 'INSERT INTO narrow_int_test (id, tiny, small) VALUES (?, ?, ?)' }
+    
+    it 'raises instead of wrapping values the column cannot hold' do
+      expect(session.write_columns(insert, { 'id' => [1, 2], 'tiny' => [-128, 127], 'small' => [-32_768, 32_767] }))
+        .to eq(2)
+      
+      expect {
+        session.write_columns(insert, { 'id' => [1], 'tiny' => [128], 'small' => [0] })
+      }.to raise_error(RangeError, /128 is out of range for a tinyint column/)
+      
+      expect {
+        session.write_columns(insert, { 'id' => [1], 'tiny' => [0], 'small' => [-32_769] })
+      }.to raise_error(RangeError, /smallint/)
+    end
+  end
+  
   describe 'Performance with collections' do
     it 'handles reasonably sized collections efficiently' do
       require 'benchmark'
@@ -0,0 +1,67 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+
+RSpec.describe 'GVL Accounting', type: :integration do
+  include CassandraCppTestHelpers
+  
+  let(:cluster) { create_test_cluster }
+  let(:session) { cluster.connect }
+  
+  before(:all) do
+    skip_unless_cassandra_available
+  end
+  
+  before do
+    skip 'Native extension not available' unless CassandraCpp.native_extension_loaded?
+    
+    CassandraCpp.reset_gvl_stats
+  end
+  
+  after do
+    session.close
+    cluster.close
+  end
+  
+  def hold_count(entry)
+    CassandraCpp.gvl_stats[:hold][entry][:count]
+  end
+  
+  def reacquire_count
+    CassandraCpp.gvl_stats[:reacquire][:count]
+  end
+  
+  it 'records the hold and reacquire time of an execute' do
+    session.execute('SELECT release_version FROM system.local')
+    
+    expect(hold_count(:execute)).to eq(1)
+    expect(reacquire_count).to be >= 1
+  end
+  
+  it 'records bind and execute spans of a prepared statement' do
+    prepared = session.prepare('SELECT release_version FROM system.local WHERE key = ?')
+    prepared.execute('local')
+    
+    expect(hold_count(:bind)).to eq(1)
+    expect(hold_count(:execute)).to be >= 1
+  end
+  
+  it 'closes the span of an execute that raises' do
+    expect {
+      session.execute('INVALID QUERY SYNTAX')
+    }.to raise_error(CassandraCpp::Error)
+    
+    expect(hold_count(:execute)).to eq(1)
+    expect(reacquire_count).to be >= 1
+  end
+  
+  it 'closes the span of a bind that raises' do
+    prepared = session.prepare('SELECT release_version FROM system.local WHERE key = ?')
+    
+    expect {
+      prepared.execute(42)
+    }.to raise_error(CassandraCpp::Error)
+    
+    expect(hold_count(:bind)).to eq(1)
+  end
+end
@@ -0,0 +1,121 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+require 'securerandom'
+require 'stringio'
+require 'zlib'
+
+RSpec.describe 'Large Objects', type: :integration do
+  include CassandraCppTestHelpers
+  
+  let(:cluster) { create_test_cluster }
+  let(:session) { cluster.connect('cassandra_cpp_test') }
+  let(:payload) { SecureRandom.random_bytes(10_000) }
+  
+  before(:all) do
+    skip_unless_cassandra_available
+    
+    with_test_session('cassandra_cpp_test') do |session|
+      session.execute(<<~CQL)
+        CREATE TABLE IF NOT EXISTS object_test (
+          key text,
+          version bigint,
+          chunk_no int,
+          data blob,
+          checksum bigint,
+          object_size bigint,
+          chunk_count int,
+          chunk_version bigint,
+          PRIMARY KEY ((key, version, chunk_no))
+        )
+      CQL
+    end
+  end
+  
+  after do
+    begin
+      session.execute('TRUNCATE object_test')
+    ensure
+      session.close
+      cluster.close
+    end
+  end
+  
+  it 'round-trips an object through chunks' do
+    manifest = session.put_object('object_test', 'blob-1', payload, chunk_size: 1024, concurrency: 4)
+    
+    expect(manifest).to eq(size: 10_000, chunks: 10, checksum: Zlib.crc32(payload))
+    expect(session.get_object('object_test', 'blob-1', concurrency: 3)).to eq(payload)
+  end
+  
+  it 'streams chunks into an IO' do
+    session.put_object('object_test', 'blob-2', StringIO.new(payload), chunk_size: 4096)
+    
+    io = StringIO.new(''.b)
+    expect(session.get_object('object_test', 'blob-2', io)).to be(io)
+    expect(io.string).to eq(payload)
+  end
+  
+  it 'returns nil for unknown keys' do
+    expect(session.get_object('object_test', 'missing')).to be_nil
+  end
+  
+  it 'replaces an object with a shorter one and deletes the old chunks' do
+    session.put_object('object_test', 'blob-4', payload, chunk_size: 1024)
+    smaller = SecureRandom.random_bytes(1500)
+    session.put_object('object_test', 'blob-4', smaller, chunk_size: 1024)
+    
+    expect(session.get_object('object_test', 'blob-4')).to eq(smaller)
+    chunk_rows = session.execute('SELECT key, version FROM object_test').select { |row| row['key'] == 'blob-4' }
+    expect(chunk_rows.size).to eq(3)
+    expect(chunk_rows.map { |row| row['version'] }.uniq.size).to eq(2)
+  end
+  
+  it 'reads whole objects while another session replaces them' do
+    replacement = SecureRandom.random_bytes(6_000)
+    session.put_object('object_test', 'blob-5', payload, chunk_size: 512)
+    writer_session = cluster.connect('cassandra_cpp_test')
+    writer = Thread.new do
+      10.times do |i|
+        writer_session.put_object('object_test', 'blob-5', i.even? ? replacement : payload, chunk_size: 512)
+      end
+    end
+    
+    reads = []
+    reads << session.get_object('object_test', 'blob-5', concurrency: 2) while writer.alive?
+    writer.join
+    
+    expect(reads).to all(eq(payload).or(eq(replacement)))
+  ensure
+    writer_session&.close
+  end
+  
+  it 'fails a streaming read whose object was replaced after chunks were written' do
+    session.put_object('object_test', 'blob-6', payload, chunk_size: 1024)
+    writer_session = cluster.connect('cassandra_cpp_test')
+    io = StringIO.new(''.b)
+    io.define_singleton_method(:write) do |data|
+      writer_session.put_object('object_test', 'blob-6', 'replaced') if string.empty?
+      super(data)
+    end
+    
+    expect {
+      session.get_object('object_test', 'blob-6', io, concurrency: 1)
+    }.to raise_error(CassandraCpp::IntegrityError, /replaced while being read \(chunk 1\)/)
+    expect(session.get_object('object_test', 'blob-6')).to eq('replaced')
+  ensure
+    writer_session&.close
+  end
+  
+  it 'detects corrupted chunks' do
+    session.put_object('object_test', 'blob-3', payload, chunk_size: 1024)
+    version = session.execute("SELECT chunk_version FROM object_test WHERE key = 'blob-3' AND version = 0 " \
+                              'AND chunk_no = -1').first['chunk_version']
+    session.execute("UPDATE object_test SET data = 0x00 WHERE key = 'blob-3' AND version = #{version} " \
+                    'AND chunk_no = 4')
+    
+    expect {
+      session.get_object('object_test', 'blob-3')
+    }.to raise_error(CassandraCpp::IntegrityError, /chunk checksum mismatch \(chunk 4\)/)
+  end
+end
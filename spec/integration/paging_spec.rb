@@ -0,0 +1,76 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+
+RSpec.describe 'Paged Reads', type: :integration do
+  include CassandraCppTestHelpers
+  
+  let(:cluster) { create_test_cluster }
+  let(:session) { cluster.connect('cassandra_cpp_test') }
+  let(:query) { 'SELECT bucket, seq, amount FROM paging_test' }
+  
+  before(:all) do
+    skip_unless_cassandra_available
+    
+    with_test_session('cassandra_cpp_test') do |session|
+      session.execute(<<~CQL)
+        CREATE TABLE IF NOT EXISTS paging_test (
+          bucket int,
+          seq int,
+          amount bigint,
+          PRIMARY KEY (bucket, seq)
+        )
+      CQL
+      session.execute('TRUNCATE paging_test')
+      prepared = session.prepare('INSERT INTO paging_test (bucket, seq, amount) VALUES (?, ?, ?)')
+      3.times do |bucket|
+        25.times { |seq| prepared.execute(bucket, seq, seq * 10) }
+      end
+    end
+  end
+  
+  after do
+    session.close
+    cluster.close
+  end
+  
+  it 'streams every row of a query across page boundaries' do
+    rows = []
+    count = session.each_row(query, as: :array, page_size: 7) { |row| rows << row.dup }
+    
+    expect(count).to eq(75)
+    expect(rows.uniq.size).to eq(75)
+  end
+  
+  it 'streams every row of a bound statement across page boundaries' do
+    seqs = session.each_row('SELECT seq FROM paging_test WHERE bucket = ?', 1, page_size: 4).map { |row| row['seq'] }
+    
+    expect(seqs).to eq((0...25).to_a)
+  end
+  
+  it 'resumes a bound scan from a saved paging state' do
+    prepared = session.prepare('SELECT seq FROM paging_test WHERE bucket = ?')
+    first_page = nil
+    saved = nil
+    prepared.each_page(2, page_size: 10) do |rows, paging_state|
+      first_page = rows.map { |row| row['seq'] }
+      saved = paging_state
+      break
+    end
+    
+    rest = []
+    prepared.each_page(2, page_size: 10, paging_state: saved) { |rows, _| rest.concat(rows.map { |row| row['seq'] }) }
+    
+    expect(first_page).to eq((0...10).to_a)
+    expect(rest).to eq((10...25).to_a)
+  end
+  
+  it 'aggregates rows from every page' do
+    groups = session.aggregate(query, group_by: 'bucket', aggregates: { sum: 'amount', max: 'seq' }, page_size: 6)
+    
+    expect(groups.keys).to contain_exactly(0, 1, 2)
+    expect(groups[1][:count]).to eq(25)
+    expect(groups[1][:sum]['amount']).to eq(3_000)
+    expect(groups[1][:max]['seq']).to eq(24)
+  end
+end
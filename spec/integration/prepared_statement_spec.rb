@@ -194,6 +194,22 @@ RSpec.describe 'Prepared Statements', type: :integration do
     end
   end
   
+  describe 'phase timings' do
+    it 'measures queue time from execute, not from bind' do
+      prepared = session.prepare('SELECT * FROM prepared_test WHERE id = ?')
+      statement = prepared.native_prepared.bind
+      statement.bind(0, SecureRandom.uuid)
+      sleep 0.2
+      
+      phases = CassandraCpp::Result.new(statement.execute).execution_info.phases
+      expect(phases[:queue]).to be < 100
+      expect(phases[:network]).to be > 0
+      expect(phases[:decode]).not_to be_nil
+      expect(prepared.phase_latencies[:network][:count]).to eq(1)
+      expect(prepared.phase_latencies[:queue][:max_ms]).to be < 100
+    end
+  end
+  
   describe 'performance' do
     it 'executes prepared statements faster than regular queries' do
       require 'benchmark'
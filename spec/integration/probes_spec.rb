@@ -0,0 +1,63 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+
+RSpec.describe 'USDT Probes', type: :integration do
+  include CassandraCppTestHelpers
+  
+  let(:cluster) { create_test_cluster }
+  let(:session) { cluster.connect }
+  let(:query) { 'SELECT release_version FROM system.local WHERE key = ?' }
+  
+  before(:all) do
+    skip_unless_cassandra_available
+  end
+  
+  before do
+    skip 'Native extension not available' unless CassandraCpp.native_extension_loaded?
+  end
+  
+  after do
+    session.close
+    cluster.close
+  end
+  
+  # 64-bit FNV-1a, as probes.cpp hashes the query text
+  def fnv1a(text)
+    text.each_byte.reduce(0xcbf29ce484222325) { |hash, byte| ((hash ^ byte) * 0x100000001b3) & 0xffffffffffffffff }
+  end
+  
+  it 'is compiled out when CASSANDRA_CPP_DISABLE_USDT is set' do
+    skip 'Built with USDT probes enabled' unless ENV['CASSANDRA_CPP_DISABLE_USDT']
+    
+    expect(CassandraCpp::USDT_PROBES).to be(false)
+  end
+  
+  describe 'query ids' do
+    it 'hashes the query text of prepared statements' do
+      info = session.prepare(query).execute('local').execution_info
+      
+      expect(info.query_id).to eq(fnv1a(query))
+      expect(info.to_h[:query_id]).to eq(fnv1a(query))
+    end
+    
+    it 'gives the same query the same id in every session' do
+      other_session = cluster.connect
+      first = session.prepare(query).execute('local').execution_info.query_id
+      second = other_session.prepare(query).execute('local').execution_info.query_id
+      other = session.prepare("#{query} ALLOW FILTERING").execute('local').execution_info.query_id
+      
+      expect(second).to eq(first)
+      expect(other).not_to eq(first)
+    ensure
+      other_session&.close
+    end
+    
+    it 'leaves simple queries without an id while the request probes are not traced' do
+      info = session.execute('SELECT release_version FROM system.local').execution_info
+      
+      expect(info.query_id).to be_nil
+      expect(info.latency).to be > 0
+    end
+  end
+end
@@ -0,0 +1,65 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+require 'tmpdir'
+
+RSpec.describe 'Table Snapshots', type: :integration do
+  include CassandraCppTestHelpers
+  
+  let(:cluster) { create_test_cluster }
+  let(:session) { cluster.connect('cassandra_cpp_test') }
+  let(:dir) { Dir.mktmpdir('cassandra_cpp_snapshot') }
+  let(:path) { File.join(dir, 'rates.snap') }
+  
+  before(:all) do
+    skip_unless_cassandra_available
+    
+    with_test_session('cassandra_cpp_test') do |session|
+      session.execute(<<~CQL)
+        CREATE TABLE IF NOT EXISTS snapshot_test (
+          region text,
+          code int,
+          rate double,
+          PRIMARY KEY (region, code)
+        )
+      CQL
+    end
+  end
+  
+  before do
+    session.execute("INSERT INTO snapshot_test (region, code, rate) VALUES ('eu', 1, 0.19)")
+    session.execute("INSERT INTO snapshot_test (region, code, rate) VALUES ('eu', 2, 0.07)")
+    session.execute("INSERT INTO snapshot_test (region, code, rate) VALUES ('us', 1, 0.0)")
+  end
+  
+  after do
+    begin
+      session.execute('TRUNCATE snapshot_test')
+    ensure
+      FileUtils.remove_entry(dir)
+      session.close
+      cluster.close
+    end
+  end
+  
+  it 'serves point and range lookups on the primary key from the file' do
+    snapshot = session.snapshot_table('snapshot_test', path: path)
+    
+    expect(snapshot.key_columns).to eq(%w[region code])
+    expect(snapshot.size).to eq(3)
+    expect(snapshot[['eu', 2]]['rate']).to be_within(0.001).of(0.07)
+    expect(snapshot[['eu', 3]]).to be_nil
+    expect(snapshot.range(['eu'], ['f']).map { |row| row['code'] }).to eq([1, 2])
+  end
+  
+  it 'reuses an existing file until it is refreshed' do
+    session.snapshot_table('snapshot_test', path: path, key: %w[region code])
+    session.execute("INSERT INTO snapshot_test (region, code, rate) VALUES ('us', 2, 0.05)")
+    
+    snapshot = session.snapshot_table('snapshot_test', path: path, key: %w[region code])
+    expect(snapshot[['us', 2]]).to be_nil
+    
+    snapshot.refresh!
+    expect(snapshot[['us', 2]]['rate']).to be_within(0.001).of(0.05)
+  end
+end
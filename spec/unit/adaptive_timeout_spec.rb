@@ -0,0 +1,18 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+
+RSpec.describe CassandraCpp::AdaptiveTimeout do
+  describe '.native_arguments' do
+    it 'fills in defaults in native argument order' do
+      expect(described_class.native_arguments(timeout_multiplier: 4.0, speculative_multiplier: nil))
+        .to eq([0.99, 4.0, 50, 12_000, 0.95, nil, 5, 1_000, 100])
+    end
+
+    it 'rejects unknown options' do
+      expect {
+        described_class.native_arguments(timeout_ms: 100)
+      }.to raise_error(ArgumentError, /Unknown adaptive timeout options: timeout_ms/)
+    end
+  end
+end
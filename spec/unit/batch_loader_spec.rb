@@ -0,0 +1,66 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+
+RSpec.describe CassandraCpp::BatchLoader do
+  let(:native_session) { double('NativeSession') }
+  let(:native_prepared) { double('NativePreparedStatement') }
+  let(:session) { CassandraCpp::Session.new(native_session, nil) }
+  let(:query) { 'SELECT * FROM users WHERE id = ?' }
+  let(:users) { { 1 => 'alice', 2 => 'bob' } }
+  let(:loads) { [] }
+
+  before do
+    allow(native_session).to receive(:prepare).with(query).and_return(native_prepared)
+    allow(native_prepared).to receive(:load_keys) do |keys, concurrency|
+      loads << [keys, concurrency]
+      keys.map { |(id)| users.key?(id) ? [{ 'id' => id, 'name' => users[id] }] : [] }
+    end
+  end
+
+  it 'reads every queued key, once, when the first value is needed' do
+    loader = session.batch_loader(query, concurrency: 8)
+    alice = loader.load(1)
+    missing = loader.load(3)
+    again = loader.load(1)
+
+    expect(loads).to be_empty
+    expect(alice.value.first['name']).to eq('alice')
+    expect(again).to equal(alice)
+    expect(missing.value).to be_empty
+    expect(loads).to eq([[[[1], [3]], 8]])
+  end
+
+  it 'serves cached keys and dispatches only new ones' do
+    loader = session.batch_loader(query)
+    loader.fetch([1])
+
+    expect(loader.fetch([2, 1]).map { |result| result.first['name'] }).to eq(%w[bob alice])
+    expect(loads.map(&:first)).to eq([[[1]], [[2]]])
+
+    loader.clear
+    loader.fetch([1])
+    expect(loads.size).to eq(3)
+  end
+
+  it 'binds multi-column keys in parameter order' do
+    compound = 'SELECT * FROM events WHERE day = ? AND kind = ?'
+    allow(native_session).to receive(:prepare).with(compound).and_return(native_prepared)
+
+    session.batch_loader(compound).fetch([['2024-01-01', 'click']])
+
+    expect(loads.first.first).to eq([['2024-01-01', 'click']])
+    expect { session.batch_loader(compound).fetch(['2024-01-01']) }.to raise_error(ArgumentError, /expected 2, got 1/)
+  end
+
+  it 'rejects every promise of a failed dispatch' do
+    allow(native_prepared).to receive(:load_keys).and_raise(CassandraCpp::Error, 'read timeout')
+    loader = session.batch_loader(query)
+    first = loader.load(1)
+    second = loader.load(2)
+
+    expect { first.value }.to raise_error(CassandraCpp::Error, 'read timeout')
+    expect { second.value }.to raise_error(CassandraCpp::Error, 'read timeout')
+    expect(session.metrics.error_count).to eq(1)
+  end
+end
\ No newline at end of file
@@ -73,6 +73,69 @@ RSpec.describe CassandraCpp do
     end
   end
 
+  describe '.copy' do
+    let(:source_session) { double('SourceSession') }
+    let(:dest_session) { double('DestSession') }
+    let(:dest) { double('DestPrepared', parameter_names: %w[id email display_name]) }
+    let(:source) { double('SourcePrepared') }
+    let(:scan) do
+      double('TokenRangeScan', range_query: 'SELECT ... WHERE token(id) > ? AND token(id) <= ?',
+                               ranges: [[-10, 0, 5.0], [0, 10, 5.0]])
+    end
+
+    it 'selects source columns in destination parameter order and copies every range' do
+      insert = 'INSERT INTO users_v2 (id, email, display_name) VALUES (?, ?, ?)'
+      allow(dest_session).to receive(:prepare).with(insert).and_return(dest)
+      expect(source_session).to receive(:token_range_scan)
+        .with('app.users', columns: 'id, email, name', splits: 8).and_return(scan)
+      allow(source_session).to receive(:prepare).with(scan.range_query).and_return(source)
+      expect(dest).to receive(:copy_from)
+        .with(source, [[-10, 0], [0, 10]], page_size: 5000, readers: 2, concurrency: 32).and_return(42)
+
+      copied = described_class.copy(source_session, 'app.users', dest_session, insert,
+                                    transform: { display_name: :name }, splits: 8, readers: 2, concurrency: 32)
+
+      expect(copied).to eq(42)
+    end
+  end
+
+  describe '.driver_memory' do
+    let(:keys) { %i[allocator thread_arenas arenas live_bytes peak_bytes allocations frees] }
+
+    it 'is empty without the native extension' do
+      allow(described_class).to receive(:native_extension_loaded?).and_return(false)
+
+      expect(described_class.driver_memory).to eq({})
+    end
+
+    it 'reports the allocator and its counters' do
+      skip 'Native extension not available' unless described_class.native_extension_loaded?
+
+      memory = described_class.driver_memory
+      expect(memory.keys).to match_array(keys)
+      expect(%i[off system jemalloc]).to include(memory[:allocator])
+      expect(memory[:live_bytes]).to be <= memory[:peak_bytes]
+      expect(memory[:frees]).to be <= memory[:allocations]
+    end
+
+    it 'counts nothing unless CASSANDRA_CPP_ALLOCATOR asks for hooks' do
+      skip 'Native extension not available' unless described_class.native_extension_loaded?
+      skip 'Counting hooks requested' unless ENV.fetch('CASSANDRA_CPP_ALLOCATOR', '').empty?
+
+      memory = described_class.driver_memory
+      expect(memory[:allocator]).to eq(:off)
+      expect(memory.values_at(:live_bytes, :peak_bytes, :allocations, :frees)).to eq([0, 0, 0, 0])
+    end
+
+    it 'restarts peak tracking from the live bytes' do
+      skip 'Native extension not available' unless described_class.native_extension_loaded?
+
+      described_class.reset_driver_memory_peak
+      memory = described_class.driver_memory
+      expect(memory[:peak_bytes]).to be >= memory[:live_bytes]
+    end
+  end
+
   describe 'autoload setup' do
     it 'autoloads main classes' do
       expect(defined?(CassandraCpp::Cluster)).to be_truthy
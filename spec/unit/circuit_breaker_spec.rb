@@ -0,0 +1,92 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+
+RSpec.describe CassandraCpp::CircuitBreaker do
+  describe '.native_arguments' do
+    it 'fills in defaults in native argument order' do
+      expect(described_class.native_arguments(open_ms: 2_000, slow_call_ms: 500))
+        .to eq([0.5, 20, 10_000, 2_000, 500, 3])
+    end
+
+    it 'rejects unknown options' do
+      expect {
+        described_class.native_arguments(threshold: 0.2)
+      }.to raise_error(ArgumentError, /Unknown circuit breaker options: threshold/)
+    end
+  end
+
+  it 'raises a distinct error class for open breakers' do
+    expect(CassandraCpp::CircuitOpenError.ancestors).to include(CassandraCpp::Error)
+  end
+
+  describe 'state transitions' do
+    let(:key) { 'spec.transitions' }
+    let(:native) { CassandraCpp::NativeCircuitBreakers }
+
+    before do
+      skip 'Native extension not available' unless CassandraCpp.native_extension_loaded?
+
+      described_class.reset
+      described_class.configure(key, failure_rate: 0.5, minimum_requests: 4, open_ms: 50, probes: 2)
+    end
+
+    def state
+      described_class.states.fetch(key)[:state]
+    end
+
+    def call(outcome)
+      return false unless native.admit(key)
+
+      native.record(key, outcome, 1)
+      true
+    end
+
+    def trip
+      %i[success timeout failure failure].each { |outcome| call(outcome) }
+    end
+
+    it 'stays closed until the failure rate is reached over minimum_requests' do
+      3.times { call(:failure) }
+      expect(state).to eq(:closed)
+
+      call(:success)
+      expect(state).to eq(:open)
+      expect(described_class.states[key][:trips]).to eq(1)
+    end
+
+    it 'rejects calls while open' do
+      trip
+
+      expect(native.admit(key)).to be(false)
+      expect(described_class.states[key][:rejected]).to eq(1)
+    end
+
+    it 'lets a limited number of probes through once open_ms has passed' do
+      trip
+      sleep 0.06
+
+      expect(native.admit(key)).to be(true)
+      expect(state).to eq(:half_open)
+      expect(native.admit(key)).to be(true)
+      expect(native.admit(key)).to be(false)
+    end
+
+    it 'closes after the probes succeed' do
+      trip
+      sleep 0.06
+
+      2.times { expect(call(:success)).to be(true) }
+      expect(state).to eq(:closed)
+    end
+
+    it 'reopens on a failed probe' do
+      trip
+      sleep 0.06
+
+      expect(call(:timeout)).to be(true)
+      expect(state).to eq(:open)
+      expect(described_class.states[key][:trips]).to eq(2)
+    end
+  end
+end
@@ -58,6 +58,45 @@ RSpec.describe CassandraCpp::Cluster do
     end
   end
 
+  describe '.shared' do
+    let(:native_cluster) { double('NativeCluster') }
+    let(:keys) { [] }
+
+    before do
+      allow(CassandraCpp).to receive(:native_extension_loaded?).and_return(true)
+      stub_const('CassandraCpp::NativeCluster', native_cluster)
+      stub_const('CassandraCpp::CONSISTENCY_QUORUM', 4)
+      allow(native_cluster).to receive(:acquire_shared) do |key, _options, _keyspace|
+        keys << key
+        double('NativeSession')
+      end
+    end
+
+    it 'acquires equivalent configurations under one registry key' do
+      described_class.shared(hosts: ['10.0.0.2', '10.0.0.1']).connect('app')
+      described_class.shared(hosts: ['10.0.0.1', '10.0.0.2']).connect('app')
+
+      expect(keys.uniq.size).to eq(1)
+      expect(keys.first).to include('hosts=10.0.0.1,10.0.0.2')
+      expect(keys.first).to include('keyspace=app')
+    end
+
+    it 'keys different keyspaces separately' do
+      cluster = described_class.shared
+      cluster.connect('app')
+      cluster.connect('audit')
+
+      expect(keys.uniq.size).to eq(2)
+    end
+
+    it 'gives each consumer its own session metrics' do
+      first = described_class.shared.connect
+      second = described_class.shared.connect
+
+      expect(first.metrics).not_to equal(second.metrics)
+    end
+  end
+
   describe '#connect', type: :integration do
     let(:cluster) { create_test_cluster }
 
@@ -0,0 +1,103 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+
+RSpec.describe CassandraCpp::ExecutionInfo do
+  let(:tracing_id) { '4e1fb5a0-6c1b-11ef-9d4a-2b3c4d5e6f70' }
+  let(:native_session) { double('NativeSession') }
+  let(:native) do
+    double('NativeExecutionInfo', tracing_id: tracing_id, session: native_session, query_id: nil,
+                                  phases: { queue: 0.25, network: 40.0, gvl_wait: 0.5, decode: nil })
+  end
+  let(:session_row) do
+    { 'coordinator' => '10.0.0.12', 'duration' => 38_900, 'started_at' => Time.at(1_700_000_000),
+      'request' => 'Execute CQL3 query', 'parameters' => { 'consistency_level' => 'LOCAL_QUORUM' },
+      'client' => '10.0.1.5' }
+  end
+
+  before { stub_const('CassandraCpp::ExecutionInfo::TRACE_RETRY_INTERVAL', 0) }
+
+  it 'reports client-side phases without a trace' do
+    info = described_class.new(double('NativeExecutionInfo', tracing_id: nil, query_id: 7,
+                                                             phases: { queue: 0.25, network: 40.0, decode: nil }))
+
+    expect(info).not_to be_traced
+    expect(info.latency).to eq(40.25)
+    expect(info.trace).to be_nil
+    expect(info.coordinator).to be_nil
+    expect(info.to_h).to include(tracing_id: nil, query_id: 7, latency: 40.25)
+  end
+
+  it 'reads the coordinator and server latency from the trace once' do
+    expect(native_session).to receive(:execute).with(/FROM system_traces.sessions WHERE session_id = #{tracing_id}\z/)
+      .once.and_return([session_row])
+    expect(native_session).to receive(:execute).with(/FROM system_traces.events WHERE session_id = #{tracing_id}\z/)
+      .once.and_return([{ 'activity' => 'Parsing', 'source' => '10.0.0.12', 'source_elapsed' => 150,
+                          'thread' => 'Native-Transport-Requests-1' }])
+    info = described_class.new(native)
+
+    expect(info.coordinator).to eq('10.0.0.12')
+    expect(info.server_latency).to eq(38.9)
+    expect(info.trace.parameters).to eq('consistency_level' => 'LOCAL_QUORUM')
+    expect(info.trace.events.map(&:to_h)).to eq([{ activity: 'Parsing', source: '10.0.0.12', source_elapsed: 0.15,
+                                                   thread: 'Native-Transport-Requests-1' }])
+  end
+
+  it 'reads again while the coordinator is still writing the trace' do
+    responses = [[], [session_row.merge('duration' => nil)], [session_row]]
+    allow(native_session).to receive(:execute) do |cql|
+      cql.include?('system_traces.events') ? [] : responses.shift
+    end
+
+    expect(described_class.new(native).server_latency).to eq(38.9)
+    expect(responses).to be_empty
+  end
+
+  it 'gives up on a trace that never completes' do
+    reads = 0
+    allow(native_session).to receive(:execute) { reads += 1; [] }
+
+    expect(described_class.new(native).trace).to be_nil
+    expect(reads).to eq(described_class::TRACE_ATTEMPTS)
+  end
+
+  describe 'Result#execution_info' do
+    before { stub_const('CassandraCpp::NativeExecutionInfo', Class.new) }
+
+    it 'looks up the info attached to the rows' do
+      rows = [{ 'id' => 1 }]
+      allow(CassandraCpp::NativeExecutionInfo).to receive(:of).with(rows).and_return(native)
+
+      expect(CassandraCpp::Result.new(rows).execution_info.tracing_id).to eq(tracing_id)
+    end
+
+    it 'asks a lazy result, and is nil for rows that were not executed' do
+      allow(CassandraCpp::NativeExecutionInfo).to receive(:of).and_return(nil)
+      lazy = double('NativeResult', execution_info: native)
+
+      expect(CassandraCpp::Result.new(lazy).execution_info.phases[:network]).to eq(40.0)
+      expect(CassandraCpp::Result.new([]).execution_info).to be_nil
+    end
+  end
+
+  describe 'trace: on execute' do
+    let(:session) { CassandraCpp::Session.new(native_session, nil) }
+
+    it 'asks the driver to trace simple statements' do
+      expect(native_session).to receive(:execute).with('SELECT * FROM users', { tracing: true }).and_return([])
+      expect(native_session).to receive(:execute_result).with('SELECT * FROM users').and_return(double('NativeResult'))
+
+      session.execute('SELECT * FROM users', trace: true)
+      session.execute('SELECT * FROM users', lazy: true)
+    end
+
+    it 'enables tracing on bound statements' do
+      statement = double('NativeStatement', bind: nil, execute: [])
+      allow(native_session).to receive(:prepare)
+        .and_return(double('NativePreparedStatement', bind: statement))
+      expect(statement).to receive(:tracing=).with(true)
+
+      session.execute('SELECT * FROM users WHERE id = ?', 1, trace: true)
+    end
+  end
+end
\ No newline at end of file
@@ -0,0 +1,46 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+
+RSpec.describe CassandraCpp::FloatVector do
+  let(:vector) { described_class.pack([1.0, 2.5, -3.0]) }
+
+  it 'packs values as native float32s' do
+    expect(vector.buffer).to eq([1.0, 2.5, -3.0].pack('f*'))
+    expect(vector.buffer.encoding).to eq(Encoding::BINARY)
+    expect(vector.buffer).to be_frozen
+  end
+
+  it 'unpacks elements on demand' do
+    expect(vector.size).to eq(3)
+    expect(vector.to_a).to eq([1.0, 2.5, -3.0])
+    expect(vector[1]).to eq(2.5)
+    expect(vector[-1]).to eq(-3.0)
+    expect(vector[3]).to be_nil
+  end
+
+  it 'rejects buffers that are not whole floats' do
+    expect { described_class.new("\x00\x00\x00") }.to raise_error(ArgumentError, /multiple of 4/)
+  end
+
+  it 'compares by contents' do
+    expect(vector).to eq(described_class.new([1.0, 2.5, -3.0].pack('f*')))
+    expect(vector.hash).to eq(described_class.pack([1.0, 2.5, -3.0]).hash)
+    expect(vector).not_to eq(described_class.pack([1.0, 2.5]))
+  end
+
+  describe '.top_k' do
+    it 'scores the packed buffers natively' do
+      native = double('NativeVector')
+      stub_const('CassandraCpp::NativeVector', native)
+      candidates = [vector, nil, vector.buffer]
+      expect(native).to receive(:top_k).with(vector, candidates, 2, :dot).and_return([[0, 16.25], [2, 16.25]])
+
+      expect(described_class.top_k(vector, candidates, 2, metric: :dot)).to eq([[0, 16.25], [2, 16.25]])
+    end
+
+    it 'rejects unknown metrics' do
+      expect { described_class.top_k(vector, [], 1, metric: :euclidean) }.to raise_error(ArgumentError, /Unknown metric/)
+    end
+  end
+end
@@ -0,0 +1,61 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+
+RSpec.describe 'Hot partition tracking' do
+  let(:native_session) { double('NativeSession') }
+  let(:session) { CassandraCpp::Session.new(native_session, nil, 'app') }
+  let(:read) { 'SELECT * FROM events WHERE kind = ? AND day = ? AND at > ?' }
+  let(:write) { 'INSERT INTO events (day, kind, at, payload) VALUES (?, ?, ?, ?)' }
+  let(:natives) { Hash.new { |hash, query| hash[query] = double("NativePreparedStatement #{query}") } }
+  let(:schema_reads) { [] }
+
+  before do
+    allow(native_session).to receive(:prepare) { |query| natives[query] }
+    allow(session).to receive(:primary_key_columns) do |table, options|
+      schema_reads << [table, options[:kinds]]
+      %w[day kind]
+    end
+  end
+
+  it 'tracks statements prepared before and after, keyed by the bound partition key columns' do
+    expect(natives[read]).to receive(:track_partitions).with([1, 0], 20, 512, 2)
+    expect(natives[write]).to receive(:track_partitions).with([0, 1], 20, 512, 2)
+
+    session.prepare(read)
+    session.track_hot_partitions(top: 20, width: 512, depth: 2)
+    session.prepare(write)
+
+    expect(schema_reads).to eq([['app.events', %w[partition_key]]])
+  end
+
+  it 'leaves statements alone that do not bind the whole partition key' do
+    session.track_hot_partitions
+
+    expect { session.prepare('SELECT * FROM events WHERE day = ?') }.not_to raise_error
+    expect { session.prepare('SELECT * FROM system_schema.tables WHERE keyspace_name = ?') }.not_to raise_error
+    expect(schema_reads.size).to eq(1)
+  end
+
+  it 'ranks partitions across statements' do
+    allow(natives[read]).to receive(:hot_partitions).and_return(
+      requests: 900,
+      hot: [{ key: %w[2024-01-01 click], requests: 700, bytes: 7_000, rows: 700, max_bytes: 10 }],
+      heavy: [{ key: %w[2024-01-01 click], requests: 700, bytes: 7_000, rows: 700, max_bytes: 10 }]
+    )
+    allow(natives[write]).to receive(:hot_partitions).and_return(
+      requests: 50,
+      hot: [{ key: %w[2024-01-02 view], requests: 40, bytes: 0, rows: 0, max_bytes: 0 }],
+      heavy: []
+    )
+    allow(natives[read]).to receive(:track_partitions)
+    allow(natives[write]).to receive(:track_partitions)
+    session.track_hot_partitions
+    session.prepare(read)
+    session.prepare(write)
+
+    expect(session.hot_partitions.map { |entry| [entry[:query], entry[:requests]] }).to eq([[read, 700], [write, 40]])
+    expect(session.hot_partitions(limit: 1).size).to eq(1)
+    expect(session.heavy_partitions.map { |entry| entry[:key] }).to eq([%w[2024-01-01 click]])
+  end
+end
\ No newline at end of file
@@ -0,0 +1,91 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+require 'set'
+
+RSpec.describe CassandraCpp::KeyFilter do
+  # Exact set standing in for the native Bloom filter
+  let(:native_filter) do
+    Class.new do
+      def initialize(*)
+        @keys = Set.new
+      end
+
+      def add(key)
+        @keys << key
+      end
+
+      def add_all(keys)
+        @keys.merge(keys)
+      end
+
+      def include?(key)
+        @keys.include?(key)
+      end
+
+      def stats
+        { keys: @keys.size }
+      end
+    end
+  end
+  let(:session) { double('Session', each_row: 0) }
+
+  before { stub_const('CassandraCpp::NativeBloomFilter', native_filter) }
+
+  def filter(type)
+    described_class.new(session, 'users', key: 'id', expected_keys: 10, type: type)
+  end
+
+  it 'hashes integer keys alike whether bound as Integer or String' do
+    ints = filter('int')
+    ints.add('42')
+    ints.add_all([7.0])
+
+    expect(ints.might_contain?(42)).to be(true)
+    expect(ints.might_contain?('7')).to be(true)
+    expect(ints.might_contain?(43)).to be(false)
+  end
+
+  it 'hashes UUIDs without regard to case' do
+    uuids = filter('uuid')
+    uuids.add('A0EEBC99-9C0B-4EF8-BB6D-6BB9BD380A11')
+
+    expect(uuids.might_contain?('a0eebc99-9c0b-4ef8-bb6d-6bb9bd380a11')).to be(true)
+  end
+
+  it 'hashes text keys given as symbols or strings alike' do
+    names = filter('text')
+    names.add(:ann)
+
+    expect(names.might_contain?('ann')).to be(true)
+  end
+
+  it 'treats keys that do not convert to the column type as possibly present' do
+    ints = filter('int')
+
+    expect(ints.might_contain?('not a number')).to be(true)
+    expect(ints.might_contain?(1.5)).to be(true)
+    expect(ints.stats[:lookups]).to eq(0)
+  end
+
+  it 'keeps keys written before a deferred first build' do
+    ints = described_class.new(session, 'users', key: 'id', expected_keys: 10, type: 'int', build: false)
+    ints.add(5)
+
+    expect(ints.active?).to be(false)
+    ints.rebuild!
+
+    expect(ints.active?).to be(true)
+    expect(ints.might_contain?(5)).to be(true)
+    expect(ints.might_contain?(6)).to be(false)
+  end
+
+  it 'reads the key type from system_schema when not given' do
+    allow(session).to receive(:keyspace).and_return('app')
+    expect(session).to receive(:execute)
+      .with(/FROM system_schema.columns/, 'app', 'users', 'id')
+      .and_return([{ 'type' => 'bigint' }])
+
+    expect(described_class.new(session, 'users', key: 'id', expected_keys: 10).key_type).to eq('bigint')
+  end
+end
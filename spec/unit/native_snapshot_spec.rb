@@ -0,0 +1,98 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+require 'tmpdir'
+require 'bigdecimal'
+require 'set'
+
+RSpec.describe 'CassandraCpp::NativeSnapshot' do
+  let(:dir) { Dir.mktmpdir('cassandra_cpp_snapshot') }
+  let(:path) { File.join(dir, 'table.snap') }
+  let(:native) { CassandraCpp::NativeSnapshot }
+
+  before do
+    skip 'Native extension not available' unless CassandraCpp.native_extension_loaded?
+  end
+
+  after { FileUtils.remove_entry(dir) }
+
+  it 'reads back what it wrote' do
+    native.write(path, [['b', 2], ['a', 1]], %w[second first])
+    snapshot = native.open(path)
+
+    expect(snapshot.get(['a', 1])).to eq('first')
+    expect(snapshot.range(nil, nil, nil)).to eq(%w[first second])
+  ensure
+    snapshot&.close
+  end
+
+  it 'round-trips rows as plain data' do
+    row = {
+      'id' => 2**70, 'rate' => 0.07, 'name' => 'Zoë', 'blob' => "\x00\xff".b, 'active' => true, 'note' => nil,
+      'at' => Time.at(1_717_000_000, 123_000, :usec), 'price' => BigDecimal('12.50'),
+      'tags' => Set['a', 'b'], 'scores' => [1, -2], 'limits' => { 'daily' => 5 }
+    }
+    native.write(path, [1], [row])
+    snapshot = native.open(path)
+
+    read = snapshot.get(1)
+    expect(read).to eq(row)
+    expect(read['name'].encoding).to eq(Encoding::UTF_8)
+    expect(read['blob'].encoding).to eq(Encoding::BINARY)
+  ensure
+    snapshot&.close
+  end
+
+  it 'creates the file readable by its owner only' do
+    native.write(path, %w[a], %w[first])
+
+    expect(File.stat(path).mode & 0o777).to eq(0o600)
+  end
+
+  it 'rejects corrupt values instead of decoding them' do
+    native.write(path, %w[a], [[1, 2]])
+    bytes = File.binread(path)
+    index_offset = bytes[16, 8].unpack1('Q')
+    value_offset = bytes[index_offset, 8].unpack1('Q') + bytes[index_offset + 8, 4].unpack1('L')
+
+    # List count past the end of the value
+    bytes.setbyte(value_offset + 1, 0x7f)
+    File.binwrite(path, bytes)
+    snapshot = native.open(path)
+    expect { snapshot.get('a') }.to raise_error(ArgumentError, /Corrupt/)
+  ensure
+    snapshot&.close
+  end
+
+  it 'rejects truncated and corrupt files' do
+    native.write(path, %w[a b], %w[first second])
+    bytes = File.binread(path)
+
+    File.binwrite(path, bytes[0, bytes.bytesize - 8])
+    expect { native.open(path) }.to raise_error(ArgumentError, /Not a snapshot file/)
+
+    # Index offset past the end of the file
+    File.binwrite(path, bytes[0, 16] + [bytes.bytesize + 8].pack('Q') + bytes[24..])
+    expect { native.open(path) }.to raise_error(ArgumentError, /Not a snapshot file/)
+
+    # First entry's key running past the data section
+    index_offset = bytes[16, 8].unpack1('Q')
+    corrupt = bytes.dup
+    corrupt[index_offset + 8, 4] = [0xffff].pack('L')
+    File.binwrite(path, corrupt)
+    expect { native.open(path) }.to raise_error(ArgumentError, /Not a snapshot file/)
+  end
+
+  it 'lets concurrent writers of one path finish without clobbering each other' do
+    threads = 4.times.map do |i|
+      Thread.new { native.write(path, ["key#{i}"], ["value#{i}"]) }
+    end
+    threads.each(&:join)
+
+    snapshot = native.open(path)
+    expect(snapshot.size).to eq(1)
+    expect(Dir.children(dir)).to eq(['table.snap'])
+  ensure
+    snapshot&.close
+  end
+end
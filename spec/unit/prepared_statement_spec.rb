@@ -95,6 +95,99 @@ RSpec.describe CassandraCpp::PreparedStatement do
     end
   end
   
+  describe '#each_row' do
+    let(:native_statement) { double('NativeStatement') }
+    let(:row) { { 'id' => '123', 'name' => 'Test' } }
+    
+    before do
+      allow(native_prepared).to receive(:bind).and_return(native_statement)
+      allow(native_statement).to receive(:bind)
+    end
+    
+    it 'binds parameters and streams rows natively' do
+      expect(native_statement).to receive(:each_row).with(true, false, 5000).and_yield(row).and_return(1)
+      
+      yielded = []
+      count = prepared_statement.each_row('123', 'John', 'john@example.com') { |r| yielded << r }
+      
+      expect(count).to eq(1)
+      expect(yielded).to eq([row])
+    end
+    
+    it 'passes row format and paging options through' do
+      expect(native_statement).to receive(:each_row).with(false, true, 100).and_return(0)
+      
+      prepared_statement.each_row('123', 'John', 'john@example.com', reuse: false, as: :array, page_size: 100) { |_| }
+    end
+    
+    it 'never reuses rows when returning an enumerator' do
+      expect(native_statement).to receive(:each_row).with(false, false, 5000).and_yield(row).and_return(1)
+      
+      rows = prepared_statement.each_row('123', 'John', 'john@example.com', reuse: true).to_a
+      
+      expect(rows).to eq([row])
+    end
+    
+    it 'rejects unknown row formats' do
+      expect {
+        prepared_statement.each_row('123', 'John', 'john@example.com', as: :struct) { |_| }
+      }.to raise_error(ArgumentError, /row format/)
+    end
+  end
+  
+  describe '#aggregate' do
+    let(:native_statement) { double('NativeStatement') }
+    let(:groups) { { 'acme' => { count: 2, sum: { 'bytes' => 30 } } } }
+    
+    before do
+      allow(native_prepared).to receive(:bind).and_return(native_statement)
+      allow(native_statement).to receive(:bind)
+    end
+    
+    it 'normalizes aggregates and folds natively' do
+      expect(native_statement).to receive(:aggregate)
+        .with(['tenant'], [[:sum, 'bytes'], [:max, 'bytes'], [:max, 'latency']], 5000)
+        .and_return(groups)
+      
+      result = prepared_statement.aggregate('123', 'John', 'john@example.com',
+                                            group_by: :tenant,
+                                            aggregates: { count: true, sum: 'bytes', max: %w[bytes latency] })
+      
+      expect(result).to eq(groups)
+    end
+    
+    it 'rejects unknown aggregates' do
+      expect {
+        prepared_statement.aggregate('123', 'John', 'john@example.com', group_by: :tenant, aggregates: { avg: 'bytes' })
+      }.to raise_error(ArgumentError, /Unknown aggregate/)
+    end
+  end
+  
+  describe '#phase_latencies' do
+    it 'returns the native per-statement histograms' do
+      phases = { queue: { count: 1 }, network: { count: 1 }, gvl_wait: { count: 1 }, decode: { count: 1 } }
+      expect(native_prepared).to receive(:phase_latencies).and_return(phases)
+      
+      expect(prepared_statement.phase_latencies).to eq(phases)
+    end
+  end
+  
+  describe '#circuit_breaker=' do
+    it 'sets the native breaker key as a string' do
+      expect(native_prepared).to receive(:circuit_breaker=).with('users-writes')
+      
+      prepared_statement.circuit_breaker = :'users-writes'
+    end
+  end
+  
+  describe '#idempotent=' do
+    it 'marks the native statement' do
+      expect(native_prepared).to receive(:idempotent=).with(true)
+      
+      prepared_statement.idempotent = true
+    end
+  end
+  
   describe '#has_params?' do
     it 'returns true when statement has parameters' do
       expect(prepared_statement.has_params?).to be(true)
@@ -0,0 +1,64 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+
+RSpec.describe CassandraCpp::Result do
+  let(:users) do
+    described_class.new([
+      { 'id' => 1, 'name' => 'alice' },
+      { 'id' => 2, 'name' => 'bob' },
+      { 'id' => nil, 'name' => 'ghost' }
+    ])
+  end
+
+  let(:orders) do
+    described_class.new([
+      { 'user_id' => 1, 'total' => 10, 'name' => 'order-a' },
+      { 'user_id' => 3, 'total' => 30, 'name' => 'order-b' },
+      { 'user_id' => 1, 'total' => 15, 'name' => 'order-c' }
+    ])
+  end
+
+  describe '#index_by' do
+    it 'indexes rows by a column, skipping null keys' do
+      index = users.index_by(:id)
+
+      expect(index.keys).to eq([1, 2])
+      expect(index[2]['name']).to eq('bob')
+    end
+
+    it 'keeps the last row for duplicate keys' do
+      index = orders.index_by('user_id')
+
+      expect(index[1]['total']).to eq(15)
+    end
+
+    it 'delegates to the native result when lazy' do
+      native = double('NativeResult')
+      expect(native).to receive(:index_by).with('id').and_return({ 1 => { 'id' => 1 } })
+
+      expect(described_class.new(native).index_by(:id)).to eq({ 1 => { 'id' => 1 } })
+    end
+  end
+
+  describe '.join' do
+    it 'inner joins rows on mapped columns in left order' do
+      joined = described_class.join(users, orders, on: { id: :user_id }).to_a
+
+      expect(joined.map { |row| [row['id'], row['total']] }).to eq([[1, 10], [1, 15]])
+    end
+
+    it 'keeps left values for columns present on both sides' do
+      joined = described_class.join(users, orders, on: { 'id' => 'user_id' }).first
+
+      expect(joined['name']).to eq('alice')
+      expect(joined['user_id']).to eq(1)
+    end
+  end
+
+  describe '#lazy?' do
+    it 'is false for materialized rows' do
+      expect(users.lazy?).to be(false)
+    end
+  end
+end
\ No newline at end of file
@@ -0,0 +1,86 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+
+RSpec.describe 'Routing keys' do
+  let(:native_session) { double('NativeSession') }
+  let(:session) { CassandraCpp::Session.new(native_session, nil, 'app') }
+
+  it 'runs a routed query unprepared, with its params and the keyspace of its table' do
+    allow(session).to receive(:partition_key_types).with('shop.orders').and_return(%w[bigint date])
+    expect(native_session).to receive(:execute)
+      .with('SELECT * FROM shop.orders WHERE customer = ? AND day = ?',
+            { params: [42, '2024-06-01'], key_indexes: [0, 1], key_types: %w[bigint date], keyspace: 'shop' })
+      .and_return([{ 'id' => 1 }])
+
+    result = session.execute('SELECT * FROM shop.orders WHERE customer = ? AND day = ?', 42, '2024-06-01',
+                             routing_key: [0, 1])
+    expect(result.first['id']).to eq(1)
+  end
+
+  it 'finds the partition key params from the schema' do
+    allow(session).to receive(:primary_key_columns).and_return(%w[customer])
+    allow(session).to receive(:partition_key_types).and_return(%w[bigint])
+    expect(native_session).to receive(:execute_async)
+      .with('UPDATE orders SET state = ? WHERE customer = ?',
+            { params: ['paid', 42], key_indexes: [1], key_types: %w[bigint], keyspace: 'app' })
+      .and_return(double('NativeFuture'))
+
+    session.execute_async('UPDATE orders SET state = ? WHERE customer = ?', 'paid', 42,
+                          routing_key: true, keyspace: 'app')
+  end
+
+  it 'routes the query string entries of a batch' do
+    stub_const('CassandraCpp::BATCH_TYPE_UNLOGGED', 1)
+    native_batch = double('NativeBatch')
+    allow(native_session).to receive(:batch).with(1).and_return(native_batch)
+    expect(native_batch).to receive(:keyspace=).with('shop')
+    allow(session).to receive(:partition_key_types).and_return(%w[bigint])
+    expect(native_batch).to receive(:add_statement)
+      .with('INSERT INTO orders (customer, id) VALUES (?, ?)', [42, 7], [0], %w[bigint])
+    expect(native_batch).to receive(:add_statement).with('DELETE FROM carts WHERE customer = 42', nil)
+
+    batch = session.batch(:unlogged, routing_key: [0], keyspace: 'shop')
+    batch.add('INSERT INTO orders (customer, id) VALUES (?, ?)', [42, 7])
+    batch.add('DELETE FROM carts WHERE customer = 42', routing_key: nil)
+  end
+
+  it 'rejects a routing key that does not cover the partition key' do
+    allow(session).to receive(:partition_key_types).and_return(%w[bigint date])
+
+    expect {
+      session.execute('SELECT * FROM orders WHERE customer = ?', 42, routing_key: [0])
+    }.to raise_error(CassandraCpp::QueryError, /2 partition key columns, routing key has 1/)
+  end
+
+  describe 'routing tokens' do
+    before do
+      skip 'Native extension not available' unless CassandraCpp.native_extension_loaded?
+    end
+
+    def token(values, types)
+      CassandraCpp::NativeSession.routing_token(values, types)
+    end
+
+    # SELECT token(k) on a Murmur3Partitioner cluster
+    it 'hashes small Integers in a bigint key at 8 bytes' do
+      expect(token([1], %w[bigint])).to eq(6_292_367_497_774_912_474)
+      expect(token([42], %w[bigint])).to eq(8_623_491_988_607_824_794)
+      expect(token([-1], %w[bigint])).to eq(7_071_048_584_287_372_947)
+      expect(token([1], %w[int])).to eq(-4_069_959_284_402_364_209)
+    end
+
+    it 'hashes non-String values of a text key as their text' do
+      expect(token([42], %w[text])).to eq(-5_291_771_196_513_038_484)
+    end
+
+    it 'hashes composite keys as Cassandra does' do
+      expect(token([42, 'a'], %w[int text])).to eq(4_165_665_305_332_159_090)
+    end
+
+    it 'rejects values that do not fit the key type' do
+      expect { token([2**40], %w[int]) }.to raise_error(RangeError)
+      expect { token([nil], %w[bigint]) }.to raise_error(ArgumentError, /nil/)
+    end
+  end
+end
@@ -0,0 +1,189 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+
+RSpec.describe CassandraCpp::Session do
+  let(:native_session) { double('NativeSession') }
+  let(:native_prepared) { double('NativePreparedStatement') }
+  let(:session) { described_class.new(native_session, nil) }
+  let(:query) { 'INSERT INTO readings (sensor, value) VALUES (?, ?)' }
+
+  before do
+    allow(native_session).to receive(:prepare).with(query).and_return(native_prepared)
+  end
+
+  describe '#write_columns' do
+    it 'passes array and packed columns to the native writer' do
+      values = CassandraCpp::PackedColumn.pack(:double, [1.5, 2.5])
+      expect(native_prepared).to receive(:write_columns)
+        .with(%w[sensor value], [%w[a b], values.buffer], [nil, :double], 16)
+        .and_return(2)
+
+      rows = session.write_columns(query, { sensor: %w[a b], value: values }, concurrency: 16)
+
+      expect(rows).to eq(2)
+      expect(session.metrics.query_count).to eq(1)
+    end
+
+    it 'counts native failures as errors' do
+      allow(native_prepared).to receive(:write_columns).and_raise(CassandraCpp::Error, 'write timeout')
+
+      expect {
+        session.write_columns(query, { 'sensor' => ['a'], 'value' => [1.0] })
+      }.to raise_error(CassandraCpp::Error, /write timeout/)
+      expect(session.metrics.error_count).to eq(1)
+    end
+  end
+
+  describe '#each_row' do
+    let(:rows_query) { 'SELECT sensor, value FROM readings' }
+
+    it 'reuses rows by default when given a block' do
+      expect(native_session).to receive(:each_row).with(rows_query, true, false, 5000).and_return(0)
+
+      session.each_row(rows_query) { |_| }
+    end
+
+    it 'yields fresh rows through the enumerator form' do
+      expect(native_session).to receive(:each_row).with(rows_query, false, true, 5000)
+        .and_yield(['a', 1.5]).and_return(1)
+
+      expect(session.each_row(rows_query, reuse: true, as: :array).to_a).to eq([['a', 1.5]])
+    end
+  end
+
+  describe '#execute with priority:' do
+    it 'submits the request in the requested class and restores the previous one' do
+      seen = nil
+      allow(native_session).to receive(:execute) do
+        seen = Thread.current[described_class::PRIORITY_KEY]
+        []
+      end
+
+      session.with_priority(:interactive) do
+        session.execute('SELECT * FROM readings', priority: :batch)
+        expect(Thread.current[described_class::PRIORITY_KEY]).to eq(:interactive)
+      end
+
+      expect(seen).to eq(:batch)
+      expect(Thread.current[described_class::PRIORITY_KEY]).to be_nil
+    end
+
+    it 'rejects unknown classes before submitting' do
+      expect(native_session).not_to receive(:execute)
+
+      expect {
+        session.execute('SELECT * FROM readings', priority: :urgent)
+      }.to raise_error(ArgumentError, /Unknown priority/)
+    end
+  end
+
+  describe '#key_filter' do
+    let(:filter) { double('KeyFilter', key_column: 'id', rebuild!: nil) }
+
+    before do
+      allow(CassandraCpp::KeyFilter).to receive(:new).and_return(filter)
+      session.key_filter('users', key: 'id', expected_keys: 1_000)
+    end
+
+    it 'answers reads of keys the filter has never seen without a round trip' do
+      allow(filter).to receive(:might_contain?).with(42).and_return(false)
+      expect(native_session).not_to receive(:prepare)
+
+      expect(session.execute('SELECT * FROM users WHERE id = ?', 42).to_a).to eq([])
+    end
+
+    it 'sees writes made while its first scan runs' do
+      scanning = double('KeyFilter', key_column: 'id')
+      allow(CassandraCpp::KeyFilter).to receive(:new).and_return(scanning)
+      allow(scanning).to receive(:rebuild!) {
+        session.key_filter_admit('INSERT INTO users (id) VALUES (?)', [5], reads: false)
+      }
+      expect(scanning).to receive(:add).with(5)
+
+      session.key_filter('users', key: 'id', expected_keys: 1_000)
+    end
+
+    it 'drops the filter when its first scan fails' do
+      failing = double('KeyFilter', key_column: 'id')
+      allow(CassandraCpp::KeyFilter).to receive(:new).and_return(failing)
+      allow(failing).to receive(:rebuild!).and_raise(CassandraCpp::Error, 'scan failed')
+
+      expect { session.key_filter('users', key: 'id', expected_keys: 1_000) }.to raise_error(CassandraCpp::Error)
+      expect(failing).not_to receive(:might_contain?)
+      expect(session.key_filter_admit('SELECT * FROM users WHERE id = ?', [42])).to be(true)
+    end
+
+    it 'adds the bound key of inserts and updates' do
+      expect(filter).to receive(:add).with(7)
+      expect(filter).to receive(:add).with(8)
+
+      session.key_filter_admit('INSERT INTO users (name, id) VALUES (?, ?)', ['ann', 7], reads: false)
+      session.key_filter_admit('UPDATE users SET name = ? WHERE id = ?', ['bob', 8], reads: false)
+    end
+
+    it 'stops filtering after a batch string that writes the table' do
+      expect(filter).to receive(:invalidate!)
+
+      session.key_filter_admit('BEGIN BATCH INSERT INTO users (id) VALUES (?); APPLY BATCH', [9], reads: false)
+    end
+
+    it 'stops filtering after a write whose key it cannot see' do
+      expect(filter).to receive(:invalidate!)
+
+      session.key_filter_admit("INSERT INTO users (id, name) VALUES (9, 'cy')", [], reads: false)
+    end
+
+    it 'sees the keys of statements it prepared, executed directly' do
+      select = 'SELECT * FROM users WHERE id = ?'
+      insert = 'INSERT INTO users (id, name) VALUES (?, ?)'
+      native_statement = double('NativeStatement', bind: nil, execute: [])
+      allow(native_session).to receive(:prepare).with(select).and_return(double('NativePreparedStatement'))
+      allow(native_session).to receive(:prepare).with(insert)
+        .and_return(double('NativePreparedStatement', bind: native_statement))
+      allow(filter).to receive(:might_contain?).with(42).and_return(false)
+      expect(filter).to receive(:add).with(7)
+
+      expect(session.prepare(select).execute(42).to_a).to eq([])
+      session.prepare(insert).execute(7, 'ann')
+    end
+
+    it 'sees the keys of bound statements' do
+      insert = 'INSERT INTO users (id, name) VALUES (?, ?)'
+      native_statement = double('NativeStatement', bind: nil, execute: [])
+      allow(native_session).to receive(:prepare).with(insert)
+        .and_return(double('NativePreparedStatement', bind: native_statement))
+      expect(filter).to receive(:add).with(8)
+
+      session.prepare(insert).bind(8, 'bob').execute
+    end
+
+    it 'stops filtering when a native bound statement of unknown origin joins a batch' do
+      native_batch = double('NativeBatch', add_statement: nil)
+      expect(filter).to receive(:invalidate!)
+
+      CassandraCpp::Batch.new(native_batch, session).add(double('NativeStatement'))
+    end
+  end
+
+  describe '#configure_priorities' do
+    it 'passes the gate settings to the native session' do
+      expect(native_session).to receive(:configure_priorities).with(64, 0.25, 20)
+
+      expect(session.configure_priorities(max_in_flight: 64, interactive_latency_target_ms: 20)).to eq(session)
+    end
+  end
+end
+
+RSpec.describe CassandraCpp::PackedColumn do
+  it 'packs values in native byte order' do
+    column = described_class.pack(:int64, [1, 2, 3])
+
+    expect(column.buffer).to eq([1, 2, 3].pack('q*'))
+    expect(column.size).to eq(3)
+  end
+
+  it 'rejects unknown types' do
+    expect { described_class.new(:decimal, '') }.to raise_error(ArgumentError, /Unknown packed type/)
+  end
+end
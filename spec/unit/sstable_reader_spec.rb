@@ -0,0 +1,129 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+require 'tmpdir'
+
+RSpec.describe CassandraCpp::SSTableReader do
+  # Serves fixed rows the way the native reader yields them
+  let(:native_class) do
+    Class.new do
+      attr_reader :path, :key_names, :clustering_names, :iterations
+
+      def initialize(path, key_names, clustering_names)
+        @path = path
+        @key_names = key_names
+        @clustering_names = clustering_names
+        @iterations = []
+      end
+
+      def columns
+        [['day', 'date', :partition_key], ['kind', 'text', :partition_key], ['at', 'int', :clustering],
+         ['note', 'text', :regular]]
+      end
+
+      def each_row(as_array, now)
+        @iterations << [as_array, now]
+        rows = [[1, 'a', 1, 'x'], [1, 'a', 2, 'y'], [1, 'b', 1, nil], [2, 'a', 1, 'z']]
+        rows.each { |row| yield as_array ? row : columns.map(&:first).zip(row).to_h }
+        rows.size
+      end
+
+      def close
+        nil
+      end
+    end
+  end
+  let(:dir) { Dir.mktmpdir }
+
+  before do
+    stub_const('CassandraCpp::NativeSSTableReader', Class.new)
+    allow(CassandraCpp::NativeSSTableReader).to receive(:open) { |*args| native_class.new(*args) }
+  end
+
+  after { FileUtils.rm_rf(dir) }
+
+  def native(reader)
+    reader.instance_variable_get(:@native)
+  end
+
+  def data_file(name, size = 1)
+    File.join(dir, name).tap { |path| File.binwrite(path, 'x' * size) }
+  end
+
+  it 'names key columns from the schema.cql next to the SSTable' do
+    File.write(File.join(dir, 'schema.cql'), <<~CQL)
+      CREATE TYPE IF NOT EXISTS app.tag (name text);
+      CREATE TABLE IF NOT EXISTS app.events (
+          day date,
+          kind text,
+          at int,
+          note text,
+          PRIMARY KEY ((day, kind), at)
+      ) WITH ID = 5bc52802-de25-35ed-aeab-188eecebb090
+          AND CLUSTERING ORDER BY (at ASC);
+    CQL
+    reader = described_class.new(data_file('nb-1-big-Data.db'))
+
+    expect(native(reader).key_names).to eq(%w[day kind])
+    expect(native(reader).clustering_names).to eq(%w[at])
+  end
+
+  it 'leaves names to the native defaults without a schema' do
+    reader = described_class.new(data_file('nb-1-big-Data.db'))
+
+    expect(native(reader).key_names).to be_nil
+    expect(reader.columns.map(&:to_h).first).to eq(
+      name: 'day', type: 'date', kind: :partition_key, position: 0, descending: false
+    )
+    expect(reader.columns.map(&:position)).to eq([0, 1, 0, -1])
+  end
+
+  it 'streams rows as hashes or arrays, evaluating TTLs at now' do
+    reader = described_class.new(data_file('nb-1-big-Data.db'))
+
+    expect(reader.each_row(now: Time.at(1_700_000_000)).first).to eq('day' => 1, 'kind' => 'a', 'at' => 1, 'note' => 'x')
+    expect(reader.each_row(as: :array, now: 5).to_a.last).to eq([2, 'a', 1, 'z'])
+    expect(native(reader).iterations).to eq([[false, 1_700_000_000], [true, 5]])
+    expect(reader.count).to eq(4)
+    expect { reader.each_row(as: :csv) {} }.to raise_error(ArgumentError, /hash, array/)
+  end
+
+  it 'groups consecutive rows by partition key' do
+    reader = described_class.new(data_file('nb-1-big-Data.db'))
+
+    partitions = reader.each_partition(as: :array).map { |key, rows| [key, rows.size] }
+
+    expect(partitions).to eq([[[1, 'a'], 2], [[1, 'b'], 1], [[2, 'a'], 1]])
+  end
+
+  it 'lists Data.db files largest first' do
+    small = data_file('nb-1-big-Data.db', 1)
+    large = data_file('nb-2-big-Data.db', 10)
+    data_file('nb-2-big-Index.db', 100)
+
+    expect(described_class.sstables(dir)).to eq([large, small])
+  end
+
+  it 'maps over SSTables in order, in this process or in workers' do
+    paths = [data_file('nb-1-big-Data.db', 1), data_file('nb-2-big-Data.db', 3), data_file('nb-3-big-Data.db', 2)]
+
+    expect(described_class.map(paths, processes: 1) { |reader| File.basename(reader.path) })
+      .to eq(%w[nb-1-big-Data.db nb-2-big-Data.db nb-3-big-Data.db])
+    expect(described_class.map(dir, processes: 2) { |reader| [File.basename(reader.path), reader.count] })
+      .to eq([['nb-2-big-Data.db', 4], ['nb-3-big-Data.db', 4], ['nb-1-big-Data.db', 4]])
+  end
+
+  it 'raises worker errors in the caller' do
+    data_file('nb-1-big-Data.db')
+    data_file('nb-2-big-Data.db')
+
+    expect { described_class.map(dir, processes: 2) { |_reader| raise KeyError, 'bad row' } }
+      .to raise_error(KeyError, 'bad row')
+  end
+
+  it 'closes readers opened with a block' do
+    reader = described_class.open(data_file('nb-1-big-Data.db')) { |opened| opened }
+
+    expect(reader).to be_closed
+  end
+end
\ No newline at end of file
@@ -0,0 +1,66 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+require 'tmpdir'
+
+# Exercises the native writer and reader together, without stubs
+RSpec.describe 'SSTable round trip' do
+  let(:dir) { Dir.mktmpdir }
+  let(:schema) do
+    <<~CQL
+      CREATE TABLE app.readings (
+        sensor int,
+        at bigint,
+        value double,
+        note text,
+        PRIMARY KEY (sensor, at)
+      );
+    CQL
+  end
+
+  before do
+    skip 'Native extension not available' unless CassandraCpp.native_extension_loaded?
+  end
+
+  after { FileUtils.rm_rf(dir) }
+
+  describe 'Murmur3 tokens' do
+    def token(bytes)
+      CassandraCpp::NativeSSTableWriter.token(bytes.b)
+    end
+
+    it 'match Cassandra for int partition keys' do
+      # SELECT token(k) for int k = 1..5 on a Murmur3Partitioner cluster
+      tokens = (1..5).map { |key| token([key].pack('l>')) }
+
+      expect(tokens).to eq([-4_069_959_284_402_364_209, -3_248_873_570_005_575_792, 9_010_454_139_840_013_625,
+                            -2_729_420_104_000_364_805, -7_509_452_495_886_106_294])
+    end
+
+    it 'match Cassandra for keys with multi-block and sign-extended tails' do
+      expect(token('a')).to eq(-8_839_064_797_231_613_815)
+      expect(token('hello world')).to eq(5_998_619_086_395_760_910)
+      expect(token('The quick brown fox jumps over the lazy dog')).to eq(-2_068_352_364_225_029_268)
+      expect(token([-1].pack('l>'))).to eq(7_297_452_126_230_313_552)
+      expect(token('ü€∂ñ')).to eq(-2_129_813_760_074_740_698)
+    end
+  end
+
+  it 'reads back what the writer wrote, partitions in token order' do
+    rows = [1, 2, 3, 4, 5].flat_map do |sensor|
+      [{ 'sensor' => sensor, 'at' => 10, 'value' => sensor * 1.5, 'note' => "s#{sensor}" },
+       { 'sensor' => sensor, 'at' => 20, 'value' => -sensor.to_f, 'note' => nil }]
+    end
+    paths = CassandraCpp::SSTableWriter.new(dir, schema: schema).tap { |writer| rows.each { |row| writer << row } }.close
+
+    reader = CassandraCpp::SSTableReader.new(paths.first, schema: schema)
+    read = reader.each_row.to_a
+
+    expect(paths.size).to eq(1)
+    expect(read.map { |row| row['sensor'] }.uniq).to eq([5, 1, 2, 4, 3])
+    expect(read).to match_array(rows)
+    expect(read.each_slice(2).map { |pair| pair.map { |row| row['at'] } }.uniq).to eq([[10, 20]])
+  ensure
+    reader&.close
+  end
+end
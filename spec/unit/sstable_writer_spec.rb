@@ -0,0 +1,155 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+require 'date'
+require 'tmpdir'
+
+RSpec.describe CassandraCpp::SSTableWriter do
+  # Records what the wrapper hands to the native writer
+  let(:native_class) do
+    Class.new do
+      attr_reader :directory, :columns, :generation, :rows
+
+      def initialize(directory, columns, generation, _buffer_size, _fp_chance)
+        @directory = directory
+        @columns = columns
+        @generation = generation
+        @rows = []
+        @written = []
+      end
+
+      def add(values, timestamp, ttl)
+        @rows << [values, timestamp, ttl]
+        nil
+      end
+
+      def flush
+        return nil if @rows.empty?
+
+        @rows = []
+        path = File.join(@directory, "nb-#{@generation + @written.size}-big-Data.db")
+        @written << path
+        path
+      end
+
+      def sstables
+        @written.dup
+      end
+
+      def buffered_rows
+        @rows.size
+      end
+    end
+  end
+  let(:dir) { Dir.mktmpdir }
+  let(:schema) do
+    <<~CQL
+      CREATE TABLE app.events (
+        day date,
+        kind text,
+        at timestamp,
+        "Payload" blob,
+        note text,
+        PRIMARY KEY ((day, kind), at)
+      ) WITH CLUSTERING ORDER BY (at DESC) AND comment = 'events';
+    CQL
+  end
+
+  before do
+    stub_const('CassandraCpp::NativeSSTableWriter', Class.new)
+    allow(CassandraCpp::NativeSSTableWriter).to receive(:new) { |*args| native_class.new(*args) }
+  end
+
+  after { FileUtils.rm_rf(dir) }
+
+  def native(writer)
+    writer.instance_variable_get(:@native)
+  end
+
+  describe '.parse_schema' do
+    it 'reads key positions, clustering order and quoted identifiers' do
+      columns = described_class.parse_schema(schema).to_h { |column| [column.name, column] }
+
+      expect(columns.keys).to eq(%w[day kind at Payload note])
+      expect(columns['day'].to_h).to include(kind: :partition_key, position: 0)
+      expect(columns['kind'].to_h).to include(kind: :partition_key, position: 1)
+      expect(columns['at'].to_h).to include(kind: :clustering, type: 'timestamp', descending: true)
+      expect(columns['Payload'].kind).to eq(:regular)
+    end
+
+    it 'handles inline primary keys, nested types and static columns' do
+      columns = described_class.parse_schema(
+        'create table if not exists t (ID uuid PRIMARY KEY, tags frozen<map<text, int>>, n int static)'
+      )
+
+      expect(columns.map(&:to_h)).to eq([
+        { name: 'id', type: 'uuid', kind: :partition_key, position: 0, descending: false },
+        { name: 'tags', type: 'frozen<map<text,int>>', kind: :regular, position: -1, descending: false },
+        { name: 'n', type: 'int', kind: :static, position: -1, descending: false }
+      ])
+    end
+
+    it 'rejects statements without a primary key' do
+      expect { described_class.parse_schema('CREATE TABLE t (id int)') }.to raise_error(ArgumentError, /PRIMARY KEY/)
+      expect { described_class.parse_schema('SELECT * FROM t') }.to raise_error(ArgumentError, /CREATE TABLE/)
+    end
+  end
+
+  it 'passes key columns first, in key order, to the native writer' do
+    writer = described_class.new(dir, schema: schema)
+
+    expect(native(writer).columns).to eq([
+      ['day', 'date', :partition_key, false],
+      ['kind', 'text', :partition_key, false],
+      ['at', 'timestamp', :clustering, true],
+      ['Payload', 'blob', :regular, false],
+      ['note', 'text', :regular, false]
+    ])
+  end
+
+  it 'maps rows to values by column name and converts Time timestamps' do
+    writer = described_class.new(dir, schema: schema)
+    at = Time.at(1_700_000_000, 250, :usec)
+
+    writer.add({ kind: 'click', day: Date.new(2024, 1, 1), at: at, 'Payload' => 'x' }, timestamp: at, ttl: 60)
+    writer << { day: 1, kind: 'view', at: 2 }
+
+    expect(native(writer).rows).to eq([
+      [[Date.new(2024, 1, 1), 'click', at, 'x', nil], 1_700_000_000_000_250, 60],
+      [[1, 'view', 2, nil, nil], nil, nil]
+    ])
+    expect { writer.add({ unknown: 1 }) }.to raise_error(ArgumentError, /Unknown column unknown/)
+  end
+
+  it 'numbers SSTables after the generations already in the directory' do
+    FileUtils.touch(File.join(dir, 'nb-7-big-Data.db'))
+    writer = described_class.new(dir, schema: schema)
+
+    expect(native(writer).generation).to eq(8)
+  end
+
+  it 'flushes the remaining rows on close' do
+    writer = described_class.new(dir, schema: schema)
+    writer << { day: 1, kind: 'view', at: 2 }
+
+    expect(writer.close).to eq([File.join(dir, 'nb-1-big-Data.db')])
+    expect(writer).to be_closed
+    expect { writer << { day: 1, kind: 'view', at: 3 } }.to raise_error(IOError)
+  end
+
+  it 'refuses tables with static columns' do
+    expect do
+      described_class.new(dir, schema: 'CREATE TABLE t (id int, c int, s text STATIC, PRIMARY KEY (id, c))')
+    end.to raise_error(ArgumentError, /Static column s/)
+  end
+
+  it 'accepts a table builder' do
+    builder = CassandraCpp::Schema::DDL::TableBuilder.new('users')
+    builder.uuid(:id, primary_key: true)
+    builder.text(:name)
+
+    writer = described_class.new(dir, schema: builder)
+
+    expect(native(writer).columns.map(&:first)).to eq(%w[id name])
+  end
+end
@@ -0,0 +1,94 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+require 'tmpdir'
+
+RSpec.describe CassandraCpp::TokenRangeScan do
+  # Rows keyed by token; pages of two rows, paging state is the row offset
+  let(:tokens) { [-2**62, -5, 0, 7, 2**40, 2**62] }
+  let(:prepared) do
+    rows_by_token = tokens
+    Class.new do
+      define_method(:each_page) do |from, to, as:, page_size:, paging_state:, &block|
+        rows = rows_by_token.select { |token| token > from && token <= to }.map { |token| { 'token' => token } }
+        offset = paging_state ? Integer(paging_state) : 0
+        while offset < rows.size
+          page = rows[offset, 2]
+          offset += page.size
+          block.call(page, offset < rows.size ? offset.to_s : nil)
+        end
+        rows.size
+      end
+    end.new
+  end
+  let(:estimates) { [] }
+  let(:session) { double('Session', keyspace: 'app') }
+  let(:dir) { Dir.mktmpdir }
+  let(:checkpoint) { described_class::FileCheckpoint.new(File.join(dir, 'scan.json')) }
+
+  before do
+    allow(session).to receive(:prepare).and_return(prepared)
+    allow(session).to receive(:execute).and_return(estimates)
+  end
+
+  after { FileUtils.rm_rf(dir) }
+
+  def scan(**options)
+    described_class.new(session, 'events', key_columns: ['id'], checkpoint: checkpoint, splits: 4,
+                                           checkpoint_interval: 0, **options)
+  end
+
+  it 'yields every row once across the planned ranges' do
+    seen = []
+    expect(scan.each_row { |row| seen << row['token'] }).to eq(tokens.size)
+
+    expect(seen.sort).to eq(tokens)
+    expect(scan.done?).to be(true)
+  end
+
+  it 'resumes from the checkpoint after an interrupted run' do
+    seen = []
+    expect {
+      scan.each_row do |row|
+        raise 'deploy' if seen.size == 3
+
+        seen << row['token']
+      end
+    }.to raise_error('deploy')
+
+    resumed = []
+    scan.each_row { |row| resumed << row['token'] }
+
+    # The interrupted page is delivered again, finished pages are not
+    expect((seen + resumed).uniq.sort).to eq(tokens)
+    expect(resumed.size).to be < tokens.size
+  end
+
+  it 'scans nothing once the job is done, until reset' do
+    scan.each_row { |_row| }
+
+    expect(scan.each_row { |_row| }).to eq(0)
+    expect(scan.reset!.each_row { |_row| }).to eq(tokens.size)
+  end
+
+  context 'with size estimates' do
+    let(:estimates) do
+      [
+        { 'range_start' => (-2**63).to_s, 'range_end' => '0', 'partitions_count' => 300 },
+        { 'range_start' => '0', 'range_end' => (-2**63).to_s, 'partitions_count' => 100 }
+      ]
+    end
+
+    it 'balances ranges by estimated partitions' do
+      job = scan
+      job.each_row { |_row| }
+      ranges = JSON.parse(File.read(checkpoint.path))['ranges']
+
+      # Three quarters of the partitions sit below token 0
+      expect(ranges.count { |_from, to, _| to <= 0 }).to eq(3)
+      expect(ranges.first.first).to eq(described_class::TOKEN_MIN)
+      expect(ranges.last[1]).to eq(described_class::TOKEN_MAX)
+      expect(job.progress).to include(ranges: 4, completed_ranges: 4, estimated_partitions: 400, fraction_done: 1.0)
+    end
+  end
+end
@@ -0,0 +1,157 @@
+# frozen_string_literal: true
+
+require 'spec_helper'
+require 'tempfile'
+
+RSpec.describe CassandraCpp::TrafficLog do
+  # Minimal writer mirroring ext/cassandra_cpp/recorder.cpp
+  def varint(value)
+    bytes = []
+    loop do
+      byte = value & 0x7f
+      value >>= 7
+      bytes << (value.zero? ? byte : byte | 0x80)
+      break if value.zero?
+    end
+    bytes.pack('C*')
+  end
+
+  def zigzag(value)
+    varint(value >= 0 ? value << 1 : ((-value) << 1) - 1)
+  end
+
+  def bytes_with_length(string)
+    varint(string.bytesize) + string.b
+  end
+
+  def write_log(entries, started_us: 1_700_000_000_000_000)
+    file = Tempfile.new(['traffic', '.cctr'])
+    file.binmode
+    file.write('CCTR'.b + [1].pack('C') + [started_us].pack('Q<') + entries.map(&:b).join)
+    file.flush
+    file
+  end
+
+  def query_entry(id, query)
+    [1].pack('C') + varint(id) + bytes_with_length(query)
+  end
+
+  def request_entry(id, prepared:, offset_us:, latency_us:, consistency: 0, status: 0, params: [])
+    [2].pack('C') + varint(id) + [prepared ? 1 : 0].pack('C') + varint(offset_us) + varint(latency_us) +
+      varint(consistency) + varint(status) + varint(params.size) + params.join.b
+  end
+
+  let(:select_query) { 'SELECT * FROM users WHERE id = ?' }
+  let(:entries) do
+    [
+      query_entry(0, select_query),
+      request_entry(0, prepared: true, offset_us: 150, latency_us: 900,
+                       params: ["\x05".b + bytes_with_length('alice')]),
+      query_entry(1, 'SELECT now() FROM system.local'),
+      request_entry(1, prepared: false, offset_us: 2_000, latency_us: 1_500, consistency: 2, status: 3),
+      request_entry(0, prepared: true, offset_us: 3_000, latency_us: 700,
+                       params: ["\x08".b + varint(3) + "\x03".b + zigzag(-5) + "\x01\x00".b])
+    ]
+  end
+
+  let(:file) { write_log(entries) }
+  let(:log) { described_class.new(file.path) }
+
+  after { file.close! }
+
+  describe '#each' do
+    it 'decodes requests with their query text' do
+      requests = log.to_a
+
+      expect(requests.size).to eq(3)
+      expect(requests.map(&:query)).to eq([select_query, 'SELECT now() FROM system.local', select_query])
+      expect(requests.map(&:prepared?)).to eq([true, false, true])
+    end
+
+    it 'decodes timing, consistency and status' do
+      first, second = log.first(2)
+
+      expect(first.offset_us).to eq(150)
+      expect(first.latency_us).to eq(900)
+      expect(first.consistency).to be_nil
+      expect(first.error?).to be(false)
+
+      expect(second.consistency).to eq(1)
+      expect(second.status).to eq(3)
+      expect(second.error?).to be(true)
+    end
+
+    it 'decodes bound values' do
+      requests = log.to_a
+
+      expect(requests[0].params).to eq(['alice'])
+      expect(requests[2].params).to eq([[-5, true, nil]])
+    end
+
+    it 'decodes integers wider than 64 bits' do
+      wide = [query_entry(0, select_query),
+              request_entry(0, prepared: true, offset_us: 0, latency_us: 0,
+                               params: ["\x03".b + zigzag(2**80 + 7), "\x03".b + zigzag(-(2**70))])]
+      wide_file = write_log(wide)
+
+      expect(described_class.new(wide_file.path).first.params).to eq([2**80 + 7, -(2**70)])
+    ensure
+      wide_file&.close!
+    end
+
+    it 'exposes the recording start time' do
+      log.to_a
+      expect(log.started_at.to_i).to eq(1_700_000_000)
+    end
+  end
+
+  describe 'format validation' do
+    it 'rejects files without the traffic log header' do
+      bad = Tempfile.new('not-a-log')
+      bad.write('nope')
+      bad.flush
+
+      expect { described_class.new(bad.path).to_a }.to raise_error(described_class::FormatError)
+    ensure
+      bad.close!
+    end
+
+    it 'rejects truncated logs' do
+      truncated = write_log([query_entry(0, select_query), request_entry(0, prepared: true, offset_us: 1, latency_us: 1)[0..3]])
+
+      expect { described_class.new(truncated.path).to_a }.to raise_error(described_class::FormatError)
+    ensure
+      truncated.close!
+    end
+  end
+
+  describe CassandraCpp::TrafficReplay do
+    let(:request_class) { CassandraCpp::TrafficLog::Request }
+
+    def request(query, latency_us, status: 0)
+      request_class.new(query: query, prepared: true, offset_us: 0, latency_us: latency_us,
+                        consistency: nil, status: status, params: [])
+    end
+
+    it 'compares recorded and replayed latencies per query' do
+      recorded = [request('q1', 1_000), request('q1', 3_000), request('q2', 10_000, status: 5)]
+      replayed = [request('q1', 2_000), request('q1', 4_000)]
+
+      report = described_class.compare(recorded, replayed)
+
+      expect(report[:overall][:recorded_count]).to eq(3)
+      expect(report[:overall][:replayed_count]).to eq(2)
+      expect(report[:overall][:recorded_errors]).to eq(1)
+      expect(report[:queries]['q1'][:recorded_p50_ms]).to eq(3.0)
+      expect(report[:queries]['q1'][:replayed_p50_ms]).to eq(4.0)
+      expect(report[:queries]['q1'][:delta_p50_ms]).to eq(1.0)
+      expect(report[:queries]['q2'][:replayed_count]).to eq(0)
+    end
+
+    it 'validates the replay speed' do
+      expect {
+        described_class.new(double('Session'), file.path, speed: 0)
+      }.to raise_error(ArgumentError, /speed/)
+    end
+  end
+end